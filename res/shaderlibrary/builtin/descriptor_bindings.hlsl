@@ -11,6 +11,8 @@
 #define BIND_TRANSFORM 0
 #define BIND_LIGHTS 1
 #define BIND_PARTICLES 2
+// StructuredBuffer<uint> draw_instances: entity index per instance of an instanced draw
+#define BIND_DRAW_INSTANCES 3
 #endif
 
 #if defined(MATERIAL_SET)   //binding indices for material set
@@ -4,6 +4,45 @@
 #include "transform.hlsl"
 #include "push_constant.hlsl"
 
+#ifdef QUANTIZED_VERTEX
+// MeshVertexFormat::Quantized (mesh_buffer_allocator.h), 20 bytes per vertex.
+struct VSInput
+{
+// x | y << 16, z: UNORM16 fractions of the mesh's quantization box, which the model matrix maps to object space.
+[[vk::location(0)]] uint2 Pos : POSITION0;
+// Octahedral normal, two SNORM16s.
+[[vk::location(1)]] uint Normal : NORMAL0;
+// Two halfs.
+[[vk::location(2)]] uint UV : TEXCOORD0;
+// RGBA UNORM8.
+[[vk::location(3)]] uint Color : COLOR0;
+};
+
+float3 DecodePosition(uint2 packed)
+{
+	return float3(packed.x & 0xffff, packed.x >> 16, packed.y & 0xffff) / 65535.0;
+}
+
+float3 DecodeNormal(uint packed)
+{
+	float2 e = max(float2(asint(uint2(packed << 16, packed)) >> 16) / 32767.0, -1.0);
+	float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+float2 DecodeUV(uint packed)
+{
+	return f16tof32(uint2(packed & 0xffff, packed >> 16));
+}
+
+float4 DecodeColor(uint packed)
+{
+	return float4(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff, packed >> 24) / 255.0;
+}
+#else
 struct VSInput
 {
 [[vk::location(0)]] float3 Pos : POSITION0;
@@ -12,6 +51,12 @@ struct VSInput
 [[vk::location(3)]] float4 Color : COLOR0;
 };
 
+float3 DecodePosition(float3 pos) { return pos; }
+float3 DecodeNormal(float3 normal) { return normal; }
+float2 DecodeUV(float2 uv) { return uv; }
+float4 DecodeColor(float4 color) { return color; }
+#endif
+
 [[vk::push_constant]]
 PushConstants pushConstants;
 
@@ -26,18 +71,18 @@ struct VSOutput
 [[vk::location(5)]] float3 WorldPos : TEXCOORD3;
 };
 
-VSOutput main(VSInput input)
+VSOutput main(VSInput input, uint instanceIndex : SV_InstanceID)
 {
 	VSOutput output = (VSOutput)0;
-    Transform transform = LoadTransform(pushConstants.transform_index);
-	float4 worldPos = mul(transform.modelMatrix, float4(input.Pos, 1.0));
+    Transform transform = LoadTransform(DrawTransformIndex(pushConstants.transform_index, instanceIndex));
+	float4 worldPos = mul(transform.modelMatrix, float4(DecodePosition(input.Pos), 1.0));
 	float4 viewPos = mul(viewMatrix, worldPos);
 	output.Pos = mul(projectionMatrix, viewPos);
 
 	float3x3 normalMatrix = transpose((float3x3)transform.modelMatrixInverse);
-	output.Normal = normalize(mul(normalMatrix, input.Normal));
-	output.Color = input.Color.rgb;
-	output.UV = input.UV;
+	output.Normal = normalize(mul(normalMatrix, DecodeNormal(input.Normal)));
+	output.Color = DecodeColor(input.Color).rgb;
+	output.UV = DecodeUV(input.UV);
 	output.LightVec = -sunDirection.xyz;
 	output.ViewVec = cameraPos.xyz - worldPos.xyz;
 	output.WorldPos = worldPos.xyz;
@@ -7,3 +7,4 @@ struct PushConstants
     uint transform_index;
     uint material_index;
 };
+
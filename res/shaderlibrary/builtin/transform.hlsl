@@ -6,9 +6,20 @@ struct Transform
     float4x4 modelMatrixInverse;
 };
 
-[[vk::binding(0, SCENE_SET)]] StructuredBuffer<Transform> transforms : register(t0);
+[[vk::binding(BIND_TRANSFORM, SCENE_SET)]] StructuredBuffer<Transform> transforms : register(t0);
+[[vk::binding(BIND_DRAW_INSTANCES, SCENE_SET)]] StructuredBuffer<uint> draw_instances : register(t3);
+
+// Pushed as transform_index by instanced draws; the entity index then comes from
+// draw_instances. SV_InstanceID maps to gl_InstanceIndex, which includes first_instance,
+// so it addresses the draw's range of the buffer directly.
+#define INSTANCED_TRANSFORM_INDEX 0xffffffff
 
 Transform LoadTransform(uint transformIndex)
 {
     return transforms[transformIndex];
 }
+
+uint DrawTransformIndex(uint pushedTransformIndex, uint instanceIndex)
+{
+    return pushedTransformIndex != INSTANCED_TRANSFORM_INDEX ? pushedTransformIndex : draw_instances[instanceIndex];
+}
@@ -0,0 +1,18 @@
+// Samples the rendered corner of a dynamic-resolution target (see upscale.vert).
+
+[[vk::binding(0, 1)]]Texture2D albedo : register(t1);
+[[vk::binding(1, 1)]]SamplerState sampler_albedo : register(s1);
+
+struct VSOutput
+{
+[[vk::location(0)]] float2 UV : TEXCOORD0;
+[[vk::location(1)]] nointerpolation float2 UVMax : TEXCOORD1;
+};
+
+float4 main(VSOutput input) : SV_TARGET
+{
+	// Bilinear taps past the extent would blend in texels of an older, larger frame.
+	float4 color = albedo.Sample(sampler_albedo, min(input.UV, input.UVMax));
+
+	return float4(color.rgb, 1.0);
+}
@@ -0,0 +1,34 @@
+// Fullscreen upscale of a dynamic-resolution target: the quad mesh is drawn as-is in clip
+// space and UVs are scaled to the rendered corner of the target.
+
+struct VSInput
+{
+[[vk::location(0)]] float3 Pos : POSITION0;
+[[vk::location(1)]] float2 UV : TEXCOORD0;
+[[vk::location(2)]] float4 Color : COLOR0;
+};
+
+struct PushConstants
+{
+    // xy: rendered extent / target size, zw: UV clamp half a texel inside the extent.
+    float4 uvTransform;
+};
+
+[[vk::push_constant]]
+PushConstants pushConstants;
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+	[[vk::location(0)]] float2 UV : TEXCOORD0;
+	[[vk::location(1)]] nointerpolation float2 UVMax : TEXCOORD1;
+};
+
+VSOutput main(VSInput input)
+{
+	VSOutput output = (VSOutput)0;
+	output.Pos = float4(input.Pos.xy, 0.0, 1.0);
+	output.UV = (input.Pos.xy * 0.5 + 0.5) * pushConstants.uvTransform.xy;
+	output.UVMax = pushConstants.uvTransform.zw;
+	return output;
+}
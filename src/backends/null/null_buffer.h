@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "rhi/resources/buffer.h"
+
+namespace ocarina {
+
+/// Buffer in host memory. Mapping returns the storage itself, and copies recorded with
+/// NullCommandBuffer::copy_buffer() run on submission, so CPU readbacks see the same
+/// bytes a GPU would have.
+class NullBuffer : public Buffer {
+public:
+    NullBuffer(Device::Impl *device, size_t size_in_byte)
+        : Buffer(device, 0, size_in_byte), storage_(size_in_byte) {}
+    ~NullBuffer() override = default;
+
+    [[nodiscard]] std::byte *data() noexcept { return storage_.data(); }
+    [[nodiscard]] const std::byte *data() const noexcept { return storage_.data(); }
+
+protected:
+    void map() noexcept override { mapped_ = storage_.data(); }
+    void unmap() noexcept override { mapped_ = nullptr; }
+
+private:
+    std::vector<std::byte> storage_;
+};
+
+}// namespace ocarina
@@ -0,0 +1,141 @@
+#include "null_command_buffer.h"
+#include "null_device.h"
+
+namespace ocarina {
+
+void NullCommandBuffer::begin() {
+    stats_ = {};
+    buffer_copies_.clear();
+    if (secondary_) {
+        stats_.secondary_command_buffers = 1;
+    } else {
+        stats_.command_buffers = 1;
+    }
+}
+
+void NullCommandBuffer::begin_render_pass(RHIRenderPass *render_pass, RenderPassContents contents) {
+    (void)render_pass;
+    (void)contents;
+    ++stats_.render_passes;
+}
+
+void NullCommandBuffer::bind_pipeline(const RHIPipeline *pipeline) {
+    (void)pipeline;
+    ++stats_.pipeline_binds;
+}
+
+void NullCommandBuffer::bind_descriptor_sets(DescriptorSet **descriptor_sets, uint32_t first_set, uint32_t descriptor_set_count, handle_ty pipeline_layout) {
+    (void)descriptor_sets;
+    (void)first_set;
+    (void)pipeline_layout;
+    stats_.descriptor_set_binds += descriptor_set_count;
+}
+
+void NullCommandBuffer::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) {
+    (void)first_index;
+    (void)vertex_offset;
+    (void)first_instance;
+    ++stats_.draws;
+    stats_.drawn_indices += static_cast<uint64_t>(index_count) * instance_count;
+}
+
+void NullCommandBuffer::push_constants(const void *data, uint32_t offset, uint32_t size) {
+    (void)data;
+    (void)offset;
+    ++stats_.push_constant_updates;
+    stats_.push_constant_bytes += size;
+}
+
+void NullCommandBuffer::draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) {
+    (void)indirect_buffer;
+    (void)offset;
+    (void)draw_count;
+    (void)stride;
+    ++stats_.indirect_draws;
+}
+
+void NullCommandBuffer::draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) {
+    (void)indirect_buffer;
+    (void)offset;
+    (void)draw_count;
+    (void)stride;
+    ++stats_.indirect_draws;
+}
+
+void NullCommandBuffer::draw_indexed_indirect_count(
+    handle_ty indirect_buffer,
+    size_t offset,
+    handle_ty count_buffer,
+    size_t count_offset,
+    uint32_t max_draw_count,
+    uint32_t stride) {
+    (void)indirect_buffer;
+    (void)offset;
+    (void)count_buffer;
+    (void)count_offset;
+    (void)max_draw_count;
+    (void)stride;
+    ++stats_.indirect_draws;
+}
+
+void NullCommandBuffer::set_vertex_buffer(VertexBuffer *vertex_buffer, uint32_t base_vertex) {
+    (void)vertex_buffer;
+    (void)base_vertex;
+    ++stats_.vertex_buffer_binds;
+}
+
+void NullCommandBuffer::set_index_buffer(IndexBuffer *index_buffer, uint32_t first_index) {
+    (void)index_buffer;
+    (void)first_index;
+    ++stats_.index_buffer_binds;
+}
+
+void NullCommandBuffer::copy_buffer(
+    handle_ty src,
+    handle_ty dst,
+    size_t src_offset,
+    size_t dst_offset,
+    size_t size_in_byte) {
+    ++stats_.buffer_copies;
+    stats_.buffer_copy_bytes += size_in_byte;
+    buffer_copies_.push_back(BufferCopy{src, dst, src_offset, dst_offset, size_in_byte});
+}
+
+void NullCommandBuffer::transition_texture_layout(
+    handle_ty texture,
+    TextureLayout old_layout,
+    TextureLayout new_layout) {
+    (void)texture;
+    (void)old_layout;
+    (void)new_layout;
+    ++stats_.texture_transitions;
+}
+
+void NullCommandBuffer::copy_buffer_to_texture(
+    handle_ty src_buffer,
+    handle_ty dst_texture,
+    const BufferTextureCopy *regions,
+    uint32_t region_count) {
+    (void)src_buffer;
+    (void)dst_texture;
+    (void)regions;
+    stats_.texture_copies += region_count;
+}
+
+void NullCommandBuffer::execute_secondary_command_buffers(const CommandBuffer *secondaries, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        const auto *secondary = static_cast<const NullCommandBuffer *>(secondaries[i].impl());
+        if (secondary == nullptr) {
+            continue;
+        }
+        stats_ += secondary->stats();
+        buffer_copies_.insert(buffer_copies_.end(), secondary->buffer_copies().begin(), secondary->buffer_copies().end());
+    }
+}
+
+void NullCommandBuffer::submit_to_queue(QueueType queue_type, Fence *fence) {
+    (void)queue_type;
+    device_->submit(*this, fence);
+}
+
+}// namespace ocarina
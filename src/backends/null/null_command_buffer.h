@@ -0,0 +1,74 @@
+#pragma once
+
+#include "core/stl.h"
+#include "rhi/command_buffer.h"
+
+namespace ocarina {
+
+class NullDevice;
+
+/// Records nothing but counts: every command adds to stats(), and buffer copies are kept
+/// so the device can carry them out when the buffer is submitted.
+class NullCommandBuffer : public CommandBuffer::Impl {
+public:
+    struct BufferCopy {
+        handle_ty src = 0;
+        handle_ty dst = 0;
+        size_t src_offset = 0;
+        size_t dst_offset = 0;
+        size_t size_in_byte = 0;
+    };
+
+    NullCommandBuffer(NullDevice *device, bool secondary) : device_(device), secondary_(secondary) {}
+
+    void begin_render_pass(RHIRenderPass *render_pass, RenderPassContents contents) override;
+    void end_render_pass() override {}
+    void bind_pipeline(const RHIPipeline *pipeline) override;
+    void bind_descriptor_sets(DescriptorSet **descriptor_sets, uint32_t first_set, uint32_t descriptor_set_count, handle_ty pipeline_layout) override;
+    void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) override;
+    void push_constants(const void *data, uint32_t offset, uint32_t size) override;
+    void draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) override;
+    void draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) override;
+    void draw_indexed_indirect_count(
+        handle_ty indirect_buffer,
+        size_t offset,
+        handle_ty count_buffer,
+        size_t count_offset,
+        uint32_t max_draw_count,
+        uint32_t stride) override;
+    void set_vertex_buffer(VertexBuffer *vertex_buffer, uint32_t base_vertex) override;
+    void set_index_buffer(IndexBuffer *index_buffer, uint32_t first_index) override;
+    void copy_buffer(
+        handle_ty src,
+        handle_ty dst,
+        size_t src_offset,
+        size_t dst_offset,
+        size_t size_in_byte) override;
+    void transition_texture_layout(
+        handle_ty texture,
+        TextureLayout old_layout,
+        TextureLayout new_layout) override;
+    void copy_buffer_to_texture(
+        handle_ty src_buffer,
+        handle_ty dst_texture,
+        const BufferTextureCopy *regions,
+        uint32_t region_count) override;
+    void submit_to_queue(QueueType queue_type, Fence *fence) override;
+    void begin() override;
+    void end() override {}
+    void set_viewport(float x, float y, float width, float height, float min_depth, float max_depth) override {}
+    void set_scissor(int32_t x, int32_t y, uint32_t width, uint32_t height) override {}
+    void execute_secondary_command_buffers(const CommandBuffer *secondaries, uint32_t count) override;
+
+    [[nodiscard]] bool is_secondary() const noexcept { return secondary_; }
+    [[nodiscard]] const CommandStats &stats() const noexcept { return stats_; }
+    [[nodiscard]] const std::vector<BufferCopy> &buffer_copies() const noexcept { return buffer_copies_; }
+
+private:
+    NullDevice *device_ = nullptr;
+    bool secondary_ = false;
+    CommandStats stats_;
+    std::vector<BufferCopy> buffer_copies_;
+};
+
+}// namespace ocarina
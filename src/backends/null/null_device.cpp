@@ -0,0 +1,338 @@
+#include "null_device.h"
+#include "null_buffer.h"
+#include "null_fence.h"
+#include "null_render_pass.h"
+#include "null_shader.h"
+#include "null_texture.h"
+#include "rhi/context.h"
+#include "rhi/index_buffer.h"
+#include "rhi/vertex_buffer.h"
+#include "core/logging.h"
+
+namespace ocarina {
+
+namespace {
+
+/// Swapchain size when the creation info has no window: the default sample window size.
+constexpr uint2 kDefaultSwapchainExtent = {1280u, 720u};
+
+/// Timeline semaphores are one counter each; the Semaphore handle points at it.
+struct NullTimelineSemaphore {
+    std::atomic<uint64_t> value{0};
+};
+
+[[nodiscard]] NullTimelineSemaphore *timeline_of(const Semaphore &semaphore) noexcept {
+    if (!semaphore.is_timeline || semaphore.semaphore == 0 || semaphore.semaphore == InvalidUI64) {
+        return nullptr;
+    }
+    return reinterpret_cast<NullTimelineSemaphore *>(semaphore.semaphore);
+}
+
+}// namespace
+
+NullDevice::NullDevice(RHIContext *context, const InstanceCreation &instance_creation)
+    : Device::Impl(context, instance_creation) {
+    swapchain_extent_ = instance_creation.windowWidth > 0 && instance_creation.windowHeight > 0
+                            ? uint2(instance_creation.windowWidth, instance_creation.windowHeight)
+                            : kDefaultSwapchainExtent;
+    OC_INFO_FORMAT("null device created, swapchain {}x{}", swapchain_extent_.x, swapchain_extent_.y);
+}
+
+NullDevice::~NullDevice() = default;
+
+handle_ty NullDevice::create_buffer(size_t size, const string &desc, bool exported) noexcept {
+    (void)desc;
+    (void)exported;
+    if (size == 0) {
+        return 0;
+    }
+    return reinterpret_cast<handle_ty>(ocarina::new_with_allocator<NullBuffer>(this, size));
+}
+
+handle_ty NullDevice::create_gpu_buffer(size_t size_in_byte, GraphicBufferBindFlags bind_flags) noexcept {
+    (void)bind_flags;
+    return create_buffer(size_in_byte, "", false);
+}
+
+void NullDevice::destroy_buffer(handle_ty handle) noexcept {
+    NullBuffer *buffer = reinterpret_cast<NullBuffer *>(handle);
+    if (buffer) {
+        ocarina::delete_with_allocator<NullBuffer>(buffer);
+    }
+}
+
+handle_ty NullDevice::create_texture(uint3 res, PixelStorage pixel_storage,
+                                     uint level_num,
+                                     const string &desc) noexcept {
+    (void)desc;
+    return reinterpret_cast<handle_ty>(ocarina::new_with_allocator<NullTexture>(
+        res, pixel_storage, level_num, TextureSampler{}, TextureUsageFlags::ShaderReadOnly, false));
+}
+
+handle_ty NullDevice::create_texture(
+    Image *image,
+    const TextureViewCreation &texture_view,
+    const TextureSampler &sampler) noexcept {
+    // The image's size is not needed: image textures are only ever sampled.
+    (void)image;
+    return reinterpret_cast<handle_ty>(ocarina::new_with_allocator<NullTexture>(
+        uint3(0u), texture_view.format, texture_view.mip_level_count, sampler, texture_view.usage, false));
+}
+
+handle_ty NullDevice::create_texture(
+    uint32_t width,
+    uint32_t height,
+    uint32_t depth,
+    PixelStorage pixel_storage,
+    const TextureViewCreation &texture_view,
+    const TextureSampler &sampler,
+    uint4 default_color,
+    const void *data) noexcept {
+    (void)default_color;
+    (void)data;
+    return reinterpret_cast<handle_ty>(ocarina::new_with_allocator<NullTexture>(
+        uint3(width, height, depth), pixel_storage, texture_view.mip_level_count, sampler, texture_view.usage, false));
+}
+
+handle_ty NullDevice::create_render_target_texture(uint32_t width, uint32_t height, PixelStorage pixel_storage,
+                                                   TextureUsageFlags usage) noexcept {
+    return reinterpret_cast<handle_ty>(ocarina::new_with_allocator<NullTexture>(
+        uint3(width, height, 1u), pixel_storage, 1u, TextureSampler{}, usage, true));
+}
+
+void NullDevice::destroy_texture(handle_ty handle) noexcept {
+    ocarina::delete_with_allocator(reinterpret_cast<NullTexture *>(handle));
+}
+
+handle_ty NullDevice::create_shader_from_file(const std::string &file_name, ShaderType shader_type, const std::set<string> &options) noexcept {
+    string key = file_name + "#" + std::to_string(static_cast<int>(shader_type));
+    for (const string &option : options) {
+        key += "#" + option;
+    }
+    std::lock_guard<std::mutex> lock(shader_mutex_);
+    auto [it, inserted] = shaders_.try_emplace(key);
+    if (inserted) {
+        it->second = std::make_unique<NullShader>(file_name, shader_type);
+    }
+    return reinterpret_cast<handle_ty>(it->second.get());
+}
+
+void NullDevice::destroy_shader(handle_ty handle) noexcept {
+    // Shaders are shared and live as long as the device.
+    (void)handle;
+}
+
+VertexBuffer *NullDevice::create_vertex_buffer() noexcept {
+    return ocarina::new_with_allocator<VertexBuffer>(this);
+}
+
+IndexBuffer *NullDevice::create_index_buffer(const void *initial_data, uint32_t indices_count, bool bit16) noexcept {
+    return ocarina::new_with_allocator<IndexBuffer>(this, initial_data, indices_count, bit16);
+}
+
+bool NullDevice::begin_frame() noexcept {
+    // The slot's previous frame finished on submission, so its secondaries can be recycled.
+    const uint32_t slot = frame_slot();
+    std::lock_guard<std::mutex> lock(secondary_command_pools_mutex_);
+    for (auto &thread_pools : secondary_command_pools_) {
+        (*thread_pools)[slot].used = 0;
+    }
+    return true;
+}
+
+void NullDevice::end_frame() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        last_frame_stats_ = frame_stats_;
+        frame_stats_ = {};
+    }
+    frame_count_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+RHIRenderPass *NullDevice::create_render_pass(const RenderPassCreation &render_pass_creation) noexcept {
+    return ocarina::new_with_allocator<NullRenderPass>(render_pass_creation, swapchain_extent_);
+}
+
+void NullDevice::destroy_render_pass(RHIRenderPass *render_pass) noexcept {
+    ocarina::delete_with_allocator(static_cast<NullRenderPass *>(render_pass));
+}
+
+std::array<DescriptorSetLayout *, MAX_DESCRIPTOR_SETS_PER_SHADER> NullDevice::create_descriptor_set_layout(void **shaders, uint32_t shaders_count) noexcept {
+    (void)shaders;
+    (void)shaders_count;
+    return {};
+}
+
+bool NullDevice::build_pipeline_layout_desc(const handle_ty shaders[PipelineState::MAX_SHADER_STAGE], PipelineLayoutDesc &out_desc) noexcept {
+    out_desc = {};
+    for (uint32_t i = 0; i < PipelineState::MAX_SHADER_STAGE; ++i) {
+        out_desc.shaders[i] = shaders[i];
+    }
+    return true;
+}
+
+RHIPipelineLayout *NullDevice::create_pipeline_layout(const PipelineLayoutDesc &desc) noexcept {
+    (void)desc;
+    auto *layout = ocarina::new_with_allocator<RHIPipelineLayout>();
+    layout->handle = reinterpret_cast<handle_ty>(layout);
+    return layout;
+}
+
+void NullDevice::destroy_pipeline_layout(RHIPipelineLayout *layout) noexcept {
+    ocarina::delete_with_allocator(layout);
+}
+
+void NullDevice::bind_pipeline(const CommandBuffer &cmd_buffer, const handle_ty pipeline) noexcept {
+    if (cmd_buffer.valid()) {
+        cmd_buffer.impl()->bind_pipeline(reinterpret_cast<const RHIPipeline *>(pipeline));
+    }
+}
+
+RHIPipeline *NullDevice::create_pipeline(const PipelineState &pipeline_state, RHIRenderPass *render_pass, RHIPipelineLayout *pipeline_layout) noexcept {
+    (void)pipeline_state;
+    (void)render_pass;
+    auto *pipeline = ocarina::new_with_allocator<RHIPipeline>();
+    if (pipeline_layout) {
+        pipeline->pipeline_layout = pipeline_layout->handle;
+        pipeline->push_constant_size = pipeline_layout->push_constant_size;
+        pipeline->push_constant_variables_ = pipeline_layout->push_constant_variables_;
+    }
+    return pipeline;
+}
+
+void NullDevice::destroy_pipeline(RHIPipeline *pipeline) noexcept {
+    ocarina::delete_with_allocator(pipeline);
+}
+
+CommandBuffer NullDevice::get_command_buffer() noexcept {
+    NullCommandBuffer *null_cmd_buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(command_buffer_mutex_);
+        if (free_command_buffers_.empty()) {
+            command_buffers_.push_back(std::make_unique<NullCommandBuffer>(this, false));
+            null_cmd_buffer = command_buffers_.back().get();
+        } else {
+            null_cmd_buffer = free_command_buffers_.back();
+            free_command_buffers_.pop_back();
+        }
+    }
+    CommandBuffer cmd_buffer(null_cmd_buffer);
+    cmd_buffer.command_buffer = reinterpret_cast<handle_ty>(null_cmd_buffer);
+    return cmd_buffer;
+}
+
+void NullDevice::release_command_buffer(const CommandBuffer &cmd_buffer) noexcept {
+    if (!cmd_buffer.valid()) {
+        return;
+    }
+    cmd_buffer.reset();
+    std::lock_guard<std::mutex> lock(command_buffer_mutex_);
+    free_command_buffers_.push_back(static_cast<NullCommandBuffer *>(cmd_buffer.impl()));
+}
+
+CommandBuffer NullDevice::get_secondary_command_buffer(RHIRenderPass *render_pass, uint32_t thread_index) noexcept {
+    (void)render_pass;
+    SecondaryCommandPool *secondary_pool = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(secondary_command_pools_mutex_);
+        while (secondary_command_pools_.size() <= thread_index) {
+            secondary_command_pools_.emplace_back(std::make_unique<ThreadSecondaryCommandPools>());
+        }
+        secondary_pool = &(*secondary_command_pools_[thread_index])[frame_slot()];
+    }
+
+    // Only thread_index takes buffers from this pool, so no lock is needed from here on.
+    if (secondary_pool->used == secondary_pool->command_buffers.size()) {
+        secondary_pool->command_buffers.push_back(std::make_unique<NullCommandBuffer>(this, true));
+    }
+    NullCommandBuffer *secondary = secondary_pool->command_buffers[secondary_pool->used++].get();
+    secondary->begin();
+    CommandBuffer cmd_buffer(secondary);
+    cmd_buffer.command_buffer = reinterpret_cast<handle_ty>(secondary);
+    return cmd_buffer;
+}
+
+void NullDevice::execute_command_buffers(CommandBuffer *command_buffers, uint32_t count) noexcept {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (command_buffers[i].valid()) {
+            submit(*static_cast<NullCommandBuffer *>(command_buffers[i].impl()), nullptr);
+        }
+    }
+}
+
+Fence NullDevice::create_fence() noexcept {
+    Fence::UniqueImplPtr impl(ocarina::new_with_allocator<ocarina::NullFence>());
+    return Fence(std::move(impl));
+}
+
+Semaphore NullDevice::create_timeline_semaphore(uint64_t initial_value) noexcept {
+    auto *timeline = ocarina::new_with_allocator<NullTimelineSemaphore>();
+    timeline->value.store(initial_value, std::memory_order_release);
+    Semaphore semaphore{};
+    semaphore.is_timeline = true;
+    semaphore.timeline_value = initial_value;
+    semaphore.semaphore = reinterpret_cast<handle_ty>(timeline);
+    return semaphore;
+}
+
+uint64_t NullDevice::query_timeline_semaphore_value(const Semaphore &semaphore) const noexcept {
+    const NullTimelineSemaphore *timeline = timeline_of(semaphore);
+    return timeline ? timeline->value.load(std::memory_order_acquire) : 0;
+}
+
+void NullDevice::destroy_semaphore(Semaphore &semaphore) noexcept {
+    if (NullTimelineSemaphore *timeline = timeline_of(semaphore)) {
+        ocarina::delete_with_allocator(timeline);
+    }
+    semaphore.semaphore = InvalidUI64;
+    semaphore.timeline_value = 0;
+    semaphore.is_timeline = false;
+}
+
+CommandStats NullDevice::last_frame_command_stats() const noexcept {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return last_frame_stats_;
+}
+
+void NullDevice::submit(NullCommandBuffer &cmd_buffer, Fence *fence) noexcept {
+    for (const NullCommandBuffer::BufferCopy &copy : cmd_buffer.buffer_copies()) {
+        auto *src = reinterpret_cast<NullBuffer *>(copy.src);
+        auto *dst = reinterpret_cast<NullBuffer *>(copy.dst);
+        if (src == nullptr || dst == nullptr ||
+            copy.src_offset + copy.size_in_byte > src->size_in_byte() ||
+            copy.dst_offset + copy.size_in_byte > dst->size_in_byte()) {
+            OC_WARNING("null device: buffer copy out of range");
+            continue;
+        }
+        std::memmove(dst->data() + copy.dst_offset, src->data() + copy.src_offset, copy.size_in_byte);
+    }
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        frame_stats_ += cmd_buffer.stats();
+    }
+    for (const Semaphore &semaphore : cmd_buffer.signal_semaphores) {
+        if (NullTimelineSemaphore *timeline = timeline_of(semaphore)) {
+            uint64_t value = timeline->value.load(std::memory_order_acquire);
+            while (value < semaphore.timeline_value &&
+                   !timeline->value.compare_exchange_weak(value, semaphore.timeline_value, std::memory_order_acq_rel)) {
+            }
+        }
+    }
+    cmd_buffer.wait_semaphores.clear();
+    cmd_buffer.signal_semaphores.clear();
+    if (fence) {
+        if (auto *null_fence = reinterpret_cast<NullFence *>(fence->native_handle())) {
+            null_fence->signal();
+        }
+    }
+}
+
+}// namespace ocarina
+
+OC_EXPORT_API ocarina::NullDevice *create_device(ocarina::RHIContext *context, const ocarina::InstanceCreation &instance_creation) {
+    return ocarina::new_with_allocator<ocarina::NullDevice>(context, instance_creation);
+}
+
+OC_EXPORT_API void destroy(ocarina::NullDevice *device) {
+    ocarina::delete_with_allocator(device);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "rhi/device.h"
+#include "rhi/shader_base.h"
+#include "null_command_buffer.h"
+
+namespace ocarina {
+
+/// Frame slots whose secondary command buffers are kept alive, as in the Vulkan backend.
+static constexpr uint32_t kNullFramesInFlight = 3;
+
+/// Device that runs the whole engine without a GPU or a window. Buffers live in host
+/// memory and buffer copies are carried out on submission; textures, shaders and pipelines
+/// are descriptions only, and every submission completes before it returns. Each frame's
+/// commands are counted, so the CPU side of the frame loop (culling, sorting, recording,
+/// uploads) can be measured on its own.
+class NullDevice : public Device::Impl {
+public:
+    NullDevice(RHIContext *context, const InstanceCreation &instance_creation);
+    ~NullDevice();
+
+    [[nodiscard]] handle_ty create_buffer(size_t size, const string &desc, bool exported) noexcept override;
+    [[nodiscard]] handle_ty create_gpu_buffer(
+        size_t size_in_byte,
+        GraphicBufferBindFlags bind_flags) noexcept override;
+    void destroy_buffer(handle_ty handle) noexcept override;
+    [[nodiscard]] handle_ty create_texture(uint3 res, PixelStorage pixel_storage,
+                                           uint level_num,
+                                           const string &desc) noexcept override;
+    [[nodiscard]] handle_ty create_texture(
+        Image *image,
+        const TextureViewCreation &texture_view,
+        const TextureSampler &sampler) noexcept override;
+    [[nodiscard]] handle_ty create_texture(
+        uint32_t width,
+        uint32_t height,
+        uint32_t depth,
+        PixelStorage pixel_storage,
+        const TextureViewCreation &texture_view,
+        const TextureSampler &sampler,
+        uint4 default_color,
+        const void *data) noexcept override;
+    [[nodiscard]] handle_ty create_render_target_texture(uint32_t width, uint32_t height, PixelStorage pixel_storage,
+                                                         TextureUsageFlags usage) noexcept override;
+    void destroy_texture(handle_ty handle) noexcept override;
+    [[nodiscard]] handle_ty create_shader_from_file(const std::string &file_name, ShaderType shader_type, const std::set<string> &options) noexcept override;
+    void destroy_shader(handle_ty handle) noexcept override;
+    VertexBuffer *create_vertex_buffer() noexcept override;
+    IndexBuffer *create_index_buffer(const void *initial_data, uint32_t indices_count, bool bit16) noexcept override;
+    bool begin_frame() noexcept override;
+    void end_frame() noexcept override;
+    RHIRenderPass *create_render_pass(const RenderPassCreation &render_pass_creation) noexcept override;
+    void destroy_render_pass(RHIRenderPass *render_pass) noexcept override;
+    std::array<DescriptorSetLayout *, MAX_DESCRIPTOR_SETS_PER_SHADER> create_descriptor_set_layout(void **shaders, uint32_t shaders_count) noexcept override;
+    bool build_pipeline_layout_desc(const handle_ty shaders[PipelineState::MAX_SHADER_STAGE], PipelineLayoutDesc &out_desc) noexcept override;
+    RHIPipelineLayout *create_pipeline_layout(const PipelineLayoutDesc &desc) noexcept override;
+    void destroy_pipeline_layout(RHIPipelineLayout *layout) noexcept override;
+    void bind_pipeline(const CommandBuffer &cmd_buffer, const handle_ty pipeline) noexcept override;
+    RHIPipeline *create_pipeline(const PipelineState &pipeline_state, RHIRenderPass *render_pass, RHIPipelineLayout *pipeline_layout) noexcept override;
+    void destroy_pipeline(RHIPipeline *pipeline) noexcept override;
+    CommandBuffer get_command_buffer() noexcept override;
+    void release_command_buffer(const CommandBuffer &cmd_buffer) noexcept override;
+    CommandBuffer get_secondary_command_buffer(RHIRenderPass *render_pass, uint32_t thread_index) noexcept override;
+    void execute_command_buffers(CommandBuffer *command_buffers, uint32_t count) noexcept override;
+    Semaphore get_present_complete_semaphore() noexcept override { return {}; }
+    Semaphore get_render_complete_semaphore() noexcept override { return {}; }
+    Fence create_fence() noexcept override;
+    Semaphore create_timeline_semaphore(uint64_t initial_value = 0) noexcept override;
+    [[nodiscard]] uint64_t query_timeline_semaphore_value(const Semaphore &semaphore) const noexcept override;
+    void destroy_semaphore(Semaphore &semaphore) noexcept override;
+    [[nodiscard]] bool supports_multi_draw_indirect() const noexcept override { return true; }
+    [[nodiscard]] bool supports_indirect_first_instance() const noexcept override { return true; }
+    [[nodiscard]] bool supports_draw_indirect_count() const noexcept override { return true; }
+    [[nodiscard]] uint64_t frame_count() const noexcept override { return frame_count_.load(std::memory_order_acquire); }
+    [[nodiscard]] CommandStats last_frame_command_stats() const noexcept override;
+
+    /// Carries out @p cmd_buffer: runs its buffer copies, adds its stats to the current
+    /// frame, then signals its timeline semaphores and @p fence.
+    void submit(NullCommandBuffer &cmd_buffer, Fence *fence) noexcept;
+
+private:
+    struct SecondaryCommandPool {
+        std::vector<std::unique_ptr<NullCommandBuffer>> command_buffers;
+        /// Buffers handed out since the last reset; the rest are reused in order.
+        uint32_t used = 0;
+    };
+    using ThreadSecondaryCommandPools = std::array<SecondaryCommandPool, kNullFramesInFlight>;
+
+    [[nodiscard]] uint32_t frame_slot() const noexcept {
+        return static_cast<uint32_t>(frame_count_.load(std::memory_order_acquire) % kNullFramesInFlight);
+    }
+
+    uint2 swapchain_extent_{};
+
+    std::vector<std::unique_ptr<NullCommandBuffer>> command_buffers_;
+    std::vector<NullCommandBuffer *> free_command_buffers_;
+    std::mutex command_buffer_mutex_;
+
+    std::vector<std::unique_ptr<ThreadSecondaryCommandPools>> secondary_command_pools_;
+    std::mutex secondary_command_pools_mutex_;
+
+    /// Shaders are shared by file, stage and defines, as the Vulkan shader manager does.
+    std::unordered_map<string, std::unique_ptr<RHIShader>> shaders_;
+    std::mutex shader_mutex_;
+
+    std::atomic<uint64_t> frame_count_{0};
+    CommandStats frame_stats_;
+    CommandStats last_frame_stats_;
+    mutable std::mutex stats_mutex_;
+};
+
+}// namespace ocarina
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/stl.h"
+#include "rhi/fence.h"
+
+namespace ocarina {
+
+/// Submissions finish before submit_to_queue() returns, so the device signals the fence
+/// right away and wait() never blocks. native_handle() is the NullFence itself.
+class NullFence : public Fence::Impl {
+public:
+    void reset() override { signaled_.store(false, std::memory_order_release); }
+    bool is_finished() const override { return signaled_.load(std::memory_order_acquire); }
+    handle_ty native_handle() const override { return reinterpret_cast<handle_ty>(this); }
+    void wait(uint64_t timeout_ns = std::numeric_limits<uint64_t>::max()) const override { (void)timeout_ns; }
+    void signal() noexcept { signaled_.store(true, std::memory_order_release); }
+
+private:
+    std::atomic<bool> signaled_{false};
+};
+
+}// namespace ocarina
@@ -0,0 +1,32 @@
+#include "null_render_pass.h"
+#include "rhi/resources/texture.h"
+
+namespace ocarina {
+
+NullRenderPass::NullRenderPass(const RenderPassCreation &render_pass_creation, uint2 swapchain_extent)
+    : RHIRenderPass(render_pass_creation) {
+    clear_color_ = render_pass_creation.clear_color;
+    clear_depth_ = render_pass_creation.clear_depth;
+    clear_stencil_ = render_pass_creation.clear_stencil;
+    swapchain_clear_color_ = render_pass_creation.swapchain_clear_color;
+    swapchain_clear_depth_ = render_pass_creation.swapchain_clear_depth;
+    swapchain_clear_stencil_ = render_pass_creation.swapchain_clear_stencil;
+
+    color_attachment_count_ = render_pass_creation.color_attachment_count;
+    for (uint32_t i = 0; i < color_attachment_count_; ++i) {
+        color_attachments_[i] = render_pass_creation.color_attachments[i];
+    }
+    depth_attachment_ = render_pass_creation.depth_attachment;
+
+    if (is_use_swapchain_framebuffer() && depth_attachment_ == nullptr) {
+        size_ = swapchain_extent;
+    } else {
+        const Texture *first = color_attachment_count_ > 0 ? color_attachments_[0] : depth_attachment_;
+        const uint3 res = first->impl()->resolution();
+        size_ = {res.x, res.y};
+    }
+    scissor_ = {0, 0, static_cast<int>(size_.x), static_cast<int>(size_.y)};
+    viewport_ = {0, 0, static_cast<float>(size_.x), static_cast<float>(size_.y)};
+}
+
+}// namespace ocarina
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "core/stl.h"
+#include "rhi/renderpass.h"
+
+namespace ocarina {
+
+class NullRenderPass : public RHIRenderPass {
+public:
+    /// Swapchain passes take @p swapchain_extent; offscreen passes the size of their first
+    /// color attachment, or of the depth attachment.
+    NullRenderPass(const RenderPassCreation &render_pass_creation, uint2 swapchain_extent);
+};
+
+}// namespace ocarina
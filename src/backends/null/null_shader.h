@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/stl.h"
+#include "rhi/shader_base.h"
+
+namespace ocarina {
+
+/// Shaders are not compiled: reflection finds no uniform buffers, structs, descriptor sets
+/// or push constants, so materials and pipelines end up with empty layouts.
+class NullShader : public RHIShader {
+public:
+    NullShader(string file_name, ShaderType shader_type)
+        : file_name_(std::move(file_name)), shader_type_(shader_type) {}
+
+    [[nodiscard]] const string &file_name() const noexcept { return file_name_; }
+    [[nodiscard]] ShaderType shader_type() const noexcept { return shader_type_; }
+
+private:
+    string file_name_;
+    ShaderType shader_type_;
+};
+
+}// namespace ocarina
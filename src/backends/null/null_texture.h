@@ -0,0 +1,42 @@
+#pragma once
+
+#include "core/stl.h"
+#include "rhi/resources/texture.h"
+#include "rhi/resources/texture_sampler.h"
+
+namespace ocarina {
+
+/// Texture description without pixels: render passes read its size, the rest of the
+/// engine only passes it around.
+class NullTexture : public Texture::Impl {
+public:
+    NullTexture(uint3 res, PixelStorage pixel_storage, uint32_t mip_levels, const TextureSampler &sampler,
+                TextureUsageFlags usage_flags, bool is_render_target)
+        : res_(res), pixel_storage_(pixel_storage), mip_levels_(mip_levels), texture_sampler_(sampler),
+          usage_flags_(usage_flags), is_render_target_(is_render_target) {}
+
+    [[nodiscard]] uint3 resolution() const noexcept override { return res_; }
+    [[nodiscard]] PixelStorage pixel_storage() const noexcept override { return pixel_storage_; }
+    [[nodiscard]] uint32_t mip_levels() const noexcept override { return mip_levels_; }
+    [[nodiscard]] handle_ty array_handle() const noexcept override { return reinterpret_cast<handle_ty>(this); }
+    [[nodiscard]] const handle_ty *array_handle_ptr() const noexcept override { return &handle_; }
+    [[nodiscard]] handle_ty tex_handle() const noexcept override { return reinterpret_cast<handle_ty>(this); }
+    [[nodiscard]] const TextureSampler *get_sampler_pointer() const noexcept override { return &texture_sampler_; }
+    [[nodiscard]] const void *handle_ptr() const noexcept override { return &handle_; }
+    [[nodiscard]] size_t data_size() const noexcept override { return sizeof(handle_ty); }
+    [[nodiscard]] size_t data_alignment() const noexcept override { return alignof(handle_ty); }
+    [[nodiscard]] size_t max_member_size() const noexcept override { return sizeof(handle_ty); }
+    [[nodiscard]] bool is_render_target() const noexcept override { return is_render_target_; }
+    [[nodiscard]] TextureUsageFlags usage_flags() const noexcept override { return usage_flags_; }
+
+private:
+    uint3 res_{};
+    PixelStorage pixel_storage_;
+    uint32_t mip_levels_ = 1;
+    TextureSampler texture_sampler_;
+    TextureUsageFlags usage_flags_ = TextureUsageFlags::None;
+    bool is_render_target_ = false;
+    handle_ty handle_ = reinterpret_cast<handle_ty>(this);
+};
+
+}// namespace ocarina
@@ -16,11 +16,18 @@
 
 namespace ocarina {
 
-VulkanCommandBuffer::VulkanCommandBuffer(VulkanDevice *device, VkCommandPool cmd_pool, VkCommandBuffer cmd_buffer, QueueType queue_type)
-    : device_(device), command_pool_(cmd_pool), vulkan_command_buffer_(cmd_buffer), queue_type_(queue_type) {
+VulkanCommandBuffer::VulkanCommandBuffer(VulkanDevice *device, VkCommandPool cmd_pool, VkCommandBuffer cmd_buffer, QueueType queue_type,
+                                         bool owns_command_pool)
+    : device_(device), command_pool_(cmd_pool), vulkan_command_buffer_(cmd_buffer), queue_type_(queue_type),
+      owns_command_pool_(owns_command_pool) {
 }
 
 VulkanCommandBuffer::~VulkanCommandBuffer() {
+    if (owns_command_pool_) {
+        // Destroying the pool frees the command buffer with it.
+        vkDestroyCommandPool(device_->logicalDevice(), command_pool_, nullptr);
+        return;
+    }
     // Cleanup if necessary
     if (vulkan_command_buffer_ != VK_NULL_HANDLE) {
         // Note: Command buffers are typically freed when the command pool is reset or destroyed,
@@ -29,15 +36,22 @@ VulkanCommandBuffer::~VulkanCommandBuffer() {
     }
 }
 
-void VulkanCommandBuffer::begin_render_pass(RHIRenderPass* render_pass) {
+void VulkanCommandBuffer::begin_render_pass(RHIRenderPass* render_pass, RenderPassContents contents) {
     current_render_pass_ = render_pass;
     VulkanRenderPass* vulkan_render_pass = static_cast<VulkanRenderPass*>(render_pass);
     if (render_pass->is_offscreen_renderpass()) {
-        begin_offscreen_render_pass(render_pass, vulkan_render_pass);
+        begin_offscreen_render_pass(render_pass, vulkan_render_pass, contents);
     } else {
-        begin_swapchain_render_pass(render_pass, vulkan_render_pass);
+        begin_swapchain_render_pass(render_pass, vulkan_render_pass, contents);
+    }
+
+    // Only vkCmdExecuteCommands may follow a pass begun for secondaries; they set their own.
+    if (contents == RenderPassContents::Inline) {
+        set_render_pass_viewport_and_scissor(render_pass);
     }
+}
 
+void VulkanCommandBuffer::set_render_pass_viewport_and_scissor(RHIRenderPass* render_pass) {
     float4 viewport_ = render_pass->viewport();
     VkViewport viewport = {
         .x = viewport_.x,
@@ -55,7 +69,7 @@ void VulkanCommandBuffer::begin_render_pass(RHIRenderPass* render_pass) {
     vkCmdSetScissor(vulkan_command_buffer_, 0, 1, &scissor);
 }
 
-void VulkanCommandBuffer::begin_swapchain_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass) {
+void VulkanCommandBuffer::begin_swapchain_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass, RenderPassContents contents) {
     set_pipeline_stage_flags(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
 
     if (device_->supports_dynamic_rendering()) {
@@ -102,6 +116,9 @@ void VulkanCommandBuffer::begin_swapchain_render_pass(RHIRenderPass* render_pass
 
         VkRenderingInfo rendering_info{};
         rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        if (contents == RenderPassContents::SecondaryCommandBuffers) {
+            rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        }
         rendering_info.renderArea.offset = {0, 0};
         rendering_info.renderArea.extent = {render_pass->size().x, render_pass->size().y};
         rendering_info.layerCount = 1;
@@ -124,10 +141,13 @@ void VulkanCommandBuffer::begin_swapchain_render_pass(RHIRenderPass* render_pass
     renderPassBeginInfo.clearValueCount = 2;
     renderPassBeginInfo.pClearValues = vulkan_render_pass->clear_values();
     renderPassBeginInfo.framebuffer = VulkanDriver::instance().get_frame_buffer(VulkanDriver::instance().current_buffer());
-    vkCmdBeginRenderPass(vulkan_command_buffer_, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(vulkan_command_buffer_, &renderPassBeginInfo,
+                         contents == RenderPassContents::SecondaryCommandBuffers
+                             ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                             : VK_SUBPASS_CONTENTS_INLINE);
 }
 
-void VulkanCommandBuffer::begin_offscreen_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass) {
+void VulkanCommandBuffer::begin_offscreen_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass, RenderPassContents contents) {
     use_dynamic_rendering_ = true;
     if (render_pass->color_attachment_count() > 0) {
         set_pipeline_stage_flags(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
@@ -172,8 +192,11 @@ void VulkanCommandBuffer::begin_offscreen_render_pass(RHIRenderPass* render_pass
 
     VkRenderingInfo rendering_info{};
     rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    if (contents == RenderPassContents::SecondaryCommandBuffers) {
+        rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    }
     rendering_info.renderArea.offset = {0, 0};
-    rendering_info.renderArea.extent = {render_pass->size().x, render_pass->size().y};
+    rendering_info.renderArea.extent = {render_pass->render_extent().x, render_pass->render_extent().y};
     rendering_info.layerCount = 1;
     rendering_info.colorAttachmentCount = render_pass->color_attachment_count();
     rendering_info.pColorAttachments = color_attachments;
@@ -299,10 +322,54 @@ void VulkanCommandBuffer::push_constants(const void* data, uint32_t offset, uint
     vkCmdPushConstants(vulkan_command_buffer_, current_pipeline_->pipeline_layout_, current_pipeline_->push_constant_shader_stages_, offset, size, data);
 }
 
-void VulkanCommandBuffer::draw_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride) {
+void VulkanCommandBuffer::draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) {
+    if (indirect_buffer == 0 || draw_count == 0) {
+        return;
+    }
+    const VkBuffer buffer = reinterpret_cast<VulkanBuffer*>(indirect_buffer)->buffer_handle();
+    if (draw_count == 1 || device_->supports_multi_draw_indirect()) {
+        vkCmdDrawIndirect(vulkan_command_buffer_, buffer, static_cast<VkDeviceSize>(offset), draw_count, stride);
+        return;
+    }
+    // Without multiDrawIndirect drawCount must be 0 or 1.
+    for (uint32_t i = 0; i < draw_count; ++i) {
+        vkCmdDrawIndirect(vulkan_command_buffer_, buffer, static_cast<VkDeviceSize>(offset) + VkDeviceSize{i} * stride, 1, stride);
+    }
 }
 
-void VulkanCommandBuffer::draw_indexed_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride) {
+void VulkanCommandBuffer::draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) {
+    if (indirect_buffer == 0 || draw_count == 0) {
+        return;
+    }
+    const VkBuffer buffer = reinterpret_cast<VulkanBuffer*>(indirect_buffer)->buffer_handle();
+    if (draw_count == 1 || device_->supports_multi_draw_indirect()) {
+        vkCmdDrawIndexedIndirect(vulkan_command_buffer_, buffer, static_cast<VkDeviceSize>(offset), draw_count, stride);
+        return;
+    }
+    for (uint32_t i = 0; i < draw_count; ++i) {
+        vkCmdDrawIndexedIndirect(vulkan_command_buffer_, buffer, static_cast<VkDeviceSize>(offset) + VkDeviceSize{i} * stride, 1, stride);
+    }
+}
+
+void VulkanCommandBuffer::draw_indexed_indirect_count(
+    handle_ty indirect_buffer,
+    size_t offset,
+    handle_ty count_buffer,
+    size_t count_offset,
+    uint32_t max_draw_count,
+    uint32_t stride) {
+    OC_ASSERT(device_->supports_draw_indirect_count());
+    if (indirect_buffer == 0 || count_buffer == 0 || max_draw_count == 0) {
+        return;
+    }
+    vkCmdDrawIndexedIndirectCount(
+        vulkan_command_buffer_,
+        reinterpret_cast<VulkanBuffer*>(indirect_buffer)->buffer_handle(),
+        static_cast<VkDeviceSize>(offset),
+        reinterpret_cast<VulkanBuffer*>(count_buffer)->buffer_handle(),
+        static_cast<VkDeviceSize>(count_offset),
+        max_draw_count,
+        stride);
 }
 
 void VulkanCommandBuffer::set_vertex_buffer(VertexBuffer* vertex_buffer, uint32_t base_vertex) {
@@ -383,18 +450,81 @@ void VulkanCommandBuffer::begin() {
     begin_info.pInheritanceInfo = nullptr;
     VK_CHECK_RESULT(vkBeginCommandBuffer(vulkan_command_buffer_, &begin_info));
 
+    gpu_timestamp_pair_ = InvalidUI32;
     if (record_gpu_timestamps_ && queue_type_ == QueueType::Graphics) {
-        VulkanDriver::instance().write_gpu_timestamp_begin(vulkan_command_buffer_);
+        gpu_timestamp_pair_ = VulkanDriver::instance().write_gpu_timestamp_begin(vulkan_command_buffer_);
     }
 }
 
 void VulkanCommandBuffer::end() {
-    if (record_gpu_timestamps_ && queue_type_ == QueueType::Graphics) {
-        VulkanDriver::instance().write_gpu_timestamp_end(vulkan_command_buffer_);
+    if (gpu_timestamp_pair_ != InvalidUI32) {
+        VulkanDriver::instance().write_gpu_timestamp_end(vulkan_command_buffer_, gpu_timestamp_pair_);
+        gpu_timestamp_pair_ = InvalidUI32;
     }
     VK_CHECK_RESULT(vkEndCommandBuffer(vulkan_command_buffer_));
 }
 
+void VulkanCommandBuffer::begin_gpu_timer(uint32_t timer) {
+    // Secondaries never time: they run inside a render pass, where query resets are illegal.
+    if (record_gpu_timestamps_ && queue_type_ == QueueType::Graphics && current_render_pass_ == nullptr) {
+        VulkanDriver::instance().begin_gpu_timer(vulkan_command_buffer_, timer);
+    }
+}
+
+void VulkanCommandBuffer::end_gpu_timer(uint32_t timer) {
+    if (record_gpu_timestamps_ && queue_type_ == QueueType::Graphics && current_render_pass_ == nullptr) {
+        VulkanDriver::instance().end_gpu_timer(vulkan_command_buffer_, timer);
+    }
+}
+
+void VulkanCommandBuffer::begin_secondary(RHIRenderPass* render_pass) {
+    VK_CHECK_RESULT(vkResetCommandBuffer(vulkan_command_buffer_, 0));
+    reset();
+
+    VulkanRenderPass* vulkan_render_pass = static_cast<VulkanRenderPass*>(render_pass);
+    // Swapchain passes use a legacy VkRenderPass unless dynamic rendering is available;
+    // offscreen passes always use dynamic rendering (see begin_render_pass).
+    const bool dynamic_rendering = render_pass->is_offscreen_renderpass() || device_->supports_dynamic_rendering();
+
+    VkCommandBufferInheritanceRenderingInfo rendering_inheritance{};
+    VkCommandBufferInheritanceInfo inheritance_info{};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if (dynamic_rendering) {
+        rendering_inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        rendering_inheritance.colorAttachmentCount = vulkan_render_pass->color_attachment_format_count();
+        rendering_inheritance.pColorAttachmentFormats = vulkan_render_pass->color_attachment_formats();
+        rendering_inheritance.depthAttachmentFormat = vulkan_render_pass->depth_attachment_format();
+        rendering_inheritance.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+        rendering_inheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        inheritance_info.pNext = &rendering_inheritance;
+    } else {
+        inheritance_info.renderPass = vulkan_render_pass->render_pass();
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = VulkanDriver::instance().get_frame_buffer(VulkanDriver::instance().current_buffer());
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(vulkan_command_buffer_, &begin_info));
+
+    current_render_pass_ = render_pass;
+    set_render_pass_viewport_and_scissor(render_pass);
+}
+
+void VulkanCommandBuffer::execute_secondary_command_buffers(const CommandBuffer* secondaries, uint32_t count) {
+    constexpr uint32_t kExecuteBatch = 64;
+    VkCommandBuffer handles[kExecuteBatch];
+    for (uint32_t begin = 0; begin < count; begin += kExecuteBatch) {
+        const uint32_t batch = std::min(kExecuteBatch, count - begin);
+        for (uint32_t i = 0; i < batch; ++i) {
+            handles[i] = reinterpret_cast<VkCommandBuffer>(secondaries[begin + i].command_buffer);
+        }
+        vkCmdExecuteCommands(vulkan_command_buffer_, batch, handles);
+    }
+}
+
 void VulkanCommandBuffer::set_viewport(float x, float y, float width, float height, float min_depth, float max_depth) {
     VkViewport viewport{};
     viewport.x = x;
@@ -18,17 +18,27 @@ struct CommandBufferState {
 
 class VulkanCommandBuffer : public CommandBuffer::Impl {
 public:
-    VulkanCommandBuffer(VulkanDevice *device, VkCommandPool cmd_pool, VkCommandBuffer cmd_buffer, QueueType queue_type);
+    /// With @p owns_command_pool the buffer is the only one allocated from @p cmd_pool and
+    /// destroys the pool with itself; this lets different threads record primaries at once.
+    VulkanCommandBuffer(VulkanDevice *device, VkCommandPool cmd_pool, VkCommandBuffer cmd_buffer, QueueType queue_type,
+                        bool owns_command_pool = false);
     ~VulkanCommandBuffer();
 
-    void begin_render_pass(RHIRenderPass* render_pass) override;
+    void begin_render_pass(RHIRenderPass* render_pass, RenderPassContents contents = RenderPassContents::Inline) override;
     void end_render_pass() override;
     void bind_pipeline(const RHIPipeline* pipeline) override;
     void bind_descriptor_sets(DescriptorSet** descriptor_sets, uint32_t first_set, uint32_t descriptor_set_count, handle_ty pipeline_layout) override;
     void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) override;
     void push_constants(const void* data, uint32_t offset, uint32_t size) override;
-    void draw_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride) override;
-    void draw_indexed_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride) override;
+    void draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) override;
+    void draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) override;
+    void draw_indexed_indirect_count(
+        handle_ty indirect_buffer,
+        size_t offset,
+        handle_ty count_buffer,
+        size_t count_offset,
+        uint32_t max_draw_count,
+        uint32_t stride) override;
     void set_vertex_buffer(VertexBuffer* vertex_buffer, uint32_t base_vertex = 0) override;
     void set_index_buffer(IndexBuffer* index_buffer, uint32_t first_index = 0) override;
     void copy_buffer(
@@ -51,6 +61,13 @@ public:
     void end() override;
     void set_viewport(float x, float y, float width, float height, float min_depth = 0.0f, float max_depth = 1.0f) override;
     void set_scissor(int32_t x, int32_t y, uint32_t width, uint32_t height) override;
+    void execute_secondary_command_buffers(const CommandBuffer* secondaries, uint32_t count) override;
+    void begin_gpu_timer(uint32_t timer) override;
+    void end_gpu_timer(uint32_t timer) override;
+    /// Begins a secondary command buffer that continues @p render_pass (legacy render pass or
+    /// dynamic rendering, matching how the primary begins it) and sets viewport / scissor,
+    /// which secondaries do not inherit.
+    void begin_secondary(RHIRenderPass* render_pass);
     void set_record_gpu_timestamps(bool enabled) noexcept { record_gpu_timestamps_ = enabled; }
     OC_MAKE_MEMBER_GETTER(vulkan_command_buffer, )
     //OC_MAKE_MEMBER_GETTER_SETTER(pipeline_stage_flags, )
@@ -69,8 +86,9 @@ public:
     QueueType queue_type() const noexcept { return queue_type_; }
     [[nodiscard]] VkCommandPool vulkan_command_pool() const noexcept { return command_pool_; }
 private:
-    void begin_swapchain_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass);
-    void begin_offscreen_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass);
+    void begin_swapchain_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass, RenderPassContents contents);
+    void begin_offscreen_render_pass(RHIRenderPass* render_pass, VulkanRenderPass* vulkan_render_pass, RenderPassContents contents);
+    void set_render_pass_viewport_and_scissor(RHIRenderPass* render_pass);
     VulkanDevice *device_ = nullptr;
     VkCommandPool command_pool_ = VK_NULL_HANDLE;
     VkCommandBuffer vulkan_command_buffer_ = VK_NULL_HANDLE;
@@ -79,7 +97,10 @@ private:
     CommandBufferState state_;
     QueueType queue_type_ = QueueType::Graphics;
     bool record_gpu_timestamps_ = true;
+    // Frame timestamp pair claimed in begin(), InvalidUI32 when none.
+    uint32_t gpu_timestamp_pair_ = InvalidUI32;
     bool use_dynamic_rendering_ = false;
+    bool owns_command_pool_ = false;
     RHIRenderPass* current_render_pass_ = nullptr;
 };
 
@@ -71,6 +71,9 @@ VkBufferUsageFlags to_vulkan_buffer_usage(GraphicBufferBindFlags bind_flags) noe
     if ((flags & static_cast<uint32_t>(GraphicBufferBindFlags::CopyDst)) != 0) {
         usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
     }
+    if ((flags & static_cast<uint32_t>(GraphicBufferBindFlags::IndirectBuffer)) != 0) {
+        usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    }
 
     if (usage == 0) {
         usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
@@ -375,7 +378,8 @@ void VulkanDevice::create_logical_device()
     void* next = nullptr;
 
     if (m_deviceProperties.apiVersion >= VK_API_VERSION_1_2 &&
-        (vulkan12_features_.timelineSemaphore || vulkan12_features_.descriptorIndexing)) {
+        (vulkan12_features_.timelineSemaphore || vulkan12_features_.descriptorIndexing ||
+         vulkan12_features_.drawIndirectCount)) {
         next = &vulkan12_features_;
     } else if (support_bindless_) {
         next = &indexing_features_;
@@ -405,6 +409,11 @@ void VulkanDevice::get_enable_features() {
     supports_dynamic_rendering_ = false;
     vulkan13_features_ = {};
 
+    // Indirect draws: one call per batch needs multiDrawIndirect, and per-draw data is
+    // addressed through firstInstance.
+    m_enabledFeatures.multiDrawIndirect = m_deviceFeatures.multiDrawIndirect;
+    m_enabledFeatures.drawIndirectFirstInstance = m_deviceFeatures.drawIndirectFirstInstance;
+
     if (m_deviceProperties.apiVersion >= VK_API_VERSION_1_3) {
         VkPhysicalDeviceVulkan13Features supported13{};
         supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
@@ -433,6 +442,7 @@ void VulkanDevice::get_enable_features() {
 
         vulkan12_features_ = {};
         vulkan12_features_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12_features_.drawIndirectCount = supported.drawIndirectCount;
 
 #if OCARINA_VULKAN_FRAME_SYNC_TIMELINE
         if (!supported.timelineSemaphore) {
@@ -818,6 +828,14 @@ void VulkanDevice::release_command_buffer(const CommandBuffer& cmd_buffer) noexc
     VulkanDriver::instance().release_command_buffer(static_cast<VulkanCommandBuffer*>(cmd_buffer.impl()));
 }
 
+CommandBuffer VulkanDevice::get_secondary_command_buffer(RHIRenderPass* render_pass, uint32_t thread_index) noexcept
+{
+    VulkanCommandBuffer* vk_cmd_buffer = VulkanDriver::instance().get_secondary_command_buffer(render_pass, thread_index);
+    CommandBuffer cmd_buffer(vk_cmd_buffer);
+    cmd_buffer.command_buffer = reinterpret_cast<handle_ty>(vk_cmd_buffer->vulkan_command_buffer());
+    return cmd_buffer;
+}
+
 void VulkanDevice::execute_command_buffers(CommandBuffer* command_buffers, uint32_t counts) noexcept
 {
     VulkanDriver::instance().execute_command_buffers(command_buffers, counts);
@@ -895,6 +913,24 @@ void VulkanDevice::destroy_semaphore(Semaphore& semaphore) noexcept
 double VulkanDevice::gpu_frame_time_ms() const noexcept {
     return VulkanDriver::instance().gpu_frame_time_ms();
 }
+
+bool VulkanDevice::supports_gpu_timers() const noexcept {
+    // Timers are written on graphics primaries; timestampComputeAndGraphics covers every
+    // graphics and compute queue, otherwise the graphics family has to report valid bits.
+    const VkPhysicalDeviceLimits &limits = device_limits();
+    if (limits.timestampPeriod <= 0.0f) {
+        return false;
+    }
+    if (limits.timestampComputeAndGraphics == VK_TRUE) {
+        return true;
+    }
+    const uint32_t family = get_queue_family_index(QueueType::Graphics);
+    return family < queueFamilyProperties_.size() && queueFamilyProperties_[family].timestampValidBits > 0;
+}
+
+GpuTimerResults VulkanDevice::last_gpu_timer_results() const noexcept {
+    return VulkanDriver::instance().gpu_timer_results();
+}
 }// namespace ocarina
 
 OC_EXPORT_API ocarina::VulkanDevice *create_device(ocarina::RHIContext *file_manager, const ocarina::InstanceCreation& instance_creation) {
@@ -123,6 +123,7 @@ public:
     CommandBuffer get_command_buffer() noexcept override;
     CommandBuffer get_command_buffer(QueueType queue_type) noexcept override;
     void release_command_buffer(const CommandBuffer& cmd_buffer) noexcept override;
+    CommandBuffer get_secondary_command_buffer(RHIRenderPass* render_pass, uint32_t thread_index) noexcept override;
     void execute_command_buffers(CommandBuffer* command_buffers, uint32_t counts) noexcept override;
     Semaphore get_present_complete_semaphore() noexcept override;
     Semaphore get_render_complete_semaphore() noexcept override;
@@ -132,9 +133,20 @@ public:
     [[nodiscard]] uint64_t query_timeline_semaphore_value(const Semaphore& semaphore) const noexcept override;
     void destroy_semaphore(Semaphore& semaphore) noexcept override;
     [[nodiscard]] double gpu_frame_time_ms() const noexcept override;
+    [[nodiscard]] bool supports_gpu_timers() const noexcept override;
+    [[nodiscard]] GpuTimerResults last_gpu_timer_results() const noexcept override;
     [[nodiscard]] bool supports_dynamic_rendering() const noexcept override {
         return supports_dynamic_rendering_;
     }
+    [[nodiscard]] bool supports_multi_draw_indirect() const noexcept override {
+        return m_enabledFeatures.multiDrawIndirect == VK_TRUE;
+    }
+    [[nodiscard]] bool supports_indirect_first_instance() const noexcept override {
+        return m_enabledFeatures.drawIndirectFirstInstance == VK_TRUE;
+    }
+    [[nodiscard]] bool supports_draw_indirect_count() const noexcept override {
+        return vulkan12_features_.drawIndirectCount == VK_TRUE;
+    }
  private:
     void init_vulkan();
     void create_logical_device();
@@ -53,7 +53,7 @@ void VulkanDriver::terminate()
     vulkan_shader_manager->clear(vulkan_device_);
     destroy_frame_sync();
     release_command_buffers();
-    release_command_pool();
+    release_secondary_command_pools();
 
     destroy_internal_textures();
 
@@ -61,7 +61,8 @@ void VulkanDriver::terminate()
         vkDestroyQueryPool(device(), gpu_timestamp_query_pool_, nullptr);
         gpu_timestamp_query_pool_ = VK_NULL_HANDLE;
     }
-    gpu_timestamp_written_.clear();
+    gpu_timestamp_slots_.reset();
+    gpu_timer_results_ = {};
 
     for (auto& it : samplers_)
     {
@@ -270,30 +271,15 @@ void VulkanDriver::release_frame_buffer()
     frame_buffers.clear();
 }
 
-void VulkanDriver::create_command_pool()
+VkCommandPool VulkanDriver::create_command_pool(QueueType queue_type)
 {
-    for (size_t i = 0; i < (size_t)QueueType::NumQueueType; ++i) {
-        command_pools_[i] = VK_NULL_HANDLE;
-    }
-
-    for (QueueType queue_type : { QueueType::Graphics, QueueType::Compute, QueueType::Copy }) {
-        const uint32_t family_index = vulkan_device_->get_queue_family_index(queue_type);
-        VkCommandPoolCreateInfo cmd_pool_info{};
-        cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        cmd_pool_info.queueFamilyIndex = family_index;
-        cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        VK_CHECK_RESULT(vkCreateCommandPool(device(), &cmd_pool_info, nullptr, &command_pools_[(size_t)queue_type]));
-    }
-}
-
-void VulkanDriver::release_command_pool()
-{
-    for (size_t i = 0; i < (size_t)QueueType::NumQueueType; ++i) {
-        if (command_pools_[i] != VK_NULL_HANDLE) {
-            vkDestroyCommandPool(device(), command_pools_[i], nullptr);
-            command_pools_[i] = VK_NULL_HANDLE;
-        }
-    }
+    VkCommandPoolCreateInfo cmd_pool_info{};
+    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmd_pool_info.queueFamilyIndex = vulkan_device_->get_queue_family_index(queue_type);
+    cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    VkCommandPool cmd_pool = VK_NULL_HANDLE;
+    VK_CHECK_RESULT(vkCreateCommandPool(device(), &cmd_pool_info, nullptr, &cmd_pool));
+    return cmd_pool;
 }
 
 void VulkanDriver::create_command_buffers()
@@ -321,6 +307,36 @@ void VulkanDriver::release_command_buffers() {
     command_buffer_pools_.clear();
 }
 
+void VulkanDriver::reset_secondary_command_pools(uint32_t slot)
+{
+    std::lock_guard<std::mutex> lock(secondary_command_pools_mutex_);
+    for (auto& thread_pools : secondary_command_pools_) {
+        SecondaryCommandPool& secondary_pool = (*thread_pools)[slot];
+        if (secondary_pool.pool != VK_NULL_HANDLE && secondary_pool.used > 0) {
+            VK_CHECK_RESULT(vkResetCommandPool(device(), secondary_pool.pool, 0));
+        }
+        secondary_pool.used = 0;
+    }
+}
+
+void VulkanDriver::release_secondary_command_pools()
+{
+    std::lock_guard<std::mutex> lock(secondary_command_pools_mutex_);
+    for (auto& thread_pools : secondary_command_pools_) {
+        for (SecondaryCommandPool& secondary_pool : *thread_pools) {
+            for (VulkanCommandBuffer* cmd_buffer : secondary_pool.command_buffers) {
+                ocarina::delete_with_allocator<VulkanCommandBuffer>(cmd_buffer);
+            }
+            secondary_pool.command_buffers.clear();
+            if (secondary_pool.pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(device(), secondary_pool.pool, nullptr);
+                secondary_pool.pool = VK_NULL_HANDLE;
+            }
+        }
+    }
+    secondary_command_pools_.clear();
+}
+
 void VulkanDriver::initialize()
 {
     vulkan_shader_manager = std::make_unique<VulkanShaderManager>();
@@ -330,21 +346,22 @@ void VulkanDriver::initialize()
     vkGetDeviceQueue(device(), vulkan_device_->get_queue_family_index(QueueType::Graphics), 0, &graphics_queue);
     vkGetDeviceQueue(device(), vulkan_device_->get_queue_family_index(QueueType::Compute), 0, &compute_queue);
     vkGetDeviceQueue(device(), vulkan_device_->get_queue_family_index(QueueType::Copy), 0, &copy_queue);
-    create_command_pool();
     create_command_buffers();
 
     create_internal_textures();
 
-    // GPU timestamp queries (2 per in-flight frame).
-    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE && frames_in_flight_ > 0) {
+    // GPU timestamp queries (kGpuTimestampPairsPerSlot pairs per in-flight frame); without
+    // timestamp support every timestamp write is a no-op.
+    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE && frames_in_flight_ > 0 && vulkan_device_->supports_gpu_timers()) {
         VkQueryPoolCreateInfo query_info{};
         query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
         query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
-        query_info.queryCount = frames_in_flight_ * 2;
+        query_info.queryCount = frames_in_flight_ * kGpuTimestampPairsPerSlot * 2;
         VK_CHECK_RESULT(vkCreateQueryPool(device(), &query_info, nullptr, &gpu_timestamp_query_pool_));
         gpu_timestamp_period_ns_ = static_cast<double>(vulkan_device_->device_limits().timestampPeriod);
         gpu_frame_time_ms_ = 0.0;
-        gpu_timestamp_written_.assign(frames_in_flight_, 0u);
+        gpu_timer_results_ = {};
+        gpu_timestamp_slots_ = std::make_unique<GpuTimestampSlot[]>(frames_in_flight_);
     }
 }
 
@@ -534,28 +551,11 @@ bool VulkanDriver::begin_frame()
     const uint32_t slot = current_frame_;
 #endif
 
-    // Resolve GPU timestamp for the last time we used this frame slot.
-    if (gpu_timestamp_query_pool_ != VK_NULL_HANDLE) {
-        const uint32_t query_base = slot * 2;
-        if (slot < gpu_timestamp_written_.size() && gpu_timestamp_written_[slot] != 0u) {
-            uint64_t timestamps[2] = {0, 0};
-            const VkResult qr = vkGetQueryPoolResults(
-                device(),
-                gpu_timestamp_query_pool_,
-                query_base,
-                2,
-                sizeof(timestamps),
-                timestamps,
-                sizeof(uint64_t),
-                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-            if (qr == VK_SUCCESS) {
-                const uint64_t delta = (timestamps[1] > timestamps[0]) ? (timestamps[1] - timestamps[0]) : 0;
-                const double ns = static_cast<double>(delta) * gpu_timestamp_period_ns_;
-                gpu_frame_time_ms_ = ns * 1e-6;
-            }
-            gpu_timestamp_written_[slot] = 0u;
-        }
-    }
+    // The slot's previous frame has retired, so its secondaries can be recycled.
+    reset_secondary_command_pools(slot);
+
+    // Resolve GPU timestamps for the last time we used this frame slot.
+    resolve_gpu_timestamps(slot);
 
     VkResult result = swapchain->aquire_next_image(frame_sync_[slot].image_available, &current_buffer_);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
@@ -570,36 +570,135 @@ bool VulkanDriver::begin_frame()
         return false;
     }
 
+    {
+        // The slot becomes the recording slot here. Its pair allocator restarts under the
+        // lock write_gpu_timestamp_begin claims pairs under, so a primary begun on an
+        // upload thread claims from either the old slot or the freshly reset one.
+        std::lock_guard<std::mutex> lock(command_buffer_pool_mutex_);
 #if OCARINA_VULKAN_FRAME_SYNC_TIMELINE
-    ++frame_timeline_sync_.frame_number;
-#else
+        ++frame_timeline_sync_.frame_number;
+#endif
+        if (gpu_timestamp_slots_) {
+            gpu_timestamp_slots_[slot].command_buffer_pairs.store(0, std::memory_order_relaxed);
+        }
+    }
+#if !OCARINA_VULKAN_FRAME_SYNC_TIMELINE
     VK_CHECK_RESULT(vkResetFences(device(), 1, &frame_sync_[current_frame_].in_flight_fence));
 #endif
     frame_acquired_ = true;
     return true;
 }
 
-void VulkanDriver::write_gpu_timestamp_begin(VkCommandBuffer cmd) noexcept {
+uint32_t VulkanDriver::write_gpu_timestamp_begin(VkCommandBuffer cmd) noexcept {
     if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE) {
+        return InvalidUI32;
+    }
+    uint32_t slot = 0;
+    uint32_t pair = 0;
+    {
+        // Same lock as the slot reset in begin_frame: the slot read and the claim from its
+        // allocator cannot straddle a reset.
+        std::lock_guard<std::mutex> lock(command_buffer_pool_mutex_);
+        slot = frame_slot();
+        pair = gpu_timestamp_slots_[slot].command_buffer_pairs.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (pair >= kGpuCommandBufferTimestampPairs) {
+        return InvalidUI32;
+    }
+    const uint32_t query = gpu_timestamp_query(slot, pair);
+    // Reset only this pair: other primaries of the frame own the rest (no hostQueryReset needed).
+    vkCmdResetQueryPool(cmd, gpu_timestamp_query_pool_, query, 2);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpu_timestamp_query_pool_, query);
+    return slot * kGpuTimestampPairsPerSlot + pair;
+}
+
+void VulkanDriver::write_gpu_timestamp_end(VkCommandBuffer cmd, uint32_t pair) noexcept {
+    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE || pair == InvalidUI32) {
+        return;
+    }
+    // The pair carries its slot, the frame may have advanced since begin on upload threads.
+    const uint32_t slot = pair / kGpuTimestampPairsPerSlot;
+    const uint32_t slot_pair = pair % kGpuTimestampPairsPerSlot;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpu_timestamp_query_pool_,
+                        gpu_timestamp_query(slot, slot_pair) + 1);
+    gpu_timestamp_slots_[slot].command_buffer_mask.fetch_or(1u << slot_pair, std::memory_order_relaxed);
+}
+
+void VulkanDriver::begin_gpu_timer(VkCommandBuffer cmd, uint32_t timer) noexcept {
+    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE || timer >= MAX_GPU_TIMERS) {
         return;
     }
-    const uint32_t query_base = frame_slot() * 2;
-    // Reset both queries for this frame slot before writing timestamps (no hostQueryReset needed).
-    vkCmdResetQueryPool(cmd, gpu_timestamp_query_pool_, query_base, 2);
-    const uint32_t query = query_base + 0;
+    const uint32_t query = gpu_timestamp_query(frame_slot(), kGpuCommandBufferTimestampPairs + timer);
+    vkCmdResetQueryPool(cmd, gpu_timestamp_query_pool_, query, 2);
     vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpu_timestamp_query_pool_, query);
 }
 
-void VulkanDriver::write_gpu_timestamp_end(VkCommandBuffer cmd) noexcept {
-    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE) {
+void VulkanDriver::end_gpu_timer(VkCommandBuffer cmd, uint32_t timer) noexcept {
+    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE || timer >= MAX_GPU_TIMERS) {
         return;
     }
     const uint32_t slot = frame_slot();
-    const uint32_t query = slot * 2 + 1;
-    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpu_timestamp_query_pool_, query);
-    if (slot < gpu_timestamp_written_.size()) {
-        gpu_timestamp_written_[slot] = 1u;
+    const uint32_t query = gpu_timestamp_query(slot, kGpuCommandBufferTimestampPairs + timer);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpu_timestamp_query_pool_, query + 1);
+    gpu_timestamp_slots_[slot].timer_mask.fetch_or(uint64_t{1} << timer, std::memory_order_relaxed);
+}
+
+void VulkanDriver::resolve_gpu_timestamps(uint32_t slot) noexcept {
+    if (gpu_timestamp_query_pool_ == VK_NULL_HANDLE) {
+        return;
+    }
+    GpuTimestampSlot &timestamps = gpu_timestamp_slots_[slot];
+    const uint32_t command_buffer_mask = timestamps.command_buffer_mask.exchange(0, std::memory_order_relaxed);
+    const uint64_t timer_mask = timestamps.timer_mask.exchange(0, std::memory_order_relaxed);
+    if (command_buffer_mask == 0 && timer_mask == 0) {
+        return;
+    }
+
+    // Value and availability per query; no WAIT_BIT, so a pair the GPU has not finished
+    // (it should have, the slot fence is signalled) is skipped instead of blocking.
+    auto read_pair = [&](uint32_t pair, uint64_t &begin, uint64_t &end) {
+        uint64_t values[4] = {0, 0, 0, 0};
+        const VkResult qr = vkGetQueryPoolResults(
+            device(),
+            gpu_timestamp_query_pool_,
+            gpu_timestamp_query(slot, pair),
+            2,
+            sizeof(values),
+            values,
+            sizeof(uint64_t) * 2,
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if ((qr != VK_SUCCESS && qr != VK_NOT_READY) || values[1] == 0 || values[3] == 0) {
+            return false;
+        }
+        begin = values[0];
+        end = values[2];
+        return end >= begin;
+    };
+
+    uint64_t frame_begin = UINT64_MAX;
+    uint64_t frame_end = 0;
+    for (uint32_t pair = 0; pair < kGpuCommandBufferTimestampPairs; ++pair) {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        if ((command_buffer_mask >> pair & 1u) != 0 && read_pair(pair, begin, end)) {
+            frame_begin = std::min(frame_begin, begin);
+            frame_end = std::max(frame_end, end);
+        }
     }
+    if (frame_end > frame_begin) {
+        gpu_frame_time_ms_ = static_cast<double>(frame_end - frame_begin) * gpu_timestamp_period_ns_ * 1e-6;
+    }
+
+    GpuTimerResults results;
+    for (uint32_t timer = 0; timer < MAX_GPU_TIMERS; ++timer) {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        if ((timer_mask >> timer & 1u) != 0 && read_pair(kGpuCommandBufferTimestampPairs + timer, begin, end)) {
+            results.ms[timer] = static_cast<double>(end - begin) * gpu_timestamp_period_ns_ * 1e-6;
+            results.written_mask |= uint64_t{1} << timer;
+        }
+    }
+    gpu_timer_results_ = results;
 }
 
 void VulkanDriver::end_frame()
@@ -816,14 +915,15 @@ VulkanCommandBuffer* VulkanDriver::get_command_buffer(QueueType queue_type) {
     const uint32_t slot = frame_slot();
     auto& pool = command_buffer_pools_[slot][(size_t)queue_type];
     if (pool.empty()) {
+        VkCommandPool cmd_pool = create_command_pool(queue_type);
         VkCommandBufferAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateInfo.commandPool = command_pools_[(size_t)queue_type];
+        allocateInfo.commandPool = cmd_pool;
         allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         allocateInfo.commandBufferCount = 1;
         VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
         VK_CHECK_RESULT(vkAllocateCommandBuffers(device(), &allocateInfo, &cmd_buffer));
-        return ocarina::new_with_allocator<ocarina::VulkanCommandBuffer>(vulkan_device_, command_pools_[(size_t)queue_type], cmd_buffer, queue_type);
+        return ocarina::new_with_allocator<ocarina::VulkanCommandBuffer>(vulkan_device_, cmd_pool, cmd_buffer, queue_type, true);
     }
 
     VulkanCommandBuffer* cmd_buffer = pool.front();
@@ -838,6 +938,41 @@ void VulkanDriver::release_command_buffer(VulkanCommandBuffer* cmd_buffer)
     command_buffer_pools_[frame_slot()][(size_t)cmd_buffer->queue_type()].push(cmd_buffer);
 }
 
+VulkanCommandBuffer* VulkanDriver::get_secondary_command_buffer(RHIRenderPass* render_pass, uint32_t thread_index)
+{
+    SecondaryCommandPool* secondary_pool = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(secondary_command_pools_mutex_);
+        while (secondary_command_pools_.size() <= thread_index) {
+            secondary_command_pools_.emplace_back(std::make_unique<ThreadSecondaryCommandPools>());
+        }
+        secondary_pool = &(*secondary_command_pools_[thread_index])[frame_slot()];
+    }
+
+    // Only thread_index records from this pool, so allocation and recording need no lock.
+    if (secondary_pool->pool == VK_NULL_HANDLE) {
+        secondary_pool->pool = create_command_pool(QueueType::Graphics);
+    }
+    if (secondary_pool->used == secondary_pool->command_buffers.size()) {
+        VkCommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = secondary_pool->pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device(), &allocateInfo, &cmd_buffer));
+        VulkanCommandBuffer* secondary = ocarina::new_with_allocator<ocarina::VulkanCommandBuffer>(
+            vulkan_device_, secondary_pool->pool, cmd_buffer, QueueType::Graphics);
+        // Frame timestamps belong to the primary that executes the secondaries.
+        secondary->set_record_gpu_timestamps(false);
+        secondary_pool->command_buffers.push_back(secondary);
+    }
+
+    VulkanCommandBuffer* secondary = secondary_pool->command_buffers[secondary_pool->used++];
+    secondary->begin_secondary(render_pass);
+    return secondary;
+}
+
 void VulkanDriver::queue_submit(VkQueue queue, const VkSubmitInfo2* submit_info, uint32_t submit_count, VkFence fence)
 {
     VK_CHECK_RESULT(vkQueueSubmit2(queue, submit_count, submit_info, fence));
@@ -4,9 +4,11 @@
 #include "core/concepts.h"
 #include "core/stl.h"
 #include "rhi/graphics_descriptions.h"
+#include "rhi/command_buffer.h"
 #include <vulkan/vulkan.h>
 #include "vulkan_pipeline.h"
 #include <array>
+#include <atomic>
 #include <mutex>
 #include <queue>
 
@@ -20,6 +22,7 @@ class VulkanShader;
 struct InstanceCreation;
 struct PipelineState;
 class VulkanRenderPass;
+class RHIRenderPass;
 class VulkanVertexStreamBinding;
 class VulkanDescriptorSetLayout;
 class DescriptorSetLayout;
@@ -71,10 +74,18 @@ public:
     [[nodiscard]] bool begin_frame();
     void end_frame();
 
-    // GPU frame timing (timestamps). Returns last resolved frame GPU time in ms.
+    // GPU frame timing (timestamps). Returns last resolved frame GPU time in ms: first begin
+    // to last end over the graphics primaries of that frame.
     [[nodiscard]] double gpu_frame_time_ms() const noexcept { return gpu_frame_time_ms_; }
-    void write_gpu_timestamp_begin(VkCommandBuffer cmd) noexcept;
-    void write_gpu_timestamp_end(VkCommandBuffer cmd) noexcept;
+    [[nodiscard]] const GpuTimerResults &gpu_timer_results() const noexcept { return gpu_timer_results_; }
+    /// Claims a begin/end pair for a graphics primary and writes its begin timestamp. Returns
+    /// the pair for write_gpu_timestamp_end(), InvalidUI32 without timestamps or when the
+    /// frame's pairs are used up.
+    [[nodiscard]] uint32_t write_gpu_timestamp_begin(VkCommandBuffer cmd) noexcept;
+    void write_gpu_timestamp_end(VkCommandBuffer cmd, uint32_t pair) noexcept;
+    /// Timer @p timer of the current frame slot; outside render passes only.
+    void begin_gpu_timer(VkCommandBuffer cmd, uint32_t timer) noexcept;
+    void end_gpu_timer(VkCommandBuffer cmd, uint32_t timer) noexcept;
 
     //VkPipelineLayout get_pipeline_layout(VkDescriptorSetLayout *descriptset_layouts, uint8_t descriptset_layouts_count, VkPushConstantRange* push_constants, uint32_t push_constant_array_size);
 
@@ -123,6 +134,10 @@ public:
 
     VulkanCommandBuffer* get_command_buffer(QueueType queue_type = QueueType::Graphics);
     void release_command_buffer(VulkanCommandBuffer* cmd_buffer);
+    /// Secondary graphics command buffer begun inside @p render_pass, allocated from the
+    /// pool @p thread_index owns for the current frame slot. Pools are reset wholesale in
+    /// begin_frame once the slot's previous frame has retired.
+    VulkanCommandBuffer* get_secondary_command_buffer(RHIRenderPass* render_pass, uint32_t thread_index);
 
     void queue_submit(VkQueue queue, const VkSubmitInfo2* submit_info, uint32_t submit_count, VkFence fence = VK_NULL_HANDLE);
 
@@ -149,10 +164,11 @@ private:
     void setup_frame_buffer();
     //void setup_depth_stencil(uint32_t width, uint32_t height);
     void release_frame_buffer();
-    void create_command_pool();
-    void release_command_pool();
+    [[nodiscard]] VkCommandPool create_command_pool(QueueType queue_type);
     void create_command_buffers();
     void release_command_buffers();
+    void reset_secondary_command_pools(uint32_t slot);
+    void release_secondary_command_pools();
     void initialize();
     [[nodiscard]] bool recreate_swapchain();
     void destroy_swapchain_framebuffers();
@@ -185,14 +201,25 @@ private:
     VkQueue compute_queue{VK_NULL_HANDLE};
     VkQueue copy_queue{ VK_NULL_HANDLE };
 
-    /** @brief Command pools per queue family (graphics / compute / copy) */
-    std::array<VkCommandPool, (size_t)QueueType::NumQueueType> command_pools_ = {};
     // Command buffers used for rendering
     //std::vector<VkCommandBuffer> draw_cmd_buffers_;
 
+    // Every pooled primary owns its VkCommandPool, so pass groups can be recorded on
+    // different threads at the same time without external pool synchronization.
     using CommandBufferPoolPerQueue = std::array<std::queue<VulkanCommandBuffer*>, (size_t)QueueType::NumQueueType>;
     std::vector<CommandBufferPoolPerQueue> command_buffer_pools_;
     std::mutex command_buffer_pool_mutex_;
+
+    struct SecondaryCommandPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VulkanCommandBuffer*> command_buffers;
+        /// Buffers handed out since the last reset; the rest are reused in order.
+        uint32_t used = 0;
+    };
+    /// Graphics pools for secondary command buffers, one per recording thread and frame slot.
+    using ThreadSecondaryCommandPools = std::array<SecondaryCommandPool, kMaxFramesInFlight>;
+    std::vector<std::unique_ptr<ThreadSecondaryCommandPools>> secondary_command_pools_;
+    std::mutex secondary_command_pools_mutex_;
     // Swapchain image index from the latest acquire
     uint32_t current_buffer_ = 0;
     // True after a successful begin_frame acquire; end_frame presents only then.
@@ -206,12 +233,30 @@ private:
 
     [[nodiscard]] uint32_t frame_slot() const noexcept;
 
-    // Timestamp queries: 2 per frame (begin/end).
+    // Timestamp queries, begin/end pairs per frame slot: kGpuCommandBufferTimestampPairs for
+    // graphics primaries, then one per GPU timer. Null when the device has no timestamps.
+    static constexpr uint32_t kGpuCommandBufferTimestampPairs = 16;
+    static constexpr uint32_t kGpuTimestampPairsPerSlot = kGpuCommandBufferTimestampPairs + MAX_GPU_TIMERS;
+    struct GpuTimestampSlot {
+        // Primary pairs claimed this frame, and those whose end was written.
+        std::atomic<uint32_t> command_buffer_pairs{0};
+        std::atomic<uint32_t> command_buffer_mask{0};
+        std::atomic<uint64_t> timer_mask{0};
+    };
+    static_assert(kGpuCommandBufferTimestampPairs <= 32, "command_buffer_mask is 32 bits");
+    static_assert(MAX_GPU_TIMERS <= 64, "timer_mask is 64 bits");
+    [[nodiscard]] static uint32_t gpu_timestamp_query(uint32_t slot, uint32_t pair) noexcept {
+        return (slot * kGpuTimestampPairsPerSlot + pair) * 2;
+    }
+    /// Reads the slot's written pairs without waiting (its fence has been waited for, so
+    /// unavailable results are dropped rather than stalled on). The pair allocator is left
+    /// alone; begin_frame resets it once the slot is acquired.
+    void resolve_gpu_timestamps(uint32_t slot) noexcept;
     VkQueryPool gpu_timestamp_query_pool_ = VK_NULL_HANDLE;
     double gpu_timestamp_period_ns_ = 0.0;
     double gpu_frame_time_ms_ = 0.0;
-    // Tracks whether a frame-slot has valid timestamp data to read.
-    std::vector<uint8_t> gpu_timestamp_written_;
+    GpuTimerResults gpu_timer_results_;
+    std::unique_ptr<GpuTimestampSlot[]> gpu_timestamp_slots_;
 
     VkRenderPass renderpass_framebuffer{VK_NULL_HANDLE};
     //VkFormat depth_stencil_format;
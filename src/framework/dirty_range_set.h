@@ -0,0 +1,94 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "rhi/resources/buffer.h"
+
+namespace ocarina {
+
+/// Page-granular dirty tracking for a CPU mirror of a GPU buffer. Marks set one bit per
+/// page; collect() coalesces runs of dirty pages into byte ranges for
+/// Buffer::copy_ranges_from_immediately(). Not thread-safe.
+class DirtyRangeSet {
+public:
+    static constexpr uint32_t kDefaultPageBytes = 4096;
+
+    explicit DirtyRangeSet(uint32_t page_bytes = kDefaultPageBytes) noexcept
+        : page_bytes_(page_bytes) {}
+
+    void mark(size_t byte_offset, size_t byte_size) {
+        if (byte_size == 0) {
+            return;
+        }
+        const size_t first_page = byte_offset / page_bytes_;
+        const size_t last_page = (byte_offset + byte_size - 1) / page_bytes_;
+        if (last_page / 64 >= page_bits_.size()) {
+            page_bits_.resize(last_page / 64 + 1, 0);
+        }
+        for (size_t page = first_page; page <= last_page; ++page) {
+            page_bits_[page / 64] |= uint64_t{1} << (page % 64);
+        }
+        dirty_ = true;
+    }
+
+    /// Everything up to @p byte_size (buffer recreated, bulk resize).
+    void mark_all(size_t byte_size) { mark(0, byte_size); }
+
+    [[nodiscard]] bool empty() const noexcept { return !dirty_; }
+
+    void clear() noexcept {
+        std::fill(page_bits_.begin(), page_bits_.end(), 0);
+        dirty_ = false;
+    }
+
+    /// Appends coalesced ranges clipped to @p limit_bytes; returns the total byte count.
+    size_t collect(std::vector<BufferCopyRange>& out, size_t limit_bytes) const {
+        size_t total_bytes = 0;
+        size_t run_begin = InvalidUI64;
+        auto flush_run = [&](size_t run_end) {
+            const size_t begin = run_begin * page_bytes_;
+            const size_t end = std::min(run_end * page_bytes_, limit_bytes);
+            if (begin < end) {
+                out.push_back(BufferCopyRange{static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin)});
+                total_bytes += end - begin;
+            }
+            run_begin = InvalidUI64;
+        };
+
+        for (size_t word_index = 0; word_index < page_bits_.size(); ++word_index) {
+            const uint64_t word = page_bits_[word_index];
+            const size_t word_page = word_index * 64;
+            if (word == 0) {
+                if (run_begin != InvalidUI64) {
+                    flush_run(word_page);
+                }
+                continue;
+            }
+            if (word == ~uint64_t{0}) {
+                if (run_begin == InvalidUI64) {
+                    run_begin = word_page;
+                }
+                continue;
+            }
+            for (size_t bit = 0; bit < 64; ++bit) {
+                const bool page_dirty = (word >> bit) & 1u;
+                if (page_dirty && run_begin == InvalidUI64) {
+                    run_begin = word_page + bit;
+                } else if (!page_dirty && run_begin != InvalidUI64) {
+                    flush_run(word_page + bit);
+                }
+            }
+        }
+        if (run_begin != InvalidUI64) {
+            flush_run(page_bits_.size() * 64);
+        }
+        return total_bytes;
+    }
+
+private:
+    uint32_t page_bytes_ = kDefaultPageBytes;
+    std::vector<uint64_t> page_bits_;
+    bool dirty_ = false;
+};
+
+}// namespace ocarina
@@ -0,0 +1,170 @@
+#include "draw_batch.h"
+#include "draw_sort_key.h"
+#include "frame_resources.h"
+#include "core/profiler.h"
+#include "core/hash.h"
+
+namespace ocarina {
+
+namespace {
+
+/// Instances of one mesh slice within a run.
+struct SliceGroup {
+    uint32_t entity_index = InvalidUI32;
+    uint32_t instance_offset = 0;
+    uint32_t instance_count = 0;
+};
+
+/// Mesh slice identity: groups merge only draws of the same index range and base vertex.
+struct SliceKey {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    int32_t vertex_offset = 0;
+
+    [[nodiscard]] bool operator==(const SliceKey& other) const noexcept {
+        return first_index == other.first_index &&
+               index_count == other.index_count &&
+               vertex_offset == other.vertex_offset;
+    }
+};
+
+struct SliceKeyHash {
+    [[nodiscard]] size_t operator()(const SliceKey& key) const noexcept {
+        return static_cast<size_t>(hash64(key.first_index, key.index_count, key.vertex_offset));
+    }
+};
+
+/// Cluster-culled draws record their own index ranges, so they are never instanced.
+[[nodiscard]] bool instanceable(const RenderComponent& item) noexcept {
+    return item.instanced_transform_index_offset != InvalidUI32 && item.cluster_range_offset == InvalidUI32;
+}
+
+[[nodiscard]] bool same_draw_state(const RenderComponent& first, const RenderComponent& item) noexcept {
+    return item.instanced_transform_index_offset == first.instanced_transform_index_offset &&
+           item.vertex_page == first.vertex_page &&
+           item.index_page == first.index_page &&
+           item.material_descriptor_set == first.material_descriptor_set &&
+           item.material_index == first.material_index &&
+           item.push_constant_size == first.push_constant_size;
+}
+
+[[nodiscard]] bool same_mesh_slice(const RenderComponent& a, const RenderComponent& b) noexcept {
+    return a.first_index == b.first_index &&
+           a.index_count == b.index_count &&
+           a.vertex_offset == b.vertex_offset;
+}
+
+[[nodiscard]] bool is_blended(const DrawPacket& packet) noexcept {
+    return (packet.sort_key >> (64 - draw_sort_key::kBucketBits)) == static_cast<uint64_t>(DrawBucket::Blended);
+}
+
+}// namespace
+
+void build_draw_batches(RHIRenderPass& render_pass, const std::vector<RenderComponent>& render_components) {
+    OC_PROFILE_FUNCTION;
+    render_pass.clear_draw_batches();
+
+    // Pass groups build concurrently, so scratch space is per thread.
+    thread_local std::vector<SliceGroup> groups;
+    thread_local std::vector<uint32_t> packet_groups;
+    thread_local std::vector<uint32_t> instances;
+    thread_local std::unordered_map<SliceKey, uint32_t, SliceKeyHash> slice_groups;
+
+    const std::vector<DrawPacket>& packets = render_pass.draw_packets();
+    const uint32_t count = static_cast<uint32_t>(packets.size());
+    auto drawable = [&](const DrawPacket& packet) {
+        return packet.pipeline != nullptr &&
+               packet.entity_index < render_components.size() &&
+               render_components[packet.entity_index].draw_ready;
+    };
+
+    uint32_t begin = 0;
+    while (begin < count) {
+        const DrawPacket& lead = packets[begin];
+        if (!drawable(lead)) {
+            ++begin;
+            continue;
+        }
+        const RenderComponent& first = render_components[lead.entity_index];
+        if (!instanceable(first)) {
+            render_pass.add_draw_batch(DrawBatch{lead.pipeline, lead.entity_index});
+            ++begin;
+            continue;
+        }
+
+        const bool blended = is_blended(lead);
+        groups.clear();
+        packet_groups.clear();
+        slice_groups.clear();
+
+        uint32_t end = begin;
+        for (; end < count; ++end) {
+            const DrawPacket& packet = packets[end];
+            if (packet.pipeline != lead.pipeline) {
+                break;
+            }
+            if (!drawable(packet)) {
+                packet_groups.push_back(InvalidUI32);
+                continue;
+            }
+            const RenderComponent& item = render_components[packet.entity_index];
+            if (!instanceable(item) || !same_draw_state(first, item)) {
+                break;
+            }
+
+            uint32_t group = InvalidUI32;
+            if (blended) {
+                if (!groups.empty() && same_mesh_slice(render_components[groups.back().entity_index], item)) {
+                    group = static_cast<uint32_t>(groups.size() - 1);
+                }
+            } else {
+                const SliceKey slice_key{item.first_index, item.index_count, item.vertex_offset};
+                const auto [it, inserted] = slice_groups.try_emplace(slice_key, static_cast<uint32_t>(groups.size()));
+                if (!inserted) {
+                    group = it->second;
+                }
+            }
+            if (group == InvalidUI32) {
+                group = static_cast<uint32_t>(groups.size());
+                groups.push_back(SliceGroup{packet.entity_index});
+            }
+            ++groups[group].instance_count;
+            packet_groups.push_back(group);
+        }
+
+        // Lay the groups out back to back so the whole run is one upload.
+        uint32_t instance_total = 0;
+        for (SliceGroup& group : groups) {
+            group.instance_offset = instance_total;
+            instance_total += group.instance_count;
+            group.instance_count = 0;
+        }
+        instances.resize(instance_total);
+        for (uint32_t i = begin; i < end; ++i) {
+            const uint32_t group_index = packet_groups[i - begin];
+            if (group_index == InvalidUI32) {
+                continue;
+            }
+            SliceGroup& group = groups[group_index];
+            instances[group.instance_offset + group.instance_count++] = packets[i].entity_index;
+        }
+
+        const uint32_t base = FrameResources::instance().write_draw_instances(instances.data(), instances.size());
+        if (base == InvalidUI32) {
+            for (uint32_t entity_index : instances) {
+                render_pass.add_draw_batch(DrawBatch{lead.pipeline, entity_index});
+            }
+        } else {
+            for (const SliceGroup& group : groups) {
+                render_pass.add_draw_batch(DrawBatch{
+                    lead.pipeline,
+                    group.entity_index,
+                    base + group.instance_offset,
+                    group.instance_count});
+            }
+        }
+        begin = end;
+    }
+}
+
+}// namespace ocarina
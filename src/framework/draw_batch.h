@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "rhi/renderpass.h"
+#include "render_component.h"
+
+namespace ocarina {
+
+/// Rebuilds @p render_pass's draw batches from its sorted draw packets (automatic
+/// instancing). Packets are split into runs that share pipeline, vertex / index page,
+/// material set, material index and push-constant layout; within a run, instanceable
+/// draws of the same mesh slice become one instanced batch whose entity indices are
+/// written to the frame's draw-instance buffer (FrameResources::write_draw_instances).
+///
+/// Opaque runs gather every draw of a slice into the batch of its first appearance. Blended
+/// runs merge only neighbouring draws, so their back-to-front order is kept. Draws with
+/// custom push constants or cluster-culled index ranges, and runs that no longer fit in the
+/// instance buffer, fall back to one plain batch per entity.
+void build_draw_batches(RHIRenderPass& render_pass, const std::vector<RenderComponent>& render_components);
+
+}// namespace ocarina
@@ -0,0 +1,125 @@
+#include "draw_sort_key.h"
+#include "core/profiler.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+namespace ocarina {
+
+namespace {
+
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kRadixBuckets = 1u << kRadixBits;
+constexpr uint32_t kRadixPasses = 64 / kRadixBits;
+/// Packets per histogram / scatter block in the parallel path.
+constexpr uint32_t kSortBlockPackets = 8192;
+
+using Histogram = std::array<uint32_t, kRadixBuckets>;
+
+class DrawSortBlockTask : public enki::ITaskSet {
+public:
+    using BlockFunction = ocarina::function<void(uint32_t)>;
+
+    DrawSortBlockTask(uint32_t block_count, BlockFunction function)
+        : function_(std::move(function)) {
+        m_SetSize = block_count;
+        m_MinRange = 1;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)threadnum;
+        for (uint32_t block = range.start; block < range.end; ++block) {
+            function_(block);
+        }
+    }
+
+private:
+    BlockFunction function_;
+};
+
+}// namespace
+
+void sort_draw_packets(std::vector<DrawPacket>& packets, enki::TaskScheduler* scheduler) {
+    OC_PROFILE_FUNCTION;
+    const uint32_t count = static_cast<uint32_t>(packets.size());
+    if (count < 2) {
+        return;
+    }
+
+    uint64_t varying_bits = 0;
+    const uint64_t first_key = packets[0].sort_key;
+    for (const DrawPacket& packet : packets) {
+        varying_bits |= packet.sort_key ^ first_key;
+    }
+    if (varying_bits == 0) {
+        return;
+    }
+
+    // Pass groups sort concurrently, so scratch space is owned by the calling thread. Block
+    // tasks run on other workers and must only see the raw pointers below, never the
+    // thread_local objects themselves (a worker would resolve them to its own copies).
+    thread_local std::vector<DrawPacket> scratch_storage;
+    thread_local std::vector<Histogram> block_offset_storage;
+    scratch_storage.resize(count);
+
+    const bool parallel = scheduler != nullptr && count >= kParallelDrawSortMinPackets;
+    const uint32_t block_size = parallel ? kSortBlockPackets : count;
+    const uint32_t block_count = (count + block_size - 1) / block_size;
+    block_offset_storage.resize(block_count);
+
+    Histogram* const block_offsets = block_offset_storage.data();
+    DrawPacket* source = packets.data();
+    DrawPacket* destination = scratch_storage.data();
+
+    auto run_blocks = [&](auto&& function) {
+        if (!parallel) {
+            for (uint32_t block = 0; block < block_count; ++block) {
+                function(block);
+            }
+            return;
+        }
+        DrawSortBlockTask task(block_count, function);
+        scheduler->AddTaskSetToPipe(&task);
+        scheduler->WaitforTask(&task);
+    };
+
+    for (uint32_t pass = 0; pass < kRadixPasses; ++pass) {
+        const uint32_t shift = pass * kRadixBits;
+        if (((varying_bits >> shift) & (kRadixBuckets - 1)) == 0) {
+            continue;
+        }
+
+        run_blocks([&](uint32_t block) {
+            Histogram& histogram = block_offsets[block];
+            histogram.fill(0);
+            const uint32_t end = std::min(count, (block + 1) * block_size);
+            for (uint32_t i = block * block_size; i < end; ++i) {
+                ++histogram[(source[i].sort_key >> shift) & (kRadixBuckets - 1)];
+            }
+        });
+
+        // Exclusive prefix over (digit, block) keeps equal digits in block order: stable.
+        uint32_t running = 0;
+        for (uint32_t digit = 0; digit < kRadixBuckets; ++digit) {
+            for (uint32_t block = 0; block < block_count; ++block) {
+                const uint32_t digit_count = block_offsets[block][digit];
+                block_offsets[block][digit] = running;
+                running += digit_count;
+            }
+        }
+
+        run_blocks([&](uint32_t block) {
+            Histogram& offsets = block_offsets[block];
+            const uint32_t end = std::min(count, (block + 1) * block_size);
+            for (uint32_t i = block * block_size; i < end; ++i) {
+                destination[offsets[(source[i].sort_key >> shift) & (kRadixBuckets - 1)]++] = source[i];
+            }
+        });
+
+        std::swap(source, destination);
+    }
+
+    if (source != packets.data()) {
+        packets.swap(scratch_storage);
+    }
+}
+
+}// namespace ocarina
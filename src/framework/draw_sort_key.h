@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "rhi/renderpass.h"
+#include <bit>
+
+namespace enki { class TaskScheduler; }
+
+namespace ocarina {
+
+/// Coarse ordering class of a draw: opaque draws go first, front to back, blended draws
+/// after them, back to front.
+enum class DrawBucket : uint32_t {
+    Opaque = 0,
+    Blended = 1,
+};
+
+/// 64-bit draw sort key, most significant field first.
+///
+///   opaque:  bucket:2 | pipeline:12 | material:14 | vertex page:8 | index page:8 | depth:20
+///   blended: bucket:2 | ~depth:20   | pipeline:12 | material:14   | vertex page:8 | index page:8
+///
+/// Opaque draws are grouped by the most expensive state change first and use depth only
+/// as a tie break. Blended draws must stay back to front, so inverted depth leads. Ids
+/// wider than their field wrap, which only costs a few extra state changes.
+namespace draw_sort_key {
+
+constexpr uint32_t kBucketBits = 2;
+constexpr uint32_t kPipelineBits = 12;
+constexpr uint32_t kMaterialBits = 14;
+constexpr uint32_t kPageBits = 8;
+constexpr uint32_t kDepthBits = 20;
+static_assert(kBucketBits + kPipelineBits + kMaterialBits + 2 * kPageBits + kDepthBits == 64);
+
+[[nodiscard]] constexpr uint64_t field(uint32_t value, uint32_t bits) noexcept {
+    return static_cast<uint64_t>(value) & ((uint64_t{1} << bits) - 1);
+}
+
+/// Monotonic 20-bit code for a non-negative squared view distance. The float bit pattern
+/// of a positive float orders like the value, so the top bits act as a log-scale bucket.
+[[nodiscard]] inline uint32_t quantize_depth(float distance_squared) noexcept {
+    const float clamped = distance_squared > 0.0f ? distance_squared : 0.0f;
+    return std::bit_cast<uint32_t>(clamped) >> (32 - 1 - kDepthBits);
+}
+
+[[nodiscard]] constexpr uint64_t make(DrawBucket bucket,
+                                      uint32_t pipeline_id,
+                                      uint32_t material_id,
+                                      uint32_t vertex_page,
+                                      uint32_t index_page,
+                                      uint32_t depth) noexcept {
+    const uint64_t state = (field(pipeline_id, kPipelineBits) << (kMaterialBits + 2 * kPageBits))
+                           | (field(material_id, kMaterialBits) << (2 * kPageBits))
+                           | (field(vertex_page, kPageBits) << kPageBits)
+                           | field(index_page, kPageBits);
+    const uint64_t bucket_bits = field(static_cast<uint32_t>(bucket), kBucketBits) << (64 - kBucketBits);
+    if (bucket == DrawBucket::Blended) {
+        const uint64_t far_first = field(~depth, kDepthBits);
+        return bucket_bits | (far_first << (64 - kBucketBits - kDepthBits)) | state;
+    }
+    return bucket_bits | (state << kDepthBits) | field(depth, kDepthBits);
+}
+
+}// namespace draw_sort_key
+
+/// Sorts @p packets by sort_key with a stable LSD radix sort (8 bits per pass). Byte
+/// positions that are equal across all keys are skipped. Arrays of at least
+/// kParallelDrawSortMinPackets are histogrammed and scattered in blocks across
+/// @p scheduler; a null scheduler sorts on the calling thread.
+void sort_draw_packets(std::vector<DrawPacket>& packets, enki::TaskScheduler* scheduler);
+
+constexpr uint32_t kParallelDrawSortMinPackets = 16384;
+
+}// namespace ocarina
@@ -0,0 +1,124 @@
+#include "dynamic_resolution.h"
+#include "rhi/renderpass.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ocarina {
+
+namespace {
+
+/// Bound on the accumulated error, so a long stretch at min_scale does not keep the scale
+/// pinned there after the load drops.
+constexpr double kMaxIntegral = 4.0;
+
+[[nodiscard]] uint2 scaled_extent(const RHIRenderPass* render_pass, float scale) noexcept {
+    const uint2 size = render_pass->size();
+    return {
+        std::max(1u, static_cast<uint32_t>(std::lround(static_cast<float>(size.x) * scale))),
+        std::max(1u, static_cast<uint32_t>(std::lround(static_cast<float>(size.y) * scale))),
+    };
+}
+
+}// namespace
+
+void DynamicResolution::add_render_pass(RHIRenderPass* render_pass) noexcept {
+    if (render_pass == nullptr || !render_pass->is_offscreen_renderpass()) {
+        return;
+    }
+    if (std::find(render_passes_.begin(), render_passes_.end(), render_pass) != render_passes_.end()) {
+        return;
+    }
+    render_passes_.push_back(render_pass);
+    const float current = scale();
+    render_pass->set_render_extent(current < 1.0f ? scaled_extent(render_pass, current) : uint2{0, 0});
+}
+
+void DynamicResolution::remove_render_pass(RHIRenderPass* render_pass) noexcept {
+    const auto it = std::find(render_passes_.begin(), render_passes_.end(), render_pass);
+    if (it == render_passes_.end()) {
+        return;
+    }
+    render_pass->set_render_extent({0, 0});
+    render_passes_.erase(it);
+}
+
+void DynamicResolution::set_settings(const DynamicResolutionSettings& settings) noexcept {
+    settings_ = settings;
+    settings_.min_scale = std::clamp(settings_.min_scale, 0.1f, 1.0f);
+    settings_.max_scale = std::clamp(settings_.max_scale, settings_.min_scale, 1.0f);
+    settings_.scale_step = std::max(settings_.scale_step, 0.01f);
+    reset_controller();
+}
+
+bool DynamicResolution::update(double gpu_ms) noexcept {
+    const float current = scale();
+    if (!enabled()) {
+        if (current == 1.0f) {
+            return false;
+        }
+        reset_controller();
+        apply_scale(1.0f);
+        return true;
+    }
+    if (gpu_ms <= 0.0 || settings_.target_gpu_ms <= 0.0) {
+        return false;
+    }
+
+    ++frames_since_change_;
+    const double error = (gpu_ms - settings_.target_gpu_ms) / settings_.target_gpu_ms;
+    const double derivative = error - previous_error_;
+    previous_error_ = error;
+    if (error <= settings_.downscale_threshold && error >= -settings_.upscale_headroom) {
+        // Inside the hysteresis band: hold, and let the integral fade instead of winding up.
+        integral_ *= 0.5;
+        return false;
+    }
+    integral_ = std::clamp(integral_ + error, -kMaxIntegral, kMaxIntegral);
+    if (frames_since_change_ < settings_.settle_frames) {
+        return false;
+    }
+
+    const double control = settings_.kp * error + settings_.ki * integral_ + settings_.kd * derivative;
+    const float desired = std::clamp(static_cast<float>(current - control), settings_.min_scale, settings_.max_scale);
+    const float step = settings_.scale_step;
+    const float snapped = std::clamp(std::round(desired / step) * step, settings_.min_scale, settings_.max_scale);
+    if (std::abs(snapped - current) < step * 0.5f) {
+        return false;
+    }
+    apply_scale(snapped);
+    frames_since_change_ = 0;
+    return true;
+}
+
+float4 DynamicResolution::uv_transform(const RHIRenderPass* render_pass) noexcept {
+    if (render_pass == nullptr || render_pass->size().x == 0 || render_pass->size().y == 0) {
+        return make_float4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    const uint2 size = render_pass->size();
+    const uint2 extent = render_pass->render_extent();
+    const float width = static_cast<float>(size.x);
+    const float height = static_cast<float>(size.y);
+    return make_float4(
+        static_cast<float>(extent.x) / width,
+        static_cast<float>(extent.y) / height,
+        (static_cast<float>(extent.x) - 0.5f) / width,
+        (static_cast<float>(extent.y) - 0.5f) / height);
+}
+
+void DynamicResolution::apply_scale(float scale) noexcept {
+    scale_.store(scale, std::memory_order_relaxed);
+    for (RHIRenderPass* render_pass : render_passes_) {
+        render_pass->set_render_extent(scale < 1.0f ? scaled_extent(render_pass, scale) : uint2{0, 0});
+    }
+    // After the extents: a primitive that sees the new version reads the new uv_transform().
+    scale_version_.fetch_add(1, std::memory_order_release);
+}
+
+void DynamicResolution::reset_controller() noexcept {
+    integral_ = 0.0;
+    previous_error_ = 0.0;
+    frames_since_change_ = 0;
+}
+
+}// namespace ocarina
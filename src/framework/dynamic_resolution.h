@@ -0,0 +1,84 @@
+//
+// Dynamic resolution: steers the render scale of offscreen passes from the GPU frame time.
+// Targets are created once at full size and passes render into their top-left corner
+// (RHIRenderPass::set_render_extent()), so a scale change reallocates nothing; a final pass
+// samples that corner with uv_transform() to upscale it to the swapchain.
+//
+
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "core/concepts.h"
+#include "math/basic_types.h"
+
+#include <atomic>
+
+namespace ocarina {
+class RHIRenderPass;
+
+struct DynamicResolutionSettings {
+    /// GPU frame time the controller steers to.
+    double target_gpu_ms = 1000.0 / 60.0;
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+    /// PID gains on the relative error (gpu_ms - target) / target, in scale per unit of error.
+    float kp = 0.25f;
+    float ki = 0.05f;
+    float kd = 0.1f;
+    /// Hysteresis: the scale drops once the GPU is over the target by more than
+    /// downscale_threshold and only rises again once it is under by more than
+    /// upscale_headroom, so a frame time hovering at the target does not flip it.
+    float downscale_threshold = 0.02f;
+    float upscale_headroom = 0.10f;
+    /// Frames a new scale is held before the next change. GPU times trail the CPU by the
+    /// frames in flight, so anything shorter would react to frames rendered before it.
+    uint32_t settle_frames = 4;
+    /// Scales snap to multiples of this, so small corrections do not resize every frame.
+    float scale_step = 0.05f;
+};
+
+class OC_FRAMEWORK_API DynamicResolution : public concepts::Noncopyable {
+public:
+    /// Render thread, between frames: passes whose extent follows the scale.
+    void add_render_pass(RHIRenderPass* render_pass) noexcept;
+    /// Restores the pass's full extent.
+    void remove_render_pass(RHIRenderPass* render_pass) noexcept;
+
+    /// Any thread; takes effect at the next update(). Disabling renders at full size again.
+    void set_enabled(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+    /// Render thread, between frames.
+    void set_settings(const DynamicResolutionSettings& settings) noexcept;
+    [[nodiscard]] const DynamicResolutionSettings& settings() const noexcept { return settings_; }
+
+    /// Render thread, before any group records: feeds the latest resolved GPU frame time
+    /// (0 when the backend has none, which holds the scale) and applies a new scale to the
+    /// passes. Returns true when the scale changed.
+    bool update(double gpu_ms) noexcept;
+
+    /// Current render scale per axis, 1 at full size.
+    [[nodiscard]] float scale() const noexcept { return scale_.load(std::memory_order_relaxed); }
+    /// Bumped by every scale change. Push constants built from uv_transform() register it
+    /// with Primitive::set_push_constant_version_source() so they refresh with the extent.
+    [[nodiscard]] uint32_t scale_version() const noexcept { return scale_version_.load(std::memory_order_acquire); }
+    [[nodiscard]] const std::atomic<uint32_t>* scale_version_source() const noexcept { return &scale_version_; }
+    /// UV transform for sampling @p render_pass's color at the current extent: xy scales
+    /// full-target UVs to the rendered corner, zw is the UV clamp half a texel inside it.
+    [[nodiscard]] static float4 uv_transform(const RHIRenderPass* render_pass) noexcept;
+
+private:
+    void apply_scale(float scale) noexcept;
+    void reset_controller() noexcept;
+
+    DynamicResolutionSettings settings_;
+    std::vector<RHIRenderPass*> render_passes_;
+    std::atomic<bool> enabled_{false};
+    std::atomic<float> scale_{1.0f};
+    std::atomic<uint32_t> scale_version_{0};
+    double integral_ = 0.0;
+    double previous_error_ = 0.0;
+    uint32_t frames_since_change_ = 0;
+};
+
+}// namespace ocarina
@@ -0,0 +1,115 @@
+#include "entity_chunk_storage.h"
+
+namespace ocarina {
+
+EntityChunkStorage::~EntityChunkStorage() {
+    for (EntityChunk* chunk : chunks_) {
+        ocarina::delete_with_allocator(chunk);
+    }
+    chunks_.clear();
+}
+
+uint32_t EntityChunkStorage::acquire_chunk(ComponentSignature signature) {
+    uint32_t chunk_index = InvalidUI32;
+    if (!free_chunks_.empty()) {
+        chunk_index = free_chunks_.back();
+        free_chunks_.pop_back();
+    } else {
+        chunk_index = static_cast<uint32_t>(chunks_.size());
+        chunks_.push_back(ocarina::new_with_allocator<EntityChunk>());
+    }
+    EntityChunk& chunk = *chunks_[chunk_index];
+    chunk.signature = signature;
+    chunk.count = 0;
+    archetypes_[signature].push_back(chunk_index);
+    return chunk_index;
+}
+
+EntityChunkLocation EntityChunkStorage::add(uint32_t entity_index, ComponentSignature signature) {
+    if (entity_index >= locations_.size()) {
+        locations_.resize(entity_index + 1);
+    }
+    if (locations_[entity_index].valid()) {
+        set_signature(entity_index, signature);
+        return locations_[entity_index];
+    }
+
+    std::vector<uint32_t>& archetype_chunks = archetypes_[signature];
+    uint32_t chunk_index = archetype_chunks.empty() ? InvalidUI32 : archetype_chunks.back();
+    if (chunk_index == InvalidUI32 || chunks_[chunk_index]->full()) {
+        chunk_index = acquire_chunk(signature);
+    }
+
+    EntityChunk& chunk = *chunks_[chunk_index];
+    const uint32_t slot = chunk.count;
+    chunk.entity_index[slot] = entity_index;
+    chunk.bounds_version[slot] = InvalidUI32;
+    chunk.set_bounds(slot, BoundingBox{});
+    ++chunk.count;
+
+    locations_[entity_index] = EntityChunkLocation{chunk_index, slot};
+    return locations_[entity_index];
+}
+
+void EntityChunkStorage::remove(uint32_t entity_index) {
+    const EntityChunkLocation location = this->location(entity_index);
+    if (!location.valid()) {
+        return;
+    }
+
+    EntityChunk& chunk = *chunks_[location.chunk];
+    std::vector<uint32_t>& archetype_chunks = archetypes_[chunk.signature];
+    const uint32_t last_chunk_index = archetype_chunks.back();
+    EntityChunk& last_chunk = *chunks_[last_chunk_index];
+    const uint32_t last_slot = last_chunk.count - 1;
+
+    // Fill the hole with the archetype's last entity so only the tail chunk is partial.
+    if (last_chunk_index != location.chunk || last_slot != location.slot) {
+        const uint32_t moved_entity = last_chunk.entity_index[last_slot];
+        chunk.entity_index[location.slot] = moved_entity;
+        chunk.bounds_version[location.slot] = last_chunk.bounds_version[last_slot];
+        chunk.min_x[location.slot] = last_chunk.min_x[last_slot];
+        chunk.min_y[location.slot] = last_chunk.min_y[last_slot];
+        chunk.min_z[location.slot] = last_chunk.min_z[last_slot];
+        chunk.max_x[location.slot] = last_chunk.max_x[last_slot];
+        chunk.max_y[location.slot] = last_chunk.max_y[last_slot];
+        chunk.max_z[location.slot] = last_chunk.max_z[last_slot];
+        locations_[moved_entity] = location;
+    }
+
+    --last_chunk.count;
+    if (last_chunk.count == 0) {
+        archetype_chunks.pop_back();
+        free_chunks_.push_back(last_chunk_index);
+    }
+    locations_[entity_index] = EntityChunkLocation{};
+}
+
+void EntityChunkStorage::set_signature(uint32_t entity_index, ComponentSignature signature) {
+    const EntityChunkLocation location = this->location(entity_index);
+    if (location.valid() && chunks_[location.chunk]->signature == signature) {
+        return;
+    }
+    remove(entity_index);
+    add(entity_index, signature);
+}
+
+void EntityChunkStorage::collect_chunks(ComponentSignature required, std::vector<EntityChunkRange>& out) const {
+    for (const auto& [signature, archetype_chunks] : archetypes_) {
+        if ((signature & required) != required) {
+            continue;
+        }
+        for (uint32_t chunk_index : archetype_chunks) {
+            EntityChunk* chunk = chunks_[chunk_index];
+            if (chunk->count > 0) {
+                out.push_back(EntityChunkRange{chunk, chunk->count});
+            }
+        }
+    }
+}
+
+size_t EntityChunkStorage::memory_bytes() const noexcept {
+    return chunks_.size() * sizeof(EntityChunk) + locations_.capacity() * sizeof(EntityChunkLocation);
+}
+
+}// namespace ocarina
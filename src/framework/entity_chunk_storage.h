@@ -0,0 +1,146 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "bounding_box.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+namespace ocarina {
+
+/// Bitmask of the components an entity carries. Entities with equal signatures share chunks.
+using ComponentSignature = uint32_t;
+
+enum ComponentSignatureBits : ComponentSignature {
+    kTransformComponentBit = 1u << 0,
+    kRenderComponentBit = 1u << 1,
+    kLightComponentBit = 1u << 2,
+    /// Entity has a mesh with local bounds; its world AABB is kept in the chunk.
+    kWorldBoundsComponentBit = 1u << 3,
+};
+
+inline constexpr ComponentSignature kPrimitiveSignature =
+    kTransformComponentBit | kRenderComponentBit | kWorldBoundsComponentBit;
+
+/// Fixed 16 KB block of hot per-entity data in SoA layout. Only what culling streams
+/// through lives here; Primitive / RenderComponent / LightComponent stay in the
+/// entity-indexed cold arrays of EntityComponentSystem.
+struct alignas(64) EntityChunk {
+    static constexpr size_t kDataBytes = 16 * 1024;
+    static constexpr uint32_t kBytesPerEntity = 6 * sizeof(float) + 2 * sizeof(uint32_t);
+    static constexpr uint32_t kCapacity = static_cast<uint32_t>(kDataBytes / kBytesPerEntity);
+
+    // World-space AABB. min_x > max_x marks an entity without bounds (always visible).
+    float min_x[kCapacity];
+    float min_y[kCapacity];
+    float min_z[kCapacity];
+    float max_x[kCapacity];
+    float max_y[kCapacity];
+    float max_z[kCapacity];
+    uint32_t entity_index[kCapacity];
+    /// TransformComponent version the bounds were built from; InvalidUI32 forces a refresh.
+    uint32_t bounds_version[kCapacity];
+
+    ComponentSignature signature = 0;
+    uint32_t count = 0;
+
+    [[nodiscard]] bool full() const noexcept { return count == kCapacity; }
+
+    void set_bounds(uint32_t slot, const BoundingBox& bounds) noexcept {
+        if (!bounds.valid) {
+            min_x[slot] = min_y[slot] = min_z[slot] = std::numeric_limits<float>::max();
+            max_x[slot] = max_y[slot] = max_z[slot] = -std::numeric_limits<float>::max();
+            return;
+        }
+        min_x[slot] = bounds.min.x;
+        min_y[slot] = bounds.min.y;
+        min_z[slot] = bounds.min.z;
+        max_x[slot] = bounds.max.x;
+        max_y[slot] = bounds.max.y;
+        max_z[slot] = bounds.max.z;
+    }
+
+    [[nodiscard]] bool has_bounds(uint32_t slot) const noexcept { return min_x[slot] <= max_x[slot]; }
+};
+
+static_assert(offsetof(EntityChunk, signature) == EntityChunk::kCapacity * EntityChunk::kBytesPerEntity);
+static_assert(EntityChunk::kCapacity * EntityChunk::kBytesPerEntity <= EntityChunk::kDataBytes);
+
+struct EntityChunkLocation {
+    uint32_t chunk = InvalidUI32;
+    uint32_t slot = InvalidUI32;
+
+    [[nodiscard]] bool valid() const noexcept { return chunk != InvalidUI32; }
+};
+
+/// Chunk plus the entity count observed when a query snapshot was taken.
+struct EntityChunkRange {
+    EntityChunk* chunk = nullptr;
+    uint32_t count = 0;
+};
+
+/// Archetype storage: chunks are grouped by ComponentSignature and kept dense by
+/// swap-removing from the archetype's last chunk. Chunk addresses are stable for the
+/// lifetime of the storage, so query snapshots stay valid while entities are added.
+/// Not thread-safe; EntityComponentSystem serializes access.
+class EntityChunkStorage {
+public:
+    EntityChunkStorage() = default;
+    ~EntityChunkStorage();
+
+    EntityChunkStorage(const EntityChunkStorage&) = delete;
+    EntityChunkStorage& operator=(const EntityChunkStorage&) = delete;
+
+    EntityChunkLocation add(uint32_t entity_index, ComponentSignature signature);
+    void remove(uint32_t entity_index);
+    /// Move an entity to the archetype for @p signature (no-op when unchanged).
+    void set_signature(uint32_t entity_index, ComponentSignature signature);
+
+    [[nodiscard]] EntityChunkLocation location(uint32_t entity_index) const noexcept {
+        return entity_index < locations_.size() ? locations_[entity_index] : EntityChunkLocation{};
+    }
+
+    [[nodiscard]] EntityChunk& chunk(uint32_t chunk_index) noexcept { return *chunks_[chunk_index]; }
+    [[nodiscard]] const EntityChunk& chunk(uint32_t chunk_index) const noexcept { return *chunks_[chunk_index]; }
+    [[nodiscard]] uint32_t chunk_count() const noexcept { return static_cast<uint32_t>(chunks_.size()); }
+
+    /// Appends every non-empty chunk whose signature contains all @p required bits.
+    void collect_chunks(ComponentSignature required, std::vector<EntityChunkRange>& out) const;
+
+    [[nodiscard]] size_t memory_bytes() const noexcept;
+
+private:
+    [[nodiscard]] uint32_t acquire_chunk(ComponentSignature signature);
+
+    std::vector<EntityChunk*> chunks_;
+    std::vector<uint32_t> free_chunks_;
+    /// Chunk indices per signature; every chunk but the last is full.
+    std::unordered_map<ComponentSignature, std::vector<uint32_t>> archetypes_;
+    std::vector<EntityChunkLocation> locations_;
+};
+
+/// Runs a function over a snapshot of chunks, one chunk per enkiTS range.
+class EntityChunkQueryTask : public enki::ITaskSet {
+public:
+    using ChunkFunction = ocarina::function<void(EntityChunk&, uint32_t count)>;
+
+    void configure(const std::vector<EntityChunkRange>* chunks, ChunkFunction function) {
+        chunks_ = chunks;
+        function_ = std::move(function);
+        m_SetSize = chunks_ != nullptr ? static_cast<uint32_t>(chunks_->size()) : 0u;
+        m_MinRange = 1;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)threadnum;
+        for (uint32_t i = range.start; i < range.end; ++i) {
+            const EntityChunkRange& entry = (*chunks_)[i];
+            function_(*entry.chunk, entry.count);
+        }
+    }
+
+private:
+    const std::vector<EntityChunkRange>* chunks_ = nullptr;
+    ChunkFunction function_;
+};
+
+}// namespace ocarina
@@ -1,12 +1,16 @@
 
 #include "entity_component_system.h"
 #include "math.h"
+#include "mesh.h"
+#include "core/profiler.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+#include <algorithm>
+#include <cstring>
 
 namespace ocarina {
 
 EntityComponentSystem::EntityComponentSystem() {
     gpu_transforms_.resize(kDefaultGpuTransformCapacity);
-    gpu_transform_versions_.assign(kDefaultGpuTransformCapacity, InvalidUI32);
 }
 
 EntityComponentSystem& EntityComponentSystem::instance() noexcept {
@@ -24,29 +28,486 @@ void EntityComponentSystem::ensure_gpu_transform_capacity(size_t entity_count) {
         new_capacity *= 2;
     }
 
+    // Slots only become dirty once their entity is synced; growing the mirror uploads nothing.
     gpu_transforms_.resize(new_capacity);
-    gpu_transform_versions_.resize(new_capacity, InvalidUI32);
-    mark_gpu_transforms_dirty();
 }
 
-void EntityComponentSystem::sync_gpu_transforms() {
-    std::lock_guard<std::mutex> lock(components_mutex_);
-    const size_t count = transform_components_.size();
-    ensure_gpu_transform_capacity(count);
+void EntityComponentSystem::mark_gpu_transforms_dirty() {
+    std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+    gpu_transform_dirty_ranges_.mark_all(transform_components_.size() * sizeof(GPUTransform));
+}
+
+bool EntityComponentSystem::gpu_transforms_dirty() const {
+    std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+    return !gpu_transform_dirty_ranges_.empty();
+}
+
+size_t EntityComponentSystem::take_gpu_transform_upload_ranges(std::vector<BufferCopyRange>& out, size_t limit_bytes) {
+    std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+    const size_t bytes = gpu_transform_dirty_ranges_.collect(out, limit_bytes);
+    gpu_transform_dirty_ranges_.clear();
+    return bytes;
+}
+
+namespace {
+
+/// Dirty entries per enkiTS range; small enough to balance, large enough to amortize the lock.
+constexpr uint32_t kTransformSyncBatchSize = 1024;
+
+class TransformSyncTask : public enki::ITaskSet {
+public:
+    using RangeFunction = ocarina::function<void(uint32_t, uint32_t)>;
+
+    TransformSyncTask(uint32_t count, RangeFunction function)
+        : function_(std::move(function)) {
+        m_SetSize = count;
+        m_MinRange = kTransformSyncBatchSize;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)threadnum;
+        function_(range.start, range.end);
+    }
+
+private:
+    RangeFunction function_;
+};
+
+}// namespace
+
+void enqueue_transform_sync(uint32_t entity_index) {
+    EntityComponentSystem::instance().queue_transform_sync(entity_index);
+}
+
+void enqueue_hierarchy_update(uint32_t entity_index) {
+    EntityComponentSystem::instance().queue_hierarchy_update(entity_index);
+}
+
+void EntityComponentSystem::queue_transform_sync(uint32_t entity_index) {
+    std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+    pending_transform_sync_.push_back(entity_index);
+    pending_transform_sync_count_.store(static_cast<uint32_t>(pending_transform_sync_.size()), std::memory_order_release);
+}
+
+void EntityComponentSystem::request_transform_sync(uint32_t entity_index) {
+    if (transform_components_[entity_index].try_claim_sync_queue()) {
+        queue_transform_sync(entity_index);
+    }
+}
+
+void EntityComponentSystem::sync_gpu_transform_range(uint32_t begin, uint32_t end) {
+    // Shared: batches run concurrently; entity creation / destruction waits for one batch.
+    std::shared_lock<std::shared_mutex> lock(components_mutex_);
+    for (uint32_t i = begin; i < end; ++i) {
+        const uint32_t entity_index = transform_sync_batch_[i];
+        if (!is_alive_unlocked(entity_index)) {
+            continue;
+        }
+        TransformComponent& transform = transform_components_[entity_index];
+        transform.clear_sync_queued();
+        const float4x4& world_matrix = transform.get_world_matrix();
+        // Quantized meshes decode positions in the model matrix; normals only see the world
+        // matrix, so the inverse stays the world's.
+        const Mesh* mesh = primitives_[entity_index].get_mesh();
+        gpu_transforms_[entity_index].model_matrix =
+            mesh != nullptr && mesh->is_quantized() ? world_matrix * mesh->position_decode_matrix() : world_matrix;
+        gpu_transforms_[entity_index].model_matrix_inverse = inverse(world_matrix);
+    }
+}
+
+void EntityComponentSystem::sync_gpu_transforms(enki::TaskScheduler* scheduler) {
+    OC_PROFILE_FUNCTION;
+    {
+        std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+        transform_sync_batch_.clear();
+        transform_sync_batch_.swap(pending_transform_sync_);
+        pending_transform_sync_count_.store(0u, std::memory_order_release);
+    }
+    if (transform_sync_batch_.empty()) {
+        return;
+    }
+
+    const uint32_t count = static_cast<uint32_t>(transform_sync_batch_.size());
+    if (scheduler == nullptr || count <= kTransformSyncBatchSize) {
+        sync_gpu_transform_range(0, count);
+    } else {
+        TransformSyncTask task(count, [this](uint32_t begin, uint32_t end) {
+            sync_gpu_transform_range(begin, end);
+        });
+        scheduler->AddTaskSetToPipe(&task);
+        scheduler->WaitforTask(&task);
+    }
 
-    for (size_t entity_index = 0; entity_index < count; ++entity_index) {
+    std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+    for (uint32_t entity_index : transform_sync_batch_) {
+        gpu_transform_dirty_ranges_.mark(size_t{entity_index} * sizeof(GPUTransform), sizeof(GPUTransform));
+    }
+}
+
+void EntityComponentSystem::queue_hierarchy_update(uint32_t entity_index) {
+    std::lock_guard<std::mutex> lock(transform_sync_mutex_);
+    pending_hierarchy_updates_.push_back(entity_index);
+}
+
+void EntityComponentSystem::apply_hierarchy_membership() {
+    for (uint32_t entity_index : hierarchy_touched_) {
+        if (is_alive_unlocked(entity_index)) {
+            transform_components_[entity_index].set_hierarchy_node(transform_hierarchy_.contains(entity_index));
+        }
+    }
+    hierarchy_touched_.clear();
+}
+
+bool EntityComponentSystem::set_parent(uint32_t child, uint32_t parent) {
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+    if (!is_alive_unlocked(child) || (parent != InvalidUI32 && !is_alive_unlocked(parent))) {
+        return false;
+    }
+    if (!transform_hierarchy_.set_parent(child, parent, hierarchy_touched_)) {
+        return false;
+    }
+    apply_hierarchy_membership();
+    return true;
+}
+
+uint32_t EntityComponentSystem::set_parents(span<const EntityParentLink> links) {
+    if (links.empty()) {
+        return 0;
+    }
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+    uint32_t linked = 0;
+    for (const EntityParentLink& link : links) {
+        if (!is_alive_unlocked(link.child) || (link.parent != InvalidUI32 && !is_alive_unlocked(link.parent))) {
+            continue;
+        }
+        if (transform_hierarchy_.set_parent(link.child, link.parent, hierarchy_touched_)) {
+            ++linked;
+        }
+    }
+    apply_hierarchy_membership();
+    return linked;
+}
+
+void EntityComponentSystem::propagate_transforms(enki::TaskScheduler* scheduler) {
+    OC_PROFILE_FUNCTION;
+    // The render and loader threads both propagate; the pass itself only needs the shared
+    // lock, so creation and culling keep running alongside it.
+    std::lock_guard<std::mutex> propagate_lock(hierarchy_propagate_mutex_);
+    {
+        std::lock_guard<std::mutex> sync_lock(transform_sync_mutex_);
+        hierarchy_update_batch_.clear();
+        hierarchy_update_batch_.swap(pending_hierarchy_updates_);
+    }
+    {
+        std::shared_lock<std::shared_mutex> lock(components_mutex_);
+        for (uint32_t entity_index : hierarchy_update_batch_) {
+            if (!is_alive_unlocked(entity_index)) {
+                continue;
+            }
+            transform_components_[entity_index].clear_hierarchy_queued();
+            transform_hierarchy_.mark_dirty(entity_index);
+        }
+    }
+
+    hierarchy_changed_.clear();
+    transform_hierarchy_.propagate(transform_components_, scheduler, hierarchy_changed_, &components_mutex_);
+    if (hierarchy_changed_.empty()) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(components_mutex_);
+    std::lock_guard<std::mutex> sync_lock(transform_sync_mutex_);
+    for (uint32_t entity_index : hierarchy_changed_) {
+        if (entity_index < transform_components_.size() && transform_components_[entity_index].try_claim_sync_queue()) {
+            pending_transform_sync_.push_back(entity_index);
+        }
+    }
+    pending_transform_sync_count_.store(static_cast<uint32_t>(pending_transform_sync_.size()), std::memory_order_release);
+}
+
+void EntityComponentSystem::mark_world_bounds_dirty(uint32_t entity_index) {
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+    const EntityChunkLocation location = chunk_storage_.location(entity_index);
+    if (location.valid()) {
+        chunk_storage_.chunk(location.chunk).bounds_version[location.slot] = InvalidUI32;
+    }
+}
+
+void EntityComponentSystem::refresh_chunk_world_bounds(EntityChunk& chunk, uint32_t count) {
+    // Shared: chunks refresh concurrently; entity creation / destruction waits for one chunk.
+    std::shared_lock<std::shared_mutex> lock(components_mutex_);
+    count = std::min(count, chunk.count);
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        const uint32_t entity_index = chunk.entity_index[slot];
         const TransformComponent& transform = transform_components_[entity_index];
         const uint32_t version = transform.transform_version();
-        if (version == gpu_transform_versions_[entity_index]) {
+        if (version == chunk.bounds_version[slot]) {
             continue;
         }
 
-        const float4x4& world_matrix = transform.get_world_matrix();
-        gpu_transforms_[entity_index].model_matrix = world_matrix;
-        gpu_transforms_[entity_index].model_matrix_inverse = inverse(world_matrix);
-        gpu_transform_versions_[entity_index] = version;
-        gpu_transforms_dirty_ = true;
+        const Mesh* mesh = primitives_[entity_index].get_mesh();
+        if (mesh == nullptr || !mesh->has_local_bounds()) {
+            // Leave the version stale so bounds are picked up once the mesh finishes loading.
+            chunk.set_bounds(slot, BoundingBox{});
+            continue;
+        }
+        chunk.set_bounds(slot, mesh->get_local_bounds().transformed(transform.get_world_matrix()));
+        chunk.bounds_version[slot] = version;
+    }
+}
+
+void EntityComponentSystem::refresh_world_bounds(enki::TaskScheduler& scheduler) {
+    OC_PROFILE_FUNCTION;
+    {
+        // Chunk addresses are stable; each task re-takes the lock for the chunk contents.
+        std::lock_guard<std::shared_mutex> lock(components_mutex_);
+        bounds_query_chunks_.clear();
+        chunk_storage_.collect_chunks(kWorldBoundsComponentBit, bounds_query_chunks_);
+    }
+    if (bounds_query_chunks_.empty()) {
+        return;
+    }
+
+    EntityChunkQueryTask task;
+    task.configure(&bounds_query_chunks_, [this](EntityChunk& chunk, uint32_t count) {
+        refresh_chunk_world_bounds(chunk, count);
+    });
+    scheduler.AddTaskSetToPipe(&task);
+    scheduler.WaitforTask(&task);
+}
+
+void EntityComponentSystem::collect_chunks(ComponentSignature required, std::vector<EntityChunkRange>& out) const {
+    std::shared_lock<std::shared_mutex> lock(components_mutex_);
+    chunk_storage_.collect_chunks(required, out);
+}
+
+size_t EntityComponentSystem::cold_memory_bytes() const noexcept {
+    return primitives_.capacity() * sizeof(Primitive) +
+           generations_.capacity() * sizeof(uint32_t) +
+           slot_states_.capacity() * sizeof(EntitySlotState) +
+           render_components_.capacity() * sizeof(RenderComponent) +
+           transform_components_.capacity() * sizeof(TransformComponent) +
+           light_components_.capacity() * sizeof(LightComponent) +
+           gpu_transforms_.capacity() * sizeof(GPUTransform);
+}
+
+uint32_t EntityComponentSystem::acquire_entity_slot() {
+    if (!free_slots_.empty()) {
+        // Free slots were reset when they finished retiring.
+        const uint32_t entity_index = free_slots_.back();
+        free_slots_.pop_back();
+        return entity_index;
+    }
+
+    const uint32_t entity_index = static_cast<uint32_t>(primitives_.size());
+    primitives_.emplace_back();
+    render_components_.emplace_back();
+    transform_components_.emplace_back();
+    slot_states_.push_back(EntitySlotState::Free);
+    if (generations_.size() <= entity_index) {
+        generations_.push_back(0);
+    }
+    return entity_index;
+}
+
+void EntityComponentSystem::finish_entity_creation(uint32_t entity_index) {
+    primitives_[entity_index].set_entity_index(entity_index);
+    slot_states_[entity_index] = EntitySlotState::Alive;
+    ++alive_entity_count_;
+    chunk_storage_.add(entity_index, kPrimitiveSignature);
+    ensure_gpu_transform_capacity(primitives_.size());
+    transform_components_[entity_index].bind_entity(entity_index);
+    request_transform_sync(entity_index);
+}
+
+EntityBatch EntityComponentSystem::create_entities(uint32_t count) {
+    OC_PROFILE_FUNCTION;
+    if (count == 0) {
+        return EntityBatch{};
+    }
+
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+    const uint32_t first_entity = static_cast<uint32_t>(primitives_.size());
+    const size_t new_size = size_t{first_entity} + count;
+    primitives_.resize(new_size);
+    render_components_.resize(new_size);
+    transform_components_.resize(new_size);
+    slot_states_.resize(new_size, EntitySlotState::Alive);
+    if (generations_.size() < new_size) {
+        generations_.resize(new_size, 0);
+    }
+    ensure_gpu_transform_capacity(new_size);
+
+    for (uint32_t entity_index = first_entity; entity_index < new_size; ++entity_index) {
+        primitives_[entity_index].set_entity_index(entity_index);
+        chunk_storage_.add(entity_index, kPrimitiveSignature);
+        transform_components_[entity_index].bind_entity(entity_index);
+        // Claimed up front so transform setters on the new entities never take the sync lock.
+        // Nothing is queued yet: a sync running while the batch is filled would upload
+        // half-written matrices, so commit_entities() queues the batch once it is done.
+        (void)transform_components_[entity_index].try_claim_sync_queue();
+    }
+    alive_entity_count_ += count;
+
+    EntityBatch batch;
+    batch.first_entity = first_entity;
+    batch.count = count;
+    batch.primitives = span<Primitive>(primitives_.data() + first_entity, count);
+    batch.transforms = span<TransformComponent>(transform_components_.data() + first_entity, count);
+    batch.render_components = span<RenderComponent>(render_components_.data() + first_entity, count);
+    return batch;
+}
+
+void EntityComponentSystem::commit_entities(const EntityBatch& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> sync_lock(transform_sync_mutex_);
+    pending_transform_sync_.reserve(pending_transform_sync_.size() + batch.count);
+    for (uint32_t i = 0; i < batch.count; ++i) {
+        pending_transform_sync_.push_back(batch.entity_index(i));
+    }
+    pending_transform_sync_count_.store(static_cast<uint32_t>(pending_transform_sync_.size()), std::memory_order_release);
+}
+
+uint32_t EntityComponentSystem::allocate_push_constant_region(uint32_t size) {
+    const auto it = free_push_constant_regions_.find(size);
+    if (it != free_push_constant_regions_.end() && !it->second.empty()) {
+        const uint32_t offset = it->second.back();
+        it->second.pop_back();
+        std::memset(push_constant_buffer_.data() + offset, 0, size);
+        return offset;
+    }
+    const uint32_t offset = static_cast<uint32_t>(push_constant_buffer_.size());
+    push_constant_buffer_.resize(offset + size);
+    return offset;
+}
+
+void EntityComponentSystem::free_push_constant_region(uint32_t offset, uint32_t size) {
+    if (offset == InvalidUI32 || size == 0) {
+        return;
+    }
+    free_push_constant_regions_[size].push_back(offset);
+}
+
+void EntityComponentSystem::reset_entity_slot(uint32_t entity_index) {
+    primitives_[entity_index].release_push_constant_region();
+    primitives_[entity_index] = Primitive{};
+    render_components_[entity_index] = RenderComponent{};
+    transform_components_[entity_index] = TransformComponent{};
+    if (entity_index < light_components_.size()) {
+        light_components_[entity_index] = LightComponent{};
+    }
+}
+
+bool EntityComponentSystem::destroy_entity(const EntityHandle& handle) {
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+    if (!is_alive_unlocked(handle)) {
+        return false;
     }
+
+    const uint32_t entity_index = handle.index;
+    ++generations_[entity_index];
+    --alive_entity_count_;
+    chunk_storage_.remove(entity_index);
+    // Children become roots and keep their local TRS as world transform.
+    transform_hierarchy_.remove_entity(entity_index, hierarchy_touched_);
+    apply_hierarchy_membership();
+    retire_entity_slot(entity_index);
+    return true;
+}
+
+void EntityComponentSystem::retire_entity_slot(uint32_t entity_index) {
+    slot_states_[entity_index] = EntitySlotState::Retiring;
+    retiring_slots_.push_back(RetiringSlot{entity_index, frame_index_ + kEntityRetireFrameLatency});
+}
+
+void EntityComponentSystem::advance_frame() {
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+    ++frame_index_;
+    while (!retiring_slots_.empty() && retiring_slots_.front().free_frame <= frame_index_) {
+        const uint32_t entity_index = retiring_slots_.front().entity_index;
+        retiring_slots_.pop_front();
+        reset_entity_slot(entity_index);
+        slot_states_[entity_index] = EntitySlotState::Free;
+        free_slots_.push_back(entity_index);
+    }
+}
+
+void EntityComponentSystem::move_entity_slot(uint32_t from, uint32_t to) {
+    const EntityChunkLocation location = chunk_storage_.location(from);
+    const ComponentSignature signature = location.valid()
+        ? chunk_storage_.chunk(location.chunk).signature
+        : kPrimitiveSignature;
+
+    primitives_[to] = std::move(primitives_[from]);
+    primitives_[to].set_entity_index(to);
+    render_components_[to] = render_components_[from];
+    transform_components_[to] = transform_components_[from];
+    if (from < light_components_.size() && to < light_components_.size()) {
+        light_components_[to] = light_components_[from];
+    }
+    gpu_transforms_[to] = gpu_transforms_[from];
+    transform_components_[to].bind_entity(to);
+    request_transform_sync(to);
+    transform_hierarchy_.move_entity(from, to);
+
+    chunk_storage_.remove(from);
+    chunk_storage_.add(to, signature);
+
+    slot_states_[to] = EntitySlotState::Alive;
+    ++generations_[from];
+    // Frames in flight drew the entity from this slot: keep its GPU transform until they
+    // retire. advance_frame() resets it then.
+    retire_entity_slot(from);
+}
+
+void EntityComponentSystem::pop_entity_slot() {
+    primitives_.pop_back();
+    render_components_.pop_back();
+    transform_components_.pop_back();
+    slot_states_.pop_back();
+    if (light_components_.size() > primitives_.size()) {
+        light_components_.resize(primitives_.size());
+    }
+}
+
+uint32_t EntityComponentSystem::compact(uint32_t max_moves, std::vector<EntityMove>& out_moves) {
+    OC_PROFILE_FUNCTION;
+    std::lock_guard<std::shared_mutex> lock(components_mutex_);
+
+    // Fill the lowest holes with the highest live entities; trim free slots off the tail.
+    // Retiring slots (destroyed or vacated by a move) stay put until frames in flight are
+    // done with them, so they are neither moved nor trimmed.
+    std::sort(free_slots_.begin(), free_slots_.end());
+    uint32_t move_count = 0;
+    size_t hole_cursor = 0;
+    uint32_t source_end = static_cast<uint32_t>(slot_states_.size());
+    while (hole_cursor < free_slots_.size() && move_count < max_moves) {
+        const uint32_t hole = free_slots_[hole_cursor];
+        while (source_end > 0 && slot_states_[source_end - 1] != EntitySlotState::Alive) {
+            --source_end;
+        }
+        if (source_end == 0 || source_end - 1 <= hole) {
+            break;
+        }
+
+        const uint32_t source = source_end - 1;
+        move_entity_slot(source, hole);
+        out_moves.push_back(EntityMove{source, hole});
+        --source_end;
+        ++hole_cursor;
+        ++move_count;
+    }
+    while (!slot_states_.empty() && slot_states_.back() == EntitySlotState::Free) {
+        pop_entity_slot();
+    }
+
+    free_slots_.erase(free_slots_.begin(), free_slots_.begin() + static_cast<ptrdiff_t>(hole_cursor));
+    const size_t slot_count = slot_states_.size();
+    std::erase_if(free_slots_, [slot_count](uint32_t entity_index) { return entity_index >= slot_count; });
+    // Moved entities were queued for sync individually by move_entity_slot().
+    return move_count;
 }
 
 }// namespace ocarina
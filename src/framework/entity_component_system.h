@@ -8,7 +8,15 @@
 #include "render_component.h"
 #include "transform_component.h"
 #include "light_component.h"
+#include "entity_chunk_storage.h"
+#include "transform_hierarchy.h"
+#include "dirty_range_set.h"
+#include <atomic>
+#include <deque>
 #include <mutex>
+#include <shared_mutex>
+
+namespace enki { class TaskScheduler; }
 
 namespace ocarina {
 
@@ -42,40 +50,139 @@ static_assert(sizeof(MaterialParams) == 64);
 static_assert(offsetof(MaterialParams, roughness) == 16);
 static_assert(offsetof(MaterialParams, metallicRoughnessSamplerIndex) == 48);
 
+/// Stable reference to an ECS entity. The generation is bumped when the entity is destroyed,
+/// so handles to a destroyed (or recycled) slot stop resolving.
+struct EntityHandle {
+    uint32_t index = InvalidUI32;
+    uint32_t generation = 0;
+
+    [[nodiscard]] bool valid() const noexcept { return index != InvalidUI32; }
+    [[nodiscard]] bool operator==(const EntityHandle& other) const noexcept {
+        return index == other.index && generation == other.generation;
+    }
+};
+
+/// Slot relocation reported by EntityComponentSystem::compact().
+struct EntityMove {
+    uint32_t from = InvalidUI32;
+    uint32_t to = InvalidUI32;
+};
+
+/// Contiguous entities returned by EntityComponentSystem::create_entities(). The spans
+/// alias the ECS arrays: distinct entities may be filled from different threads, but the
+/// views are invalidated by the next entity creation, so create everything first.
+struct EntityBatch {
+    uint32_t first_entity = InvalidUI32;
+    uint32_t count = 0;
+    span<Primitive> primitives;
+    span<TransformComponent> transforms;
+    span<RenderComponent> render_components;
+
+    [[nodiscard]] bool empty() const noexcept { return count == 0; }
+    [[nodiscard]] uint32_t entity_index(uint32_t i) const noexcept { return first_entity + i; }
+};
+
+/// One EntityComponentSystem::set_parents() link.
+struct EntityParentLink {
+    uint32_t child = InvalidUI32;
+    uint32_t parent = InvalidUI32;
+};
+
+enum class EntitySlotState : uint8_t {
+    Alive = 0,
+    /// Destroyed, but frames still in flight may reference the slot (transform index).
+    Retiring,
+    /// Reusable by the next emplace_primitive().
+    Free,
+};
+
 class EntityComponentSystem : public concepts::Noncopyable {
 public:
     static constexpr size_t kDefaultGpuTransformCapacity = 1024;
+    /// Frames a destroyed slot stays retired before reuse. Covers the backend's frames in
+    /// flight (at most 3) plus the frame currently being recorded.
+    static constexpr uint32_t kEntityRetireFrameLatency = 4;
     static constexpr const char* kTransformsBufferName = "transforms";
     static constexpr size_t kDefaultMaterialParamsCapacity = 256;
     static constexpr const char* kMaterialsBufferName = "g_materials";
 
     static EntityComponentSystem& instance() noexcept;
 
+    /// Creates an entity, reusing a free slot when one has fully retired.
     template<typename... Args>
     uint32_t emplace_primitive(Args&&... args) {
-        std::lock_guard<std::mutex> lock(components_mutex_);
-        const uint32_t entity_index = static_cast<uint32_t>(primitives_.size());
-        render_components_.emplace_back();
-        transform_components_.emplace_back();
-        primitives_.emplace_back(OC_FORWARD(args)...);
-        primitives_.back().set_entity_index(entity_index);
-        ensure_gpu_transform_capacity(primitives_.size());
-        mark_gpu_transforms_dirty();
+        std::lock_guard<std::shared_mutex> lock(components_mutex_);
+        const uint32_t entity_index = acquire_entity_slot();
+        primitives_[entity_index] = Primitive(OC_FORWARD(args)...);
+        finish_entity_creation(entity_index);
         return entity_index;
     }
 
     uint32_t emplace_primitive(Primitive&& primitive) {
-        std::lock_guard<std::mutex> lock(components_mutex_);
-        const uint32_t entity_index = static_cast<uint32_t>(primitives_.size());
-        render_components_.emplace_back();
-        transform_components_.emplace_back();
-        primitives_.push_back(std::move(primitive));
-        primitives_.back().set_entity_index(entity_index);
-        ensure_gpu_transform_capacity(primitives_.size());
-        mark_gpu_transforms_dirty();
+        std::lock_guard<std::shared_mutex> lock(components_mutex_);
+        const uint32_t entity_index = acquire_entity_slot();
+        primitives_[entity_index] = std::move(primitive);
+        finish_entity_creation(entity_index);
         return entity_index;
     }
 
+    /// Appends @p count entities at the tail of the arrays under a single lock (free slots
+    /// are left for emplace_primitive so the batch stays contiguous). The entities start with
+    /// default components and their transform sync entry already claimed, so filling them in
+    /// does not touch the ECS locks. The GPU transform sync skips them until
+    /// commit_entities() publishes the filled batch.
+    EntityBatch create_entities(uint32_t count);
+    /// Queues a filled create_entities() batch for GPU transform sync, under one lock.
+    void commit_entities(const EntityBatch& batch);
+
+    /// Handle / liveness queries take the shared lock, since create / destroy / compact
+    /// rewrite generations and slot states from other threads. Loops that already hold
+    /// lock_components_shared() pass it to the overloads instead of locking per entity.
+    [[nodiscard]] EntityHandle handle(uint32_t entity_index) const {
+        const std::shared_lock<std::shared_mutex> lock(components_mutex_);
+        return handle_unlocked(entity_index);
+    }
+    [[nodiscard]] EntityHandle handle(uint32_t entity_index, const std::shared_lock<std::shared_mutex>& held) const noexcept {
+        OC_ASSERT(held.mutex() == &components_mutex_ && held.owns_lock());
+        return handle_unlocked(entity_index);
+    }
+
+    [[nodiscard]] bool is_alive(uint32_t entity_index) const {
+        const std::shared_lock<std::shared_mutex> lock(components_mutex_);
+        return is_alive_unlocked(entity_index);
+    }
+    [[nodiscard]] bool is_alive(uint32_t entity_index, const std::shared_lock<std::shared_mutex>& held) const noexcept {
+        OC_ASSERT(held.mutex() == &components_mutex_ && held.owns_lock());
+        return is_alive_unlocked(entity_index);
+    }
+
+    [[nodiscard]] bool is_alive(const EntityHandle& handle) const {
+        const std::shared_lock<std::shared_mutex> lock(components_mutex_);
+        return is_alive_unlocked(handle);
+    }
+
+    /// Destroys the entity now (stale handles stop resolving, culling skips it) but keeps
+    /// its slot retired for kEntityRetireFrameLatency frames before it can be reused or
+    /// trimmed, since frames in flight still read its GPU transform.
+    /// Scenes holding the entity must drop it themselves (see Scene::destroy_entity).
+    bool destroy_entity(const EntityHandle& handle);
+
+    /// Once per frame on the render thread: frees slots whose retire latency has elapsed.
+    void advance_frame();
+    [[nodiscard]] uint64_t frame_index() const noexcept { return frame_index_; }
+
+    /// Moves live entities from the tail of the arrays into free slots (at most @p max_moves)
+    /// and trims free tail slots, appending each relocation to @p out_moves. Moved entities
+    /// get new handles; owners must apply the moves (Scene::apply_entity_moves). GPU
+    /// transforms move with their entities. A vacated tail slot retires like a destroyed
+    /// one, so frames in flight keep reading its old GPU transform until it is trimmed or
+    /// reused. Call between frames, like advance_frame().
+    uint32_t compact(uint32_t max_moves, std::vector<EntityMove>& out_moves);
+
+    [[nodiscard]] uint32_t alive_entity_count() const noexcept { return alive_entity_count_; }
+    [[nodiscard]] uint32_t free_slot_count() const noexcept { return static_cast<uint32_t>(free_slots_.size()); }
+    [[nodiscard]] uint32_t retiring_slot_count() const noexcept { return static_cast<uint32_t>(retiring_slots_.size()); }
+
     [[nodiscard]] uint32_t allocate_material_buffer_region(uint32_t size) {
         const uint32_t offset = static_cast<uint32_t>(material_parameters_buffer_.size());
         material_parameters_buffer_.resize(offset + size);
@@ -90,20 +197,49 @@ public:
         return material_parameters_buffer_;
     }
 
+    /// Contiguous push-constant blobs of all primitives; RenderComponent::push_constant_offset
+    /// indexes it. Regions are allocated on the render thread while no render-component
+    /// update or recording task runs, since growth moves the storage. Freed regions are
+    /// reused by later allocations of the same size, so entity churn does not grow it.
+    [[nodiscard]] uint32_t allocate_push_constant_region(uint32_t size);
+    void free_push_constant_region(uint32_t offset, uint32_t size);
+
+    [[nodiscard]] std::vector<std::byte>& push_constant_buffer() noexcept {
+        return push_constant_buffer_;
+    }
+
+    [[nodiscard]] const std::vector<std::byte>& push_constant_buffer() const noexcept {
+        return push_constant_buffer_;
+    }
+
+    /// Record bytes of material_parameters_buffer() that changed since the last upload.
+    /// Render thread only (material updates are processed by FrameResources).
+    void mark_material_parameters_dirty(uint32_t offset, uint32_t size) {
+        material_parameters_dirty_ranges_.mark(offset, size);
+    }
+
+    /// Appends the coalesced dirty material ranges (clipped to @p limit_bytes), clears them
+    /// and returns the byte count.
+    size_t take_material_parameter_upload_ranges(std::vector<BufferCopyRange>& out, size_t limit_bytes) {
+        const size_t bytes = material_parameters_dirty_ranges_.collect(out, limit_bytes);
+        material_parameters_dirty_ranges_.clear();
+        return bytes;
+    }
+
     void resize_render_components(size_t count) {
-        std::lock_guard<std::mutex> lock(components_mutex_);
+        std::lock_guard<std::shared_mutex> lock(components_mutex_);
         render_components_.resize(count);
     }
 
     void resize_transform_components(size_t count) {
-        std::lock_guard<std::mutex> lock(components_mutex_);
+        std::lock_guard<std::shared_mutex> lock(components_mutex_);
         transform_components_.resize(count);
         ensure_gpu_transform_capacity(count);
         mark_gpu_transforms_dirty();
     }
 
     void resize_light_components(size_t count) {
-        std::lock_guard<std::mutex> lock(components_mutex_);
+        std::lock_guard<std::shared_mutex> lock(components_mutex_);
         light_components_.resize(count);
     }
 
@@ -203,28 +339,137 @@ public:
         return transform_components_.size();
     }
 
-    void mark_gpu_transforms_dirty() noexcept { gpu_transforms_dirty_ = true; }
-    [[nodiscard]] bool gpu_transforms_dirty() const noexcept { return gpu_transforms_dirty_; }
-    void clear_gpu_transforms_dirty() noexcept { gpu_transforms_dirty_ = false; }
+    /// Mark every live GPUTransform slot for upload (bulk resize).
+    void mark_gpu_transforms_dirty();
+    [[nodiscard]] bool gpu_transforms_dirty() const;
+    /// Appends the coalesced dirty transform ranges (clipped to @p limit_bytes), clears them
+    /// and returns the byte count.
+    size_t take_gpu_transform_upload_ranges(std::vector<BufferCopyRange>& out, size_t limit_bytes);
+
+    /// Called from TransformComponent setters (once per entity between syncs); the caller
+    /// has claimed the entry with TransformComponent::try_claim_sync_queue().
+    void queue_transform_sync(uint32_t entity_index);
+    /// Claims and queues @p entity_index for changes made outside the transform setters
+    /// (mesh swaps, slot moves); no-op when it is already queued.
+    void request_transform_sync(uint32_t entity_index);
+    [[nodiscard]] bool has_pending_transform_sync() const noexcept {
+        return pending_transform_sync_count_.load(std::memory_order_acquire) > 0;
+    }
+
+    /// Refresh GPUTransform slots for entities queued since the last sync and mark their
+    /// pages dirty. Runs in parallel batches on @p scheduler when given, holding the
+    /// component lock shared per batch only.
+    void sync_gpu_transforms(enki::TaskScheduler* scheduler = nullptr);
+
+    /// Links @p child under @p parent (InvalidUI32 detaches); the child's TRS becomes relative
+    /// to the parent's world matrix from the next propagate_transforms(). Returns false for
+    /// dead entities or when the link would form a cycle.
+    bool set_parent(uint32_t child, uint32_t parent);
+    /// set_parent() for many links under one exclusive lock. Returns the links applied.
+    uint32_t set_parents(span<const EntityParentLink> links);
+    [[nodiscard]] uint32_t parent(uint32_t entity_index) const noexcept { return transform_hierarchy_.parent(entity_index); }
+    [[nodiscard]] const TransformHierarchy& transform_hierarchy() const noexcept { return transform_hierarchy_; }
+
+    /// Called from TransformComponent setters of hierarchy nodes (once per entity between propagations).
+    void queue_hierarchy_update(uint32_t entity_index);
+
+    /// Recompute world matrices below every hierarchy node changed since the last call and
+    /// queue the affected entities for GPU sync. Run once per frame before culling. Only the
+    /// dirty subtrees are visited, under the shared component lock.
+    void propagate_transforms(enki::TaskScheduler* scheduler = nullptr);
+
+    /// Hot, chunked SoA data (world AABBs) that culling streams instead of the cold arrays.
+    /// Read it, and the component arrays, from workers under lock_components_shared().
+    [[nodiscard]] const EntityChunkStorage& chunk_storage() const noexcept { return chunk_storage_; }
+    /// Appends the non-empty chunks carrying all @p required bits. Chunk addresses stay
+    /// valid; entries past a chunk's current count are stale once entities are removed.
+    void collect_chunks(ComponentSignature required, std::vector<EntityChunkRange>& out) const;
+    /// Shared lock for parallel readers: blocks create / destroy / compact, which reallocate
+    /// the component arrays and move chunk entries, until the reader is done.
+    [[nodiscard]] std::shared_lock<std::shared_mutex> lock_components_shared() const {
+        return std::shared_lock<std::shared_mutex>(components_mutex_);
+    }
 
-    /// Refresh CPU GPUTransform slots from TransformComponents; sets dirty if any slot changed.
-    void sync_gpu_transforms();
+    /// Force the cached world bounds of @p entity_index to be rebuilt (e.g. after a mesh change).
+    void mark_world_bounds_dirty(uint32_t entity_index);
+
+    /// Rebuild chunk world bounds whose TransformComponent version changed, one chunk per task.
+    void refresh_world_bounds(enki::TaskScheduler& scheduler);
+
+    [[nodiscard]] size_t hot_memory_bytes() const noexcept { return chunk_storage_.memory_bytes(); }
+    [[nodiscard]] size_t cold_memory_bytes() const noexcept;
 
 private:
     EntityComponentSystem();
 
+    [[nodiscard]] EntityHandle handle_unlocked(uint32_t entity_index) const noexcept {
+        return entity_index < generations_.size()
+            ? EntityHandle{entity_index, generations_[entity_index]}
+            : EntityHandle{};
+    }
+    [[nodiscard]] bool is_alive_unlocked(uint32_t entity_index) const noexcept {
+        return entity_index < slot_states_.size() && slot_states_[entity_index] == EntitySlotState::Alive;
+    }
+    [[nodiscard]] bool is_alive_unlocked(const EntityHandle& handle) const noexcept {
+        return is_alive_unlocked(handle.index) && generations_[handle.index] == handle.generation;
+    }
+    void retire_entity_slot(uint32_t entity_index);
     void ensure_gpu_transform_capacity(size_t entity_count);
+    [[nodiscard]] uint32_t acquire_entity_slot();
+    void finish_entity_creation(uint32_t entity_index);
+    void reset_entity_slot(uint32_t entity_index);
+    void move_entity_slot(uint32_t from, uint32_t to);
+    void pop_entity_slot();
+    void refresh_chunk_world_bounds(EntityChunk& chunk, uint32_t count);
+    void sync_gpu_transform_range(uint32_t begin, uint32_t end);
+    void apply_hierarchy_membership();
 
     std::vector<Primitive> primitives_;
     std::vector<RenderComponent> render_components_;
     std::vector<TransformComponent> transform_components_;
     std::vector<LightComponent> light_components_;
     std::vector<uint8_t> material_parameters_buffer_;
+    std::vector<std::byte> push_constant_buffer_;
+    /// Released push_constant_buffer_ regions by size.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> free_push_constant_regions_;
 
     std::vector<GPUTransform> gpu_transforms_;
-    std::vector<uint32_t> gpu_transform_versions_;
-    bool gpu_transforms_dirty_ = true;
-    mutable std::mutex components_mutex_;
+    /// Guarded by transform_sync_mutex_ (marked from creation threads, drained by the renderer).
+    DirtyRangeSet gpu_transform_dirty_ranges_;
+    DirtyRangeSet material_parameters_dirty_ranges_;
+    /// Exclusive for structural changes (create / destroy / compact), shared for batch work.
+    mutable std::shared_mutex components_mutex_;
+
+    mutable std::mutex transform_sync_mutex_;
+    std::vector<uint32_t> pending_transform_sync_;
+    std::vector<uint32_t> transform_sync_batch_;
+    std::atomic<uint32_t> pending_transform_sync_count_{0};
+
+    /// Serializes propagate_transforms(); structural hierarchy edits hold components_mutex_
+    /// exclusively, which propagation only ever holds shared.
+    std::mutex hierarchy_propagate_mutex_;
+    TransformHierarchy transform_hierarchy_;
+    std::vector<uint32_t> pending_hierarchy_updates_;
+    std::vector<uint32_t> hierarchy_update_batch_;
+    /// Entities whose hierarchy membership may have changed; scratch for apply_hierarchy_membership().
+    std::vector<uint32_t> hierarchy_touched_;
+    std::vector<uint32_t> hierarchy_changed_;
+
+    EntityChunkStorage chunk_storage_;
+    std::vector<EntityChunkRange> bounds_query_chunks_;
+
+    struct RetiringSlot {
+        uint32_t entity_index = InvalidUI32;
+        uint64_t free_frame = 0;
+    };
+
+    /// Generations outlive trimmed slots so a re-appended index never revalidates old handles.
+    std::vector<uint32_t> generations_;
+    std::vector<EntitySlotState> slot_states_;
+    std::vector<uint32_t> free_slots_;
+    std::deque<RetiringSlot> retiring_slots_;
+    uint32_t alive_entity_count_ = 0;
+    uint64_t frame_index_ = 0;
 };
 
 }// namespace ocarina
@@ -0,0 +1,18 @@
+#include "frame_packet.h"
+#include "camera.h"
+
+namespace ocarina {
+
+FrameView FrameView::capture(Camera* camera) {
+    FrameView view;
+    if (camera == nullptr) {
+        return view;
+    }
+    view.view_matrix = camera->get_view_matrix();
+    view.projection_matrix = camera->get_projection_matrix();
+    view.position = camera->get_position();
+    view.valid = true;
+    return view;
+}
+
+}// namespace ocarina
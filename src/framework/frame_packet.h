@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "math.h"
+#include "render_component.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+#include <chrono>
+
+namespace ocarina {
+
+class Camera;
+class Scene;
+
+/// Camera state captured when a frame is prepared. The frame culls, sorts and renders with
+/// it, even if the camera has moved on by the time the frame is recorded.
+struct FrameView {
+    math3d::Matrix4 view_matrix;
+    math3d::Matrix4 projection_matrix;
+    math3d::Vector3D position{};
+    bool valid = false;
+
+    [[nodiscard]] static FrameView capture(Camera* camera);
+};
+
+/// What the render thread needs from simulation and culling to record one frame. Renderer
+/// keeps one packet per pipeline stage, so workers can fill the next frame's packet while
+/// the render thread records from the current one.
+struct FramePacket {
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    Scene* scene = nullptr;
+    FrameView view;
+    std::vector<uint32_t> visible_entity_indices;
+    /// Mesh level per visible entity, parallel to visible_entity_indices.
+    std::vector<uint8_t> visible_entity_lods;
+    /// Triangles of the selected levels over the visible entities, and of their LOD 0.
+    uint64_t triangle_count = 0;
+    uint64_t full_triangle_count = 0;
+    /// Visible index ranges of cluster-culled entities. Each visible entity's ranges start
+    /// at its visible_entity_cluster_offsets entry (InvalidUI32: whole mesh), parallel to
+    /// visible_entity_indices like the counts.
+    std::vector<ClusterDrawRange> cluster_ranges;
+    std::vector<uint32_t> visible_entity_cluster_offsets;
+    std::vector<uint32_t> visible_entity_cluster_counts;
+    /// World-space origin of each visible entity when the packet was culled, parallel to
+    /// visible_entity_indices. Depth keys read it instead of the live transforms, which
+    /// the next frame's preparation may already be updating.
+    std::vector<float3> visible_entity_positions;
+    /// Meshlets tested by cluster culling, and those that survived.
+    uint64_t cluster_count = 0;
+    uint64_t visible_cluster_count = 0;
+    /// When the camera was sampled; submit time minus this is the frame's latency.
+    TimePoint capture_time{};
+    /// Time Renderer::cull_scene() took for this packet.
+    double cull_ms = 0.0;
+};
+
+/// Culls one FramePacket on a worker thread (see Renderer::set_frame_pipeline_depth()).
+class FramePrepareTask : public enki::ITaskSet {
+public:
+    using PrepareFunction = ocarina::function<void(FramePacket&)>;
+
+    FramePrepareTask() {
+        m_SetSize = 1;
+    }
+
+    void configure(FramePacket* packet, PrepareFunction function) {
+        packet_ = packet;
+        function_ = std::move(function);
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)range;
+        (void)threadnum;
+        function_(*packet_);
+    }
+
+    [[nodiscard]] FramePacket* packet() const noexcept { return packet_; }
+
+private:
+    FramePacket* packet_ = nullptr;
+    PrepareFunction function_;
+};
+
+}// namespace ocarina
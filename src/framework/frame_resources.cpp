@@ -1,5 +1,5 @@
 #include "frame_resources.h"
-#include "camera.h"
+#include "frame_packet.h"
 #include "entity_component_system.h"
 #include "material.h"
 #include "resource_manager.h"
@@ -72,6 +72,13 @@ void FrameResources::release_gpu_buffers() {
     }
     material_storage_descriptor_bound_ = false;
 
+    if (draw_instance_buffer_.handle() != 0) {
+        resources.release_buffer(draw_instance_buffer_.handle());
+        draw_instance_buffer_.reset();
+    }
+    draw_instance_descriptor_bound_ = false;
+    draw_instance_region_capacity_ = 0;
+
     // Drop the device pointer so later singleton teardown cannot recreate Vulkan objects.
     device_ = nullptr;
 }
@@ -89,6 +96,7 @@ bool FrameResources::is_global_singleton_layout(const DescriptorSetLayout* layou
     static const uint64_t kGMaterials = hash64("g_materials");
     static const uint64_t kGTextures = hash64("g_textures");
     static const uint64_t kSamplers = hash64("samplers");
+    static const uint64_t kDrawInstances = hash64(kDrawInstancesBufferName);
 
     const size_t bindings_count = layout->get_bindings_count();
     for (size_t i = 0; i < bindings_count; ++i) {
@@ -97,7 +105,8 @@ bool FrameResources::is_global_singleton_layout(const DescriptorSetLayout* layou
             name_id == kTransforms ||
             name_id == kGMaterials ||
             name_id == kGTextures ||
-            name_id == kSamplers) {
+            name_id == kSamplers ||
+            name_id == kDrawInstances) {
             return true;
         }
     }
@@ -284,27 +293,12 @@ void FrameResources::process_material_update() {
             case MaterialUpdateKind::UniformBuffer: {
                 if (request.material->uses_global_material_buffer()) {
                     // Global `g_materials` path uses a StructuredBuffer<MaterialParams>.
-                    // Copy only the updated material slot directly into GPU buffer.
-                    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+                    // Record the slot; all dirty slots are copied in one batch below.
                     if (request.material->has_material_buffer()) {
                         const uint32_t offset = request.material->material_buffer_offset();
                         const uint32_t size = request.material->material_buffer_size();
                         if (offset != InvalidUI32 && size > 0) {
-                            const size_t required_bytes =
-                                static_cast<size_t>(offset) + static_cast<size_t>(size);
-                            if (required_bytes > material_buffer_.size_in_byte()) {
-                                grow_material_gpu_buffer(required_bytes);
-                            }
-                            bind_material_storage_buffer_if_needed();
-
-                            if (material_buffer_.handle() != 0) {
-                                const uint8_t* src =
-                                    ecs.material_parameters_buffer().data() + offset;
-                                material_buffer_.copy_from_immediately(
-                                    src,
-                                    size,
-                                    offset);
-                            }
+                            EntityComponentSystem::instance().mark_material_parameters_dirty(offset, size);
                         }
                     }
                 } else {
@@ -318,11 +312,43 @@ void FrameResources::process_material_update() {
         }
     }
 
+    upload_dirty_material_parameters();
+
     for (MaterialUpdateRequest& pending : deferred) {
         material_update_queue_.push(std::move(pending));
     }
 }
 
+void FrameResources::upload_dirty_material_parameters() {
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    upload_ranges_.clear();
+    const size_t staged_bytes = ecs.material_parameters_buffer().size();
+    const size_t dirty_bytes = ecs.take_material_parameter_upload_ranges(upload_ranges_, staged_bytes);
+    if (dirty_bytes == 0) {
+        return;
+    }
+
+    const BufferCopyRange& last_range = upload_ranges_.back();
+    const size_t required_bytes = static_cast<size_t>(last_range.offset) + last_range.size;
+    if (required_bytes > material_buffer_.size_in_byte()) {
+        // Recreating the buffer refills it from staging, which covers every dirty range.
+        grow_material_gpu_buffer(required_bytes);
+        bind_material_storage_buffer_if_needed();
+        return;
+    }
+    bind_material_storage_buffer_if_needed();
+    if (material_buffer_.handle() == 0) {
+        return;
+    }
+
+    upload_stats_.material_bytes += dirty_bytes;
+    upload_stats_.material_ranges += static_cast<uint32_t>(upload_ranges_.size());
+    material_buffer_.copy_ranges_from_immediately(
+        ecs.material_parameters_buffer().data(),
+        upload_ranges_.data(),
+        upload_ranges_.size());
+}
+
 bool FrameResources::is_global_descriptor_set_index(uint32_t set_index) const {
     return has_descriptor_set(set_index);
 }
@@ -410,6 +436,8 @@ void FrameResources::grow_transform_gpu_buffer(size_t element_count) {
         transform_buffer_.copy_from_immediately(
             ecs.gpu_transforms().data(),
             static_cast<uint32_t>(copy_count * sizeof(GPUTransform)));
+        upload_stats_.transform_bytes += copy_count * sizeof(GPUTransform);
+        ++upload_stats_.transform_ranges;
     }
 }
 
@@ -438,15 +466,15 @@ void FrameResources::upload_transform_buffer() {
     }
 
     EntityComponentSystem& ecs = EntityComponentSystem::instance();
-    // Avoid scanning/copying when transforms are known to be unchanged and the
-    // descriptor buffer is already bound.
+    // Nothing queued by transform setters, nothing dirty and the descriptor is bound.
     if (!ecs.gpu_transforms_dirty() &&
+        !ecs.has_pending_transform_sync() &&
         transform_buffer_.handle() != 0 &&
         transform_storage_descriptor_bound_) {
         return;
     }
 
-    ecs.sync_gpu_transforms();
+    ecs.sync_gpu_transforms(task_scheduler_);
 
     const size_t transform_count = ecs.gpu_transform_count();
     if (transform_count > transform_buffer_.size()) {
@@ -454,16 +482,19 @@ void FrameResources::upload_transform_buffer() {
     }
     bind_transform_storage_buffer_if_needed();
 
-    if (!ecs.gpu_transforms_dirty() || transform_buffer_.handle() == 0) {
+    if (transform_buffer_.handle() == 0) {
         return;
     }
 
-    const size_t upload_count = std::max(transform_count, size_t{1});
-    const size_t upload_bytes = upload_count * sizeof(GPUTransform);
-    transform_buffer_.copy_from_immediately(
+    // Only the pages touched since the last upload, in one mapped batch.
+    upload_ranges_.clear();
+    const size_t limit_bytes = std::min(transform_count, transform_buffer_.size()) * sizeof(GPUTransform);
+    upload_stats_.transform_bytes += ecs.take_gpu_transform_upload_ranges(upload_ranges_, limit_bytes);
+    upload_stats_.transform_ranges += static_cast<uint32_t>(upload_ranges_.size());
+    transform_buffer_.copy_ranges_from_immediately(
         ecs.gpu_transforms().data(),
-        static_cast<uint32_t>(upload_bytes));
-    ecs.clear_gpu_transforms_dirty();
+        upload_ranges_.data(),
+        upload_ranges_.size());
 }
 
 void FrameResources::grow_material_gpu_buffer(size_t byte_count) {
@@ -499,9 +530,12 @@ void FrameResources::grow_material_gpu_buffer(size_t byte_count) {
     EntityComponentSystem& ecs = EntityComponentSystem::instance();
     const size_t used_bytes = ecs.material_parameters_buffer().size();
     if (material_buffer_.handle() != 0 && used_bytes > 0) {
+        const size_t copy_bytes = std::min(used_bytes, material_buffer_.size_in_byte());
         material_buffer_.copy_from_immediately(
             ecs.material_parameters_buffer().data(),
-            static_cast<uint32_t>(std::min(used_bytes, material_buffer_.size_in_byte())));
+            static_cast<uint32_t>(copy_bytes));
+        upload_stats_.material_bytes += copy_bytes;
+        ++upload_stats_.material_ranges;
     }
 }
 
@@ -541,16 +575,16 @@ void FrameResources::bind_global_ubo_if_needed() {
     global_ubo_descriptor_bound_ = true;
 }
 
-void FrameResources::upload_global_uniform_buffer(Camera* camera) {
+void FrameResources::upload_global_uniform_buffer(const FrameView* view) {
     DescriptorSet* global_descriptor_set = get_global_descriptor_set("global_ubo");
     if (global_descriptor_set == nullptr || device_ == nullptr) {
         return;
     }
 
-    if (camera != nullptr) {
-        global_ubo_.projection_matrix = camera->get_projection_matrix().transpose();
-        global_ubo_.view_matrix = camera->get_view_matrix().transpose();
-        const math3d::Vector3D& cam_position = camera->get_position();
+    if (view != nullptr && view->valid) {
+        global_ubo_.projection_matrix = view->projection_matrix.transpose();
+        global_ubo_.view_matrix = view->view_matrix.transpose();
+        const math3d::Vector3D& cam_position = view->position;
         global_ubo_.camera_pos = make_float4(cam_position[0], cam_position[1], cam_position[2], 1.0f);
     }
 
@@ -571,8 +605,70 @@ void FrameResources::upload_global_uniform_buffer(Camera* camera) {
         static_cast<uint32_t>(sizeof(GlobalUniformBuffer)));
 }
 
-void FrameResources::update_per_frame(double dt, Camera* camera) {
-    upload_global_uniform_buffer(camera);
+void FrameResources::bind_draw_instance_buffer_if_needed() {
+    if (draw_instance_descriptor_bound_ || draw_instance_buffer_.handle() == 0) {
+        return;
+    }
+
+    DescriptorSet* scene_set = get_global_descriptor_set(kDrawInstancesBufferName);
+    if (scene_set == nullptr) {
+        return;
+    }
+
+    scene_set->update_storage_buffer(
+        hash64(kDrawInstancesBufferName),
+        draw_instance_buffer_.handle(),
+        0,
+        draw_instance_buffer_.size_in_byte());
+    draw_instance_descriptor_bound_ = true;
+}
+
+void FrameResources::begin_draw_instances(size_t max_instance_count) {
+    std::lock_guard<std::mutex> lock(draw_instances_mutex_);
+    draw_instance_slot_ = (draw_instance_slot_ + 1) % kDrawInstanceFrameSlots;
+    draw_instance_cursor_ = 0;
+    if (device_ == nullptr) {
+        return;
+    }
+
+    if (draw_instance_buffer_.handle() == 0 || max_instance_count > draw_instance_region_capacity_) {
+        const size_t region_capacity = std::max({
+            max_instance_count,
+            kDefaultDrawInstanceCapacity,
+            draw_instance_region_capacity_ * 2});
+        if (draw_instance_buffer_.handle() != 0) {
+            ResourceManager::instance().release_buffer(draw_instance_buffer_.handle());
+            draw_instance_buffer_.reset();
+        }
+        draw_instance_buffer_ = ResourceManager::instance().create_buffer<uint32_t>(
+            device_,
+            region_capacity * kDrawInstanceFrameSlots,
+            GraphicBufferBindFlags::StructuredBuffer,
+            kDrawInstancesBufferName);
+        draw_instance_region_capacity_ = draw_instance_buffer_.handle() != 0 ? region_capacity : 0;
+        draw_instance_descriptor_bound_ = false;
+    }
+    bind_draw_instance_buffer_if_needed();
+}
+
+uint32_t FrameResources::write_draw_instances(const uint32_t* entity_indices, size_t count) {
+    std::lock_guard<std::mutex> lock(draw_instances_mutex_);
+    if (!draw_instance_descriptor_bound_ || draw_instance_cursor_ + count > draw_instance_region_capacity_) {
+        return InvalidUI32;
+    }
+
+    const size_t first = draw_instance_slot_ * draw_instance_region_capacity_ + draw_instance_cursor_;
+    draw_instance_buffer_.copy_from_immediately(
+        entity_indices,
+        static_cast<uint32_t>(count * sizeof(uint32_t)),
+        static_cast<uint32_t>(first * sizeof(uint32_t)));
+    draw_instance_cursor_ += count;
+    return static_cast<uint32_t>(first);
+}
+
+void FrameResources::update_per_frame(double dt, const FrameView* view) {
+    upload_stats_ = FrameUploadStats{};
+    upload_global_uniform_buffer(view);
     upload_transform_buffer();
     flush_pending_bindless_updates();
     process_material_update();
@@ -14,10 +14,24 @@
 #include "bindless_texture_registry.h"
 #include <mutex>
 
+namespace enki { class TaskScheduler; }
+
 namespace ocarina {
+
+/// Bytes written to the scene buffers by the last update_per_frame() (full-buffer refills
+/// after growth included).
+struct FrameUploadStats {
+    uint64_t transform_bytes = 0;
+    uint32_t transform_ranges = 0;
+    uint64_t material_bytes = 0;
+    uint32_t material_ranges = 0;
+
+    [[nodiscard]] uint64_t total_bytes() const noexcept { return transform_bytes + material_bytes; }
+};
+
 class DescriptorSetLayout;
 class DescriptorSet;
-class Camera;
+struct FrameView;
 class Device;
 class Material;
 
@@ -75,6 +89,9 @@ public:
 
     void initialize(Device* device);
 
+    /// Scheduler used for parallel per-frame CPU work (transform sync). Optional.
+    void set_task_scheduler(enki::TaskScheduler* scheduler) noexcept { task_scheduler_ = scheduler; }
+
     void add_global_descriptor_set(uint64_t name_id, DescriptorSet* descriptor_set);
 
     void add_global_descriptor_set(const std::string& name, DescriptorSet* descriptor_set) {
@@ -140,6 +157,23 @@ public:
     [[nodiscard]] TypedBuffer<MaterialParams>& material_buffer() noexcept { return material_buffer_; }
     [[nodiscard]] const TypedBuffer<MaterialParams>& material_buffer() const noexcept { return material_buffer_; }
 
+    /// StructuredBuffer<uint> draw_instances (SCENE_SET / BIND_DRAW_INSTANCES): entity
+    /// indices of instanced draws, read by instance id. Split into kDrawInstanceFrameSlots
+    /// regions so a frame never overwrites indices an earlier frame may still read.
+    static constexpr uint32_t kDrawInstanceFrameSlots = 3;
+    static constexpr size_t kDefaultDrawInstanceCapacity = 4096;
+    static constexpr const char* kDrawInstancesBufferName = "draw_instances";
+
+    /// Render thread, before any pass records: moves to the next region and grows the
+    /// buffer so @p max_instance_count indices fit without rebinding mid-frame.
+    void begin_draw_instances(size_t max_instance_count);
+
+    /// Any thread: copies @p count entity indices into this frame's region. Returns the
+    /// first_instance of the first one, or InvalidUI32 when there is no room or no buffer.
+    [[nodiscard]] uint32_t write_draw_instances(const uint32_t* entity_indices, size_t count);
+
+    [[nodiscard]] const FrameUploadStats& upload_stats() const noexcept { return upload_stats_; }
+
     void set_sun_direction(const float3& direction) noexcept;
     void set_sun_color(const float3& color) noexcept;
     void set_sun_intensity(float intensity) noexcept;
@@ -151,7 +185,7 @@ public:
     }
 
     /// Called on the render thread each frame. Uploads globals, flushes bindless / material queues.
-    void update_per_frame(double dt, Camera* camera = nullptr);
+    void update_per_frame(double dt, const FrameView* view = nullptr);
 
     /// Destroy owned GPU buffers. Must be called while Device / VkDevice is still alive
     /// (e.g. from Renderer::shutdown). Safe to call multiple times.
@@ -161,19 +195,22 @@ private:
     FrameResources() = default;
     ~FrameResources() { release_gpu_buffers(); }
 
-    void upload_global_uniform_buffer(Camera* camera);
+    void upload_global_uniform_buffer(const FrameView* view);
     void upload_transform_buffer();
     void flush_pending_bindless_updates();
     void process_material_update();
+    void upload_dirty_material_parameters();
     void create_default_gpu_buffers();
     void grow_transform_gpu_buffer(size_t element_count);
     void grow_material_gpu_buffer(size_t byte_count);
     void bind_global_ubo_if_needed();
     void bind_transform_storage_buffer_if_needed();
     void bind_material_storage_buffer_if_needed();
+    void bind_draw_instance_buffer_if_needed();
     DescriptorSet* find_bindless_descriptor_set_locked() const;
 
     Device* device_ = nullptr;
+    enki::TaskScheduler* task_scheduler_ = nullptr;
 
     mutable std::mutex global_descriptor_sets_mutex_;
     /// Indexed by Vulkan descriptor set index; contiguous from 0 (nullptr = unused hole).
@@ -196,6 +233,15 @@ private:
     bool transform_storage_descriptor_bound_ = false;
     TypedBuffer<MaterialParams> material_buffer_{};
     bool material_storage_descriptor_bound_ = false;
+    TypedBuffer<uint32_t> draw_instance_buffer_{};
+    bool draw_instance_descriptor_bound_ = false;
+    std::mutex draw_instances_mutex_;
+    size_t draw_instance_region_capacity_ = 0;
+    uint32_t draw_instance_slot_ = 0;
+    size_t draw_instance_cursor_ = 0;
+    /// Scratch for batched ranged uploads (reused every frame).
+    std::vector<BufferCopyRange> upload_ranges_;
+    FrameUploadStats upload_stats_{};
     UpdateCallback update_ = nullptr;
 };
 
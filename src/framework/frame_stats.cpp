@@ -0,0 +1,288 @@
+#include "frame_stats.h"
+#include "core/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace ocarina {
+
+const char* frame_stage_name(FrameStage stage) noexcept {
+    switch (stage) {
+        case FrameStage::Simulation: return "simulation";
+        case FrameStage::Cull: return "cull";
+        case FrameStage::ComponentUpdate: return "component_update";
+        case FrameStage::Upload: return "upload";
+        case FrameStage::Acquire: return "acquire";
+        case FrameStage::Record: return "record";
+        case FrameStage::Submit: return "submit";
+        case FrameStage::Present: return "present";
+        default: return "unknown";
+    }
+}
+
+namespace {
+
+[[nodiscard]] FrameTimeSummary summarize_sorted(const std::vector<double>& sorted) noexcept {
+    FrameTimeSummary summary;
+    if (sorted.empty()) {
+        return summary;
+    }
+    auto percentile = [&](double p) {
+        const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size()))) - 1;
+        return sorted[std::min(rank, sorted.size() - 1)];
+    };
+    double sum = 0.0;
+    for (double value : sorted) {
+        sum += value;
+    }
+    summary.mean_ms = sum / static_cast<double>(sorted.size());
+    summary.p50_ms = percentile(0.50);
+    summary.p95_ms = percentile(0.95);
+    summary.p99_ms = percentile(0.99);
+    summary.max_ms = sorted.back();
+    return summary;
+}
+
+void write_summary_json(std::ofstream& out, const char* name, const FrameTimeSummary& summary, bool last) {
+    out << "    \"" << name << "\": {\"mean_ms\": " << summary.mean_ms
+        << ", \"p50_ms\": " << summary.p50_ms
+        << ", \"p95_ms\": " << summary.p95_ms
+        << ", \"p99_ms\": " << summary.p99_ms
+        << ", \"max_ms\": " << summary.max_ms << "}" << (last ? "\n" : ",\n");
+}
+
+}// namespace
+
+FrameStats::FrameStats(uint32_t window)
+    : window_(std::max(window, 1u)) {
+    samples_.reserve(window_);
+    median_scratch_.reserve(window_);
+}
+
+void FrameStats::begin_frame() noexcept {
+    current_ = {};
+    frame_start_ = Clock::now();
+}
+
+void FrameStats::end_frame(double gpu_ms, const GpuTimerResults& gpu_timers) noexcept {
+    current_.frame_ms = std::chrono::duration<double, std::milli>(Clock::now() - frame_start_).count();
+    current_.gpu_ms = gpu_ms;
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        current_.record_ms[group] = static_cast<double>(record_ns_[group].exchange(0, std::memory_order_relaxed)) * 1e-6;
+        const PassGroupId group_id = static_cast<PassGroupId>(group);
+        const uint32_t group_timer = group_gpu_timer(group_id);
+        current_.gpu_group_ms[group] = gpu_timers.written(group_timer) ? gpu_timers.ms[group_timer] : 0.0;
+        for (uint32_t pass = 0; pass < kMaxGpuPassTimersPerGroup; ++pass) {
+            const uint32_t pass_timer = pass_gpu_timer(group_id, pass);
+            current_.gpu_pass_ms[group][pass] = gpu_timers.written(pass_timer) ? gpu_timers.ms[pass_timer] : 0.0;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.frame_index = frame_count_++;
+    if (!samples_.empty()) {
+        // Median of the frames before this one.
+        std::vector<double>& frame_ms = median_scratch_;
+        frame_ms.resize(samples_.size());
+        std::transform(samples_.begin(), samples_.end(), frame_ms.begin(),
+                       [](const FrameSample& sample) { return sample.frame_ms; });
+        const auto median = frame_ms.begin() + static_cast<std::ptrdiff_t>(frame_ms.size() / 2);
+        std::nth_element(frame_ms.begin(), median, frame_ms.end());
+        if (current_.frame_ms >= std::max(*median * kHitchFactor, kHitchMinMs)) {
+            current_.hitch = true;
+            ++hitch_count_;
+            last_hitch_frame_ = current_.frame_index;
+        }
+    }
+    if (samples_.size() < window_) {
+        samples_.push_back(current_);
+    } else {
+        samples_[next_] = current_;
+    }
+    next_ = (next_ + 1) % window_;
+}
+
+void FrameStats::reset() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.clear();
+    next_ = 0;
+    hitch_count_ = 0;
+    last_hitch_frame_ = 0;
+}
+
+template<typename Select>
+FrameTimeSummary FrameStats::summarize(Select&& select) const {
+    std::vector<double> values;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        values.reserve(samples_.size());
+        for (const FrameSample& sample : samples_) {
+            values.push_back(select(sample));
+        }
+    }
+    std::sort(values.begin(), values.end());
+    return summarize_sorted(values);
+}
+
+FrameTimeSummary FrameStats::frame_summary() const {
+    return summarize([](const FrameSample& sample) { return sample.frame_ms; });
+}
+
+FrameTimeSummary FrameStats::gpu_summary() const {
+    return summarize([](const FrameSample& sample) { return sample.gpu_ms; });
+}
+
+FrameTimeSummary FrameStats::stage_summary(FrameStage stage) const {
+    const size_t index = static_cast<size_t>(stage);
+    return summarize([index](const FrameSample& sample) { return sample.stage_ms[index]; });
+}
+
+FrameTimeSummary FrameStats::record_summary(PassGroupId group) const {
+    const size_t index = static_cast<size_t>(group);
+    return summarize([index](const FrameSample& sample) { return sample.record_ms[index]; });
+}
+
+FrameTimeSummary FrameStats::gpu_group_summary(PassGroupId group) const {
+    const size_t index = static_cast<size_t>(group);
+    return summarize([index](const FrameSample& sample) { return sample.gpu_group_ms[index]; });
+}
+
+FrameTimeSummary FrameStats::gpu_pass_summary(PassGroupId group, uint32_t pass_index) const {
+    const size_t index = static_cast<size_t>(group);
+    const size_t pass = std::min<size_t>(pass_index, kMaxGpuPassTimersPerGroup - 1);
+    return summarize([index, pass](const FrameSample& sample) { return sample.gpu_pass_ms[index][pass]; });
+}
+
+uint32_t FrameStats::gpu_pass_count(PassGroupId group) const noexcept {
+    const size_t index = static_cast<size_t>(group);
+    uint32_t count = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const FrameSample& sample : samples_) {
+        for (uint32_t pass = count; pass < kMaxGpuPassTimersPerGroup; ++pass) {
+            if (sample.gpu_pass_ms[index][pass] > 0.0) {
+                count = pass + 1;
+            }
+        }
+    }
+    return count;
+}
+
+std::vector<FrameSample> FrameStats::samples() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samples_.size() < window_) {
+        return samples_;
+    }
+    std::vector<FrameSample> ordered;
+    ordered.reserve(samples_.size());
+    ordered.insert(ordered.end(), samples_.begin() + static_cast<std::ptrdiff_t>(next_), samples_.end());
+    ordered.insert(ordered.end(), samples_.begin(), samples_.begin() + static_cast<std::ptrdiff_t>(next_));
+    return ordered;
+}
+
+uint64_t FrameStats::hitch_count() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hitch_count_;
+}
+
+uint64_t FrameStats::last_hitch_frame() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_hitch_frame_;
+}
+
+uint64_t FrameStats::frame_count() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_count_;
+}
+
+bool FrameStats::write_csv(const fs::path& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        OC_WARNING_FORMAT("cannot write frame stats {}", path.string());
+        return false;
+    }
+    std::array<uint32_t, kPassGroupCount> pass_counts{};
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        pass_counts[group] = gpu_pass_count(static_cast<PassGroupId>(group));
+    }
+    out << "frame,frame_ms,gpu_ms,hitch";
+    for (size_t stage = 0; stage < kFrameStageCount; ++stage) {
+        out << ',' << frame_stage_name(static_cast<FrameStage>(stage)) << "_ms";
+    }
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        out << ",record_" << pass_group_id_name(static_cast<PassGroupId>(group)) << "_ms";
+    }
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        out << ",gpu_" << pass_group_id_name(static_cast<PassGroupId>(group)) << "_ms";
+    }
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        for (uint32_t pass = 0; pass < pass_counts[group]; ++pass) {
+            out << ",gpu_" << pass_group_id_name(static_cast<PassGroupId>(group)) << "_pass" << pass << "_ms";
+        }
+    }
+    out << '\n';
+    for (const FrameSample& sample : samples()) {
+        out << sample.frame_index << ',' << sample.frame_ms << ',' << sample.gpu_ms << ',' << (sample.hitch ? 1 : 0);
+        for (double ms : sample.stage_ms) {
+            out << ',' << ms;
+        }
+        for (double ms : sample.record_ms) {
+            out << ',' << ms;
+        }
+        for (double ms : sample.gpu_group_ms) {
+            out << ',' << ms;
+        }
+        for (size_t group = 0; group < kPassGroupCount; ++group) {
+            for (uint32_t pass = 0; pass < pass_counts[group]; ++pass) {
+                out << ',' << sample.gpu_pass_ms[group][pass];
+            }
+        }
+        out << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+bool FrameStats::write_json(const fs::path& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        OC_WARNING_FORMAT("cannot write frame stats {}", path.string());
+        return false;
+    }
+    size_t window_frames = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        window_frames = samples_.size();
+    }
+    out << "{\n";
+    out << "  \"frames\": " << frame_count() << ",\n";
+    out << "  \"window_frames\": " << window_frames << ",\n";
+    out << "  \"hitches\": " << hitch_count() << ",\n";
+    out << "  \"last_hitch_frame\": " << last_hitch_frame() << ",\n";
+    out << "  \"timings\": {\n";
+    write_summary_json(out, "frame", frame_summary(), false);
+    write_summary_json(out, "gpu", gpu_summary(), false);
+    for (size_t stage = 0; stage < kFrameStageCount; ++stage) {
+        write_summary_json(out, frame_stage_name(static_cast<FrameStage>(stage)),
+                           stage_summary(static_cast<FrameStage>(stage)), false);
+    }
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        const string name = string("record_") + pass_group_id_name(static_cast<PassGroupId>(group));
+        write_summary_json(out, name.c_str(), record_summary(static_cast<PassGroupId>(group)), false);
+    }
+    for (size_t group = 0; group < kPassGroupCount; ++group) {
+        const PassGroupId group_id = static_cast<PassGroupId>(group);
+        const string name = string("gpu_") + pass_group_id_name(group_id);
+        const uint32_t pass_count = gpu_pass_count(group_id);
+        write_summary_json(out, name.c_str(), gpu_group_summary(group_id),
+                           group + 1 == kPassGroupCount && pass_count == 0);
+        for (uint32_t pass = 0; pass < pass_count; ++pass) {
+            const string pass_name = name + "_pass" + std::to_string(pass);
+            write_summary_json(out, pass_name.c_str(), gpu_pass_summary(group_id, pass),
+                               group + 1 == kPassGroupCount && pass + 1 == pass_count);
+        }
+    }
+    out << "  }\n}\n";
+    return static_cast<bool>(out);
+}
+
+}// namespace ocarina
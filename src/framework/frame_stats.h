@@ -0,0 +1,162 @@
+//
+// Rolling per-stage frame timings: the render thread times each stage of a frame, GPU
+// timers time each pass group and render pass, and the window keeps the last frames for
+// percentiles, hitch detection, the frame info overlay and CSV / JSON export.
+//
+
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "core/concepts.h"
+#include "pass_group_id.h"
+#include "rhi/command_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace ocarina {
+
+/// Render-thread stages of a frame, in execution order.
+enum class FrameStage : uint8_t {
+    Simulation,     ///< Camera update and transform propagation.
+    Cull,           ///< Culling and LOD selection of the recorded packet (on a worker when pipelined).
+    ComponentUpdate,///< Visible render component refresh.
+    Upload,         ///< FrameResources per-frame upload.
+    Acquire,        ///< Device::begin_frame(): frame slot fence and swapchain image.
+    Record,         ///< Pass-group recording, wall time on the render thread.
+    Submit,         ///< Device::execute_command_buffers().
+    Present,        ///< Device::end_frame().
+    Count,
+};
+
+inline constexpr size_t kFrameStageCount = static_cast<size_t>(FrameStage::Count);
+inline constexpr size_t kPassGroupCount = static_cast<size_t>(PassGroupId::Count);
+
+[[nodiscard]] OC_FRAMEWORK_API const char* frame_stage_name(FrameStage stage) noexcept;
+
+/// GPU timer ids (CommandBuffer::begin_gpu_timer()): one per pass group around its whole
+/// command buffer, then one per render pass for the first kMaxGpuPassTimersPerGroup passes
+/// of each group.
+inline constexpr uint32_t kMaxGpuPassTimersPerGroup = 8;
+
+[[nodiscard]] constexpr uint32_t group_gpu_timer(PassGroupId group) noexcept {
+    return static_cast<uint32_t>(group);
+}
+
+[[nodiscard]] constexpr uint32_t pass_gpu_timer(PassGroupId group, uint32_t pass_index) noexcept {
+    return static_cast<uint32_t>(kPassGroupCount) + static_cast<uint32_t>(group) * kMaxGpuPassTimersPerGroup + pass_index;
+}
+
+static_assert(kPassGroupCount * (1 + kMaxGpuPassTimersPerGroup) <= MAX_GPU_TIMERS,
+              "pass group GPU timers do not fit in MAX_GPU_TIMERS");
+
+struct FrameSample {
+    uint64_t frame_index = 0;
+    /// Render thread time of the whole frame.
+    double frame_ms = 0.0;
+    /// Device::gpu_frame_time_ms() when the frame ended (the backend reports the latest
+    /// completed frame, so it trails the CPU stages by the frames in flight).
+    double gpu_ms = 0.0;
+    std::array<double, kFrameStageCount> stage_ms{};
+    /// CPU time recording each pass group on its worker.
+    std::array<double, kPassGroupCount> record_ms{};
+    /// GPU time of each pass group's command buffer and of its render passes, in pass order.
+    /// Trails like gpu_ms; zero when the group did not run or the device has no GPU timers.
+    std::array<double, kPassGroupCount> gpu_group_ms{};
+    std::array<std::array<double, kMaxGpuPassTimersPerGroup>, kPassGroupCount> gpu_pass_ms{};
+    bool hitch = false;
+};
+
+struct FrameTimeSummary {
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+class OC_FRAMEWORK_API FrameStats : public concepts::Noncopyable {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t kDefaultWindow = 300;
+    /// A frame is a hitch when it takes kHitchFactor times the window's median, and at
+    /// least kHitchMinMs (so sub-millisecond headless frames do not count their jitter).
+    static constexpr double kHitchFactor = 2.0;
+    static constexpr double kHitchMinMs = 1.0;
+
+    explicit FrameStats(uint32_t window = kDefaultWindow);
+
+    /// Render thread: brackets one frame. @p gpu_timers is Device::last_gpu_timer_results().
+    void begin_frame() noexcept;
+    void end_frame(double gpu_ms, const GpuTimerResults& gpu_timers = {}) noexcept;
+    /// Render thread, between begin_frame() and end_frame(); repeated stages accumulate.
+    void add_stage_time(FrameStage stage, double ms) noexcept {
+        current_.stage_ms[static_cast<size_t>(stage)] += ms;
+    }
+    /// Any thread: CPU time a worker spent recording @p group this frame.
+    void add_record_time(PassGroupId group, uint64_t ns) noexcept {
+        record_ns_[static_cast<size_t>(group)].fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    /// Times one stage until the end of the scope.
+    class ScopedStage {
+    public:
+        ScopedStage(FrameStats& stats, FrameStage stage) noexcept
+            : stats_(stats), stage_(stage), start_(Clock::now()) {}
+        ~ScopedStage() {
+            stats_.add_stage_time(stage_, std::chrono::duration<double, std::milli>(Clock::now() - start_).count());
+        }
+
+    private:
+        FrameStats& stats_;
+        FrameStage stage_;
+        Clock::time_point start_;
+    };
+
+    void reset() noexcept;
+
+    [[nodiscard]] FrameTimeSummary frame_summary() const;
+    [[nodiscard]] FrameTimeSummary gpu_summary() const;
+    [[nodiscard]] FrameTimeSummary stage_summary(FrameStage stage) const;
+    [[nodiscard]] FrameTimeSummary record_summary(PassGroupId group) const;
+    [[nodiscard]] FrameTimeSummary gpu_group_summary(PassGroupId group) const;
+    [[nodiscard]] FrameTimeSummary gpu_pass_summary(PassGroupId group, uint32_t pass_index) const;
+    /// Render passes of @p group with a GPU time in any frame of the window.
+    [[nodiscard]] uint32_t gpu_pass_count(PassGroupId group) const noexcept;
+    /// Frames in the window, oldest first.
+    [[nodiscard]] std::vector<FrameSample> samples() const;
+    /// Hitches since the last reset(), and the index of the latest one.
+    [[nodiscard]] uint64_t hitch_count() const noexcept;
+    [[nodiscard]] uint64_t last_hitch_frame() const noexcept;
+    [[nodiscard]] uint64_t frame_count() const noexcept;
+
+    /// One row per frame in the window: frame, frame_ms, gpu_ms, hitch, each stage, each
+    /// pass group's record time and GPU time, then the GPU time of each timed render pass.
+    [[nodiscard]] bool write_csv(const fs::path& path) const;
+    /// Window summaries (mean and percentiles per stage, pass group and timed render pass)
+    /// and hitch counts.
+    [[nodiscard]] bool write_json(const fs::path& path) const;
+
+private:
+    template<typename Select>
+    [[nodiscard]] FrameTimeSummary summarize(Select&& select) const;
+
+    const uint32_t window_;
+    FrameSample current_;
+    Clock::time_point frame_start_{};
+    std::array<std::atomic<uint64_t>, kPassGroupCount> record_ns_{};
+
+    mutable std::mutex mutex_;
+    /// Ring of the last window_ frames; next_ is the slot the next frame goes to.
+    std::vector<FrameSample> samples_;
+    std::vector<double> median_scratch_;
+    size_t next_ = 0;
+    uint64_t frame_count_ = 0;
+    uint64_t hitch_count_ = 0;
+    uint64_t last_hitch_frame_ = 0;
+};
+
+}// namespace ocarina
@@ -8,6 +8,10 @@
 
 #include "scene.h"
 
+#include "frame_resources.h"
+
+#include "frame_stats.h"
+
 #include "rhi/device.h"
 
 #include "math.h"
@@ -110,6 +114,132 @@ void display_loading_progress(
 
 
 
+namespace {
+
+
+
+void display_timing_row(Widgets& widgets, const char* name, const FrameTimeSummary& summary) {
+
+    widgets.text(
+
+        "%-18s p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f ms",
+
+        name,
+
+        summary.p50_ms,
+
+        summary.p95_ms,
+
+        summary.p99_ms,
+
+        summary.max_ms);
+
+}
+
+
+
+/// Percentiles of the Renderer's FrameStats window, per stage and pass group, CPU and GPU.
+
+void display_frame_timing(Widgets& widgets, const Renderer& renderer) {
+
+    if (!widgets.folding_header("Frame timing")) {
+
+        return;
+
+    }
+
+    const FrameStats& stats = renderer.frame_stats();
+
+    display_timing_row(widgets, "frame", stats.frame_summary());
+
+    display_timing_row(widgets, "gpu", stats.gpu_summary());
+
+    for (size_t stage = 0; stage < kFrameStageCount; ++stage) {
+
+        display_timing_row(
+
+            widgets,
+
+            frame_stage_name(static_cast<FrameStage>(stage)),
+
+            stats.stage_summary(static_cast<FrameStage>(stage)));
+
+    }
+
+    for (const auto& [group_id, record_task] : renderer.pass_groups()) {
+
+        if (record_task.empty()) {
+
+            continue;
+
+        }
+
+        const string name = string("record ") + pass_group_id_name(group_id);
+
+        display_timing_row(widgets, name.c_str(), stats.record_summary(group_id));
+
+    }
+
+    // GPU rows only once timers have resolved (never on devices without timestamps).
+
+    for (const auto& [group_id, record_task] : renderer.pass_groups()) {
+
+        const FrameTimeSummary gpu_group = stats.gpu_group_summary(group_id);
+
+        if (record_task.empty() || gpu_group.max_ms <= 0.0) {
+
+            continue;
+
+        }
+
+        const string name = string("gpu ") + pass_group_id_name(group_id);
+
+        display_timing_row(widgets, name.c_str(), gpu_group);
+
+        const uint32_t pass_count = stats.gpu_pass_count(group_id);
+
+        for (uint32_t pass = 0; pass < pass_count && pass_count > 1; ++pass) {
+
+            const string pass_name = name + " pass " + std::to_string(pass);
+
+            display_timing_row(widgets, pass_name.c_str(), stats.gpu_pass_summary(group_id, pass));
+
+        }
+
+    }
+
+    widgets.text(
+
+        "Hitches: %llu (last at frame %llu of %llu)",
+
+        static_cast<unsigned long long>(stats.hitch_count()),
+
+        static_cast<unsigned long long>(stats.last_hitch_frame()),
+
+        static_cast<unsigned long long>(stats.frame_count()));
+
+    if (widgets.button("Export CSV")) {
+
+        (void)stats.write_csv(fs::current_path() / "frame_stats.csv");
+
+    }
+
+    widgets.same_line();
+
+    if (widgets.button("Export JSON")) {
+
+        (void)stats.write_json(fs::current_path() / "frame_stats.json");
+
+    }
+
+}
+
+
+
+}// namespace
+
+
+
 void display_frame_info(Widgets& widgets) {
 
     FrameInfoContext* context = widgets.frame_info_context();
@@ -138,6 +268,38 @@ void display_frame_info(Widgets& widgets) {
 
         widgets.text("FPS: %.2f", fps);
 
+        widgets.text("Draw record CPU: %.3f ms", context->renderer->draw_record_cpu_ms());
+
+        widgets.text(
+
+            "Frame latency: %.2f ms (pipeline depth %u)",
+
+            context->renderer->frame_latency_ms(),
+
+            context->renderer->frame_pipeline_depth());
+
+        // Applied by the render thread at the next frame, never mid-record.
+
+        DynamicResolution& dynamic_resolution = context->renderer->dynamic_resolution();
+
+        bool dynamic_resolution_enabled = dynamic_resolution.enabled();
+
+        if (widgets.check_box("Dynamic resolution", &dynamic_resolution_enabled)) {
+
+            dynamic_resolution.set_enabled(dynamic_resolution_enabled);
+
+        }
+
+        widgets.same_line();
+
+        widgets.text(
+
+            "render scale %.2f (target %.2f ms)",
+
+            dynamic_resolution.scale(),
+
+            dynamic_resolution.settings().target_gpu_ms);
+
     }
 
 
@@ -190,12 +352,60 @@ void display_frame_info(Widgets& widgets) {
 
             widgets.text("Visible primitives: %zu", context->renderer->visible_entity_indices().size());
 
+            widgets.text(
+
+                "Visible triangles: %llu (%llu at LOD 0)",
+
+                static_cast<unsigned long long>(context->renderer->visible_triangle_count()),
+
+                static_cast<unsigned long long>(context->renderer->visible_full_triangle_count()));
+
+            if (context->renderer->cluster_culling_enabled()) {
+
+                widgets.text(
+
+                    "Visible clusters: %llu / %llu",
+
+                    static_cast<unsigned long long>(context->renderer->visible_cluster_count()),
+
+                    static_cast<unsigned long long>(context->renderer->cluster_count()));
+
+            }
+
         }
 
     }
 
 
 
+    {
+
+        const FrameUploadStats& uploads = FrameResources::instance().upload_stats();
+
+        widgets.text(
+
+            "Uploads: %.1f KB transforms (%u ranges), %.1f KB materials (%u ranges)",
+
+            static_cast<double>(uploads.transform_bytes) / 1024.0,
+
+            uploads.transform_ranges,
+
+            static_cast<double>(uploads.material_bytes) / 1024.0,
+
+            uploads.material_ranges);
+
+    }
+
+
+
+    if (context->renderer != nullptr) {
+
+        display_frame_timing(widgets, *context->renderer);
+
+    }
+
+
+
     if (context->extra) {
 
         context->extra(widgets);
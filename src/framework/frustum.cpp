@@ -3,6 +3,27 @@
 
 namespace ocarina {
 
+namespace {
+
+// Point shared by three planes (n . x + d = 0). Returns false when they are near-parallel.
+bool intersect_three_planes(
+    const FrustumPlane& a,
+    const FrustumPlane& b,
+    const FrustumPlane& c,
+    float3& out_point) noexcept {
+    const float3 bc = cross(b.normal, c.normal);
+    const float denom = dot(a.normal, bc);
+    if (std::abs(denom) < 1e-6f) {
+        return false;
+    }
+    const float3 ca = cross(c.normal, a.normal);
+    const float3 ab = cross(a.normal, b.normal);
+    out_point = (bc * a.distance + ca * b.distance + ab * c.distance) * (-1.0f / denom);
+    return std::isfinite(out_point.x) && std::isfinite(out_point.y) && std::isfinite(out_point.z);
+}
+
+}// namespace
+
 void Frustum::normalize_plane(int index) {
     const float length = std::sqrt(
         planes_[index].normal[0] * planes_[index].normal[0] +
@@ -80,6 +101,36 @@ bool Frustum::intersects(const BoundingBox& bounds) const noexcept {
     return true;
 }
 
+bool Frustum::intersects_sphere(const float3& center, float radius) const noexcept {
+    for (int plane_index = 0; plane_index < plane_count; ++plane_index) {
+        if (planes_[plane_index].signed_distance(center) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BoundingBox Frustum::compute_bounds() const noexcept {
+    // Plane order from extract_from_matrix: left, right, bottom, top, near, far.
+    BoundingBox bounds;
+    for (int depth_plane = 4; depth_plane <= 5; ++depth_plane) {
+        for (int vertical_plane = 2; vertical_plane <= 3; ++vertical_plane) {
+            for (int horizontal_plane = 0; horizontal_plane <= 1; ++horizontal_plane) {
+                float3 corner;
+                if (!intersect_three_planes(
+                        planes_[horizontal_plane],
+                        planes_[vertical_plane],
+                        planes_[depth_plane],
+                        corner)) {
+                    return {};
+                }
+                bounds.expand(corner);
+            }
+        }
+    }
+    return bounds;
+}
+
 BoundingBox BoundingBox::transformed(const float4x4& matrix) const noexcept {
     BoundingBox result;
     if (!valid) {
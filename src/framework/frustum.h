@@ -28,6 +28,12 @@ public:
     [[nodiscard]] const FrustumPlane& plane(int index) const noexcept { return planes_[index]; }
 
     [[nodiscard]] bool intersects(const BoundingBox& bounds) const noexcept;
+    /// Conservative: false only when the sphere lies fully outside one plane.
+    [[nodiscard]] bool intersects_sphere(const float3& center, float radius) const noexcept;
+
+    /// World-space AABB of the 8 frustum corners. Invalid when the planes are degenerate
+    /// (e.g. infinite far plane), in which case callers should not use it to bound a walk.
+    [[nodiscard]] BoundingBox compute_bounds() const noexcept;
 
 private:
     void extract_from_matrix(const math3d::Matrix4& matrix);
@@ -32,6 +32,12 @@ MeshGeometrySlice GlobalGPUStorage::upload_geometry(const MeshGeometryInput& inp
     return allocator_.upload(input);
 }
 
+MeshGeometrySlice GlobalGPUStorage::upload_lod_indices(
+    const MeshGeometrySlice& base,
+    const std::vector<uint32_t>& indices) {
+    return allocator_.upload_lod_indices(base, indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
 void GlobalGPUStorage::upload_mesh(OwnedMeshGeometry&& geometry, Mesh* mesh) {
     auto request = std::make_shared<MeshGPUResourceRequest>();
     request->device = device_;
@@ -40,8 +46,18 @@ void GlobalGPUStorage::upload_mesh(OwnedMeshGeometry&& geometry, Mesh* mesh) {
     request->uvs = std::move(geometry.uvs);
     request->colors = std::move(geometry.colors);
     request->indices = std::move(geometry.indices);
+    request->lods = std::move(geometry.lods);
+    request->meshlets = std::move(geometry.meshlets);
+    request->vertex_format = geometry.vertex_format;
+    if (geometry.vertex_format == MeshVertexFormat::Quantized) {
+        request->quantization = compute_position_quantization(
+            request->positions.data(), static_cast<uint32_t>(request->positions.size()));
+    }
     request->mesh = mesh;
     if (mesh != nullptr) {
+        mesh->set_vertex_format(request->vertex_format, request->quantization);
+        mesh->set_lod_slices({});
+        mesh->set_meshlets({});
         mesh->set_geometry_slice({});
         mesh->set_gpu_resource_state(GPUResourceState::CPU_Loaded);
     }
@@ -3,6 +3,8 @@
 #include "core/header.h"
 #include "core/concepts.h"
 #include "mesh_buffer_allocator.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
 
 namespace ocarina {
 
@@ -17,7 +19,13 @@ struct OwnedMeshGeometry {
     std::vector<Vector3> normals;
     std::vector<Vector2> uvs;
     std::vector<Vector4> colors;
-    std::vector<uint16_t> indices;
+    std::vector<uint32_t> indices;
+    /// Simplified levels (see build_mesh_lod_chain()), uploaded as extra index ranges.
+    std::vector<MeshLod> lods;
+    /// Clusters of the base level (see build_meshlets()); empty for small meshes.
+    std::vector<Meshlet> meshlets;
+    /// Page layout to upload into; Quantized needs a kQuantizedVertexDefine vertex shader.
+    MeshVertexFormat vertex_format = MeshVertexFormat::Float;
 };
 
 /// Facade over MeshBufferAllocator for mesh GPU uploads.
@@ -28,11 +36,14 @@ public:
     void initialize(Device* device);
     void cleanup();
 
-    /// Enqueue mesh upload onto the GPU resource thread.
+    /// Enqueue mesh upload onto the GPU resource thread. Sets @p mesh's vertex format (and
+    /// quantization box) right away.
     void upload_mesh(OwnedMeshGeometry&& geometry, Mesh* mesh);
 
     /// Allocate + upload immediately (GPU resource thread only, or when thread is not running).
     [[nodiscard]] MeshGeometrySlice upload_geometry(const MeshGeometryInput& input);
+    /// Uploads one LOD's indices against @p base's vertices (same thread rules as upload_geometry()).
+    [[nodiscard]] MeshGeometrySlice upload_lod_indices(const MeshGeometrySlice& base, const std::vector<uint32_t>& indices);
 
     [[nodiscard]] VertexBuffer* vertex_buffer(uint32_t page_index) const;
     [[nodiscard]] IndexBuffer* index_buffer(uint32_t page_index) const;
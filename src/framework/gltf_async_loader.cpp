@@ -9,6 +9,7 @@
 #include "core/logging.h"
 #include "core/hash.h"
 #include "core/image.h"
+#include "core/profiler.h"
 #include "transform.h"
 #include "primitive.h"
 #include "mesh.h"
@@ -16,6 +17,10 @@
 #include "math/basic_types.h"
 #include "scene.h"
 #include "global_gpu_storage.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
+#include "mesh_optimizer.h"
+#include "mesh_splitter.h"
 #include "bounding_box.h"
 #include "resource_manager.h"
 #include "rhi/vertex_buffer.h"
@@ -29,6 +34,28 @@ namespace ocarina {
 
 namespace {
 
+/// Batch entities per task range in fill_batch_entities().
+constexpr uint32_t kBatchFillRange = 256;
+
+class EntityBatchFillTask : public enki::ITaskSet {
+public:
+    using RangeFunction = ocarina::function<void(uint32_t, uint32_t)>;
+
+    EntityBatchFillTask(uint32_t count, RangeFunction function)
+        : function_(std::move(function)) {
+        m_SetSize = count;
+        m_MinRange = kBatchFillRange;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)threadnum;
+        function_(range.start, range.end);
+    }
+
+private:
+    RangeFunction function_;
+};
+
 float4x4 node_local_transform(const tinygltf::Node& node) {
     float3 translation = float3(0.0f);
     if (node.translation.size() == 3) {
@@ -147,6 +174,22 @@ uint32_t count_gltf_primitives(const tinygltf::Model& model) {
     return count;
 }
 
+/// Primitives instantiated by walking @p node_index and its descendants (matches load_gltf_node).
+uint32_t count_node_primitives(const tinygltf::Model& model, int node_index) {
+    if (node_index < 0 || node_index >= static_cast<int>(model.nodes.size())) {
+        return 0;
+    }
+    const tinygltf::Node& node = model.nodes[node_index];
+    uint32_t count = 0;
+    if (node.mesh >= 0 && node.mesh < static_cast<int>(model.meshes.size())) {
+        count += static_cast<uint32_t>(model.meshes[node.mesh].primitives.size());
+    }
+    for (int child_index : node.children) {
+        count += count_node_primitives(model, child_index);
+    }
+    return count;
+}
+
 [[nodiscard]] BoundingBox bounds_from_position_accessor(const tinygltf::Accessor& accessor) {
     BoundingBox bounds;
     if (accessor.minValues.size() >= 3 && accessor.maxValues.size() >= 3) {
@@ -196,6 +239,10 @@ void GltfAsyncLoader::load(Device* device) {
         && (*pipeline_entries_)[0].is_graphics()) {
         vertex_shader_ = (*pipeline_entries_)[0].vertex_shader();
         pixel_shader_ = (*pipeline_entries_)[0].pixel_shader();
+        // Meshes are uploaded in the layout the scene's vertex shader reads.
+        vertex_format_ = (*pipeline_entries_)[0].graphics.vertex.options.count(kQuantizedVertexDefine) != 0
+                             ? MeshVertexFormat::Quantized
+                             : MeshVertexFormat::Float;
     }
 
     is_loaded_ = load_gltf_file();
@@ -265,15 +312,35 @@ bool GltfAsyncLoader::load_gltf_file() {
         return false;
     }
 
-    const float4x4 identity = Transform<float4x4>().mat4x4();
     const tinygltf::Scene& scene = gltf_model.scenes[gltf_model.defaultScene >= 0 ? gltf_model.defaultScene : 0];
+
+    // Create every primitive entity up front: one ECS lock instead of one per primitive.
+    uint32_t primitive_count = 0;
+    for (int node_index : scene.nodes) {
+        primitive_count += count_node_primitives(gltf_model, node_index);
+    }
+    const EntityBatch primitive_batch = scene_.create_entities(primitive_count);
+    next_batch_entity_ = primitive_batch.first_entity;
+    batch_entity_end_ = primitive_batch.empty() ? primitive_batch.first_entity : primitive_batch.first_entity + primitive_batch.count;
+
     for (int node_index : scene.nodes) {
         if (node_index < 0 || node_index >= static_cast<int>(gltf_model.nodes.size())) {
             continue;
         }
-        load_gltf_node(gltf_model.nodes[node_index], gltf_model, identity);
+        load_gltf_node(gltf_model.nodes[node_index], gltf_model, InvalidUI32);
+    }
+    fill_batch_entities();
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    (void)ecs.set_parents(parent_links_);
+    parent_links_.clear();
+    ecs.commit_entities(primitive_batch);
+
+    if (progress_listener_ != nullptr) {
+        progress_listener_->set_phase("Building meshlets and mesh LODs, optimizing indices");
     }
 
+    upload_pending_meshes();
+
     if (progress_listener_ != nullptr) {
         progress_listener_->set_phase("Building scene clusters");
     }
@@ -286,71 +353,196 @@ bool GltfAsyncLoader::load_gltf_file() {
     return true;
 }
 
+void GltfAsyncLoader::fill_batch_entities() {
+    OC_PROFILE_FUNCTION;
+    const uint32_t fill_count = static_cast<uint32_t>(batch_fills_.size());
+    if (fill_count == 0) {
+        return;
+    }
+
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    auto fill_range = [this, &ecs](uint32_t begin, uint32_t end) {
+        // Batch entities claimed their sync slot and have no mesh yet, so the setters below
+        // take no lock; the shared one keeps the component arrays in place.
+        const auto components_lock = ecs.lock_components_shared();
+        for (uint32_t i = begin; i < end; ++i) {
+            const BatchEntityFill& fill = batch_fills_[i];
+            if (fill.node_transform) {
+                TransformComponent& transform = ecs.transform_component(fill.entity_index);
+                transform.set_position(fill.translation);
+                transform.set_rotation(fill.rotation);
+                transform.set_scale(fill.scale);
+            }
+            Primitive& prim = ecs.primitive(fill.entity_index);
+            prim.set_mesh(fill.mesh);
+            if (fill.material != nullptr) {
+                prim.set_material(fill.material);
+            }
+        }
+    };
+
+    if (scheduler_ == nullptr || fill_count <= kBatchFillRange) {
+        fill_range(0, fill_count);
+    } else {
+        EntityBatchFillTask task(fill_count, fill_range);
+        scheduler_->AddTaskSetToPipe(&task);
+        scheduler_->WaitforTask(&task);
+    }
+    batch_fills_.clear();
+}
+
+void GltfAsyncLoader::upload_pending_meshes() {
+    if (pending_mesh_uploads_.empty()) {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<OwnedMeshGeometry*> geometries;
+    geometries.reserve(pending_mesh_uploads_.size());
+    for (PendingMeshUpload& upload : pending_mesh_uploads_) {
+        geometries.push_back(&upload.geometry);
+    }
+
+    auto run_task = [&](enki::ITaskSet& task) {
+        if (scheduler_ != nullptr) {
+            scheduler_->AddTaskSetToPipe(&task);
+            scheduler_->WaitforTask(&task);
+        } else {
+            task.ExecuteRange(enki::TaskSetPartition{0, static_cast<uint32_t>(pending_mesh_uploads_.size())}, 0);
+        }
+    };
+    // Meshlets reorder the base indices, so they are built before the LODs simplify them.
+    MeshletBuildTask meshlet_task(geometries);
+    run_task(meshlet_task);
+    MeshLodBuildTask lod_task(geometries);
+    run_task(lod_task);
+    // Index order for the post-transform cache and overdraw, then vertex order for fetch.
+    MeshOptimizeTask optimize_task(std::move(geometries));
+    run_task(optimize_task);
+
+    uint64_t base_triangles = 0;
+    uint64_t coarsest_triangles = 0;
+    uint32_t lod_count = 0;
+    uint64_t meshlet_count = 0;
+    uint64_t vertex_bytes = 0;
+    double acmr_before = 0.0;
+    double acmr_after = 0.0;
+    for (const MeshOptimizeStats& stats : optimize_task.stats()) {
+        acmr_before += static_cast<double>(stats.before.acmr) * stats.triangle_count;
+        acmr_after += static_cast<double>(stats.after.acmr) * stats.triangle_count;
+    }
+    for (PendingMeshUpload& upload : pending_mesh_uploads_) {
+        base_triangles += upload.geometry.indices.size() / 3;
+        coarsest_triangles += (upload.geometry.lods.empty()
+                                   ? upload.geometry.indices.size()
+                                   : upload.geometry.lods.back().indices.size()) / 3;
+        lod_count += static_cast<uint32_t>(upload.geometry.lods.size());
+        meshlet_count += upload.geometry.meshlets.size();
+        vertex_bytes += upload.geometry.positions.size() * mesh_bytes_per_vertex(upload.geometry.vertex_format);
+        GlobalGPUStorage::instance().upload_mesh(std::move(upload.geometry), upload.mesh);
+    }
+
+    OC_INFO_FORMAT(
+        "GltfAsyncLoader: {} LODs for {} meshes, {} -> {} triangles at the coarsest level, {} meshlets, "
+        "ACMR {:.3f} -> {:.3f}, {:.2f} MB of {} vertices, {:.3f} ms",
+        lod_count,
+        pending_mesh_uploads_.size(),
+        base_triangles,
+        coarsest_triangles,
+        meshlet_count,
+        base_triangles > 0 ? acmr_before / static_cast<double>(base_triangles) : 0.0,
+        base_triangles > 0 ? acmr_after / static_cast<double>(base_triangles) : 0.0,
+        static_cast<double>(vertex_bytes) / (1024.0 * 1024.0),
+        vertex_format_ == MeshVertexFormat::Quantized ? "quantized" : "float",
+        elapsed_ms(start));
+    pending_mesh_uploads_.clear();
+}
+
 void GltfAsyncLoader::build_scene_clusters() {
+    // Grid cells are placed from world bounds, so resolve the node hierarchy first.
+    EntityComponentSystem::instance().propagate_transforms();
     scene_.build_grid();
 }
 
 void GltfAsyncLoader::load_gltf_node(
     const tinygltf::Node& node,
     const tinygltf::Model& model,
-    const float4x4& parent_transform) {
-    const float4x4 world_transform = parent_transform * node_local_transform(node);
+    uint32_t parent_entity) {
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    float3 translation;
+    quaternion rotation;
+    float3 scale;
+    decompose(node_local_transform(node), &translation, &rotation, &scale);
+
+    // The node's first primitive carries the node TRS; further primitives of the same node
+    // are identity children of it, so moving the node at runtime moves all of them.
+    uint32_t node_entity = InvalidUI32;
+    // Links @p entity_index into the hierarchy; returns true when it carries the node TRS.
+    auto link_node_entity = [&](uint32_t entity_index) {
+        if (node_entity == InvalidUI32) {
+            if (parent_entity != InvalidUI32) {
+                parent_links_.push_back(EntityParentLink{entity_index, parent_entity});
+            }
+            node_entity = entity_index;
+            return true;
+        }
+        parent_links_.push_back(EntityParentLink{entity_index, node_entity});
+        return false;
+    };
+    auto apply_node_transform = [&](uint32_t entity_index) {
+        TransformComponent& transform = ecs.transform_component(entity_index);
+        transform.set_position(translation);
+        transform.set_rotation(rotation);
+        transform.set_scale(scale);
+    };
 
     if (node.mesh >= 0 && node.mesh < static_cast<int>(model.meshes.size())) {
         const tinygltf::Mesh& mesh = model.meshes[node.mesh];
         for (size_t gltf_primitive_index = 0; gltf_primitive_index < mesh.primitives.size(); ++gltf_primitive_index) {
             const tinygltf::Primitive& gltf_primitive = mesh.primitives[gltf_primitive_index];
 
-            Primitive& prim = scene_.emplace_primitive();
-
-            float3 translation;
-            quaternion rotation;
-            float3 scale;
-            decompose(world_transform, &translation, &rotation, &scale);
-            const uint32_t scene_primitive_index = static_cast<uint32_t>(scene_.primitive_count() - 1);
-            scene_.transform_component(scene_primitive_index).set_position(translation);
-            scene_.transform_component(scene_primitive_index).set_rotation(rotation);
-            scene_.transform_component(scene_primitive_index).set_scale(scale);
-
-            Mesh* mesh_obj = nullptr;
             const uint64_t geometry_key = make_geometry_key(gltf_primitive);
-            const auto cached_mesh = geometry_meshes_.find(geometry_key);
-            if (cached_mesh != geometry_meshes_.end()) {
-                mesh_obj = cached_mesh->second;
+            auto cached_meshes = geometry_meshes_.find(geometry_key);
+            if (cached_meshes != geometry_meshes_.end()) {
                 OC_INFO_FORMAT(
                     "GltfAsyncLoader: reused mesh geometry key={:#x} (skipped vertex/index load)",
                     geometry_key);
             } else {
-                mesh_obj = ocarina::new_with_allocator<Mesh>();
-                mesh_storage_.push_back(mesh_obj);
+                cached_meshes = geometry_meshes_.emplace(
+                    geometry_key, append_primitive_geometry(gltf_primitive, model)).first;
+            }
 
-                const BoundingBox local_bounds = append_primitive_geometry(
-                    gltf_primitive, model, mesh_obj);
-                if (local_bounds.valid) {
-                    mesh_obj->set_local_bounds(local_bounds.min, local_bounds.max);
+            // Each piece of a split mesh is its own entity under the node.
+            for (Mesh* mesh_obj : cached_meshes->second) {
+                Material* prim_material = nullptr;
+                if (gltf_primitive.material >= 0 && gltf_primitive.material < static_cast<int>(model.materials.size())) {
+                    prim_material = load_material(model.materials[gltf_primitive.material], model);
+                } else {
+                    prim_material = create_default_material();
                 }
 
-                geometry_meshes_.emplace(geometry_key, mesh_obj);
-            }
+                if (next_batch_entity_ < batch_entity_end_) {
+                    // Written by fill_batch_entities() once the walk is done.
+                    BatchEntityFill& fill = batch_fills_.emplace_back();
+                    fill.entity_index = next_batch_entity_++;
+                    fill.mesh = mesh_obj;
+                    fill.material = prim_material;
+                    fill.node_transform = link_node_entity(fill.entity_index);
+                    fill.translation = translation;
+                    fill.rotation = rotation;
+                    fill.scale = scale;
+                    continue;
+                }
 
-            prim.set_mesh(mesh_obj);
-
-            if (gltf_primitive.material >= 0 && gltf_primitive.material < static_cast<int>(model.materials.size())) {
-                load_material(prim, model.materials[gltf_primitive.material], model);
-            } else if (vertex_shader_ != InvalidUI64 && pixel_shader_ != InvalidUI64) {
-                Material* prim_material = ResourceManager::instance().create_unique_material(
-                    device_,
-                    vertex_shader_,
-                    pixel_shader_);
-                prim.set_material(prim_material);
-                prim_material->set_property("baseColorFactor", make_float4(1.f, 1.f, 1.f, 1.f));
-                prim_material->set_property("roughness", 1.f);
-                prim_material->set_property("metallic", 0.f);
-                prim_material->set_property("ao", 1.f);
-                prim_material->set_property("normalIndex", 0u);
-                prim_material->set_property("normalSamplerIndex", 0u);
-                prim_material->set_property("metallicRoughnessIndex", InvalidUI32);
-                prim_material->set_property("metallicRoughnessSamplerIndex", 0u);
+                const uint32_t entity_index = scene_.emplace_primitive().entity_index();
+                if (link_node_entity(entity_index)) {
+                    apply_node_transform(entity_index);
+                }
+                Primitive& prim = ecs.primitive(entity_index);
+                prim.set_mesh(mesh_obj);
+                if (prim_material != nullptr) {
+                    prim.set_material(prim_material);
+                }
             }
 
             if (progress_listener_ != nullptr) {
@@ -359,18 +551,25 @@ void GltfAsyncLoader::load_gltf_node(
         }
     }
 
+    if (node_entity == InvalidUI32 && !node.children.empty()) {
+        // Mesh-less group node: a transform-only entity outside the scene, so it is never drawn.
+        const uint32_t group_entity = ecs.emplace_primitive();
+        if (link_node_entity(group_entity)) {
+            apply_node_transform(group_entity);
+        }
+    }
+
     for (int child_index : node.children) {
         if (child_index < 0 || child_index >= static_cast<int>(model.nodes.size())) {
             continue;
         }
-        load_gltf_node(model.nodes[child_index], model, world_transform);
+        load_gltf_node(model.nodes[child_index], model, node_entity);
     }
 }
 
-BoundingBox GltfAsyncLoader::append_primitive_geometry(
+std::vector<Mesh*> GltfAsyncLoader::append_primitive_geometry(
     const tinygltf::Primitive& primitive,
-    const tinygltf::Model& model,
-    Mesh* mesh) {
+    const tinygltf::Model& model) {
     const auto start = std::chrono::steady_clock::now();
     const uint64_t geometry_key = make_geometry_key(primitive);
     BoundingBox local_bounds;
@@ -459,7 +658,7 @@ BoundingBox GltfAsyncLoader::append_primitive_geometry(
         colors.clear();
     }
 
-    std::vector<uint16_t> indices;
+    std::vector<uint32_t> indices;
     if (primitive.indices >= 0 && primitive.indices < static_cast<int>(model.accessors.size())) {
         const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
         if (accessor.bufferView >= 0 && accessor.bufferView < static_cast<int>(model.bufferViews.size())) {
@@ -469,13 +668,15 @@ BoundingBox GltfAsyncLoader::append_primitive_geometry(
                 const unsigned char* data = buffer.data.data() + buffer_view.byteOffset + accessor.byteOffset;
                 const int count = accessor.count;
                 indices.resize(static_cast<size_t>(count));
-                if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-                    memcpy(indices.data(), data, static_cast<size_t>(count) * sizeof(uint16_t));
-                } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-                    const auto* src = reinterpret_cast<const uint32_t*>(data);
-                    for (int i = 0; i < count; ++i) {
-                        indices[static_cast<size_t>(i)] = static_cast<uint16_t>(src[i]);
-                    }
+                if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
+                    memcpy(indices.data(), data, static_cast<size_t>(count) * sizeof(uint32_t));
+                } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+                    const auto* src = reinterpret_cast<const uint16_t*>(data);
+                    std::copy(src, src + count, indices.begin());
+                } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+                    std::copy(data, data + count, indices.begin());
+                } else {
+                    indices.clear();
                 }
             }
         }
@@ -484,7 +685,7 @@ BoundingBox GltfAsyncLoader::append_primitive_geometry(
     if (indices.empty()) {
         indices.resize(vertex_count);
         for (uint32_t i = 0; i < vertex_count; ++i) {
-            indices[i] = static_cast<uint16_t>(i);
+            indices[i] = i;
         }
     }
 
@@ -500,15 +701,49 @@ BoundingBox GltfAsyncLoader::append_primitive_geometry(
         geometry.colors = std::move(colors);
     }
     geometry.indices = std::move(indices);
-    GlobalGPUStorage::instance().upload_mesh(std::move(geometry), mesh);
+    geometry.vertex_format = vertex_format_;
+
+    std::vector<OwnedMeshGeometry> pieces;
+    if (mesh_splitting_enabled_) {
+        pieces = split_mesh(std::move(geometry));
+    } else {
+        pieces.push_back(std::move(geometry));
+    }
+
+    std::vector<Mesh*> meshes;
+    meshes.reserve(pieces.size());
+    for (OwnedMeshGeometry& piece : pieces) {
+        Mesh* mesh = ocarina::new_with_allocator<Mesh>();
+        mesh_storage_.push_back(mesh);
+        if (pieces.size() > 1) {
+            local_bounds.reset();
+            for (const Vector3& position : piece.positions) {
+                local_bounds.expand(make_float3(position.x, position.y, position.z));
+            }
+        }
+        if (local_bounds.valid) {
+            mesh->set_local_bounds(local_bounds.min, local_bounds.max);
+        }
+        if (vertex_format_ == MeshVertexFormat::Quantized) {
+            // Known before the node's primitives take the mesh, so their GPU transforms fold in
+            // the decode from the start; upload_mesh() sets the same box.
+            mesh->set_vertex_format(
+                vertex_format_,
+                compute_position_quantization(piece.positions.data(), static_cast<uint32_t>(piece.positions.size())));
+        }
+        // Uploaded after the scene walk, once every mesh's LOD chain is built.
+        pending_mesh_uploads_.push_back(PendingMeshUpload{std::move(piece), mesh});
+        meshes.push_back(mesh);
+    }
 
     OC_INFO_FORMAT(
-        "GltfAsyncLoader::append_primitive_geometry: geometry key={:#x}, {} vertices, {:.3f} ms",
+        "GltfAsyncLoader::append_primitive_geometry: geometry key={:#x}, {} vertices in {} meshes, {:.3f} ms",
         geometry_key,
         vertex_count,
+        meshes.size(),
         elapsed_ms(start));
 
-    return local_bounds;
+    return meshes;
 }
 
 TextureHandle GltfAsyncLoader::load_gltf_image(int image_index, const tinygltf::Model& model) {
@@ -574,14 +809,33 @@ TextureHandle GltfAsyncLoader::load_gltf_image(int image_index, const tinygltf::
     return handle;
 }
 
-void GltfAsyncLoader::load_material(Primitive& prim, const tinygltf::Material& material, const tinygltf::Model& model) {
-    if (vertex_shader_ != InvalidUI64 && pixel_shader_ != InvalidUI64) {
-        Material* prim_material = ResourceManager::instance().create_unique_material(
-            device_,
-            vertex_shader_,
-            pixel_shader_);
-        prim.set_material(prim_material);
+Material* GltfAsyncLoader::create_default_material() {
+    if (vertex_shader_ == InvalidUI64 || pixel_shader_ == InvalidUI64) {
+        return nullptr;
+    }
+    Material* prim_material = ResourceManager::instance().create_unique_material(
+        device_,
+        vertex_shader_,
+        pixel_shader_);
+    prim_material->set_property("baseColorFactor", make_float4(1.f, 1.f, 1.f, 1.f));
+    prim_material->set_property("roughness", 1.f);
+    prim_material->set_property("metallic", 0.f);
+    prim_material->set_property("ao", 1.f);
+    prim_material->set_property("normalIndex", 0u);
+    prim_material->set_property("normalSamplerIndex", 0u);
+    prim_material->set_property("metallicRoughnessIndex", InvalidUI32);
+    prim_material->set_property("metallicRoughnessSamplerIndex", 0u);
+    return prim_material;
+}
+
+Material* GltfAsyncLoader::load_material(const tinygltf::Material& material, const tinygltf::Model& model) {
+    if (vertex_shader_ == InvalidUI64 || pixel_shader_ == InvalidUI64) {
+        return nullptr;
     }
+    Material* prim_material = ResourceManager::instance().create_unique_material(
+        device_,
+        vertex_shader_,
+        pixel_shader_);
 
     const auto& pbr = material.pbrMetallicRoughness;
     const float4 base_color_factor = make_float4(
@@ -595,11 +849,6 @@ void GltfAsyncLoader::load_material(Primitive& prim, const tinygltf::Material& m
     const float metallic = static_cast<float>(pbr.metallicFactor);
     const float ao = 1.f;
 
-    Material* prim_material = prim.get_material();
-    if (prim_material == nullptr) {
-        return;
-    }
-
     prim_material->set_property("baseColorFactor", base_color_factor);
     prim_material->set_property("roughness", roughness);
     prim_material->set_property("metallic", metallic);
@@ -631,6 +880,7 @@ void GltfAsyncLoader::load_material(Primitive& prim, const tinygltf::Material& m
             prim_material->set_property("metallicRoughnessSamplerIndex", linear_repeat_sampler);
         }
     }
+    return prim_material;
 }
 
 }// namespace ocarina
@@ -5,6 +5,7 @@
 #include "math/basic_types.h"
 #include "scene.h"
 #include "mesh_geometry.h"
+#include "global_gpu_storage.h"
 #include "material.h"
 #include "bindless_texture_registry.h"
 #include "rhi/device.h"
@@ -39,6 +40,12 @@ public:
     [[nodiscard]] Scene& get_scene() noexcept { return scene_; }
     [[nodiscard]] const Scene& get_scene() const noexcept { return scene_; }
 
+    /// Splits meshes with more than kMaxUInt16IndexedVertices vertices into pieces that keep
+    /// 16-bit indices (see split_mesh()); when off they upload whole with 32-bit indices.
+    /// On by default; set before loading starts.
+    void set_mesh_splitting_enabled(bool enabled) noexcept { mesh_splitting_enabled_ = enabled; }
+    [[nodiscard]] bool mesh_splitting_enabled() const noexcept { return mesh_splitting_enabled_; }
+
 protected:
     void load(Device* device) override;
     [[nodiscard]] uint32_t count_load_progress_steps() override;
@@ -48,12 +55,20 @@ private:
     void begin_gltf_progress();
     bool load_gltf_file();
     void build_scene_clusters();
-    void load_gltf_node(const tinygltf::Node& node, const tinygltf::Model& model, const float4x4& parent_transform);
-    [[nodiscard]] BoundingBox append_primitive_geometry(
+    /// Builds every new mesh's LOD chain in parallel, then queues the GPU uploads.
+    void upload_pending_meshes();
+    /// Creates the node's primitives and links them under @p parent_entity (InvalidUI32 for scene roots).
+    void load_gltf_node(const tinygltf::Node& node, const tinygltf::Model& model, uint32_t parent_entity);
+    /// Parses the primitive's geometry into one mesh, or one per piece when it is split.
+    [[nodiscard]] std::vector<Mesh*> append_primitive_geometry(
         const tinygltf::Primitive& primitive,
-        const tinygltf::Model& model,
-        Mesh* mesh);
-    void load_material(Primitive& prim, const tinygltf::Material& material, const tinygltf::Model& model);
+        const tinygltf::Model& model);
+    /// Fills the batch entities recorded by load_gltf_node() in parallel ranges.
+    void fill_batch_entities();
+    /// Creates a material for @p material; null when the loader has no shaders.
+    [[nodiscard]] Material* load_material(const tinygltf::Material& material, const tinygltf::Model& model);
+    /// Material for primitives without one in the glTF; null when the loader has no shaders.
+    [[nodiscard]] Material* create_default_material();
     [[nodiscard]] TextureHandle load_gltf_image(int image_index, const tinygltf::Model& model);
     [[nodiscard]] static uint64_t make_geometry_key(const tinygltf::Primitive& primitive);
 
@@ -65,10 +80,37 @@ private:
     std::string gltf_parse_error_;
     handle_ty vertex_shader_ = InvalidUI64;
     handle_ty pixel_shader_ = InvalidUI64;
+    /// Quantized when the first pipeline entry's vertex shader has kQuantizedVertexDefine.
+    MeshVertexFormat vertex_format_ = MeshVertexFormat::Float;
+    bool mesh_splitting_enabled_ = true;
     std::vector<Mesh*> mesh_storage_;
+    /// Geometry parsed by append_primitive_geometry(), uploaded by upload_pending_meshes().
+    struct PendingMeshUpload {
+        OwnedMeshGeometry geometry;
+        Mesh* mesh = nullptr;
+    };
+    std::vector<PendingMeshUpload> pending_mesh_uploads_;
     std::unordered_map<int, TextureHandle> image_textures_;
-    std::unordered_map<uint64_t, Mesh*> geometry_meshes_;
+    std::unordered_map<uint64_t, std::vector<Mesh*>> geometry_meshes_;
     Scene scene_;
+    /// Unconsumed part of the entity batch created for the scene's primitives.
+    uint32_t next_batch_entity_ = InvalidUI32;
+    uint32_t batch_entity_end_ = InvalidUI32;
+    /// Hierarchy links collected while the batch is filled, applied under one ECS lock.
+    std::vector<EntityParentLink> parent_links_;
+    /// Component writes for one batch entity. The node walk creates meshes and materials
+    /// (shared caches, so serially); the writes themselves touch only the entity's slot.
+    struct BatchEntityFill {
+        uint32_t entity_index = InvalidUI32;
+        Mesh* mesh = nullptr;
+        Material* material = nullptr;
+        /// Only a node's first primitive carries the node TRS; the others stay identity.
+        bool node_transform = false;
+        float3 translation;
+        quaternion rotation;
+        float3 scale;
+    };
+    std::vector<BatchEntityFill> batch_fills_;
     bool is_loaded_ = false;
 };
 
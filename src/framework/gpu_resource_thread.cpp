@@ -89,8 +89,23 @@ void MeshGPUResourceRequest::process() {
     input.colors = colors.empty() ? nullptr : colors.data();
     input.indices = indices.empty() ? nullptr : indices.data();
     input.index_count = static_cast<uint32_t>(indices.size());
-
-    const MeshGeometrySlice slice = GlobalGPUStorage::instance().upload_geometry(input);
+    input.vertex_format = vertex_format;
+    input.quantization = quantization;
+
+    GlobalGPUStorage& gpu_storage = GlobalGPUStorage::instance();
+    const MeshGeometrySlice slice = gpu_storage.upload_geometry(input);
+
+    // LODs reuse the base vertices. They are published first: the geometry slice bumps the
+    // mesh version that precompiled draws watch.
+    std::vector<MeshLodSlice> lod_slices;
+    lod_slices.reserve(lods.size());
+    for (const MeshLod& lod : lods) {
+        if (!lod.indices.empty()) {
+            lod_slices.push_back(MeshLodSlice{gpu_storage.upload_lod_indices(slice, lod.indices), lod.error});
+        }
+    }
+    mesh->set_lod_slices(std::move(lod_slices));
+    mesh->set_meshlets(std::move(meshlets));
     mesh->set_geometry_slice(slice);
     mesh->set_gpu_resource_state(GPUResourceState::GPU_Ready);
 }
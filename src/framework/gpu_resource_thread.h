@@ -7,6 +7,7 @@
 #include "rhi/graphics_descriptions.h"
 #include "rhi/resources/texture_sampler.h"
 #include "rhi/vertex_buffer.h"
+#include "mesh_simplifier.h"
 #include "ext/enkiTS/src/TaskScheduler.h"
 #include <atomic>
 #include <memory>
@@ -73,7 +74,11 @@ struct MeshGPUResourceRequest : GPUResourceRequest {
     std::vector<Vector3> normals;
     std::vector<Vector2> uvs;
     std::vector<Vector4> colors;
-    std::vector<uint16_t> indices;
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    MeshVertexFormat vertex_format = MeshVertexFormat::Float;
+    PositionQuantization quantization{};
 
     Mesh* mesh = nullptr;
 
@@ -0,0 +1,108 @@
+#include "indirect_draw_list.h"
+#include "resource_manager.h"
+#include "core/profiler.h"
+
+namespace ocarina {
+
+namespace {
+
+[[nodiscard]] bool can_batch(const RenderComponent& first, const RenderComponent& item) noexcept {
+    return item.instanced_transform_index_offset == first.instanced_transform_index_offset &&
+           item.vertex_page == first.vertex_page &&
+           item.index_page == first.index_page &&
+           item.material_descriptor_set == first.material_descriptor_set &&
+           item.material_index == first.material_index &&
+           item.push_constant_size == first.push_constant_size;
+}
+
+/// Recreates @p buffer with room for @p count elements (doubling) when it is too small.
+template<typename T>
+void ensure_capacity(Device* device, TypedBuffer<T>& buffer, size_t count, const char* name) {
+    if (buffer.size() >= count) {
+        return;
+    }
+    const size_t grown = std::max(count, buffer.size() * 2);
+    // The slot was last read kFrameSlots frames ago, so the old buffer is idle.
+    if (buffer.handle() != 0) {
+        ResourceManager::instance().release_buffer(buffer.handle());
+        buffer.reset();
+    }
+    buffer = ResourceManager::instance().create_buffer<T>(device, grown, GraphicBufferBindFlags::IndirectBuffer, name);
+}
+
+}// namespace
+
+void IndirectDrawList::build(
+    Device* device,
+    const std::vector<DrawBatch>& draws,
+    const std::vector<RenderComponent>& render_components) {
+    OC_PROFILE_FUNCTION;
+    commands_.clear();
+    counts_.clear();
+    batches_.clear();
+
+    const RenderComponent* batch_first = nullptr;
+    for (const DrawBatch& draw : draws) {
+        const RenderComponent& item = render_components[draw.entity_index];
+        const bool indirect = draw.instanced();
+        const bool extends_batch = indirect && !batches_.empty() && batches_.back().indirect &&
+                                   batches_.back().pipeline == draw.pipeline &&
+                                   can_batch(*batch_first, item);
+        if (!extends_batch) {
+            batches_.push_back(Batch{
+                draw.pipeline,
+                draw.entity_index,
+                static_cast<uint32_t>(commands_.size()),
+                0,
+                indirect});
+            batch_first = &item;
+        }
+
+        commands_.push_back(DrawIndexedIndirectCommand{
+            item.index_count,
+            draw.instance_count,
+            item.first_index,
+            item.vertex_offset,
+            indirect ? draw.first_instance : 0});
+        ++batches_.back().command_count;
+    }
+
+    slot_ = (slot_ + 1) % kFrameSlots;
+    if (commands_.empty()) {
+        return;
+    }
+
+    counts_.reserve(batches_.size());
+    for (const Batch& batch : batches_) {
+        counts_.push_back(batch.command_count);
+    }
+
+    FrameSlot& slot = slots_[slot_];
+    ensure_capacity(device, slot.commands, commands_.size(), "indirect_draw_commands");
+    ensure_capacity(device, slot.counts, counts_.size(), "indirect_draw_counts");
+    slot.commands.copy_from_immediately(
+        commands_.data(),
+        static_cast<uint32_t>(commands_.size() * sizeof(DrawIndexedIndirectCommand)));
+    slot.counts.copy_from_immediately(
+        counts_.data(),
+        static_cast<uint32_t>(counts_.size() * sizeof(uint32_t)));
+}
+
+void IndirectDrawList::release() noexcept {
+    ResourceManager& resources = ResourceManager::instance();
+    for (FrameSlot& slot : slots_) {
+        if (slot.commands.handle() != 0) {
+            resources.release_buffer(slot.commands.handle());
+            slot.commands.reset();
+        }
+        if (slot.counts.handle() != 0) {
+            resources.release_buffer(slot.counts.handle());
+            slot.counts.reset();
+        }
+    }
+    commands_.clear();
+    counts_.clear();
+    batches_.clear();
+}
+
+}// namespace ocarina
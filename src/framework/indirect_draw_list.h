@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "rhi/graphics_descriptions.h"
+#include "rhi/renderpass.h"
+#include "rhi/resources/buffer.h"
+#include "render_component.h"
+
+namespace ocarina {
+
+class Device;
+
+/// CPU-built multi-draw-indirect commands for one render pass. build() walks the pass's
+/// draw batches and merges runs of instanced batches that share pipeline, vertex / index
+/// page, material set and material index into one multi-draw; each instanced batch becomes
+/// a DrawIndexedIndirectCommand carrying its instance count and its first_instance in the
+/// frame's draw-instance buffer. Plain batches stay single draws recorded with draw_indexed().
+///
+/// Commands live in host-visible buffers, one set per frame slot, so a frame never
+/// overwrites arguments the GPU may still read for an earlier frame.
+class IndirectDrawList {
+public:
+    /// Matches the backend's frames in flight.
+    static constexpr uint32_t kFrameSlots = 3;
+
+    struct Batch {
+        RHIPipeline* pipeline = nullptr;
+        /// Entity whose precompiled draw supplies buffers, sets and push constants.
+        uint32_t entity_index = InvalidUI32;
+        uint32_t first_command = 0;
+        uint32_t command_count = 0;
+        /// False for draws that must be recorded with draw_indexed().
+        bool indirect = false;
+    };
+
+    IndirectDrawList() = default;
+    IndirectDrawList(const IndirectDrawList&) = delete;
+    IndirectDrawList& operator=(const IndirectDrawList&) = delete;
+    ~IndirectDrawList() { release(); }
+
+    /// Builds batches for @p draws, advances to the next frame slot and uploads the
+    /// commands (and per-batch draw counts) into it.
+    void build(Device* device, const std::vector<DrawBatch>& draws, const std::vector<RenderComponent>& render_components);
+
+    [[nodiscard]] const std::vector<Batch>& batches() const noexcept { return batches_; }
+    [[nodiscard]] uint32_t draw_count() const noexcept { return static_cast<uint32_t>(commands_.size()); }
+
+    /// Buffers of the slot filled by the last build().
+    [[nodiscard]] handle_ty command_buffer() const noexcept { return slots_[slot_].commands.handle(); }
+    [[nodiscard]] handle_ty count_buffer() const noexcept { return slots_[slot_].counts.handle(); }
+
+    void release() noexcept;
+
+private:
+    struct FrameSlot {
+        TypedBuffer<DrawIndexedIndirectCommand> commands;
+        TypedBuffer<uint32_t> counts;
+    };
+
+    std::array<FrameSlot, kFrameSlots> slots_{};
+    uint32_t slot_ = 0;
+    std::vector<DrawIndexedIndirectCommand> commands_;
+    std::vector<uint32_t> counts_;
+    std::vector<Batch> batches_;
+};
+
+}// namespace ocarina
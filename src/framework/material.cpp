@@ -12,7 +12,14 @@
 
 namespace ocarina {
 
-Material::Material(Device* device, handle_ty vertex_shader, handle_ty pixel_shader) : device_(device) {
+namespace {
+
+std::atomic<uint32_t> next_material_id{0};
+
+}// namespace
+
+Material::Material(Device* device, handle_ty vertex_shader, handle_ty pixel_shader)
+    : material_id_(next_material_id.fetch_add(1, std::memory_order_relaxed)), device_(device) {
     pipeline_state_ = PipelineState::MakeGraphicsDefault(vertex_shader, pixel_shader);
 
     // Descriptor set layouts / pipeline layout are created in PipelineCompileTask /
@@ -28,6 +35,18 @@ Material::Material(Device* device, handle_ty vertex_shader, handle_ty pixel_shad
     ensure_uniform_buffer_gpus();
 }
 
+uint32_t Material::pipeline_state_id() {
+    // Pass groups call this concurrently; a duplicate registration returns the same id.
+    if (pipeline_dirty_.load(std::memory_order_relaxed)
+        || pipeline_state_id_.load(std::memory_order_relaxed) == InvalidUI32) {
+        pipeline_state_id_.store(
+            PipelineManager::instance().register_pipeline_state(pipeline_state_),
+            std::memory_order_relaxed);
+        pipeline_dirty_.store(false, std::memory_order_relaxed);
+    }
+    return pipeline_state_id_.load(std::memory_order_relaxed);
+}
+
 Material::~Material() {
     release_gpu_buffers();
 }
@@ -309,6 +328,7 @@ void Material::bind_texture(uint64_t name_id, const TextureHandle& handle) {
         }
     }
     textures_ready_.store(false, std::memory_order_relaxed);
+    bump_version();
 }
 
 bool Material::evaluate_textures_ready() {
@@ -335,6 +355,11 @@ bool Material::evaluate_textures_ready() {
 }
 
 bool Material::is_renderable() {
+    if (textures_ready_.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    // Evaluation caches texture pointers and writes the material set.
+    std::lock_guard<std::mutex> lock(textures_ready_mutex_);
     if (textures_ready_.load(std::memory_order_relaxed)) {
         return true;
     }
@@ -449,6 +474,7 @@ void Material::ensure_material_buffer() {
         ecs.material_parameters_buffer().data() + material_buffer_offset_,
         0,
         material_params_byte_size_);
+    bump_version();
 }
 
 }// namespace ocarina
@@ -73,7 +73,8 @@ public:
     }
 
     /// True when every bound texture is GPU_Ready.
-    /// Cached; re-evaluates only while textures_ready_ is still false.
+    /// Cached; re-evaluates only while textures_ready_ is still false. Safe to call from
+    /// parallel render-component updates.
     [[nodiscard]] bool is_renderable();
 
     void add_sampler(uint64_t name_id, const TextureSampler& sampler);
@@ -127,14 +128,25 @@ public:
 
     void mark_pipeline_dirty() {
         pipeline_dirty_ = true;
+        bump_version();
     }
 
+    /// Bumped whenever a change may invalidate a primitive's precompiled draw or SSBO
+    /// push constants: pipeline state, bound textures or the g_materials slot.
+    [[nodiscard]] uint32_t version() const noexcept { return version_.load(std::memory_order_acquire); }
+
     const std::array<DescriptorSetLayout*, MAX_DESCRIPTOR_SETS_PER_SHADER>& descriptor_set_layouts() const {
         return descriptor_set_layouts_;
     }
 
-    [[nodiscard]] bool is_pipeline_dirty() const { return pipeline_dirty_; }
-    void clear_pipeline_dirty() { pipeline_dirty_ = false; }
+    [[nodiscard]] bool is_pipeline_dirty() const { return pipeline_dirty_.load(std::memory_order_relaxed); }
+    /// Pass groups populate their queues concurrently and may share a material.
+    void clear_pipeline_dirty() { pipeline_dirty_.store(false, std::memory_order_relaxed); }
+
+    /// PipelineManager id of the current pipeline state; re-registered after mark_pipeline_dirty().
+    [[nodiscard]] uint32_t pipeline_state_id();
+    /// Process-unique id, used to group draws by material in draw sort keys.
+    [[nodiscard]] uint32_t material_id() const noexcept { return material_id_; }
 
     /// True when this material owns one or more local UBO properties.
     [[nodiscard]] bool has_material_uniform_buffer() const noexcept {
@@ -233,7 +245,9 @@ private:
     DescriptorSetLayout *descriptor_set_layout_ = nullptr;
     std::array<DescriptorSetLayout*, MAX_DESCRIPTOR_SETS_PER_SHADER> descriptor_set_layouts_ = {};
     PipelineState pipeline_state_;
-    bool pipeline_dirty_ = true;
+    std::atomic<bool> pipeline_dirty_{true};
+    std::atomic<uint32_t> pipeline_state_id_{InvalidUI32};
+    uint32_t material_id_ = 0;
 
     Device* device_ = nullptr;
 
@@ -258,12 +272,15 @@ private:
     /// Bound textures keyed by property / binding name id.
     std::unordered_map<uint64_t, TextureHandle> texture_handles_;
     std::atomic<bool> textures_ready_{true};
+    std::mutex textures_ready_mutex_;
+    std::atomic<uint32_t> version_{0};
 
     /// True while a uniform-buffer update for this material is already queued.
     bool in_update_queue_ = false;
 
     /// Queue at most one pending uniform-buffer upload per material per frame batch.
     void try_queue_uniform_buffer_update();
+    void bump_version() noexcept { version_.fetch_add(1, std::memory_order_release); }
     void clear_uniform_buffer_update_queued() noexcept { in_update_queue_ = false; }
 
     friend class FrameResources;
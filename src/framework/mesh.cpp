@@ -1,5 +1,6 @@
 #include "mesh.h"
 #include "global_gpu_storage.h"
+#include "mesh_optimizer.h"
 #include "resource_manager.h"
 #include <cmath>
 
@@ -38,13 +39,13 @@ void add_face(
     std::vector<Vector3>& normals,
     std::vector<Vector2>& uvs,
     std::vector<Vector4>& colors,
-    std::vector<uint16_t>& indices,
+    std::vector<uint32_t>& indices,
     const Vector3& v0,
     const Vector3& v1,
     const Vector3& v2,
     const Vector3& v3,
     const Vector3& normal) {
-    const uint16_t base = static_cast<uint16_t>(positions.size());
+    const uint32_t base = static_cast<uint32_t>(positions.size());
     append_vertex(positions, normals, uvs, colors, v0, normal, Vector2(0.0f, 0.0f));
     append_vertex(positions, normals, uvs, colors, v1, normal, Vector2(1.0f, 0.0f));
     append_vertex(positions, normals, uvs, colors, v2, normal, Vector2(1.0f, 1.0f));
@@ -65,6 +66,33 @@ void Mesh::set_local_bounds(const float3& min_point, const float3& max_point) no
     local_bounds_.valid = true;
 }
 
+float4x4 Mesh::position_decode_matrix() const noexcept {
+    if (vertex_format_ != MeshVertexFormat::Quantized) {
+        return float4x4(1.0f);
+    }
+    const float3& offset = position_quantization_.offset;
+    const float3& extent = position_quantization_.extent;
+    return make_float4x4(
+        extent.x, 0.0f, 0.0f, 0.0f,
+        0.0f, extent.y, 0.0f, 0.0f,
+        0.0f, 0.0f, extent.z, 0.0f,
+        offset.x, offset.y, offset.z, 1.0f);
+}
+
+const MeshGeometrySlice& Mesh::lod_slice(uint32_t lod) const noexcept {
+    if (lod == 0 || lod_slices_.empty()) {
+        return geometry_slice_;
+    }
+    return lod_slices_[std::min(lod, static_cast<uint32_t>(lod_slices_.size())) - 1].slice;
+}
+
+float Mesh::lod_error(uint32_t lod) const noexcept {
+    if (lod == 0 || lod_slices_.empty()) {
+        return 0.0f;
+    }
+    return lod_slices_[std::min(lod, static_cast<uint32_t>(lod_slices_.size())) - 1].error;
+}
+
 Mesh* Mesh::create_quad() {
     Mesh* mesh = ResourceManager::instance().get_mesh("quad");
     if (!mesh) {
@@ -126,7 +154,7 @@ Cube::Cube() {
     std::vector<Vector3> normals;
     std::vector<Vector2> uvs;
     std::vector<Vector4> colors;
-    std::vector<uint16_t> indices;
+    std::vector<uint32_t> indices;
     positions.reserve(24);
     normals.reserve(24);
     uvs.reserve(24);
@@ -195,7 +223,7 @@ Sphere::Sphere(uint32_t slice_count, uint32_t stack_count) {
     std::vector<Vector3> normals;
     std::vector<Vector2> uvs;
     std::vector<Vector4> colors;
-    std::vector<uint16_t> indices;
+    std::vector<uint32_t> indices;
 
     for (uint32_t stack = 0; stack <= stack_count; ++stack) {
         const float v = static_cast<float>(stack) / static_cast<float>(stack_count);
@@ -227,8 +255,8 @@ Sphere::Sphere(uint32_t slice_count, uint32_t stack_count) {
 
     for (uint32_t stack = 0; stack < stack_count; ++stack) {
         for (uint32_t slice = 0; slice < slice_count; ++slice) {
-            const uint16_t first = static_cast<uint16_t>(stack * (slice_count + 1) + slice);
-            const uint16_t second = static_cast<uint16_t>(first + static_cast<uint16_t>(slice_count + 1));
+            const uint32_t first = stack * (slice_count + 1) + slice;
+            const uint32_t second = first + slice_count + 1;
 
             indices.push_back(first);
             indices.push_back(second);
@@ -246,6 +274,8 @@ Sphere::Sphere(uint32_t slice_count, uint32_t stack_count) {
     geometry.uvs = std::move(uvs);
     geometry.colors = std::move(colors);
     geometry.indices = std::move(indices);
+    build_mesh_lods(geometry);
+    optimize_mesh(geometry);
     GlobalGPUStorage::instance().upload_mesh(std::move(geometry), this);
     set_local_bounds(make_float3(-1.0f, -1.0f, -1.0f), make_float3(1.0f, 1.0f, 1.0f));
 }
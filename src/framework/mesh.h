@@ -21,8 +21,39 @@ public:
 
     [[nodiscard]] uint32_t mesh_id() const noexcept { return mesh_id_; }
 
-    void set_geometry_slice(const MeshGeometrySlice& slice) { geometry_slice_ = slice; }
+    void set_geometry_slice(const MeshGeometrySlice& slice) {
+        geometry_slice_ = slice;
+        ++geometry_version_;
+    }
     [[nodiscard]] const MeshGeometrySlice& geometry_slice() const { return geometry_slice_; }
+    /// Bumped on every set_geometry_slice(); precompiled draws rebuild when it moves.
+    [[nodiscard]] uint32_t geometry_version() const noexcept { return geometry_version_; }
+
+    /// Simplified levels after the base level; set before the geometry slice they share
+    /// vertices with is published.
+    void set_lod_slices(std::vector<MeshLodSlice> lod_slices) { lod_slices_ = std::move(lod_slices); }
+    /// Level count including the base level, so always at least 1.
+    [[nodiscard]] uint32_t lod_count() const noexcept { return 1 + static_cast<uint32_t>(lod_slices_.size()); }
+    /// LOD 0 is geometry_slice(); levels past the last clamp to the coarsest one.
+    [[nodiscard]] const MeshGeometrySlice& lod_slice(uint32_t lod) const noexcept;
+    /// Simplification error of @p lod relative to the mesh's bounding radius (0 for LOD 0).
+    [[nodiscard]] float lod_error(uint32_t lod) const noexcept;
+
+    /// Clusters of the base level, ordered like its indices; set before the geometry slice.
+    void set_meshlets(std::vector<Meshlet> meshlets) { meshlets_ = std::move(meshlets); }
+    [[nodiscard]] const std::vector<Meshlet>& meshlets() const noexcept { return meshlets_; }
+
+    /// Layout the mesh is uploaded with. Set before primitives reference the mesh: the GPU
+    /// transforms of Quantized meshes fold in position_decode_matrix().
+    void set_vertex_format(MeshVertexFormat format, const PositionQuantization& quantization = {}) noexcept {
+        vertex_format_ = format;
+        position_quantization_ = quantization;
+    }
+    [[nodiscard]] MeshVertexFormat vertex_format() const noexcept { return vertex_format_; }
+    [[nodiscard]] bool is_quantized() const noexcept { return vertex_format_ == MeshVertexFormat::Quantized; }
+    [[nodiscard]] const PositionQuantization& position_quantization() const noexcept { return position_quantization_; }
+    /// Maps quantized positions (box fractions) to object space; apply before the world matrix.
+    [[nodiscard]] float4x4 position_decode_matrix() const noexcept;
 
     void set_local_bounds(const float3& min_point, const float3& max_point) noexcept;
     [[nodiscard]] bool has_local_bounds() const noexcept { return local_bounds_.valid; }
@@ -31,7 +62,12 @@ public:
 protected:
     BoundingBox local_bounds_;
     MeshGeometrySlice geometry_slice_{};
+    std::vector<MeshLodSlice> lod_slices_;
+    std::vector<Meshlet> meshlets_;
+    uint32_t geometry_version_ = 0;
     uint32_t mesh_id_ = InvalidUI32;
+    MeshVertexFormat vertex_format_ = MeshVertexFormat::Float;
+    PositionQuantization position_quantization_{};
 };
 
 class Quad : public Mesh {
@@ -1,9 +1,12 @@
 #include "mesh_buffer_allocator.h"
+#include "bounding_box.h"
 #include "rhi/device.h"
 #include "rhi/index_buffer.h"
 #include "rhi/resources/resource.h"
 #include "core/logging.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace ocarina {
 
@@ -13,22 +16,158 @@ constexpr Vector3 kDefaultNormal = {0.0f, 0.0f, 1.0f};
 constexpr Vector2 kDefaultUv = {0.0f, 0.0f};
 constexpr Vector4 kDefaultColor = {1.0f, 1.0f, 1.0f, 1.0f};
 
-[[nodiscard]] uint32_t vertex_capacity_for_bytes(uint64_t total_bytes) noexcept {
-    return static_cast<uint32_t>(total_bytes / kMeshBytesPerVertex);
+/// MeshVertexFormat::Quantized position: x | y << 16, then z, as UNORM16 box fractions.
+struct QuantizedPosition {
+    uint32_t xy = 0;
+    uint32_t z = 0;
+};
+
+static_assert(sizeof(QuantizedPosition) + 3 * sizeof(uint32_t) == kMeshQuantizedBytesPerVertex);
+
+[[nodiscard]] uint32_t vertex_capacity_for_bytes(MeshVertexFormat format, uint64_t total_bytes) noexcept {
+    return static_cast<uint32_t>(total_bytes / mesh_bytes_per_vertex(format));
 }
 
-[[nodiscard]] uint64_t default_index_page_bytes() noexcept {
-    const uint32_t vertex_capacity = vertex_capacity_for_bytes(kMeshVertexPageBytes);
+[[nodiscard]] uint64_t default_index_page_bytes(MeshIndexFormat format) noexcept {
+    const uint32_t vertex_capacity = vertex_capacity_for_bytes(MeshVertexFormat::Float, kMeshVertexPageBytes);
     // Derive IB page size from VB page vertex capacity (assume ~3 indices per vertex).
-    return static_cast<uint64_t>(vertex_capacity) * 3ull * sizeof(uint16_t);
+    return static_cast<uint64_t>(vertex_capacity) * 3ull * index_format_bytes(format);
+}
+
+[[nodiscard]] uint32_t index_capacity_for_bytes(MeshIndexFormat format, uint64_t total_bytes) noexcept {
+    return static_cast<uint32_t>(total_bytes / index_format_bytes(format));
+}
+
+[[nodiscard]] uint32_t quantize_unorm(float value, float scale) noexcept {
+    return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * scale));
+}
+
+[[nodiscard]] uint32_t quantize_snorm16(float value) noexcept {
+    const auto snorm = static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    return static_cast<uint16_t>(snorm);
 }
 
-[[nodiscard]] uint32_t index_capacity_for_bytes(uint64_t total_bytes) noexcept {
-    return static_cast<uint32_t>(total_bytes / sizeof(uint16_t));
+/// IEEE 754 binary16, rounded to nearest even; values past the half range saturate.
+[[nodiscard]] uint32_t float_to_half(float value) noexcept {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t magnitude_bits = bits & 0x7fffffffu;
+    if (magnitude_bits > 0x7f800000u) {
+        return sign | 0x7e00u;
+    }
+    if (magnitude_bits >= 0x477ff000u) {
+        // 65520 and up round past the largest half (65504).
+        return sign | 0x7bffu;
+    }
+    if (magnitude_bits < 0x38800000u) {
+        // Below the smallest normal half: a denormal in units of 2^-24.
+        float magnitude = 0.0f;
+        std::memcpy(&magnitude, &magnitude_bits, sizeof(magnitude));
+        return sign | static_cast<uint32_t>(std::lrint(magnitude * 16777216.0f));
+    }
+    const uint32_t rebased = magnitude_bits - 0x38000000u;
+    return sign | ((rebased + 0xfffu + ((rebased >> 13) & 1u)) >> 13);
+}
+
+/// Octahedral map of the unit sphere onto [-1, 1]^2 (Cigolle et al. 2014), two SNORM16s.
+[[nodiscard]] uint32_t encode_octahedral(const Vector3& normal) noexcept {
+    const float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 <= 0.0f) {
+        // (0, 0) decodes to +Z, the Float format's default normal.
+        return 0;
+    }
+    float x = normal.x / l1;
+    float y = normal.y / l1;
+    if (normal.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals.
+        const float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+    }
+    return quantize_snorm16(x) | (quantize_snorm16(y) << 16);
+}
+
+[[nodiscard]] QuantizedPosition quantize_position(const Vector3& position, const PositionQuantization& box) noexcept {
+    auto fraction = [](float value, float offset, float extent) {
+        return extent > 0.0f ? (value - offset) / extent : 0.0f;
+    };
+    QuantizedPosition quantized;
+    quantized.xy = quantize_unorm(fraction(position.x, box.offset.x, box.extent.x), 65535.0f) |
+                   (quantize_unorm(fraction(position.y, box.offset.y, box.extent.y), 65535.0f) << 16);
+    quantized.z = quantize_unorm(fraction(position.z, box.offset.z, box.extent.z), 65535.0f);
+    return quantized;
+}
+
+[[nodiscard]] uint32_t quantize_uv(const Vector2& uv) noexcept {
+    return float_to_half(uv.x) | (float_to_half(uv.y) << 16);
+}
+
+[[nodiscard]] uint32_t quantize_color(const Vector4& color) noexcept {
+    return quantize_unorm(color.x, 255.0f) |
+           (quantize_unorm(color.y, 255.0f) << 8) |
+           (quantize_unorm(color.z, 255.0f) << 16) |
+           (quantize_unorm(color.w, 255.0f) << 24);
+}
+
+/// Encodes one attribute of every vertex; @p source may be null, which repeats @p fallback.
+template<typename Source, typename Encoded, typename Encode>
+[[nodiscard]] std::vector<Encoded> encode_attribute(
+    const Source* source,
+    const Source& fallback,
+    uint32_t vertex_count,
+    Encode&& encode) {
+    std::vector<Encoded> encoded(vertex_count);
+    for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+        encoded[vertex] = encode(source != nullptr ? source[vertex] : fallback);
+    }
+    return encoded;
+}
+
+void upload_quantized_vertices(
+    VertexBuffer* vertex_buffer,
+    const MeshGeometryInput& input,
+    uint32_t vertex_offset) {
+    const uint32_t vertex_count = input.vertex_count;
+    const std::vector<QuantizedPosition> positions = encode_attribute<Vector3, QuantizedPosition>(
+        input.positions, Vector3{}, vertex_count,
+        [&](const Vector3& position) { return quantize_position(position, input.quantization); });
+    vertex_buffer->upload_attribute_range(
+        VertexAttributeType::Enum::Position, positions.data(), vertex_offset, vertex_count);
+
+    const std::vector<uint32_t> normals = encode_attribute<Vector3, uint32_t>(
+        input.normals, kDefaultNormal, vertex_count, encode_octahedral);
+    vertex_buffer->upload_attribute_range(
+        VertexAttributeType::Enum::Normal, normals.data(), vertex_offset, vertex_count);
+
+    const std::vector<uint32_t> uvs = encode_attribute<Vector2, uint32_t>(
+        input.uvs, kDefaultUv, vertex_count, quantize_uv);
+    vertex_buffer->upload_attribute_range(
+        VertexAttributeType::Enum::TexCoord0, uvs.data(), vertex_offset, vertex_count);
+
+    const std::vector<uint32_t> colors = encode_attribute<Vector4, uint32_t>(
+        input.colors, kDefaultColor, vertex_count, quantize_color);
+    vertex_buffer->upload_attribute_range(
+        VertexAttributeType::Enum::Color0, colors.data(), vertex_offset, vertex_count);
 }
 
 }// namespace
 
+PositionQuantization compute_position_quantization(const Vector3* positions, uint32_t vertex_count) {
+    PositionQuantization quantization;
+    if (positions == nullptr || vertex_count == 0) {
+        return quantization;
+    }
+    BoundingBox bounds;
+    bounds.reset();
+    for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+        bounds.expand(make_float3(positions[vertex].x, positions[vertex].y, positions[vertex].z));
+    }
+    quantization.offset = bounds.min;
+    quantization.extent = bounds.max - bounds.min;
+    return quantization;
+}
+
 void VertexAllocator::initialize(Device* device) {
     device_ = device;
 }
@@ -46,6 +185,17 @@ void VertexAllocator::cleanup() {
 
 void VertexAllocator::allocate_page_streams(VertexPage& page, uint32_t vertex_capacity) {
     OC_ASSERT(page.buffer != nullptr);
+    if (page.format == MeshVertexFormat::Quantized) {
+        page.buffer->allocate_stream_capacity(
+            VertexAttributeType::Enum::Position, vertex_capacity, sizeof(QuantizedPosition));
+        page.buffer->allocate_stream_capacity(
+            VertexAttributeType::Enum::Normal, vertex_capacity, sizeof(uint32_t));
+        page.buffer->allocate_stream_capacity(
+            VertexAttributeType::Enum::TexCoord0, vertex_capacity, sizeof(uint32_t));
+        page.buffer->allocate_stream_capacity(
+            VertexAttributeType::Enum::Color0, vertex_capacity, sizeof(uint32_t));
+        return;
+    }
     page.buffer->allocate_stream_capacity(
         VertexAttributeType::Enum::Position, vertex_capacity, sizeof(Vector3));
     page.buffer->allocate_stream_capacity(
@@ -56,36 +206,38 @@ void VertexAllocator::allocate_page_streams(VertexPage& page, uint32_t vertex_ca
         VertexAttributeType::Enum::Color0, vertex_capacity, sizeof(Vector4));
 }
 
-uint32_t VertexAllocator::create_page(uint64_t total_bytes) {
+uint32_t VertexAllocator::create_page(MeshVertexFormat format, uint64_t total_bytes) {
     OC_ASSERT(device_ != nullptr);
-    OC_ASSERT(total_bytes >= kMeshBytesPerVertex);
+    OC_ASSERT(total_bytes >= mesh_bytes_per_vertex(format));
 
     VertexPage page;
+    page.format = format;
     page.total_bytes = total_bytes;
     page.used_bytes = 0;
     page.buffer = device_->create_vertex_buffer();
-    allocate_page_streams(page, vertex_capacity_for_bytes(total_bytes));
+    allocate_page_streams(page, vertex_capacity_for_bytes(format, total_bytes));
 
     const uint32_t page_index = static_cast<uint32_t>(pages_.size());
     pages_.push_back(page);
     return page_index;
 }
 
-uint32_t VertexAllocator::allocate(uint32_t vertex_count, uint32_t& out_vertex_offset) {
+uint32_t VertexAllocator::allocate(MeshVertexFormat format, uint32_t vertex_count, uint32_t& out_vertex_offset) {
     OC_ASSERT(vertex_count > 0);
-    const uint64_t needed_bytes = static_cast<uint64_t>(vertex_count) * kMeshBytesPerVertex;
+    const uint32_t bytes_per_vertex = mesh_bytes_per_vertex(format);
+    const uint64_t needed_bytes = static_cast<uint64_t>(vertex_count) * bytes_per_vertex;
 
     for (uint32_t page_index = 0; page_index < pages_.size(); ++page_index) {
         VertexPage& page = pages_[page_index];
-        if (page.remaining_bytes() >= needed_bytes) {
-            out_vertex_offset = static_cast<uint32_t>(page.used_bytes / kMeshBytesPerVertex);
+        if (page.format == format && page.remaining_bytes() >= needed_bytes) {
+            out_vertex_offset = static_cast<uint32_t>(page.used_bytes / bytes_per_vertex);
             page.used_bytes += needed_bytes;
             return page_index;
         }
     }
 
     const uint64_t page_bytes = std::max(kMeshVertexPageBytes, needed_bytes);
-    const uint32_t page_index = create_page(page_bytes);
+    const uint32_t page_index = create_page(format, page_bytes);
     VertexPage& page = pages_[page_index];
     out_vertex_offset = 0;
     page.used_bytes = needed_bytes;
@@ -119,36 +271,38 @@ void IndexAllocator::allocate_page_buffer(IndexPage& page, uint32_t index_capaci
     page.buffer->allocate_capacity(index_capacity);
 }
 
-uint32_t IndexAllocator::create_page(uint64_t total_bytes) {
+uint32_t IndexAllocator::create_page(MeshIndexFormat format, uint64_t total_bytes) {
     OC_ASSERT(device_ != nullptr);
-    OC_ASSERT(total_bytes >= sizeof(uint16_t));
+    OC_ASSERT(total_bytes >= index_format_bytes(format));
 
     IndexPage page;
+    page.format = format;
     page.total_bytes = total_bytes;
     page.used_bytes = 0;
-    page.buffer = device_->create_index_buffer(nullptr, 0, true);
-    allocate_page_buffer(page, index_capacity_for_bytes(total_bytes));
+    page.buffer = device_->create_index_buffer(nullptr, 0, format == MeshIndexFormat::UInt16);
+    allocate_page_buffer(page, index_capacity_for_bytes(format, total_bytes));
 
     const uint32_t page_index = static_cast<uint32_t>(pages_.size());
     pages_.push_back(page);
     return page_index;
 }
 
-uint32_t IndexAllocator::allocate(uint32_t index_count, uint32_t& out_index_offset) {
+uint32_t IndexAllocator::allocate(MeshIndexFormat format, uint32_t index_count, uint32_t& out_index_offset) {
     OC_ASSERT(index_count > 0);
-    const uint64_t needed_bytes = static_cast<uint64_t>(index_count) * sizeof(uint16_t);
+    const uint32_t bytes_per_index = index_format_bytes(format);
+    const uint64_t needed_bytes = static_cast<uint64_t>(index_count) * bytes_per_index;
 
     for (uint32_t page_index = 0; page_index < pages_.size(); ++page_index) {
         IndexPage& page = pages_[page_index];
-        if (page.remaining_bytes() >= needed_bytes) {
-            out_index_offset = static_cast<uint32_t>(page.used_bytes / sizeof(uint16_t));
+        if (page.format == format && page.remaining_bytes() >= needed_bytes) {
+            out_index_offset = static_cast<uint32_t>(page.used_bytes / bytes_per_index);
             page.used_bytes += needed_bytes;
             return page_index;
         }
     }
 
-    const uint64_t page_bytes = std::max(default_index_page_bytes(), needed_bytes);
-    const uint32_t page_index = create_page(page_bytes);
+    const uint64_t page_bytes = std::max(default_index_page_bytes(format), needed_bytes);
+    const uint32_t page_index = create_page(format, page_bytes);
     IndexPage& page = pages_[page_index];
     out_index_offset = 0;
     page.used_bytes = needed_bytes;
@@ -184,13 +338,19 @@ MeshGeometrySlice MeshBufferAllocator::upload(const MeshGeometryInput& input) {
     MeshGeometrySlice slice;
     slice.vertex_count = input.vertex_count;
     slice.index_count = input.index_count;
-    slice.vertex_page = vertex_allocator_.allocate(input.vertex_count, slice.vertex_offset);
-    slice.index_page = index_allocator_.allocate(input.index_count, slice.index_offset);
+    slice.vertex_format = input.vertex_format;
+    slice.index_format = index_format_for_vertex_count(input.vertex_count);
+    slice.vertex_page = vertex_allocator_.allocate(input.vertex_format, input.vertex_count, slice.vertex_offset);
+    slice.index_page = index_allocator_.allocate(slice.index_format, input.index_count, slice.index_offset);
 
     VertexBuffer* vertex_buffer = vertex_allocator_.buffer(slice.vertex_page);
-    IndexBuffer* index_buffer = index_allocator_.buffer(slice.index_page);
     OC_ASSERT(vertex_buffer != nullptr);
-    OC_ASSERT(index_buffer != nullptr);
+    upload_indices(slice, input.indices);
+
+    if (input.vertex_format == MeshVertexFormat::Quantized) {
+        upload_quantized_vertices(vertex_buffer, input, slice.vertex_offset);
+        return slice;
+    }
 
     vertex_buffer->upload_attribute_range(
         VertexAttributeType::Enum::Position,
@@ -243,14 +403,39 @@ MeshGeometrySlice MeshBufferAllocator::upload(const MeshGeometryInput& input) {
             input.vertex_count);
     }
 
-    index_buffer->upload_indices_range(
-        input.indices,
-        slice.index_offset,
-        input.index_count);
+    return slice;
+}
+
+MeshGeometrySlice MeshBufferAllocator::upload_lod_indices(
+    const MeshGeometrySlice& base,
+    const uint32_t* indices,
+    uint32_t index_count) {
+    OC_ASSERT(device_ != nullptr);
+    OC_ASSERT(indices != nullptr);
+    OC_ASSERT(index_count > 0);
 
+    MeshGeometrySlice slice = base;
+    slice.index_count = index_count;
+    slice.index_page = index_allocator_.allocate(slice.index_format, index_count, slice.index_offset);
+    upload_indices(slice, indices);
     return slice;
 }
 
+void MeshBufferAllocator::upload_indices(const MeshGeometrySlice& slice, const uint32_t* indices) {
+    IndexBuffer* index_buffer = index_allocator_.buffer(slice.index_page);
+    OC_ASSERT(index_buffer != nullptr);
+    if (slice.index_format == MeshIndexFormat::UInt32) {
+        index_buffer->upload_indices_range(indices, slice.index_offset, slice.index_count);
+        return;
+    }
+    narrowed_indices_.resize(slice.index_count);
+    for (uint32_t i = 0; i < slice.index_count; ++i) {
+        OC_ASSERT(indices[i] < kMaxUInt16IndexedVertices);
+        narrowed_indices_[i] = static_cast<uint16_t>(indices[i]);
+    }
+    index_buffer->upload_indices_range(narrowed_indices_.data(), slice.index_offset, slice.index_count);
+}
+
 VertexBuffer* MeshBufferAllocator::vertex_buffer(uint32_t page_index) const {
     return vertex_allocator_.buffer(page_index);
 }
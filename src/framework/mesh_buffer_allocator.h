@@ -15,6 +15,16 @@ class IndexBuffer;
 constexpr uint64_t kMeshVertexPageBytes = 32ull * 1024ull * 1024ull;
 constexpr uint32_t kMeshBytesPerVertex =
     static_cast<uint32_t>(sizeof(Vector3) + sizeof(Vector3) + sizeof(Vector2) + sizeof(Vector4));
+/// MeshVertexFormat::Quantized: uint2 position (3 x UNORM16), uint normal (octahedral
+/// 2 x SNORM16), uint uv (2 x half), uint color (4 x UNORM8).
+constexpr uint32_t kMeshQuantizedBytesPerVertex = 5 * sizeof(uint32_t);
+
+[[nodiscard]] constexpr uint32_t mesh_bytes_per_vertex(MeshVertexFormat format) noexcept {
+    return format == MeshVertexFormat::Quantized ? kMeshQuantizedBytesPerVertex : kMeshBytesPerVertex;
+}
+
+/// Bounding box of @p positions as a quantization box; flat axes keep a zero extent.
+[[nodiscard]] PositionQuantization compute_position_quantization(const Vector3* positions, uint32_t vertex_count);
 
 struct MeshGeometryInput {
     uint32_t vertex_count = 0;
@@ -22,12 +32,16 @@ struct MeshGeometryInput {
     const Vector3* normals = nullptr;
     const Vector2* uvs = nullptr;
     const Vector4* colors = nullptr;
-    const uint16_t* indices = nullptr;
+    const uint32_t* indices = nullptr;
     uint32_t index_count = 0;
+    MeshVertexFormat vertex_format = MeshVertexFormat::Float;
+    /// Quantized only: the box positions are encoded against (see compute_position_quantization()).
+    PositionQuantization quantization{};
 };
 
 struct VertexPage {
     VertexBuffer* buffer = nullptr;
+    MeshVertexFormat format = MeshVertexFormat::Float;
     uint64_t used_bytes = 0;
     uint64_t total_bytes = 0;
 
@@ -38,6 +52,7 @@ struct VertexPage {
 
 struct IndexPage {
     IndexBuffer* buffer = nullptr;
+    MeshIndexFormat format = MeshIndexFormat::UInt16;
     uint64_t used_bytes = 0;
     uint64_t total_bytes = 0;
 
@@ -51,13 +66,13 @@ public:
     void initialize(Device* device);
     void cleanup();
 
-    /// First-fit across pages; creates a new page when none fit.
-    [[nodiscard]] uint32_t allocate(uint32_t vertex_count, uint32_t& out_vertex_offset);
+    /// First-fit across pages of @p format; creates a new page when none fit.
+    [[nodiscard]] uint32_t allocate(MeshVertexFormat format, uint32_t vertex_count, uint32_t& out_vertex_offset);
     [[nodiscard]] VertexBuffer* buffer(uint32_t page_index) const;
     [[nodiscard]] size_t page_count() const noexcept { return pages_.size(); }
 
 private:
-    uint32_t create_page(uint64_t total_bytes);
+    uint32_t create_page(MeshVertexFormat format, uint64_t total_bytes);
     void allocate_page_streams(VertexPage& page, uint32_t vertex_capacity);
 
     Device* device_ = nullptr;
@@ -69,12 +84,13 @@ public:
     void initialize(Device* device);
     void cleanup();
 
-    [[nodiscard]] uint32_t allocate(uint32_t index_count, uint32_t& out_index_offset);
+    /// First-fit across pages of @p format; creates a new page when none fit.
+    [[nodiscard]] uint32_t allocate(MeshIndexFormat format, uint32_t index_count, uint32_t& out_index_offset);
     [[nodiscard]] IndexBuffer* buffer(uint32_t page_index) const;
     [[nodiscard]] size_t page_count() const noexcept { return pages_.size(); }
 
 private:
-    uint32_t create_page(uint64_t total_bytes);
+    uint32_t create_page(MeshIndexFormat format, uint64_t total_bytes);
     void allocate_page_buffer(IndexPage& page, uint32_t index_capacity);
 
     Device* device_ = nullptr;
@@ -87,16 +103,27 @@ public:
     void initialize(Device* device);
     void cleanup();
 
-    /// Allocate page space and upload mesh geometry. Returns page-local slice.
+    /// Allocate page space and upload mesh geometry. Returns page-local slice; indices go to
+    /// 16-bit pages when the vertex count allows (index_format_for_vertex_count()).
     [[nodiscard]] MeshGeometrySlice upload(const MeshGeometryInput& input);
+    /// Allocate index space and upload an LOD's indices. The slice reuses @p base's vertex
+    /// range and index format, so the LOD costs index memory only.
+    [[nodiscard]] MeshGeometrySlice upload_lod_indices(
+        const MeshGeometrySlice& base,
+        const uint32_t* indices,
+        uint32_t index_count);
 
     [[nodiscard]] VertexBuffer* vertex_buffer(uint32_t page_index) const;
     [[nodiscard]] IndexBuffer* index_buffer(uint32_t page_index) const;
 
 private:
     Device* device_ = nullptr;
+    void upload_indices(const MeshGeometrySlice& slice, const uint32_t* indices);
+
     VertexAllocator vertex_allocator_;
     IndexAllocator index_allocator_;
+    /// Narrowed copy of the indices being uploaded to a 16-bit page.
+    std::vector<uint16_t> narrowed_indices_;
 };
 
 }// namespace ocarina
@@ -2,9 +2,49 @@
 
 #include "core/header.h"
 #include "core/stl.h"
+#include "math/basic_types.h"
 
 namespace ocarina {
 
+/// Vertex layout of a mesh in MeshBufferAllocator's pages.
+enum class MeshVertexFormat : uint8_t {
+    /// float3 position, float3 normal, float2 uv, float4 color (kMeshBytesPerVertex).
+    Float,
+    /// 16-bit positions over the mesh's PositionQuantization box, octahedral 16-bit normals,
+    /// half-float uvs and UNORM8 colors (kMeshQuantizedBytesPerVertex). Drawn with mesh.vert
+    /// compiled with kQuantizedVertexDefine.
+    Quantized,
+};
+
+/// Vertex shader define that switches mesh.vert to MeshVertexFormat::Quantized inputs.
+constexpr const char* kQuantizedVertexDefine = "QUANTIZED_VERTEX";
+
+/// Box spanned by a quantized mesh's positions: object position = offset + fraction * extent,
+/// with each fraction stored as a 16-bit UNORM.
+struct PositionQuantization {
+    float3 offset{};
+    float3 extent{};
+};
+
+/// Index width of a mesh in MeshBufferAllocator's pages. CPU-side geometry always holds
+/// 32-bit indices; the upload narrows them when the mesh's vertices allow.
+enum class MeshIndexFormat : uint8_t {
+    UInt16,
+    UInt32,
+};
+
+/// Meshes with at most this many vertices get 16-bit indices; split_mesh() cuts larger
+/// ones into pieces of this size.
+constexpr uint32_t kMaxUInt16IndexedVertices = 65536;
+
+[[nodiscard]] constexpr MeshIndexFormat index_format_for_vertex_count(uint32_t vertex_count) noexcept {
+    return vertex_count <= kMaxUInt16IndexedVertices ? MeshIndexFormat::UInt16 : MeshIndexFormat::UInt32;
+}
+
+[[nodiscard]] constexpr uint32_t index_format_bytes(MeshIndexFormat format) noexcept {
+    return format == MeshIndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
 struct MeshGeometrySlice {
     uint32_t vertex_page = InvalidUI32;
     uint32_t index_page = InvalidUI32;
@@ -12,6 +52,32 @@ struct MeshGeometrySlice {
     uint32_t vertex_count = 0;
     uint32_t index_offset = 0;
     uint32_t index_count = 0;
+    /// Layout of the vertex page; pages never mix formats.
+    MeshVertexFormat vertex_format = MeshVertexFormat::Float;
+    /// Width of the index page; LODs share their base level's.
+    MeshIndexFormat index_format = MeshIndexFormat::UInt16;
+};
+
+/// A simplified level of a mesh: its own index range over the base level's vertices.
+struct MeshLodSlice {
+    MeshGeometrySlice slice;
+    /// Simplification error relative to the mesh's bounding radius.
+    float error = 0.0f;
+};
+
+/// A contiguous run of a mesh's base-level triangles with object-space culling bounds.
+struct Meshlet {
+    float3 center{};
+    float radius = 0.0f;
+    /// Average triangle normal. The cluster faces away from every viewpoint e with
+    /// dot(center - e, cone_axis) >= cone_cutoff * |center - e| + radius.
+    float3 cone_axis{};
+    /// Sine of the angle between cone_axis and its farthest triangle normal; 1 when the
+    /// normals spread too far for a backface test.
+    float cone_cutoff = 1.0f;
+    /// Index range relative to the mesh's base slice.
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
 };
 
 [[nodiscard]] inline bool is_valid_geometry_slice(const MeshGeometrySlice& slice) {
@@ -0,0 +1,434 @@
+#include "mesh_optimizer.h"
+#include "global_gpu_storage.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ocarina {
+
+namespace {
+
+[[nodiscard]] float3 to_float3(const Vector3& v) noexcept {
+    return make_float3(v.x, v.y, v.z);
+}
+
+[[nodiscard]] bool indices_in_range(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count) noexcept {
+    return std::all_of(indices, indices + index_count, [&](uint32_t index) { return index < vertex_count; });
+}
+
+/// Tipsify over @p indices (all below @p vertex_count), writing the reordered triangles to
+/// @p out. Appends the first output triangle after every jump to a vertex unconnected to
+/// the previous fans (a hard boundary, including triangle 0) to @p hard_starts when set.
+void tipsify(
+    const uint32_t* indices,
+    uint32_t index_count,
+    uint32_t vertex_count,
+    uint32_t cache_size,
+    uint32_t* out,
+    std::vector<uint32_t>* hard_starts) {
+    const uint32_t triangle_count = index_count / 3;
+
+    // Triangles around each vertex.
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+        ++adjacency_offsets[indices[i] + 1];
+    }
+    for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+        adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+    }
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    {
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    // Live triangles per vertex; a vertex is cached while fewer than cache_size vertices
+    // were loaded after it.
+    std::vector<uint32_t> live(vertex_count);
+    for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+        live[vertex] = adjacency_offsets[vertex + 1] - adjacency_offsets[vertex];
+    }
+    std::vector<uint32_t> cache_time(vertex_count, 0);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+    uint32_t timestamp = cache_size + 1;
+    uint32_t cursor = 0;
+    uint32_t out_triangle = 0;
+    bool hard_boundary = false;
+
+    // Most recently touched vertex with live triangles, else the next one in index order.
+    auto skip_dead_end = [&]() {
+        while (!dead_end.empty()) {
+            const uint32_t vertex = dead_end.back();
+            dead_end.pop_back();
+            if (live[vertex] > 0) {
+                return vertex;
+            }
+        }
+        for (; cursor < vertex_count; ++cursor) {
+            if (live[cursor] > 0) {
+                hard_boundary = true;
+                return cursor;
+            }
+        }
+        return InvalidUI32;
+    };
+
+    for (uint32_t fan = skip_dead_end(); fan != InvalidUI32;) {
+        if (hard_boundary && hard_starts != nullptr) {
+            hard_starts->push_back(out_triangle);
+        }
+        hard_boundary = false;
+
+        candidates.clear();
+        for (uint32_t a = adjacency_offsets[fan]; a < adjacency_offsets[fan + 1]; ++a) {
+            const uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = 1;
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t vertex = indices[triangle * 3 + k];
+                out[out_triangle * 3 + k] = vertex;
+                dead_end.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                if (timestamp - cache_time[vertex] > cache_size) {
+                    cache_time[vertex] = timestamp++;
+                }
+            }
+            ++out_triangle;
+        }
+
+        // Next fan: the candidate that stays cached longest while its remaining triangles
+        // are emitted; cold candidates rank last.
+        uint32_t best = InvalidUI32;
+        int64_t best_priority = -1;
+        for (uint32_t vertex : candidates) {
+            if (live[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            const uint32_t age = timestamp - cache_time[vertex];
+            if (age + 2 * live[vertex] <= cache_size) {
+                priority = age;
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = vertex;
+            }
+        }
+        fan = best != InvalidUI32 ? best : skip_dead_end();
+    }
+}
+
+/// Cuts the clusters starting at @p hard_starts further: a cluster ends after the first
+/// triangle at which, drawn from a cold cache, its ACMR is at most @p acmr_threshold.
+[[nodiscard]] std::vector<uint32_t> split_soft_clusters(
+    const uint32_t* indices,
+    uint32_t triangle_count,
+    uint32_t vertex_count,
+    const std::vector<uint32_t>& hard_starts,
+    float acmr_threshold,
+    uint32_t cache_size) {
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> loaded_at(vertex_count, InvalidUI32);
+    uint32_t misses = 0;
+    uint32_t cluster_misses_base = 0;
+    uint32_t cluster_start = 0;
+    size_t next_hard = 0;
+    bool cut = true;
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        while (next_hard < hard_starts.size() && hard_starts[next_hard] <= triangle) {
+            cut = cut || hard_starts[next_hard] == triangle;
+            ++next_hard;
+        }
+        if (cut) {
+            starts.push_back(triangle);
+            cluster_start = triangle;
+            cluster_misses_base = misses;
+            cut = false;
+        }
+        for (uint32_t k = 0; k < 3; ++k) {
+            const uint32_t vertex = indices[triangle * 3 + k];
+            // Vertices loaded before the cluster began count as cold.
+            if (loaded_at[vertex] == InvalidUI32 || loaded_at[vertex] < cluster_misses_base ||
+                misses - loaded_at[vertex] >= cache_size) {
+                loaded_at[vertex] = misses++;
+            }
+        }
+        const uint32_t cluster_triangles = triangle + 1 - cluster_start;
+        cut = static_cast<float>(misses - cluster_misses_base) <= acmr_threshold * static_cast<float>(cluster_triangles);
+    }
+    return starts;
+}
+
+/// Runs Tipsify inside each meshlet's index range, on meshlet-local vertex numbers so the
+/// work stays proportional to the meshlet.
+void optimize_meshlet_vertex_cache(OwnedMeshGeometry& geometry) {
+    const uint32_t vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    std::vector<uint32_t> local_of(vertex_count, InvalidUI32);
+    std::vector<uint32_t> global_of;
+    std::vector<uint32_t> local_indices;
+    std::vector<uint32_t> optimized;
+    for (const Meshlet& meshlet : geometry.meshlets) {
+        global_of.clear();
+        local_indices.clear();
+        for (uint32_t i = meshlet.first_index; i < meshlet.first_index + meshlet.index_count; ++i) {
+            const uint32_t vertex = geometry.indices[i];
+            if (local_of[vertex] == InvalidUI32) {
+                local_of[vertex] = static_cast<uint32_t>(global_of.size());
+                global_of.push_back(vertex);
+            }
+            local_indices.push_back(local_of[vertex]);
+        }
+        optimized.resize(local_indices.size());
+        tipsify(local_indices.data(), meshlet.index_count, static_cast<uint32_t>(global_of.size()),
+                kVertexCacheSize, optimized.data(), nullptr);
+        for (uint32_t i = 0; i < meshlet.index_count; ++i) {
+            geometry.indices[meshlet.first_index + i] = global_of[optimized[i]];
+        }
+        for (uint32_t vertex : global_of) {
+            local_of[vertex] = InvalidUI32;
+        }
+    }
+}
+
+}// namespace
+
+VertexCacheStats analyze_vertex_cache(const MeshGeometryInput& input, uint32_t cache_size) {
+    VertexCacheStats stats;
+    const uint32_t triangle_count = input.index_count / 3;
+    if (input.indices == nullptr || triangle_count == 0 || input.vertex_count == 0) {
+        return stats;
+    }
+
+    std::vector<uint32_t> loaded_at(input.vertex_count, InvalidUI32);
+    std::vector<uint8_t> referenced(input.vertex_count, 0);
+    uint32_t misses = 0;
+    uint32_t referenced_count = 0;
+    for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+        const uint32_t vertex = input.indices[i];
+        if (vertex >= input.vertex_count) {
+            continue;
+        }
+        if (!referenced[vertex]) {
+            referenced[vertex] = 1;
+            ++referenced_count;
+        }
+        if (loaded_at[vertex] == InvalidUI32 || misses - loaded_at[vertex] >= cache_size) {
+            loaded_at[vertex] = misses++;
+        }
+    }
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(triangle_count);
+    stats.atvr = referenced_count > 0 ? static_cast<float>(misses) / static_cast<float>(referenced_count) : 0.0f;
+    return stats;
+}
+
+std::vector<uint32_t> optimize_vertex_cache(const MeshGeometryInput& input, std::vector<uint32_t>* out_cluster_starts) {
+    OC_PROFILE_FUNCTION;
+    const uint32_t triangle_count = input.index_count / 3;
+    if (out_cluster_starts != nullptr) {
+        out_cluster_starts->clear();
+    }
+    if (input.indices == nullptr || triangle_count == 0 ||
+        !indices_in_range(input.indices, triangle_count * 3, input.vertex_count)) {
+        return input.indices != nullptr ? std::vector<uint32_t>(input.indices, input.indices + input.index_count)
+                                        : std::vector<uint32_t>{};
+    }
+
+    std::vector<uint32_t> optimized(triangle_count * 3);
+    std::vector<uint32_t> hard_starts;
+    tipsify(input.indices, triangle_count * 3, input.vertex_count, kVertexCacheSize, optimized.data(),
+            out_cluster_starts != nullptr ? &hard_starts : nullptr);
+
+    if (out_cluster_starts != nullptr) {
+        MeshGeometryInput optimized_input = input;
+        optimized_input.indices = optimized.data();
+        optimized_input.index_count = triangle_count * 3;
+        const float threshold = kOverdrawCacheThreshold * analyze_vertex_cache(optimized_input).acmr;
+        *out_cluster_starts = split_soft_clusters(
+            optimized.data(), triangle_count, input.vertex_count, hard_starts, threshold, kVertexCacheSize);
+    }
+    return optimized;
+}
+
+std::vector<uint32_t> optimize_overdraw(const MeshGeometryInput& input, const std::vector<uint32_t>& cluster_starts) {
+    OC_PROFILE_FUNCTION;
+    const uint32_t triangle_count = input.index_count / 3;
+    std::vector<uint32_t> ordered(input.indices, input.indices + triangle_count * 3);
+    if (input.positions == nullptr || cluster_starts.size() < 2 ||
+        !indices_in_range(input.indices, triangle_count * 3, input.vertex_count)) {
+        return ordered;
+    }
+
+    struct Cluster {
+        uint32_t first_triangle = 0;
+        uint32_t triangle_count = 0;
+        float3 centroid{};
+        float3 normal{};
+        float area = 0.0f;
+        float sort_key = 0.0f;
+    };
+    std::vector<Cluster> clusters(cluster_starts.size());
+    float3 mesh_centroid = make_float3(0.0f, 0.0f, 0.0f);
+    float mesh_area = 0.0f;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        Cluster& cluster = clusters[c];
+        cluster.first_triangle = cluster_starts[c];
+        const uint32_t end = c + 1 < cluster_starts.size() ? cluster_starts[c + 1] : triangle_count;
+        cluster.triangle_count = end - cluster.first_triangle;
+        for (uint32_t triangle = cluster.first_triangle; triangle < end; ++triangle) {
+            const float3 p0 = to_float3(input.positions[input.indices[triangle * 3 + 0]]);
+            const float3 p1 = to_float3(input.positions[input.indices[triangle * 3 + 1]]);
+            const float3 p2 = to_float3(input.positions[input.indices[triangle * 3 + 2]]);
+            // Area-weighted: the cross product's length is twice the triangle's area.
+            const float3 normal = cross(p1 - p0, p2 - p0);
+            const float area = length(normal);
+            cluster.normal = cluster.normal + normal;
+            cluster.centroid = cluster.centroid + (p0 + p1 + p2) * (area / 3.0f);
+            cluster.area += area;
+        }
+        mesh_centroid = mesh_centroid + cluster.centroid;
+        mesh_area += cluster.area;
+        if (cluster.area > 0.0f) {
+            cluster.centroid = cluster.centroid / cluster.area;
+        }
+    }
+    if (mesh_area <= 0.0f) {
+        return ordered;
+    }
+    mesh_centroid = mesh_centroid / mesh_area;
+
+    for (Cluster& cluster : clusters) {
+        const float normal_length = length(cluster.normal);
+        cluster.sort_key = normal_length > 0.0f ? dot(cluster.centroid - mesh_centroid, cluster.normal / normal_length) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sort_key > b.sort_key;
+    });
+
+    size_t write = 0;
+    for (const Cluster& cluster : clusters) {
+        std::copy_n(input.indices + cluster.first_triangle * 3, cluster.triangle_count * 3, ordered.begin() + write);
+        write += cluster.triangle_count * 3;
+    }
+    return ordered;
+}
+
+void optimize_vertex_fetch(OwnedMeshGeometry& geometry) {
+    OC_PROFILE_FUNCTION;
+    const uint32_t vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    if (vertex_count == 0) {
+        return;
+    }
+
+    std::vector<uint32_t> remap(vertex_count, InvalidUI32);
+    uint32_t next = 0;
+    auto visit = [&](const std::vector<uint32_t>& indices) {
+        for (uint32_t index : indices) {
+            if (index < vertex_count && remap[index] == InvalidUI32) {
+                remap[index] = next++;
+            }
+        }
+    };
+    visit(geometry.indices);
+    for (const MeshLod& lod : geometry.lods) {
+        visit(lod.indices);
+    }
+    // Unreferenced vertices keep their relative order at the end.
+    for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+        if (remap[vertex] == InvalidUI32) {
+            remap[vertex] = next++;
+        }
+    }
+
+    auto permute = [&](auto& attribute) {
+        if (attribute.size() != vertex_count) {
+            return;
+        }
+        std::remove_reference_t<decltype(attribute)> reordered(vertex_count);
+        for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+            reordered[remap[vertex]] = attribute[vertex];
+        }
+        attribute = std::move(reordered);
+    };
+    permute(geometry.positions);
+    permute(geometry.normals);
+    permute(geometry.uvs);
+    permute(geometry.colors);
+
+    auto rewrite = [&](std::vector<uint32_t>& indices) {
+        for (uint32_t& index : indices) {
+            if (index < vertex_count) {
+                index = remap[index];
+            }
+        }
+    };
+    rewrite(geometry.indices);
+    for (MeshLod& lod : geometry.lods) {
+        rewrite(lod.indices);
+    }
+}
+
+MeshOptimizeStats optimize_mesh(OwnedMeshGeometry& geometry) {
+    OC_PROFILE_FUNCTION;
+    MeshOptimizeStats stats;
+    const uint32_t vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    MeshGeometryInput input{};
+    input.vertex_count = vertex_count;
+    input.positions = geometry.positions.data();
+    input.indices = geometry.indices.data();
+    input.index_count = static_cast<uint32_t>(geometry.indices.size());
+    stats.triangle_count = input.index_count / 3;
+    stats.before = analyze_vertex_cache(input);
+    stats.after = stats.before;
+    if (vertex_count == 0 || stats.triangle_count == 0 ||
+        !indices_in_range(input.indices, input.index_count, vertex_count) ||
+        std::any_of(geometry.lods.begin(), geometry.lods.end(), [&](const MeshLod& lod) {
+            return !indices_in_range(lod.indices.data(), static_cast<uint32_t>(lod.indices.size()), vertex_count);
+        })) {
+        return stats;
+    }
+
+    if (geometry.meshlets.empty()) {
+        std::vector<uint32_t> cluster_starts;
+        const std::vector<uint32_t> cache_ordered = optimize_vertex_cache(input, &cluster_starts);
+        input.indices = cache_ordered.data();
+        geometry.indices = optimize_overdraw(input, cluster_starts);
+    } else {
+        optimize_meshlet_vertex_cache(geometry);
+    }
+
+    for (MeshLod& lod : geometry.lods) {
+        MeshGeometryInput lod_input{};
+        lod_input.vertex_count = vertex_count;
+        lod_input.indices = lod.indices.data();
+        lod_input.index_count = static_cast<uint32_t>(lod.indices.size());
+        lod.indices = optimize_vertex_cache(lod_input);
+    }
+
+    optimize_vertex_fetch(geometry);
+
+    input.indices = geometry.indices.data();
+    stats.after = analyze_vertex_cache(input);
+    return stats;
+}
+
+MeshOptimizeTask::MeshOptimizeTask(std::vector<OwnedMeshGeometry*> geometries)
+    : geometries_(std::move(geometries)), stats_(geometries_.size()) {
+    m_SetSize = static_cast<uint32_t>(geometries_.size());
+    m_MinRange = 1;
+}
+
+void MeshOptimizeTask::ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) {
+    (void)threadnum;
+    for (uint32_t i = range.start; i < range.end; ++i) {
+        stats_[i] = optimize_mesh(*geometries_[i]);
+    }
+}
+
+}// namespace ocarina
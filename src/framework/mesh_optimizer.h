@@ -0,0 +1,78 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "mesh_buffer_allocator.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+namespace ocarina {
+
+struct OwnedMeshGeometry;
+
+/// Post-transform vertex cache size (FIFO entries) the optimizers target and
+/// analyze_vertex_cache() simulates.
+constexpr uint32_t kVertexCacheSize = 16;
+/// optimize_vertex_cache() cuts its output into clusters wherever a run, drawn from a cold
+/// cache, stays within this factor of the whole mesh's ACMR; reordering such clusters for
+/// overdraw costs at most that much vertex shading.
+constexpr float kOverdrawCacheThreshold = 1.05f;
+
+struct VertexCacheStats {
+    /// Average cache misses per triangle: 3 is the worst case, about 0.5-0.7 is
+    /// achievable on regular meshes.
+    float acmr = 0.0f;
+    /// Average transforms per referenced vertex; 1 means every vertex is shaded once.
+    float atvr = 0.0f;
+};
+
+/// Simulates a FIFO vertex cache of @p cache_size entries over @p input's triangle list.
+[[nodiscard]] VertexCacheStats analyze_vertex_cache(const MeshGeometryInput& input, uint32_t cache_size = kVertexCacheSize);
+
+/// Tipsify (Sander, Nehab and Barczak 2007): reorders @p input's triangles into fans around
+/// vertices picked by their remaining cache lifetime. Winding is kept. When
+/// @p out_cluster_starts is set it receives the first triangle of each cluster that
+/// optimize_overdraw() may move (see kOverdrawCacheThreshold).
+[[nodiscard]] std::vector<uint32_t> optimize_vertex_cache(
+    const MeshGeometryInput& input,
+    std::vector<uint32_t>* out_cluster_starts = nullptr);
+
+/// Orders the clusters of @p input's triangles (runs starting at @p cluster_starts) so that
+/// clusters facing away from the mesh centre draw first. Those tend to occlude the rest from
+/// any viewpoint, so this cuts overdraw without knowing the camera.
+[[nodiscard]] std::vector<uint32_t> optimize_overdraw(
+    const MeshGeometryInput& input,
+    const std::vector<uint32_t>& cluster_starts);
+
+/// Renumbers @p geometry's vertices in order of first use by the base indices, then the
+/// LODs, so vertex fetches walk memory forward. Every attribute array and every level's
+/// indices are rewritten; meshlets index triangles and stay valid.
+void optimize_vertex_fetch(OwnedMeshGeometry& geometry);
+
+/// Base level vertex cache behaviour before and after optimize_mesh().
+struct MeshOptimizeStats {
+    uint32_t triangle_count = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+/// Vertex cache and overdraw order for the base level and every LOD, then vertex fetch
+/// order. Meshes with meshlets are optimized per meshlet, and the meshlets keep their
+/// spatial order so neighbouring clusters still merge into one range after culling.
+MeshOptimizeStats optimize_mesh(OwnedMeshGeometry& geometry);
+
+/// Optimizes a batch of meshes in parallel, one mesh per range.
+class MeshOptimizeTask : public enki::ITaskSet {
+public:
+    explicit MeshOptimizeTask(std::vector<OwnedMeshGeometry*> geometries);
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override;
+
+    /// Per mesh, in the order of the geometries passed in; filled once the task completes.
+    [[nodiscard]] const std::vector<MeshOptimizeStats>& stats() const noexcept { return stats_; }
+
+private:
+    std::vector<OwnedMeshGeometry*> geometries_;
+    std::vector<MeshOptimizeStats> stats_;
+};
+
+}// namespace ocarina
@@ -0,0 +1,439 @@
+#include "mesh_simplifier.h"
+#include "global_gpu_storage.h"
+#include "core/hash.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ocarina {
+
+namespace {
+
+/// Symmetric 4x4 error quadric: sum of squared distances to a set of planes.
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+
+    void add_plane(double nx, double ny, double nz, double d) noexcept {
+        a00 += nx * nx;
+        a01 += nx * ny;
+        a02 += nx * nz;
+        a11 += ny * ny;
+        a12 += ny * nz;
+        a22 += nz * nz;
+        b0 += nx * d;
+        b1 += ny * d;
+        b2 += nz * d;
+        c += d * d;
+    }
+
+    Quadric& operator+=(const Quadric& other) noexcept {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a11 += other.a11;
+        a12 += other.a12;
+        a22 += other.a22;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        return *this;
+    }
+
+    [[nodiscard]] double evaluate(const Vector3& p) const noexcept {
+        const double x = p.x;
+        const double y = p.y;
+        const double z = p.z;
+        const double error = a00 * x * x + a11 * y * y + a22 * z * z +
+                             2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                             2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::max(error, 0.0);
+    }
+};
+
+struct Collapse {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    double cost = 0.0;
+};
+
+/// Every attribute of a vertex; vertices with equal keys are interchangeable.
+struct VertexKey {
+    Vector3 position;
+    Vector3 normal;
+    Vector2 uv;
+    Vector4 color;
+};
+
+[[nodiscard]] Vector3 sub(const Vector3& a, const Vector3& b) noexcept {
+    return Vector3{a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+[[nodiscard]] Vector3 cross(const Vector3& a, const Vector3& b) noexcept {
+    return Vector3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+[[nodiscard]] float dot(const Vector3& a, const Vector3& b) noexcept {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+[[nodiscard]] Vector3 triangle_normal(const Vector3& p0, const Vector3& p1, const Vector3& p2) noexcept {
+    return cross(sub(p1, p0), sub(p2, p0));
+}
+
+[[nodiscard]] VertexKey vertex_key(const MeshGeometryInput& input, uint32_t vertex) noexcept {
+    VertexKey key{};
+    key.position = input.positions[vertex];
+    if (input.normals != nullptr) {
+        key.normal = input.normals[vertex];
+    }
+    if (input.uvs != nullptr) {
+        key.uv = input.uvs[vertex];
+    }
+    if (input.colors != nullptr) {
+        key.color = input.colors[vertex];
+    }
+    return key;
+}
+
+/// Maps each vertex to the first vertex with identical attributes (bit-exact), so
+/// duplicates collapse together instead of looking like a seam.
+[[nodiscard]] std::vector<uint32_t> weld_vertices(const MeshGeometryInput& input) {
+    std::vector<uint32_t> remap(input.vertex_count);
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+    buckets.reserve(input.vertex_count);
+    for (uint32_t vertex = 0; vertex < input.vertex_count; ++vertex) {
+        const VertexKey key = vertex_key(input, vertex);
+        std::vector<uint32_t>& bucket = buckets[xxh3_hash64(&key, sizeof(key), 0)];
+        remap[vertex] = vertex;
+        for (uint32_t candidate : bucket) {
+            const VertexKey other = vertex_key(input, candidate);
+            if (memcmp(&key, &other, sizeof(key)) == 0) {
+                remap[vertex] = candidate;
+                break;
+            }
+        }
+        if (remap[vertex] == vertex) {
+            bucket.push_back(vertex);
+        }
+    }
+    return remap;
+}
+
+/// Maps each vertex to the first vertex at the same position.
+[[nodiscard]] std::vector<uint32_t> position_ids(const MeshGeometryInput& input) {
+    std::vector<uint32_t> ids(input.vertex_count);
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+    buckets.reserve(input.vertex_count);
+    for (uint32_t vertex = 0; vertex < input.vertex_count; ++vertex) {
+        const Vector3& position = input.positions[vertex];
+        std::vector<uint32_t>& bucket = buckets[xxh3_hash64(&position, sizeof(position), 0)];
+        ids[vertex] = vertex;
+        for (uint32_t candidate : bucket) {
+            if (memcmp(&position, &input.positions[candidate], sizeof(position)) == 0) {
+                ids[vertex] = candidate;
+                break;
+            }
+        }
+        if (ids[vertex] == vertex) {
+            bucket.push_back(vertex);
+        }
+    }
+    return ids;
+}
+
+/// Locks vertices that share their position with a vertex of different attributes
+/// (seams) and vertices on edges used by a single triangle (borders).
+void lock_seams_and_borders(
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& position_id,
+    std::vector<uint8_t>& locked) {
+    std::unordered_map<uint32_t, uint32_t> position_owner;
+    for (uint32_t vertex : indices) {
+        const auto [it, inserted] = position_owner.try_emplace(position_id[vertex], vertex);
+        if (!inserted && it->second != vertex) {
+            locked[vertex] = 1;
+            locked[it->second] = 1;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edge_use;
+    edge_use.reserve(indices.size());
+    auto edge_key = [&](uint32_t a, uint32_t b) {
+        const uint32_t pa = position_id[a];
+        const uint32_t pb = position_id[b];
+        return (static_cast<uint64_t>(std::min(pa, pb)) << 32) | std::max(pa, pb);
+    };
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (uint32_t e = 0; e < 3; ++e) {
+            ++edge_use[edge_key(indices[i + e], indices[i + (e + 1) % 3])];
+        }
+    }
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (uint32_t e = 0; e < 3; ++e) {
+            const uint32_t a = indices[i + e];
+            const uint32_t b = indices[i + (e + 1) % 3];
+            if (edge_use[edge_key(a, b)] == 1) {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+}
+
+/// True when moving @p from onto @p to turns any surviving triangle of @p from over.
+[[nodiscard]] bool collapse_flips(
+    const MeshGeometryInput& input,
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& adjacency_offsets,
+    const std::vector<uint32_t>& adjacency,
+    uint32_t from,
+    uint32_t to) {
+    const Vector3& target = input.positions[to];
+    for (uint32_t a = adjacency_offsets[from]; a < adjacency_offsets[from + 1]; ++a) {
+        const uint32_t first = adjacency[a] * 3;
+        const uint32_t* triangle = indices.data() + first;
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            continue;
+        }
+        Vector3 moved[3];
+        for (uint32_t k = 0; k < 3; ++k) {
+            moved[k] = triangle[k] == from ? target : input.positions[triangle[k]];
+        }
+        const Vector3 before = triangle_normal(
+            input.positions[triangle[0]], input.positions[triangle[1]], input.positions[triangle[2]]);
+        const Vector3 after = triangle_normal(moved[0], moved[1], moved[2]);
+        if (dot(before, after) <= 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+[[nodiscard]] float bounding_radius(const MeshGeometryInput& input) noexcept {
+    Vector3 min_point = input.positions[0];
+    Vector3 max_point = input.positions[0];
+    for (uint32_t vertex = 1; vertex < input.vertex_count; ++vertex) {
+        const Vector3& p = input.positions[vertex];
+        min_point = Vector3{std::min(min_point.x, p.x), std::min(min_point.y, p.y), std::min(min_point.z, p.z)};
+        max_point = Vector3{std::max(max_point.x, p.x), std::max(max_point.y, p.y), std::max(max_point.z, p.z)};
+    }
+    const Vector3 extent = sub(max_point, min_point);
+    return 0.5f * std::sqrt(dot(extent, extent));
+}
+
+}// namespace
+
+std::vector<uint32_t> simplify_mesh(
+    const MeshGeometryInput& input,
+    uint32_t target_index_count,
+    float max_error,
+    float* out_error) {
+    OC_PROFILE_FUNCTION;
+    std::vector<uint32_t> indices(input.indices, input.indices + input.index_count - input.index_count % 3);
+    if (out_error != nullptr) {
+        *out_error = 0.0f;
+    }
+    const float radius = input.positions != nullptr && input.vertex_count > 0 ? bounding_radius(input) : 0.0f;
+    if (indices.size() <= target_index_count || radius <= 0.0f) {
+        return indices;
+    }
+
+    const uint32_t vertex_count = input.vertex_count;
+    if (std::any_of(indices.begin(), indices.end(), [&](uint32_t index) { return index >= vertex_count; })) {
+        return indices;
+    }
+    const std::vector<uint32_t> welded = weld_vertices(input);
+    for (uint32_t& index : indices) {
+        index = welded[index];
+    }
+
+    std::vector<uint8_t> locked(vertex_count, 0);
+    lock_seams_and_borders(indices, position_ids(input), locked);
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const Vector3& p0 = input.positions[indices[i + 0]];
+        const Vector3 normal = triangle_normal(p0, input.positions[indices[i + 1]], input.positions[indices[i + 2]]);
+        const float length = std::sqrt(dot(normal, normal));
+        if (length <= 0.0f) {
+            continue;
+        }
+        const double nx = normal.x / length;
+        const double ny = normal.y / length;
+        const double nz = normal.z / length;
+        const double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+        for (uint32_t k = 0; k < 3; ++k) {
+            quadrics[indices[i + k]].add_plane(nx, ny, nz, d);
+        }
+    }
+
+    const double max_cost = static_cast<double>(max_error) * radius * static_cast<double>(max_error) * radius;
+    double reached_cost = 0.0;
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapse_target(vertex_count);
+    std::vector<uint8_t> touched(vertex_count);
+
+    while (indices.size() > target_index_count) {
+        const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+        // Triangles around each vertex, rebuilt per pass as collapses remove triangles.
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0u);
+        for (uint32_t index : indices) {
+            ++adjacency_offsets[index + 1];
+        }
+        for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+            adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+        }
+        adjacency.resize(indices.size());
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                adjacency[fill[indices[triangle * 3 + k]]++] = triangle;
+            }
+        }
+
+        collapses.clear();
+        for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t a = indices[triangle * 3 + k];
+                const uint32_t b = indices[triangle * 3 + (k + 1) % 3];
+                for (const auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+                    if (locked[from]) {
+                        continue;
+                    }
+                    Quadric quadric = quadrics[from];
+                    quadric += quadrics[to];
+                    const double cost = quadric.evaluate(input.positions[to]);
+                    if (cost <= max_cost) {
+                        collapses.push_back(Collapse{from, to, cost});
+                    }
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        // Cheapest first; a collapse freezes the neighbourhood of both endpoints for the rest
+        // of the pass, so the flip test never looks at a triangle another collapse moved.
+        std::fill(touched.begin(), touched.end(), uint8_t{0});
+        for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+            collapse_target[vertex] = vertex;
+        }
+        const uint32_t target_triangles = target_index_count / 3;
+        uint32_t remaining_triangles = triangle_count;
+        uint32_t collapsed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (remaining_triangles <= target_triangles) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] ||
+                collapse_flips(input, indices, adjacency_offsets, adjacency, collapse.from, collapse.to)) {
+                continue;
+            }
+
+            for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; ++a) {
+                const uint32_t* triangle = indices.data() + adjacency[a] * 3;
+                for (uint32_t k = 0; k < 3; ++k) {
+                    touched[triangle[k]] = 1;
+                }
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    --remaining_triangles;
+                }
+            }
+            touched[collapse.to] = 1;
+            collapse_target[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            reached_cost = std::max(reached_cost, collapse.cost);
+            ++collapsed;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const uint32_t a = collapse_target[indices[i + 0]];
+            const uint32_t b = collapse_target[indices[i + 1]];
+            const uint32_t c = collapse_target[indices[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+    }
+
+    if (out_error != nullptr) {
+        *out_error = static_cast<float>(std::sqrt(reached_cost) / radius);
+    }
+    return indices;
+}
+
+std::vector<MeshLod> build_mesh_lod_chain(const MeshGeometryInput& input, const MeshLodSettings& settings) {
+    OC_PROFILE_FUNCTION;
+    std::vector<MeshLod> lods;
+    if (input.positions == nullptr || input.indices == nullptr ||
+        input.index_count / 3 < settings.min_triangle_count) {
+        return lods;
+    }
+
+    MeshGeometryInput level = input;
+    float error = 0.0f;
+    for (uint32_t lod = 0; lod < settings.max_lod_count; ++lod) {
+        const uint32_t target = static_cast<uint32_t>(static_cast<float>(level.index_count) * settings.reduction) / 3 * 3;
+        float level_error = 0.0f;
+        std::vector<uint32_t> indices = simplify_mesh(level, target, settings.max_error, &level_error);
+        if (indices.empty() ||
+            static_cast<float>(indices.size()) > static_cast<float>(level.index_count) * settings.min_reduction) {
+            break;
+        }
+        error += level_error;
+        lods.push_back(MeshLod{std::move(indices), error});
+        level.indices = lods.back().indices.data();
+        level.index_count = static_cast<uint32_t>(lods.back().indices.size());
+    }
+    return lods;
+}
+
+void build_mesh_lods(OwnedMeshGeometry& geometry, const MeshLodSettings& settings) {
+    geometry.lods.clear();
+    if (geometry.positions.empty() || geometry.indices.empty()) {
+        return;
+    }
+    MeshGeometryInput input{};
+    input.vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    input.positions = geometry.positions.data();
+    input.normals = geometry.normals.empty() ? nullptr : geometry.normals.data();
+    input.uvs = geometry.uvs.empty() ? nullptr : geometry.uvs.data();
+    input.colors = geometry.colors.empty() ? nullptr : geometry.colors.data();
+    input.indices = geometry.indices.data();
+    input.index_count = static_cast<uint32_t>(geometry.indices.size());
+    geometry.lods = build_mesh_lod_chain(input, settings);
+}
+
+MeshLodBuildTask::MeshLodBuildTask(std::vector<OwnedMeshGeometry*> geometries, const MeshLodSettings& settings)
+    : geometries_(std::move(geometries)), settings_(settings) {
+    m_SetSize = static_cast<uint32_t>(geometries_.size());
+    m_MinRange = 1;
+}
+
+void MeshLodBuildTask::ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) {
+    (void)threadnum;
+    for (uint32_t i = range.start; i < range.end; ++i) {
+        build_mesh_lods(*geometries_[i], settings_);
+    }
+}
+
+}// namespace ocarina
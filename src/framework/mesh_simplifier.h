@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "mesh_buffer_allocator.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+namespace ocarina {
+
+struct OwnedMeshGeometry;
+
+/// How build_mesh_lod_chain() derives the simplified levels of a mesh.
+struct MeshLodSettings {
+    /// Simplified levels generated after the base level.
+    uint32_t max_lod_count = 3;
+    /// Target index count of each level, relative to the level it is simplified from.
+    float reduction = 0.5f;
+    /// A level that keeps more than this fraction of the previous level's indices is dropped
+    /// and ends the chain (locked seams or borders left nothing to collapse).
+    float min_reduction = 0.8f;
+    /// Largest error, relative to the mesh's bounding radius, a single level may add.
+    float max_error = 0.05f;
+    /// Meshes with fewer triangles keep only the base level.
+    uint32_t min_triangle_count = 64;
+};
+
+/// One simplified level: indices into the base level's vertices.
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    /// Geometric error of the level relative to the mesh's bounding radius, accumulated
+    /// over the levels it was simplified from.
+    float error = 0.0f;
+};
+
+/// Quadric error metric edge collapse on @p input's triangle list. Vertices collapse onto
+/// one of their neighbours, so the result indexes the same vertex data and needs no new
+/// vertices. Vertices on attribute seams (one position, several normals / UVs / colours)
+/// and on open borders never move, so UV islands and hard edges keep their shape.
+///
+/// Stops at @p target_index_count or when the next collapse would exceed @p max_error
+/// (relative to the mesh's bounding radius). Writes the error reached to @p out_error.
+[[nodiscard]] std::vector<uint32_t> simplify_mesh(
+    const MeshGeometryInput& input,
+    uint32_t target_index_count,
+    float max_error,
+    float* out_error = nullptr);
+
+/// Simplifies @p input level by level until settings.max_lod_count levels exist, the
+/// reduction stalls or the error budget is spent. The base level is not included.
+[[nodiscard]] std::vector<MeshLod> build_mesh_lod_chain(
+    const MeshGeometryInput& input,
+    const MeshLodSettings& settings = {});
+
+/// Fills @p geometry.lods with the LOD chain of its base level.
+void build_mesh_lods(OwnedMeshGeometry& geometry, const MeshLodSettings& settings = {});
+
+/// Builds the LOD chains of a batch of meshes in parallel, one mesh per range, writing
+/// each chain into OwnedMeshGeometry::lods.
+class MeshLodBuildTask : public enki::ITaskSet {
+public:
+    MeshLodBuildTask(std::vector<OwnedMeshGeometry*> geometries, const MeshLodSettings& settings = {});
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override;
+
+private:
+    std::vector<OwnedMeshGeometry*> geometries_;
+    MeshLodSettings settings_;
+};
+
+}// namespace ocarina
@@ -0,0 +1,107 @@
+#include "mesh_splitter.h"
+#include "global_gpu_storage.h"
+#include "bounding_box.h"
+#include "core/profiler.h"
+#include <algorithm>
+
+namespace ocarina {
+
+namespace {
+
+[[nodiscard]] float3 to_float3(const Vector3& v) noexcept {
+    return make_float3(v.x, v.y, v.z);
+}
+
+/// Copies the attributes of @p vertices (in order) from @p source into @p piece; attribute
+/// arrays that do not cover every vertex stay empty, as in the source.
+void gather_attributes(
+    const OwnedMeshGeometry& source,
+    const std::vector<uint32_t>& vertices,
+    OwnedMeshGeometry& piece) {
+    const size_t vertex_count = source.positions.size();
+    auto gather = [&](const auto& attribute, auto& out) {
+        if (attribute.size() != vertex_count) {
+            return;
+        }
+        out.reserve(vertices.size());
+        for (uint32_t vertex : vertices) {
+            out.push_back(attribute[vertex]);
+        }
+    };
+    gather(source.positions, piece.positions);
+    gather(source.normals, piece.normals);
+    gather(source.uvs, piece.uvs);
+    gather(source.colors, piece.colors);
+}
+
+}// namespace
+
+std::vector<OwnedMeshGeometry> split_mesh(OwnedMeshGeometry&& geometry, uint32_t max_vertices) {
+    OC_PROFILE_FUNCTION;
+    std::vector<OwnedMeshGeometry> pieces;
+    const uint32_t vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    const uint32_t triangle_count = static_cast<uint32_t>(geometry.indices.size() / 3);
+    if (vertex_count <= max_vertices || triangle_count == 0 || max_vertices < 3 ||
+        std::any_of(geometry.indices.begin(), geometry.indices.end(),
+                    [&](uint32_t index) { return index >= vertex_count; })) {
+        pieces.push_back(std::move(geometry));
+        return pieces;
+    }
+
+    BoundingBox bounds;
+    bounds.reset();
+    for (const Vector3& position : geometry.positions) {
+        bounds.expand(to_float3(position));
+    }
+    std::vector<uint32_t> codes(triangle_count);
+    std::vector<uint32_t> order(triangle_count);
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        const float3 centroid = (to_float3(geometry.positions[geometry.indices[triangle * 3 + 0]]) +
+                                 to_float3(geometry.positions[geometry.indices[triangle * 3 + 1]]) +
+                                 to_float3(geometry.positions[geometry.indices[triangle * 3 + 2]])) /
+                                3.0f;
+        codes[triangle] = morton_code(centroid, bounds);
+        order[triangle] = triangle;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+
+    // Greedy fill: a triangle whose new vertices would overflow the piece starts the next one.
+    std::vector<uint32_t> local_of(vertex_count, InvalidUI32);
+    std::vector<uint32_t> piece_vertices;
+    OwnedMeshGeometry piece;
+    auto flush = [&]() {
+        gather_attributes(geometry, piece_vertices, piece);
+        piece.vertex_format = geometry.vertex_format;
+        for (uint32_t vertex : piece_vertices) {
+            local_of[vertex] = InvalidUI32;
+        }
+        piece_vertices.clear();
+        pieces.push_back(std::move(piece));
+        piece = OwnedMeshGeometry{};
+    };
+    for (uint32_t triangle : order) {
+        const uint32_t* corners = geometry.indices.data() + triangle * 3;
+        uint32_t new_vertices = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            const bool repeated = (k > 0 && corners[k] == corners[0]) || (k > 1 && corners[k] == corners[1]);
+            new_vertices += local_of[corners[k]] == InvalidUI32 && !repeated ? 1 : 0;
+        }
+        if (piece_vertices.size() + new_vertices > max_vertices) {
+            flush();
+        }
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t& local = local_of[corners[k]];
+            if (local == InvalidUI32) {
+                local = static_cast<uint32_t>(piece_vertices.size());
+                piece_vertices.push_back(corners[k]);
+            }
+            piece.indices.push_back(local);
+        }
+    }
+    if (!piece.indices.empty()) {
+        flush();
+    }
+    return pieces;
+}
+
+}// namespace ocarina
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "mesh_geometry.h"
+
+namespace ocarina {
+
+struct OwnedMeshGeometry;
+
+/// Cuts @p geometry into pieces of at most @p max_vertices vertices, so each piece keeps
+/// 16-bit indices. Triangles are taken in Morton order of their centroids, which keeps
+/// pieces compact for culling; winding is kept and every piece owns copies of the
+/// attributes it uses. Geometry that already fits is returned whole. Run it before
+/// meshlets and LODs are built: pieces carry neither.
+[[nodiscard]] std::vector<OwnedMeshGeometry> split_mesh(
+    OwnedMeshGeometry&& geometry,
+    uint32_t max_vertices = kMaxUInt16IndexedVertices);
+
+}// namespace ocarina
@@ -0,0 +1,241 @@
+#include "meshlet_builder.h"
+#include "global_gpu_storage.h"
+#include "bounding_box.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ocarina {
+
+namespace {
+
+/// Normals spread wider than this (cosine of the widest angle to the axis) make the cone
+/// test reject nothing, so it is switched off for the cluster.
+constexpr float kMinConeSpread = 0.1f;
+
+[[nodiscard]] float3 to_float3(const Vector3& v) noexcept {
+    return make_float3(v.x, v.y, v.z);
+}
+
+/// Spreads the low 10 bits of @p v so three axes interleave into a 30-bit Morton code.
+[[nodiscard]] uint32_t spread_bits(uint32_t v) noexcept {
+    v &= 0x3ffu;
+    v = (v | (v << 16)) & 0x030000ffu;
+    v = (v | (v << 8)) & 0x0300f00fu;
+    v = (v | (v << 4)) & 0x030c30c3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+/// Right-handed cross product, written out so the winding convention is explicit.
+[[nodiscard]] float3 triangle_normal(const float3& p0, const float3& p1, const float3& p2) noexcept {
+    const float3 e0 = p1 - p0;
+    const float3 e1 = p2 - p0;
+    return make_float3(e0.y * e1.z - e0.z * e1.y, e0.z * e1.x - e0.x * e1.z, e0.x * e1.y - e0.y * e1.x);
+}
+
+/// Bounding sphere and normal cone of the triangles @p triangles of @p input.
+void compute_meshlet_bounds(
+    const MeshGeometryInput& input,
+    const std::vector<uint32_t>& triangles,
+    Meshlet& meshlet) {
+    BoundingBox bounds;
+    bounds.reset();
+    float3 normal_sum = make_float3(0.0f, 0.0f, 0.0f);
+    for (uint32_t triangle : triangles) {
+        const float3 p0 = to_float3(input.positions[input.indices[triangle * 3 + 0]]);
+        const float3 p1 = to_float3(input.positions[input.indices[triangle * 3 + 1]]);
+        const float3 p2 = to_float3(input.positions[input.indices[triangle * 3 + 2]]);
+        bounds.expand(p0);
+        bounds.expand(p1);
+        bounds.expand(p2);
+        const float3 normal = triangle_normal(p0, p1, p2);
+        const float normal_length = length(normal);
+        if (normal_length > 0.0f) {
+            normal_sum = normal_sum + normal / normal_length;
+        }
+    }
+
+    meshlet.center = bounds.center();
+    meshlet.radius = 0.0f;
+    for (uint32_t triangle : triangles) {
+        for (uint32_t k = 0; k < 3; ++k) {
+            const float3 p = to_float3(input.positions[input.indices[triangle * 3 + k]]);
+            meshlet.radius = std::max(meshlet.radius, length(p - meshlet.center));
+        }
+    }
+
+    meshlet.cone_axis = make_float3(0.0f, 0.0f, 0.0f);
+    meshlet.cone_cutoff = 1.0f;
+    const float axis_length = length(normal_sum);
+    if (axis_length <= 0.0f) {
+        return;
+    }
+    const float3 axis = normal_sum / axis_length;
+    float min_dot = 1.0f;
+    for (uint32_t triangle : triangles) {
+        const float3 normal = triangle_normal(
+            to_float3(input.positions[input.indices[triangle * 3 + 0]]),
+            to_float3(input.positions[input.indices[triangle * 3 + 1]]),
+            to_float3(input.positions[input.indices[triangle * 3 + 2]]));
+        const float normal_length = length(normal);
+        if (normal_length > 0.0f) {
+            min_dot = std::min(min_dot, dot(normal / normal_length, axis));
+        }
+    }
+    meshlet.cone_axis = axis;
+    if (min_dot >= kMinConeSpread) {
+        meshlet.cone_cutoff = std::sqrt(std::max(0.0f, 1.0f - min_dot * min_dot));
+    }
+}
+
+}// namespace
+
+uint32_t morton_code(const float3& point, const BoundingBox& bounds) noexcept {
+    auto quantize = [](float value, float min_value, float max_value) {
+        const float extent = max_value - min_value;
+        const float t = extent > 0.0f ? (value - min_value) / extent : 0.0f;
+        return static_cast<uint32_t>(std::clamp(t, 0.0f, 1.0f) * 1023.0f);
+    };
+    return spread_bits(quantize(point.x, bounds.min.x, bounds.max.x)) |
+           (spread_bits(quantize(point.y, bounds.min.y, bounds.max.y)) << 1) |
+           (spread_bits(quantize(point.z, bounds.min.z, bounds.max.z)) << 2);
+}
+
+std::vector<Meshlet> build_meshlets(const MeshGeometryInput& input, std::vector<uint32_t>& out_indices) {
+    OC_PROFILE_FUNCTION;
+    std::vector<Meshlet> meshlets;
+    const uint32_t triangle_count = input.index_count / 3;
+    if (input.positions == nullptr || input.indices == nullptr || triangle_count == 0 ||
+        std::any_of(input.indices, input.indices + triangle_count * 3,
+                    [&](uint32_t index) { return index >= input.vertex_count; })) {
+        return meshlets;
+    }
+
+    // Seeds walk the triangles in Morton order of their centroids.
+    std::vector<uint32_t> codes(triangle_count);
+    BoundingBox bounds;
+    bounds.reset();
+    for (uint32_t vertex = 0; vertex < input.vertex_count; ++vertex) {
+        bounds.expand(to_float3(input.positions[vertex]));
+    }
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        const float3 centroid = (to_float3(input.positions[input.indices[triangle * 3 + 0]]) +
+                                 to_float3(input.positions[input.indices[triangle * 3 + 1]]) +
+                                 to_float3(input.positions[input.indices[triangle * 3 + 2]])) /
+                                3.0f;
+        codes[triangle] = morton_code(centroid, bounds);
+    }
+    std::vector<uint32_t> order(triangle_count);
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        order[triangle] = triangle;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+
+    // Triangles around each vertex.
+    std::vector<uint32_t> adjacency_offsets(input.vertex_count + 1, 0);
+    for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+        ++adjacency_offsets[input.indices[i] + 1];
+    }
+    for (uint32_t vertex = 0; vertex < input.vertex_count; ++vertex) {
+        adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+    }
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    {
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+            adjacency[fill[input.indices[i]]++] = i / 3;
+        }
+    }
+
+    // Grow each meshlet breadth-first over shared vertices. A connected region that runs
+    // out below kMeshletMinTriangles continues at the next seed, which is spatially close.
+    std::vector<uint8_t> assigned(triangle_count, 0);
+    // Meshlet that last queued each triangle; frontier leftovers stay free for later ones.
+    std::vector<uint32_t> queued_by(triangle_count, InvalidUI32);
+    std::vector<uint32_t> frontier;
+    std::vector<uint32_t> cluster;
+    std::vector<uint32_t> reordered;
+    reordered.reserve(triangle_count * 3);
+    uint32_t seed_cursor = 0;
+    auto next_seed = [&]() {
+        while (seed_cursor < triangle_count && assigned[order[seed_cursor]]) {
+            ++seed_cursor;
+        }
+        return seed_cursor < triangle_count ? order[seed_cursor] : InvalidUI32;
+    };
+
+    for (uint32_t seed = next_seed(); seed != InvalidUI32; seed = next_seed()) {
+        const uint32_t meshlet_index = static_cast<uint32_t>(meshlets.size());
+        frontier.clear();
+        cluster.clear();
+        size_t head = 0;
+        queued_by[seed] = meshlet_index;
+        frontier.push_back(seed);
+        while (cluster.size() < kMeshletMaxTriangles) {
+            if (head == frontier.size()) {
+                const uint32_t next = cluster.size() < kMeshletMinTriangles ? next_seed() : InvalidUI32;
+                if (next == InvalidUI32) {
+                    break;
+                }
+                queued_by[next] = meshlet_index;
+                frontier.push_back(next);
+            }
+            const uint32_t triangle = frontier[head++];
+            assigned[triangle] = 1;
+            cluster.push_back(triangle);
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t vertex = input.indices[triangle * 3 + k];
+                for (uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex + 1]; ++a) {
+                    const uint32_t neighbour = adjacency[a];
+                    if (!assigned[neighbour] && queued_by[neighbour] != meshlet_index) {
+                        queued_by[neighbour] = meshlet_index;
+                        frontier.push_back(neighbour);
+                    }
+                }
+            }
+        }
+
+        Meshlet meshlet;
+        meshlet.first_index = static_cast<uint32_t>(reordered.size());
+        meshlet.index_count = static_cast<uint32_t>(cluster.size() * 3);
+        compute_meshlet_bounds(input, cluster, meshlet);
+        for (uint32_t triangle : cluster) {
+            reordered.insert(reordered.end(), input.indices + triangle * 3, input.indices + triangle * 3 + 3);
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    out_indices = std::move(reordered);
+    return meshlets;
+}
+
+void build_mesh_meshlets(OwnedMeshGeometry& geometry) {
+    geometry.meshlets.clear();
+    if (geometry.positions.empty() || geometry.indices.size() / 3 < kMeshletMinMeshTriangles) {
+        return;
+    }
+    // The builder reads the original order while it writes the new one.
+    const std::vector<uint32_t> source_indices = geometry.indices;
+    MeshGeometryInput input{};
+    input.vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    input.positions = geometry.positions.data();
+    input.indices = source_indices.data();
+    input.index_count = static_cast<uint32_t>(source_indices.size());
+    geometry.meshlets = build_meshlets(input, geometry.indices);
+}
+
+MeshletBuildTask::MeshletBuildTask(std::vector<OwnedMeshGeometry*> geometries)
+    : geometries_(std::move(geometries)) {
+    m_SetSize = static_cast<uint32_t>(geometries_.size());
+    m_MinRange = 1;
+}
+
+void MeshletBuildTask::ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) {
+    (void)threadnum;
+    for (uint32_t i = range.start; i < range.end; ++i) {
+        build_mesh_meshlets(*geometries_[i]);
+    }
+}
+
+}// namespace ocarina
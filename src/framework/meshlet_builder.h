@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "mesh_buffer_allocator.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+namespace ocarina {
+
+struct OwnedMeshGeometry;
+struct BoundingBox;
+
+/// Triangles per meshlet; builders stop growing a cluster here.
+constexpr uint32_t kMeshletMaxTriangles = 128;
+/// A connected region that runs out below this keeps growing from the next nearby seed.
+constexpr uint32_t kMeshletMinTriangles = 64;
+/// Meshes below this triangle count draw whole; cluster culling would cost more than it saves.
+constexpr uint32_t kMeshletMinMeshTriangles = 2048;
+
+/// 30-bit Morton code of @p point's cell in a 1024^3 grid over @p bounds; sorting by it keeps
+/// spatial neighbours close.
+[[nodiscard]] uint32_t morton_code(const float3& point, const BoundingBox& bounds) noexcept;
+
+/// Splits @p input's triangles into meshlets of up to kMeshletMaxTriangles connected
+/// triangles, seeded in Morton order of the triangle centroids so clusters stay compact.
+/// Writes input's triangles to @p out_indices (which must not alias input.indices) grouped
+/// by meshlet, so each meshlet is one contiguous index range.
+[[nodiscard]] std::vector<Meshlet> build_meshlets(const MeshGeometryInput& input, std::vector<uint32_t>& out_indices);
+
+/// Builds @p geometry's meshlets (reordering its indices) when it has at least
+/// kMeshletMinMeshTriangles triangles.
+void build_mesh_meshlets(OwnedMeshGeometry& geometry);
+
+/// Builds the meshlets of a batch of meshes in parallel, one mesh per range.
+class MeshletBuildTask : public enki::ITaskSet {
+public:
+    explicit MeshletBuildTask(std::vector<OwnedMeshGeometry*> geometries);
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override;
+
+private:
+    std::vector<OwnedMeshGeometry*> geometries_;
+};
+
+}// namespace ocarina
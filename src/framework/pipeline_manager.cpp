@@ -171,6 +171,27 @@ void PipelineManager::compile_targets(
     }
 }
 
+uint32_t PipelineManager::register_pipeline_state(const PipelineState& pipeline_state) {
+    std::lock_guard<std::mutex> lock(pipeline_state_ids_mutex_);
+    const auto [it, inserted] = pipeline_state_ids_.try_emplace(
+        pipeline_state, static_cast<uint32_t>(pipeline_states_.size()));
+    if (inserted) {
+        pipeline_states_.push_back(pipeline_state);
+    }
+    return it->second;
+}
+
+PipelineState PipelineManager::pipeline_state(uint32_t pipeline_id) const {
+    std::lock_guard<std::mutex> lock(pipeline_state_ids_mutex_);
+    OC_ASSERT(pipeline_id < pipeline_states_.size());
+    return pipeline_states_[pipeline_id];
+}
+
+uint32_t PipelineManager::pipeline_state_count() const {
+    std::lock_guard<std::mutex> lock(pipeline_state_ids_mutex_);
+    return static_cast<uint32_t>(pipeline_states_.size());
+}
+
 RHIPipeline* PipelineManager::get_pipeline(const PipelineState& pipeline_state, RHIRenderPass* render_pass) const noexcept {
     if (render_pass == nullptr) {
         return nullptr;
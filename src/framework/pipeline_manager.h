@@ -34,6 +34,12 @@ public:
     // Reclaim finished pooled tasks (safe to call every frame from the render thread).
     void update();
 
+    /// Stable small id for @p pipeline_state, allocated on first sight. Draw packets and
+    /// materials carry the id instead of hashing the full PipelineState every frame.
+    [[nodiscard]] uint32_t register_pipeline_state(const PipelineState& pipeline_state);
+    [[nodiscard]] PipelineState pipeline_state(uint32_t pipeline_id) const;
+    [[nodiscard]] uint32_t pipeline_state_count() const;
+
     [[nodiscard]] RHIPipeline* get_pipeline(const PipelineState& pipeline_state, RHIRenderPass* render_pass) const noexcept;
     [[nodiscard]] bool has_pipeline(const PipelineState& pipeline_state, RHIRenderPass* render_pass) const noexcept;
 
@@ -85,6 +91,11 @@ private:
     std::unordered_map<PipelineCacheKey, RHIPipeline*, PipelineCacheKeyHash> pipelines_;
     std::unordered_map<PipelineLayoutCacheKey, RHIPipelineLayout*, PipelineLayoutCacheKeyHash> pipeline_layouts_;
 
+    // Pipeline-state id table; never cleared, so cached ids stay valid across shutdown().
+    mutable std::mutex pipeline_state_ids_mutex_;
+    std::unordered_map<PipelineState, uint32_t, PipelineStateHash> pipeline_state_ids_;
+    std::vector<PipelineState> pipeline_states_;
+
     std::mutex pending_mutex_;
     std::unordered_set<PipelineCacheKey, PipelineCacheKeyHash> pending_keys_;
 
@@ -9,9 +9,19 @@
 #include "core/hash.h"
 #include "mesh.h"
 #include "transform_component.h"
+#include "global_gpu_storage.h"
+#include <limits>
+#include <utility>
 
 namespace ocarina {
 
+namespace {
+
+/// PushConstants in push_constant.hlsl: transform_index + material_index.
+constexpr uint32_t kInstancedPushConstantBytes = 2 * sizeof(uint32_t);
+
+}// namespace
+
 void Primitive::sync_render_component_material_buffer(RenderComponent& render_component) {
     if (material_ == nullptr || !material_->has_material_buffer()) {
         render_component.material_buffer_offset = InvalidUI32;
@@ -22,13 +32,35 @@ void Primitive::sync_render_component_material_buffer(RenderComponent& render_co
     render_component.material_buffer_size = material_->material_buffer_size();
 }
 
+void Primitive::set_mesh(Mesh* mesh) {
+    if (mesh_ == mesh) {
+        return;
+    }
+    const Mesh* previous_mesh = std::exchange(mesh_, mesh);
+    draw_compiled_ = false;
+    // Entities without a mesh keep a stale bounds version, so the first mesh needs no
+    // (locking) invalidation; this keeps bulk-created entities lock-free to fill.
+    if (previous_mesh != nullptr && entity_index_ != InvalidUI32) {
+        EntityComponentSystem::instance().mark_world_bounds_dirty(entity_index_);
+    }
+    // The GPU transform folds in a quantized mesh's position decode.
+    const bool quantized = (previous_mesh != nullptr && previous_mesh->is_quantized()) ||
+                           (mesh != nullptr && mesh->is_quantized());
+    if (quantized && entity_index_ != InvalidUI32) {
+        EntityComponentSystem::instance().request_transform_sync(entity_index_);
+    }
+}
+
 void Primitive::set_material(Material* material) {
     if (material_ == material) {
         return;
     }
     material_ = material;
     render_component_initialized_ = false;
+    draw_compiled_ = false;
+    push_constant_layout_ = nullptr;
     last_push_constant_transform_version_ = InvalidUI32;
+    last_push_constant_source_version_ = InvalidUI32;
 
     if (entity_index_ != InvalidUI32) {
         sync_render_component_material_buffer(
@@ -36,13 +68,6 @@ void Primitive::set_material(Material* material) {
     }
 }
 
-Primitive::~Primitive() {
-    if (push_constant_data_) {
-        ocarina::deallocate(push_constant_data_);
-        push_constant_data_ = nullptr;
-    }
-}
-
 void Primitive::set_geometry_data_setup(Device* device, GeometryDataSetup setup) {
     geometry_data_setup_ = setup;
     if (geometry_data_setup_) {
@@ -59,10 +84,13 @@ void Primitive::initialize_render_component(
     }
 
     render_component.mesh_id = InvalidUI32;
-    render_component.push_constant_data = nullptr;
+    render_component.push_constant_offset = InvalidUI32;
     render_component.push_constant_size = 0;
     render_component.material_buffer_offset = InvalidUI32;
     render_component.material_buffer_size = 0;
+    render_component.draw_ready = false;
+    render_component.instanced_transform_index_offset = InvalidUI32;
+    draw_compiled_ = false;
 
     if (material_ == nullptr) {
         return;
@@ -78,20 +106,39 @@ void Primitive::initialize_render_component(
     RHIPipelineLayout* pipeline_layout = PipelineManager::instance().get_pipeline_layout(
         pipeline_state.shaders);
     const uint32_t push_constant_size = pipeline_layout != nullptr ? pipeline_layout->push_constant_size : 0;
-    if (push_constant_data_ == nullptr && push_constant_size > 0) {
-        push_constant_data_ = ocarina::allocate(push_constant_size);
-        memset(push_constant_data_, 0, push_constant_size);
+    push_constant_layout_ = pipeline_layout;
+    if (push_constant_size > push_constant_region_.capacity) {
+        // Fresh regions are zeroed; a smaller blob reuses the old region.
+        release_push_constant_region();
+        push_constant_region_.offset = EntityComponentSystem::instance().allocate_push_constant_region(push_constant_size);
+        push_constant_region_.capacity = push_constant_size;
     }
 
     update_push_constants(transform);
 
-    render_component.push_constant_size = push_constant_size;
-    render_component.push_constant_data = push_constant_data_;
+    if (pipeline_layout != nullptr && push_constant_size <= kInstancedPushConstantBytes) {
+        const auto it = pipeline_layout->push_constant_variables_.find(hash64("transform_index"));
+        if (it != pipeline_layout->push_constant_variables_.end()) {
+            render_component.instanced_transform_index_offset = it->second.offset;
+        }
+    }
+
+    OC_ASSERT(push_constant_size <= std::numeric_limits<uint16_t>::max());
+    render_component.push_constant_size = static_cast<uint16_t>(push_constant_size);
+    render_component.push_constant_offset = push_constant_size > 0 ? push_constant_region_.offset : InvalidUI32;
     render_component_initialized_ = true;
 }
 
+void Primitive::release_push_constant_region() noexcept {
+    if (push_constant_region_.offset == InvalidUI32) {
+        return;
+    }
+    EntityComponentSystem::instance().free_push_constant_region(push_constant_region_.offset, push_constant_region_.capacity);
+    push_constant_region_ = PushConstantRegion{};
+}
+
 void Primitive::write_ssbo_index_push_constants() {
-    if (push_constant_data_ == nullptr) {
+    if (push_constant_layout_ == nullptr || push_constant_region_.capacity == 0) {
         return;
     }
 
@@ -119,38 +166,105 @@ void Primitive::update_push_constants(TransformComponent& transform) {
     if (update_push_constant_function_ == nullptr) {
         return;
     }
+    // Read the versions first: a change racing the update is picked up next frame.
+    const uint32_t transform_version = transform.transform_version();
+    const uint32_t source_version = push_constant_source_version();
     if (render_component_initialized_
-        && transform.transform_version() == last_push_constant_transform_version_) {
+        && transform_version == last_push_constant_transform_version_
+        && source_version == last_push_constant_source_version_) {
         return;
     }
 
     update_push_constant_function_(*this, transform);
-    last_push_constant_transform_version_ = transform.transform_version();
+    last_push_constant_transform_version_ = transform_version;
+    last_push_constant_source_version_ = source_version;
+}
+
+bool Primitive::render_component_current(const TransformComponent& transform) const noexcept {
+    if (!render_component_initialized_ || !draw_compiled_ || material_ == nullptr || mesh_ == nullptr) {
+        return false;
+    }
+    // Transforms reach the GPU through the transform SSBO; only custom push constants
+    // depend on the transform version and the version source.
+    return material_->version() == compiled_material_version_ &&
+           mesh_->geometry_version() == compiled_geometry_version_ &&
+           (update_push_constant_function_ == nullptr ||
+            (transform.transform_version() == last_push_constant_transform_version_ &&
+             push_constant_source_version() == last_push_constant_source_version_));
 }
 
 void Primitive::update_render_component(
     Device* device,
     RenderComponent& render_component,
     TransformComponent& transform) {
+    if (render_component_current(transform)) {
+        return;
+    }
     initialize_render_component(device, render_component, transform);
     update_push_constants(transform);
+    compile_draw(render_component);
 }
 
-void Primitive::set_push_constant_variable(uint64_t name_id, const std::byte* data, size_t size) {
-    if (push_constant_data_ == nullptr || material_ == nullptr) {
+void Primitive::compile_draw(RenderComponent& render_component) {
+    const uint32_t geometry_version = mesh_ != nullptr ? mesh_->geometry_version() : InvalidUI32;
+    // Read before the material is inspected, so a concurrent change forces another compile.
+    const uint32_t material_version = material_ != nullptr ? material_->version() : InvalidUI32;
+    if (draw_compiled_ &&
+        geometry_version == compiled_geometry_version_ &&
+        material_version == compiled_material_version_) {
         return;
     }
 
-    const PipelineState& pipeline_state = material_->get_pipeline_state();
-    RHIPipelineLayout* pipeline_layout = PipelineManager::instance().get_pipeline_layout(
-        pipeline_state.shaders);
-    if (pipeline_layout == nullptr) {
+    render_component.draw_ready = false;
+    if (!render_component_initialized_ || material_ == nullptr || mesh_ == nullptr ||
+        mesh_->gpu_resource_state() != GPUResourceState::GPU_Ready) {
+        return;
+    }
+
+    const MeshGeometrySlice& geometry = mesh_->lod_slice(lod_);
+    if (!is_valid_geometry_slice(geometry) || !material_->is_renderable()) {
+        return;
+    }
+
+    sync_render_component_material_buffer(render_component);
+    GlobalGPUStorage& gpu_storage = GlobalGPUStorage::instance();
+    VertexBuffer* vertex_buffer = gpu_storage.vertex_buffer(geometry.vertex_page);
+    IndexBuffer* index_buffer = gpu_storage.index_buffer(geometry.index_page);
+    if (vertex_buffer == nullptr || index_buffer == nullptr) {
+        return;
+    }
+
+    render_component.vertex_page = geometry.vertex_page;
+    render_component.index_page = geometry.index_page;
+    render_component.vertex_buffer = vertex_buffer;
+    render_component.index_buffer = index_buffer;
+    render_component.first_index = geometry.index_offset;
+    render_component.index_count = geometry.index_count;
+    render_component.vertex_offset = static_cast<int32_t>(geometry.vertex_offset);
+    render_component.descriptor_set_layouts = &material_->descriptor_set_layouts();
+    const bool binds_material_set = material_->has_material_descriptor_set() &&
+                                    !material_->uses_shared_bindless_descriptor_set();
+    render_component.material_descriptor_set = binds_material_set ? material_->get_material_descriptor_set() : nullptr;
+    render_component.material_descriptor_set_index = material_->material_descriptor_set_index();
+    render_component.material_index = material_->material_slot_index();
+    render_component.draw_ready = true;
+
+    // Not-ready entities retry every frame they are visible; ready ones only on change.
+    draw_compiled_ = true;
+    compiled_geometry_version_ = geometry_version;
+    compiled_material_version_ = material_version;
+}
+
+void Primitive::set_push_constant_variable(uint64_t name_id, const std::byte* data, size_t size) {
+    if (push_constant_layout_ == nullptr || push_constant_region_.capacity == 0) {
         return;
     }
 
-    const auto it = pipeline_layout->push_constant_variables_.find(name_id);
-    if (it != pipeline_layout->push_constant_variables_.end()) {
-        memcpy(push_constant_data_ + it->second.offset, data, size);
+    const auto it = push_constant_layout_->push_constant_variables_.find(name_id);
+    if (it != push_constant_layout_->push_constant_variables_.end() &&
+        it->second.offset + size <= push_constant_region_.capacity) {
+        std::byte* push_constant_data = EntityComponentSystem::instance().push_constant_buffer().data() + push_constant_region_.offset;
+        memcpy(push_constant_data + it->second.offset, data, size);
     }
 }
 
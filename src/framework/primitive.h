@@ -8,6 +8,7 @@
 #include "rhi/graphics_descriptions.h"
 #include "rhi/pipeline_state.h"
 #include "render_component.h"
+#include <atomic>
 
 namespace ocarina {
 class VertexBuffer;
@@ -21,50 +22,110 @@ class TransformComponent;
 class Primitive {
 public:
     Primitive() = default;
-    Primitive(Primitive&&) noexcept = default;
-    Primitive& operator=(Primitive&&) noexcept = default;
+    Primitive(Primitive&& other) noexcept = default;
+    Primitive& operator=(Primitive&& other) noexcept = default;
     Primitive(const Primitive&) = delete;
     Primitive& operator=(const Primitive&) = delete;
-    ~Primitive();
 
     using GeometryDataSetup = ocarina::function<void(Primitive&)>;
     using UpdatePushConstant = ocarina::function<void(Primitive&, TransformComponent&)>;
 
-    void set_entity_index(uint32_t entity_index) noexcept { entity_index_ = entity_index; }
+    void set_entity_index(uint32_t entity_index) noexcept {
+        entity_index_ = entity_index;
+        // transform_index in the push constants follows the entity index.
+        draw_compiled_ = false;
+    }
     [[nodiscard]] uint32_t entity_index() const noexcept { return entity_index_; }
 
     void set_geometry_data_setup(Device* device, GeometryDataSetup setup);
     void set_update_push_constant_function(UpdatePushConstant func) {
         update_push_constant_function_ = func;
     }
+    /// Push constants that depend on state outside the transform (e.g.
+    /// DynamicResolution::scale_version_source()) re-run the update function whenever
+    /// @p version changes. The counter must outlive the primitive; null detaches.
+    void set_push_constant_version_source(const std::atomic<uint32_t>* version) noexcept {
+        push_constant_version_source_ = version;
+        last_push_constant_source_version_ = InvalidUI32;
+    }
 
     void initialize_render_component(
         Device* device,
         RenderComponent& render_component,
         TransformComponent& transform);
     void update_push_constants(TransformComponent& transform);
+    /// Brings @p render_component up to date; returns at once when render_component_current().
     void update_render_component(Device* device, RenderComponent& render_component, TransformComponent& transform);
+    /// True when the transform and version source (for custom push constants), material and
+    /// mesh versions match the last update and the draw is compiled, so an update would change nothing.
+    [[nodiscard]] bool render_component_current(const TransformComponent& transform) const noexcept;
+    /// Initialization allocates push-constant storage, which must not overlap parallel updates.
+    [[nodiscard]] bool render_component_initialized() const noexcept { return render_component_initialized_; }
+    /// Refreshes the precompiled draw in @p render_component. Cheap when nothing changed;
+    /// otherwise resolves buffers and descriptor sets once so recording needs no lookups.
+    void compile_draw(RenderComponent& render_component);
     void set_push_constant_variable(uint64_t name_id, const std::byte* data, size_t size);
 
-    void set_mesh(Mesh* mesh) { mesh_ = mesh; }
+    /// Mesh level the next compile_draw() records (see Mesh::lod_slice()). Changing it
+    /// recompiles the draw; the renderer sets it from the frame's LOD selection.
+    void set_lod(uint32_t lod) noexcept {
+        if (lod != lod_) {
+            lod_ = lod;
+            draw_compiled_ = false;
+        }
+    }
+    [[nodiscard]] uint32_t lod() const noexcept { return lod_; }
+
+    void set_mesh(Mesh* mesh);
     Mesh* get_mesh() const { return mesh_; }
 
     void set_material(Material* material);
     Material* get_material() const noexcept { return material_; }
 
+    /// Returns the push-constant region to the ECS for reuse. Called when the entity slot
+    /// is reset, after the frames that recorded from it have retired.
+    void release_push_constant_region() noexcept;
+
 private:
+    /// Owned region in EntityComponentSystem::push_constant_buffer(). Moving a primitive
+    /// (slot compaction) hands the region over, so only one slot ever releases it.
+    struct PushConstantRegion {
+        uint32_t offset = InvalidUI32;
+        uint32_t capacity = 0;
+        PushConstantRegion() = default;
+        PushConstantRegion(PushConstantRegion&& other) noexcept
+            : offset(std::exchange(other.offset, InvalidUI32)), capacity(std::exchange(other.capacity, 0u)) {}
+        PushConstantRegion& operator=(PushConstantRegion&& other) noexcept {
+            offset = std::exchange(other.offset, InvalidUI32);
+            capacity = std::exchange(other.capacity, 0u);
+            return *this;
+        }
+    };
+
     void sync_render_component_material_buffer(RenderComponent& render_component);
     void write_ssbo_index_push_constants();
+    [[nodiscard]] uint32_t push_constant_source_version() const noexcept {
+        return push_constant_version_source_ != nullptr ? push_constant_version_source_->load(std::memory_order_acquire) : 0u;
+    }
 
     GeometryDataSetup geometry_data_setup_;
     UpdatePushConstant update_push_constant_function_ = nullptr;
-    std::byte* push_constant_data_ = nullptr;
+    const std::atomic<uint32_t>* push_constant_version_source_ = nullptr;
+    /// Kept across re-initialization while the blob fits.
+    PushConstantRegion push_constant_region_;
+    /// Layout of the current material's shaders, cached so push-constant writes take no lock.
+    RHIPipelineLayout* push_constant_layout_ = nullptr;
 
     Material* material_ = nullptr;
     Mesh* mesh_ = nullptr;
     uint32_t entity_index_ = InvalidUI32;
+    uint32_t lod_ = 0;
     bool render_component_initialized_ = false;
+    bool draw_compiled_ = false;
+    uint32_t compiled_geometry_version_ = InvalidUI32;
+    uint32_t compiled_material_version_ = InvalidUI32;
     uint32_t last_push_constant_transform_version_ = InvalidUI32;
+    uint32_t last_push_constant_source_version_ = InvalidUI32;
 };
 
 }// namespace ocarina
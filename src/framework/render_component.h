@@ -1,17 +1,60 @@
 #pragma once
 
 #include "core/stl.h"
+#include "rhi/graphics_descriptions.h"
 
 namespace ocarina {
 
+class VertexBuffer;
+class IndexBuffer;
+class DescriptorSet;
+class DescriptorSetLayout;
+
+/// One index range of a cluster-culled draw (see Renderer::set_cluster_culling_enabled()).
+struct ClusterDrawRange {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+};
+
 struct RenderComponent {
     uint32_t mesh_id = InvalidUI32;
 
-    std::byte* push_constant_data = nullptr;
-    uint8_t push_constant_size = 0;
+    /// Blob in EntityComponentSystem::push_constant_buffer(); InvalidUI32 when the
+    /// pipeline has no push constants.
+    uint32_t push_constant_offset = InvalidUI32;
+    /// Bytes; 16 bits so a full 256-byte push-constant range does not wrap to 0.
+    uint16_t push_constant_size = 0;
 
     uint32_t material_buffer_offset = InvalidUI32;
     uint32_t material_buffer_size = 0;
+
+    /// Precompiled draw, filled by Primitive::compile_draw() when the mesh, material or
+    /// GPU readiness changes. Recording reads only these fields; draw_ready is false
+    /// until the mesh is GPU resident and the material's textures are ready.
+    bool draw_ready = false;
+    uint32_t vertex_page = InvalidUI32;
+    uint32_t index_page = InvalidUI32;
+    VertexBuffer* vertex_buffer = nullptr;
+    IndexBuffer* index_buffer = nullptr;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    int32_t vertex_offset = 0;
+    const std::array<DescriptorSetLayout*, MAX_DESCRIPTOR_SETS_PER_SHADER>* descriptor_set_layouts = nullptr;
+    /// Null when the material has no own set or uses the shared bindless set.
+    DescriptorSet* material_descriptor_set = nullptr;
+    uint32_t material_descriptor_set_index = InvalidUI32;
+    uint32_t material_index = InvalidUI32;
+    /// Offset of transform_index in the push-constant blob when the blob holds nothing but
+    /// the SSBO indices, else InvalidUI32. Only such draws can be instanced: the instanced
+    /// draw pushes INSTANCED_TRANSFORM_INDEX there and reads each entity index from the
+    /// frame's draw-instance buffer instead.
+    uint32_t instanced_transform_index_offset = InvalidUI32;
+    /// When cluster culling trimmed the mesh, cluster_range_count ranges starting here in
+    /// the frame packet's cluster_ranges replace first_index / index_count; InvalidUI32
+    /// draws the whole slice. Refreshed for visible entities every frame; such draws are
+    /// never instanced.
+    uint32_t cluster_range_offset = InvalidUI32;
+    uint32_t cluster_range_count = 0;
 };
 
 }// namespace ocarina
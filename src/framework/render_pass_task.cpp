@@ -29,6 +29,15 @@ void record_render_pass(
         attach_swapchain_semaphores(device, cmd);
     }
 
+    // GUI draws are recorded inline, so only GUI-free passes may go to secondaries.
+    std::vector<CommandBuffer> secondaries;
+    if (!render_gui && renderer.record_render_queue_secondaries(render_pass, secondaries)) {
+        cmd.begin_render_pass(render_pass, RenderPassContents::SecondaryCommandBuffers);
+        cmd.execute_secondary_command_buffers(secondaries.data(), static_cast<uint32_t>(secondaries.size()));
+        cmd.end_render_pass();
+        return;
+    }
+
     cmd.begin_render_pass(render_pass);
     renderer.draw_render_queues(cmd, render_pass);
 
@@ -42,20 +51,33 @@ void record_render_pass(
 void record_frame_command_buffer(
     Renderer& renderer,
     Device* device,
+    PassGroupId group_id,
     CommandBuffer& cmd,
     const std::list<RHIRenderPass*>& render_passes,
     const RenderPassGUICallback& render_gui) noexcept
 {
     cmd.begin();
+    cmd.begin_gpu_timer(group_gpu_timer(group_id));
 
+    uint32_t pass_index = 0;
     for (RHIRenderPass* render_pass : render_passes) {
         renderer.populate_render_pass_queues(render_pass);
 
+        // Passes past kMaxGpuPassTimersPerGroup only count towards the group timer.
+        const bool timed = pass_index < kMaxGpuPassTimersPerGroup;
+        if (timed) {
+            cmd.begin_gpu_timer(pass_gpu_timer(group_id, pass_index));
+        }
         const RenderPassGUICallback& pass_render_gui =
             render_pass->is_swapchain_renderpass() ? render_gui : RenderPassGUICallback{};
         record_render_pass(renderer, device, cmd, render_pass, pass_render_gui);
+        if (timed) {
+            cmd.end_gpu_timer(pass_gpu_timer(group_id, pass_index));
+        }
+        ++pass_index;
     }
 
+    cmd.end_gpu_timer(group_gpu_timer(group_id));
     cmd.end();
 }
 
@@ -106,12 +128,17 @@ void RenderPassTask::ExecuteRange(enki::TaskSetPartition range, uint32_t threadn
         return;
     }
 
+    const auto start = FrameStats::Clock::now();
     record_frame_command_buffer(
         *renderer_,
         device_,
+        group_id_,
         command_buffer_,
         render_passes_,
         render_gui_);
+    renderer_->frame_stats().add_record_time(
+        group_id_,
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(FrameStats::Clock::now() - start).count()));
 }
 
 }// namespace ocarina
@@ -8,12 +8,52 @@
 #include "rhi/device.h"
 #include "rhi/command_buffer.h"
 #include "rhi/graphics_descriptions.h"
+#include "rhi/renderpass.h"
 #include "frame_resources.h"
+#include "frame_packet.h"
 #include "core/profiler.h"
 #include "TaskScheduler.h"
 
 namespace ocarina {
 
+namespace {
+
+[[nodiscard]] bool pass_renders_into(const RHIRenderPass* render_pass, const Texture* texture) noexcept {
+    for (uint32_t i = 0; i < render_pass->color_attachment_count(); ++i) {
+        if (render_pass->color_attachment(i) == texture) {
+            return true;
+        }
+    }
+    return render_pass->depth_attachment() == texture;
+}
+
+[[nodiscard]] bool passes_share_attachment(const RHIRenderPass* lhs, const RHIRenderPass* rhs) noexcept {
+    if (lhs->is_swapchain_renderpass() || rhs->is_swapchain_renderpass()) {
+        return lhs->is_swapchain_renderpass() && rhs->is_swapchain_renderpass();
+    }
+    for (uint32_t i = 0; i < lhs->color_attachment_count(); ++i) {
+        if (pass_renders_into(rhs, lhs->color_attachment(i))) {
+            return true;
+        }
+    }
+    return lhs->depth_attachment() != nullptr && pass_renders_into(rhs, lhs->depth_attachment());
+}
+
+/// Recording a pass reads and updates its attachments' CPU-tracked image layouts, so two
+/// groups rendering into the same image must not record at the same time.
+[[nodiscard]] bool groups_share_attachment(const RenderPassTask& lhs, const RenderPassTask& rhs) noexcept {
+    for (const RHIRenderPass* lhs_pass : lhs.render_passes()) {
+        for (const RHIRenderPass* rhs_pass : rhs.render_passes()) {
+            if (passes_share_attachment(lhs_pass, rhs_pass)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}// namespace
+
 RenderTask::RenderTask(Renderer& renderer) noexcept
     : enki::IPinnedTask(pinned_task_thread_num(PinnedTaskIds::RenderTask)),
       renderer_(renderer) {}
@@ -28,17 +68,61 @@ void RenderTask::Execute() {
         dt_ = clock_.elapse_s();
         clock_.start();
 
+        renderer_.frame_stats_.begin_frame();
         render_one_frame();
+        renderer_.frame_stats_.end_frame(renderer_.device_->gpu_frame_time_ms(), renderer_.device_->last_gpu_timer_results());
     }
+    (void)renderer_.wait_frame_preparation();
 
     if (end_callback_) {
         end_callback_();
     }
 }
 
+void RenderTask::advance_simulation(bool loading) {
+    if (loading) {
+        return;
+    }
+    FrameStats::ScopedStage stage(renderer_.frame_stats_, FrameStage::Simulation);
+    if (renderer_.camera_ != nullptr) {
+        renderer_.camera_->update(dt_);
+    }
+    // Parent moves reach children before bounds refresh, culling and the transform upload.
+    EntityComponentSystem::instance().propagate_transforms(&renderer_.task_scheduler_);
+}
+
+void RenderTask::begin_frame_packet(FramePacket& packet, bool loading) {
+    renderer_.set_render_packet(packet);
+    FrameStats& stats = renderer_.frame_stats_;
+    stats.add_stage_time(FrameStage::Cull, packet.cull_ms);
+    if (!loading) {
+        FrameStats::ScopedStage stage(stats, FrameStage::ComponentUpdate);
+        renderer_.update_visible_render_components();
+    }
+
+    FrameStats::ScopedStage stage(stats, FrameStage::Upload);
+    FrameResources::instance().update_per_frame(dt_, loading ? nullptr : &packet.view);
+
+    // Every pass may instance each visible entity once; size this frame's instance region
+    // before any group records.
+    size_t pass_count = 0;
+    for (const auto& [group_id, record_task] : renderer_.render_pass_tasks_) {
+        (void)group_id;
+        pass_count += record_task.render_passes().size();
+    }
+    FrameResources::instance().begin_draw_instances(packet.visible_entity_indices.size() * pass_count);
+}
+
 void RenderTask::render_one_frame() {
     OC_PROFILE_FUNCTION;
 
+    // With pipelined frames, this frame's culling may still run on a worker; the ECS and the
+    // scene must not change until it is done.
+    FramePacket* prepared = renderer_.wait_frame_preparation();
+
+    // Recycle entity slots destroyed more than kEntityRetireFrameLatency frames ago.
+    EntityComponentSystem::instance().advance_frame();
+
     // Kick pending PSO creates first so workers can compile while we cull / update components.
     PipelineManager::instance().update();
 
@@ -46,17 +130,36 @@ void RenderTask::render_one_frame() {
     renderer_.poll_async_loader_completion();
 
     const bool loading = renderer_.is_async_loading();
-
-    if (!loading && renderer_.camera_ != nullptr) {
-        renderer_.camera_->update(dt_);
-    }
-
+    // The previous frame has recorded, so pass extents may change; push constants refreshed
+    // by the component update below already see the new scale.
     if (!loading) {
-        renderer_.cull_scene();
-        renderer_.update_visible_render_components();
+        renderer_.dynamic_resolution_.update(renderer_.device_->gpu_frame_time_ms());
+    }
+    const bool pipelined = !loading && !renderer_.render && renderer_.frame_pipeline_depth() > 1;
+    if (prepared != nullptr && (!pipelined || prepared->scene != renderer_.scene_)) {
+        prepared = nullptr;
     }
 
-    FrameResources::instance().update_per_frame(dt_, loading ? nullptr : renderer_.camera_);
+    if (prepared != nullptr) {
+        // Upload the prepared frame's components and transforms before the simulation moves
+        // on, then cull the next frame on workers while this one records.
+        begin_frame_packet(*prepared, loading);
+        advance_simulation(loading);
+        renderer_.kick_frame_preparation(renderer_.capture_frame_packet());
+    } else {
+        advance_simulation(loading);
+        FramePacket& packet = renderer_.capture_frame_packet();
+        if (loading) {
+            packet.visible_entity_indices.clear();
+        } else {
+            renderer_.cull_scene(packet);
+        }
+        begin_frame_packet(packet, loading);
+        if (pipelined) {
+            // Nothing was in flight: fill the pipeline with a packet of the same state.
+            renderer_.kick_frame_preparation(renderer_.capture_frame_packet());
+        }
+    }
 
     if (renderer_.render) {
         renderer_.render(dt_);
@@ -70,16 +173,30 @@ void RenderTask::render_one_frame() {
 
 void RenderTask::execute_default_render_path() {
     Device* device = renderer_.device_;
+    FrameStats& stats = renderer_.frame_stats_;
 
-    if (!device->begin_frame()) {
+    bool frame_started = false;
+    {
+        FrameStats::ScopedStage stage(stats, FrameStage::Acquire);
+        frame_started = device->begin_frame();
+    }
+    if (!frame_started) {
         return;
     }
+    renderer_.begin_draw_record_timing();
 
     CommandBuffer recorded_cmds[MAX_COMMAND_BUFFERS_PER_SUBMIT];
+    RenderPassTask* record_tasks[MAX_COMMAND_BUFFERS_PER_SUBMIT] = {};
     uint32_t recorded_count = 0;
     const bool loading = renderer_.is_async_loading();
+    const auto record_start = FrameStats::Clock::now();
 
-    // std::map iterates PassGroupId in numeric order (Offscreen → … → UI).
+    // Every group records into its own primary, so all of them go to the scheduler at
+    // once. std::map iterates PassGroupId in numeric order (Offscreen → … → UI), which
+    // keeps the submit order fixed no matter which group finishes recording first.
+    // A group that renders into an attachment of an earlier group waits for that group's
+    // recording first. Sampling another group's target needs no such wait: the producer
+    // leaves it shader-readable and the submit order carries the GPU dependency.
     for (auto& [group_id, record_task] : renderer_.render_pass_tasks_) {
         if (record_task.empty()) {
             continue;
@@ -99,20 +216,36 @@ void RenderTask::execute_default_render_path() {
         }
 
         record_task.configure(&renderer_, device, cmd, gui);
+        for (uint32_t i = 0; i < recorded_count; ++i) {
+            if (groups_share_attachment(*record_tasks[i], record_task)) {
+                renderer_.task_scheduler_.WaitforTask(record_tasks[i]);
+            }
+        }
         renderer_.task_scheduler_.AddTaskSetToPipe(&record_task);
-        renderer_.task_scheduler_.WaitforTask(&record_task);
 
+        record_tasks[recorded_count] = &record_task;
         recorded_cmds[recorded_count++] = cmd;
     }
 
+    for (uint32_t i = 0; i < recorded_count; ++i) {
+        renderer_.task_scheduler_.WaitforTask(record_tasks[i]);
+    }
+    stats.add_stage_time(FrameStage::Record,
+                         std::chrono::duration<double, std::milli>(FrameStats::Clock::now() - record_start).count());
+
     if (recorded_count > 0) {
+        FrameStats::ScopedStage stage(stats, FrameStage::Submit);
         device->execute_command_buffers(recorded_cmds, recorded_count);
         for (uint32_t i = 0; i < recorded_count; ++i) {
             device->release_command_buffer(recorded_cmds[i]);
         }
+        renderer_.record_frame_latency();
     }
 
-    device->end_frame();
+    {
+        FrameStats::ScopedStage stage(stats, FrameStage::Present);
+        device->end_frame();
+    }
     OC_PROFILE_FRAME_MARK;
 
     // Dispatch PSOs enqueued during populate_render_pass_queues this frame.
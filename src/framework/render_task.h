@@ -8,6 +8,7 @@
 namespace ocarina {
 
 class Renderer;
+struct FramePacket;
 
 class RenderTask : public enki::IPinnedTask {
 public:
@@ -24,6 +25,11 @@ public:
 
 private:
     void render_one_frame();
+    /// Camera update and transform propagation for the next frame to be culled.
+    void advance_simulation(bool loading);
+    /// Makes @p packet the recorded frame: updates its visible render components and
+    /// uploads the per-frame buffers with its view.
+    void begin_frame_packet(FramePacket& packet, bool loading);
 
     void execute_default_render_path();
 
@@ -20,16 +20,24 @@
 #include "rhi/index_buffer.h"
 #include "rhi/descriptor_set.h"
 #include "frame_resources.h"
+#include "draw_sort_key.h"
+#include "draw_batch.h"
+#include "indirect_draw_list.h"
 #include "enki_task_debug.h"
 #include "core/profiler.h"
 #include "rhi/resources/resource.h"
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <cstdio>
 
 namespace ocarina {
 
 namespace {
 
+/// INSTANCED_TRANSFORM_INDEX in transform.hlsl.
+constexpr uint32_t kInstancedTransformIndex = 0xffffffffu;
+
 void bind_global_descriptor_sets(
     CommandBuffer& cmd,
     const std::array<DescriptorSetLayout*, MAX_DESCRIPTOR_SETS_PER_SHADER>& layouts,
@@ -63,6 +71,311 @@ void enki_thread_start_profiler_callback(uint32_t thread_num) noexcept {
     set_current_thread_name(name);
 }
 
+/// Pushes @p item's blob from @p push_constant_buffer; instanced draws replace
+/// transform_index with the INSTANCED_TRANSFORM_INDEX marker so the shader reads entity
+/// indices by instance id.
+void push_draw_constants(
+    CommandBuffer& cmd,
+    const RenderComponent& item,
+    const std::byte* push_constant_buffer,
+    bool instanced) {
+    if (item.push_constant_offset == InvalidUI32 || item.push_constant_size == 0) {
+        return;
+    }
+    const std::byte* push_constant_data = push_constant_buffer + item.push_constant_offset;
+    if (!instanced) {
+        cmd.push_constants(push_constant_data, 0, item.push_constant_size);
+        return;
+    }
+
+    // Instanceable blobs hold only the SSBO indices (see RenderComponent).
+    std::array<std::byte, 2 * sizeof(uint32_t)> instanced_push_constants{};
+    std::memcpy(instanced_push_constants.data(), push_constant_data, item.push_constant_size);
+    std::memcpy(instanced_push_constants.data() + item.instanced_transform_index_offset, &kInstancedTransformIndex, sizeof(uint32_t));
+    cmd.push_constants(instanced_push_constants.data(), 0, item.push_constant_size);
+}
+
+/// Records one non-instanced draw of @p item: its whole slice, or its visible cluster ranges
+/// in @p cluster_ranges when cluster culling trimmed it.
+void draw_render_component(CommandBuffer& cmd, const RenderComponent& item, const ClusterDrawRange* cluster_ranges) {
+    if (item.cluster_range_offset == InvalidUI32) {
+        cmd.draw_indexed(item.index_count, 1, item.first_index, item.vertex_offset, 0);
+        return;
+    }
+    for (uint32_t i = 0; i < item.cluster_range_count; ++i) {
+        const ClusterDrawRange& range = cluster_ranges[item.cluster_range_offset + i];
+        cmd.draw_indexed(range.index_count, 1, range.first_index, item.vertex_offset, 0);
+    }
+}
+
+/// Records @p count draw batches from the entities' precompiled draws; no locks or
+/// lookups happen here. Pipelines are rebound only where the resolved pipeline changes, and
+/// global sets are bound once per pipeline from its first draw's material layouts.
+void draw_batch_range(
+    CommandBuffer& cmd,
+    const DrawBatch* batches,
+    uint32_t count,
+    const ClusterDrawRange* cluster_ranges) {
+    const EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    const std::vector<RenderComponent>& render_components = ecs.render_components();
+    const std::byte* push_constant_buffer = ecs.push_constant_buffer().data();
+
+    RHIPipeline* bound_pipeline = nullptr;
+    bool globals_bound = false;
+    uint32_t bound_vertex_page = InvalidUI32;
+    uint32_t bound_index_page = InvalidUI32;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const DrawBatch& batch = batches[i];
+        const RenderComponent& item = render_components[batch.entity_index];
+
+        if (batch.pipeline != bound_pipeline) {
+            cmd.bind_pipeline(batch.pipeline);
+            bound_pipeline = batch.pipeline;
+            globals_bound = false;
+        }
+
+        // All batches with one pipeline share the PipelineState / shader pair, so the
+        // first draw's layouts are valid for the whole run.
+        if (!globals_bound) {
+            bind_global_descriptor_sets(cmd, *item.descriptor_set_layouts, bound_pipeline->pipeline_layout);
+            globals_bound = true;
+        }
+
+        if (item.vertex_page != bound_vertex_page) {
+            cmd.set_vertex_buffer(item.vertex_buffer);
+            bound_vertex_page = item.vertex_page;
+        }
+        if (item.index_page != bound_index_page) {
+            cmd.set_index_buffer(item.index_buffer);
+            bound_index_page = item.index_page;
+        }
+
+        push_draw_constants(cmd, item, push_constant_buffer, batch.instanced());
+
+        if (item.material_descriptor_set != nullptr) {
+            DescriptorSet* material_descriptor_set = item.material_descriptor_set;
+            cmd.bind_descriptor_sets(
+                &material_descriptor_set,
+                item.material_descriptor_set_index,
+                1,
+                bound_pipeline->pipeline_layout);
+        }
+
+        if (!batch.instanced()) {
+            draw_render_component(cmd, item, cluster_ranges);
+            continue;
+        }
+        cmd.draw_indexed(item.index_count, batch.instance_count, item.first_index, item.vertex_offset, batch.first_instance);
+    }
+}
+
+/// Records @p list's batches: one draw_indexed_indirect (or its count variant) per
+/// indirect batch, draw_indexed for the rest. Pipeline, globals and buffers are rebound
+/// only where they change, as in draw_batch_range().
+void draw_indirect_batches(
+    CommandBuffer& cmd,
+    const IndirectDrawList& list,
+    bool use_draw_count,
+    const ClusterDrawRange* cluster_ranges) {
+    const EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    const std::vector<RenderComponent>& render_components = ecs.render_components();
+    const std::byte* push_constant_buffer = ecs.push_constant_buffer().data();
+    constexpr uint32_t stride = sizeof(DrawIndexedIndirectCommand);
+
+    RHIPipeline* bound_pipeline = nullptr;
+    uint32_t bound_vertex_page = InvalidUI32;
+    uint32_t bound_index_page = InvalidUI32;
+
+    const std::vector<IndirectDrawList::Batch>& batches = list.batches();
+    for (uint32_t batch_index = 0; batch_index < batches.size(); ++batch_index) {
+        const IndirectDrawList::Batch& batch = batches[batch_index];
+        const RenderComponent& item = render_components[batch.entity_index];
+
+        if (batch.pipeline != bound_pipeline) {
+            cmd.bind_pipeline(batch.pipeline);
+            bound_pipeline = batch.pipeline;
+            bind_global_descriptor_sets(cmd, *item.descriptor_set_layouts, bound_pipeline->pipeline_layout);
+        }
+
+        if (item.vertex_page != bound_vertex_page) {
+            cmd.set_vertex_buffer(item.vertex_buffer);
+            bound_vertex_page = item.vertex_page;
+        }
+        if (item.index_page != bound_index_page) {
+            cmd.set_index_buffer(item.index_buffer);
+            bound_index_page = item.index_page;
+        }
+
+        if (item.material_descriptor_set != nullptr) {
+            DescriptorSet* material_descriptor_set = item.material_descriptor_set;
+            cmd.bind_descriptor_sets(
+                &material_descriptor_set,
+                item.material_descriptor_set_index,
+                1,
+                bound_pipeline->pipeline_layout);
+        }
+
+        push_draw_constants(cmd, item, push_constant_buffer, batch.indirect);
+        if (!batch.indirect) {
+            draw_render_component(cmd, item, cluster_ranges);
+            continue;
+        }
+
+        const size_t offset = size_t{batch.first_command} * stride;
+        if (use_draw_count) {
+            cmd.draw_indexed_indirect_count(
+                list.command_buffer(),
+                offset,
+                list.count_buffer(),
+                size_t{batch_index} * sizeof(uint32_t),
+                batch.command_count,
+                stride);
+        } else {
+            cmd.draw_indexed_indirect(list.command_buffer(), offset, batch.command_count, stride);
+        }
+    }
+}
+
+/// Records one secondary command buffer per Renderer::kSecondaryChunkDraws batches. Each
+/// worker allocates from the device's pool for its own thread index, so no two threads
+/// share a command pool.
+class SecondaryDrawTask : public enki::ITaskSet {
+public:
+    SecondaryDrawTask(
+        Device* device,
+        RHIRenderPass* render_pass,
+        const ClusterDrawRange* cluster_ranges,
+        std::vector<CommandBuffer>& secondaries)
+        : device_(device), render_pass_(render_pass), cluster_ranges_(cluster_ranges), secondaries_(secondaries) {
+        m_SetSize = static_cast<uint32_t>(secondaries.size());
+        m_MinRange = 1;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        OC_PROFILE_FUNCTION;
+        const std::vector<DrawBatch>& batches = render_pass_->draw_batches();
+        for (uint32_t chunk_index = range.start; chunk_index < range.end; ++chunk_index) {
+            CommandBuffer secondary = device_->get_secondary_command_buffer(render_pass_, threadnum);
+            if (!secondary.valid()) {
+                unsupported_.store(true, std::memory_order_relaxed);
+                return;
+            }
+            const uint32_t begin = chunk_index * Renderer::kSecondaryChunkDraws;
+            const uint32_t end = std::min(static_cast<uint32_t>(batches.size()), begin + Renderer::kSecondaryChunkDraws);
+            draw_batch_range(secondary, batches.data() + begin, end - begin, cluster_ranges_);
+            secondary.end();
+            secondaries_[chunk_index] = secondary;
+        }
+    }
+
+    [[nodiscard]] bool unsupported() const noexcept { return unsupported_.load(std::memory_order_relaxed); }
+
+private:
+    Device* device_ = nullptr;
+    RHIRenderPass* render_pass_ = nullptr;
+    const ClusterDrawRange* cluster_ranges_ = nullptr;
+    std::vector<CommandBuffer>& secondaries_;
+    std::atomic<bool> unsupported_{false};
+};
+
+/// Column scales within this ratio count as uniform for the cone test.
+constexpr float kClusterConeUniformScale = 0.99f;
+
+/// Appends the index ranges of @p mesh's meshlets that pass the frustum test (when
+/// @p frustum is set) and, with @p cone_test, the back-face cone test seen from @p eye.
+/// Neighbouring survivors merge into one range. Returns the surviving meshlet count.
+uint32_t append_visible_clusters(
+    const Mesh& mesh,
+    const float4x4& world,
+    const Frustum* frustum,
+    bool cone_test,
+    const float3& eye,
+    std::vector<ClusterDrawRange>& ranges) {
+    const float3 x_axis = make_float3(world[0].x, world[0].y, world[0].z);
+    const float3 y_axis = make_float3(world[1].x, world[1].y, world[1].z);
+    const float3 z_axis = make_float3(world[2].x, world[2].y, world[2].z);
+    const float min_scale = std::min({length(x_axis), length(y_axis), length(z_axis)});
+    const float max_scale = std::max({length(x_axis), length(y_axis), length(z_axis)});
+    // Mirrored or sheared transforms would flip or skew the cones.
+    cone_test = cone_test && dot(x_axis, cross(y_axis, z_axis)) > 0.0f &&
+                min_scale >= kClusterConeUniformScale * max_scale;
+
+    const uint32_t base_index = mesh.geometry_slice().index_offset;
+    const size_t first_range = ranges.size();
+    uint32_t visible_count = 0;
+    for (const Meshlet& meshlet : mesh.meshlets()) {
+        const float4 center4 = world * make_float4(meshlet.center.x, meshlet.center.y, meshlet.center.z, 1.0f);
+        const float3 center = make_float3(center4.x, center4.y, center4.z);
+        const float radius = meshlet.radius * max_scale;
+        if (frustum != nullptr && !frustum->intersects_sphere(center, radius)) {
+            continue;
+        }
+        if (cone_test && meshlet.cone_cutoff < 1.0f) {
+            const float4 axis4 = world * make_float4(meshlet.cone_axis.x, meshlet.cone_axis.y, meshlet.cone_axis.z, 0.0f);
+            const float3 axis = make_float3(axis4.x, axis4.y, axis4.z) / max_scale;
+            const float3 view = center - eye;
+            if (dot(view, axis) >= meshlet.cone_cutoff * length(view) + radius) {
+                continue;
+            }
+        }
+
+        ++visible_count;
+        const uint32_t first_index = base_index + meshlet.first_index;
+        if (ranges.size() > first_range &&
+            ranges.back().first_index + ranges.back().index_count == first_index) {
+            ranges.back().index_count += meshlet.index_count;
+        } else {
+            ranges.push_back(ClusterDrawRange{first_index, meshlet.index_count});
+        }
+    }
+    return visible_count;
+}
+
+/// Brings visible entities' render components up to date in parallel ranges. Entities
+/// whose render component was never initialized would allocate push-constant storage, which
+/// may move the shared buffer under other workers, so they are deferred to the caller.
+class RenderComponentUpdateTask : public enki::ITaskSet {
+public:
+    RenderComponentUpdateTask(
+        Renderer& renderer,
+        const FramePacket& packet,
+        std::vector<std::vector<uint32_t>>& deferred)
+        : renderer_(renderer), packet_(packet), deferred_(deferred) {
+        m_SetSize = static_cast<uint32_t>(packet.visible_entity_indices.size());
+        m_MinRange = Renderer::kRenderComponentUpdateBatch;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        OC_PROFILE_FUNCTION;
+        EntityComponentSystem& ecs = EntityComponentSystem::instance();
+        const uint32_t primitive_count = static_cast<uint32_t>(ecs.primitive_count());
+        for (uint32_t i = range.start; i < range.end; ++i) {
+            const uint32_t entity_index = packet_.visible_entity_indices[i];
+            if (entity_index >= primitive_count) {
+                continue;
+            }
+            Primitive& primitive = ecs.primitive(entity_index);
+            primitive.set_lod(i < packet_.visible_entity_lods.size() ? packet_.visible_entity_lods[i] : 0u);
+            // Per-frame draw ranges, independent of the render component's versions.
+            RenderComponent& render_component = ecs.render_component(entity_index);
+            const bool clustered = i < packet_.visible_entity_cluster_offsets.size();
+            render_component.cluster_range_offset = clustered ? packet_.visible_entity_cluster_offsets[i] : InvalidUI32;
+            render_component.cluster_range_count = clustered ? packet_.visible_entity_cluster_counts[i] : 0u;
+            if (!primitive.render_component_initialized()) {
+                deferred_[threadnum].push_back(entity_index);
+                continue;
+            }
+            renderer_.update_entity_render_component(entity_index);
+        }
+    }
+
+private:
+    Renderer& renderer_;
+    const FramePacket& packet_;
+    std::vector<std::vector<uint32_t>>& deferred_;
+};
+
 }// namespace
 
 Renderer::Renderer(Device *device)
@@ -76,6 +389,7 @@ Renderer::Renderer(Device *device)
     scheduler_config.numTaskThreadsToCreate = std::max(scheduler_config.numTaskThreadsToCreate, 3u);
     scheduler_config.profilerCallbacks.threadStart = enki_thread_start_profiler_callback;
     task_scheduler_.Initialize(scheduler_config);
+    FrameResources::instance().set_task_scheduler(&task_scheduler_);
     PipelineManager::instance().initialize(device, &task_scheduler_);
     GPUResourceThread::instance().start(task_scheduler_, device);
 }
@@ -96,6 +410,7 @@ void Renderer::shutdown() {
     GPUResourceThread::instance().shutdown();
     PipelineManager::instance().shutdown();
     GlobalGPUStorage::instance().cleanup();
+    indirect_draw_lists_.clear();
 
     // Release GPU resources while VkDevice is still alive. Singletons / atexit
     // destructors may run after Device destruction and must not free Vulkan objects.
@@ -179,17 +494,26 @@ void Renderer::update_entity_render_component(uint32_t entity_index) {
     Primitive& primitive = ecs.primitive(entity_index);
     RenderComponent& render_component = ecs.render_component(entity_index);
     TransformComponent& transform = ecs.transform_component(entity_index);
-    primitive.initialize_render_component(device_, render_component, transform);
-    primitive.update_push_constants(transform);
+    primitive.update_render_component(device_, render_component, transform);
 }
 
 void Renderer::update_visible_render_components() {
+    OC_PROFILE_FUNCTION;
     if (scene_ == nullptr) {
         return;
     }
 
-    for (uint32_t entity_index : primitive_cull_task_.visible_entity_indices()) {
-        update_entity_render_component(entity_index);
+    // Unchanged entities return from update_render_component() after a version check.
+    deferred_render_component_updates_.resize(task_scheduler_.GetNumTaskThreads());
+    RenderComponentUpdateTask task(*this, *render_packet_, deferred_render_component_updates_);
+    task_scheduler_.AddTaskSetToPipe(&task);
+    task_scheduler_.WaitforTask(&task);
+
+    for (std::vector<uint32_t>& deferred : deferred_render_component_updates_) {
+        for (uint32_t entity_index : deferred) {
+            update_entity_render_component(entity_index);
+        }
+        deferred.clear();
     }
 }
 
@@ -200,8 +524,12 @@ void Renderer::populate_render_pass_queues(RHIRenderPass* render_pass) {
     }
 
     EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    // Depth keys use the camera the frame was culled with.
+    const math3d::Vector3D& position = render_packet_->view.position;
+    const float3 camera_position = make_float3(position[0], position[1], position[2]);
 
-    auto add_entity_draw_call = [&](uint32_t entity_index) {
+    const std::vector<float3>& visible_positions = render_packet_->visible_entity_positions;
+    auto add_entity_draw_packet = [&](uint32_t entity_index, const float3& world_position) {
         if (entity_index >= ecs.primitive_count()) {
             return;
         }
@@ -212,27 +540,73 @@ void Renderer::populate_render_pass_queues(RHIRenderPass* render_pass) {
             return;
         }
 
-        const PipelineState& pipeline_state = material->get_pipeline_state();
-        render_pass->add_draw_call(entity_index, pipeline_state);
-        PipelineManager::instance().enqueue(pipeline_state, render_pass);
-        if (material->is_pipeline_dirty()) {
-            material->clear_pipeline_dirty();
-        }
+        // Precompiled by update_visible_render_components() earlier this frame.
+        const RenderComponent& render_component = ecs.render_component(entity_index);
+        const uint32_t vertex_page = render_component.draw_ready ? render_component.vertex_page : 0;
+        const uint32_t index_page = render_component.draw_ready ? render_component.index_page : 0;
+
+        const float3 to_camera = world_position - camera_position;
+        const DrawBucket bucket = material->get_pipeline_state().blend_state.blend_enable
+                                      ? DrawBucket::Blended
+                                      : DrawBucket::Opaque;
+
+        const uint32_t pipeline_id = material->pipeline_state_id();
+        render_pass->add_draw_packet(DrawPacket{
+            draw_sort_key::make(
+                bucket,
+                pipeline_id,
+                material->material_id(),
+                vertex_page,
+                index_page,
+                draw_sort_key::quantize_depth(dot(to_camera, to_camera))),
+            entity_index,
+            pipeline_id});
     };
 
     bool cleared = false;
-    for (uint32_t entity_index : primitive_cull_task_.visible_entity_indices()) {
+    const std::vector<uint32_t>& visible = render_packet_->visible_entity_indices;
+    OC_ASSERT(visible_positions.size() == visible.size());
+    for (size_t i = 0; i < visible.size(); ++i) {
+        const uint32_t entity_index = visible[i];
         if (render_pass_primitive_filter_
             && !render_pass_primitive_filter_(entity_index, render_pass)) {
             continue;
         }
 
         if (!cleared) {
-            render_pass->clear_draw_call_items();
+            render_pass->clear_draw_packets();
             cleared = true;
         }
 
-        add_entity_draw_call(entity_index);
+        add_entity_draw_packet(entity_index, visible_positions[i]);
+    }
+    if (cleared) {
+        sort_and_resolve_draw_packets(render_pass);
+    }
+
+    // Instance ranges live in this frame's region of the instance buffer, so batches are
+    // rebuilt every frame even when the packets were kept.
+    build_draw_batches(*render_pass, ecs.render_components());
+}
+
+void Renderer::sort_and_resolve_draw_packets(RHIRenderPass* render_pass) {
+    sort_draw_packets(render_pass->draw_packets(), &task_scheduler_);
+
+    // Sorted packets group pipelines, so the PSO cache is touched once per run; recording
+    // then uses the resolved handle directly.
+    PipelineManager& pipeline_manager = PipelineManager::instance();
+    uint32_t resolved_pipeline_id = InvalidUI32;
+    RHIPipeline* pipeline = nullptr;
+    for (DrawPacket& packet : render_pass->draw_packets()) {
+        if (packet.pipeline_id != resolved_pipeline_id) {
+            resolved_pipeline_id = packet.pipeline_id;
+            const PipelineState pipeline_state = pipeline_manager.pipeline_state(packet.pipeline_id);
+            pipeline = pipeline_manager.get_pipeline(pipeline_state, render_pass);
+            if (pipeline == nullptr) {
+                pipeline_manager.enqueue(pipeline_state, render_pass);
+            }
+        }
+        packet.pipeline = pipeline;
     }
 }
 
@@ -242,106 +616,86 @@ void Renderer::draw_render_queues(CommandBuffer& cmd, RHIRenderPass* render_pass
         return;
     }
 
-    EntityComponentSystem& ecs = EntityComponentSystem::instance();
-    GlobalGPUStorage& gpu_storage = GlobalGPUStorage::instance();
-
-    for (const auto& queue : render_pass->pipeline_render_queues()) {
-        const PipelineState& pipeline_state = queue.first;
-        RHIPipeline* pipeline = PipelineManager::instance().get_pipeline(pipeline_state, render_pass);
-        if (pipeline == nullptr) {
-            continue;
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<DrawBatch>& batches = render_pass->draw_batches();
+    IndirectDrawList* indirect_list = nullptr;
+    if (indirect_drawing_enabled()) {
+        indirect_list = &indirect_draw_list(render_pass);
+        indirect_list->build(device_, batches, EntityComponentSystem::instance().render_components());
+        if (indirect_list->draw_count() > 0 && indirect_list->command_buffer() == 0) {
+            indirect_list = nullptr;
         }
+    }
 
-        cmd.bind_pipeline(pipeline);
-        Material* queue_material = nullptr;
-        // Bind globals using the first drawable's material layouts in this queue.
-        // All items in a queue share the same PipelineState / shader pair.
-        for (uint32_t entity_index : queue.second->draw_call_items) {
-            if (entity_index >= ecs.primitive_count()) {
-                continue;
-            }
-            queue_material = ecs.primitive(entity_index).get_material();
-            if (queue_material != nullptr) {
-                break;
-            }
-        }
-        if (queue_material != nullptr) {
-            bind_global_descriptor_sets(
-                cmd,
-                queue_material->descriptor_set_layouts(),
-                pipeline->pipeline_layout);
-        }
-
-        uint32_t bound_vertex_page = InvalidUI32;
-        uint32_t bound_index_page = InvalidUI32;
-
-        for (uint32_t entity_index : queue.second->draw_call_items) {
-            if (entity_index >= ecs.render_component_count()) {
-                continue;
-            }
-
-            RenderComponent& item = ecs.render_component(entity_index);
-            Mesh* mesh = ResourceManager::instance().get_mesh(item.mesh_id);
-            if (mesh == nullptr ||
-                mesh->gpu_resource_state() != GPUResourceState::GPU_Ready) {
-                continue;
-            }
+    if (indirect_list != nullptr) {
+        draw_indirect_batches(cmd, *indirect_list, device_->supports_draw_indirect_count(), render_packet_->cluster_ranges.data());
+    } else {
+        draw_batch_range(cmd, batches.data(), static_cast<uint32_t>(batches.size()), render_packet_->cluster_ranges.data());
+    }
 
-            const MeshGeometrySlice& geometry = mesh->geometry_slice();
-            if (!is_valid_geometry_slice(geometry)) {
-                continue;
-            }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    draw_record_cpu_ns_.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+}
 
-            VertexBuffer* vertex_buffer = gpu_storage.vertex_buffer(geometry.vertex_page);
-            IndexBuffer* index_buffer = gpu_storage.index_buffer(geometry.index_page);
-            if (vertex_buffer == nullptr || index_buffer == nullptr) {
-                continue;
-            }
+bool Renderer::indirect_drawing_enabled() const noexcept {
+    return indirect_drawing_enabled_.load(std::memory_order_relaxed) &&
+           device_ != nullptr &&
+           device_->supports_indirect_first_instance();
+}
 
-            Primitive& primitive = ecs.primitive(entity_index);
-            Material* material = primitive.get_material();
-            if (material != nullptr && !material->is_renderable()) {
-                continue;
-            }
+IndirectDrawList& Renderer::indirect_draw_list(RHIRenderPass* render_pass) {
+    std::lock_guard<std::mutex> lock(indirect_draw_lists_mutex_);
+    std::unique_ptr<IndirectDrawList>& list = indirect_draw_lists_[render_pass];
+    if (list == nullptr) {
+        list = std::make_unique<IndirectDrawList>();
+    }
+    return *list;
+}
 
-            if (geometry.vertex_page != bound_vertex_page) {
-                cmd.set_vertex_buffer(vertex_buffer);
-                bound_vertex_page = geometry.vertex_page;
-            }
-            if (geometry.index_page != bound_index_page) {
-                cmd.set_index_buffer(index_buffer);
-                bound_index_page = geometry.index_page;
-            }
+void Renderer::begin_draw_record_timing() noexcept {
+    last_draw_record_cpu_ns_.store(
+        draw_record_cpu_ns_.exchange(0, std::memory_order_relaxed),
+        std::memory_order_relaxed);
+}
 
-            if (item.push_constant_data && item.push_constant_size > 0) {
-                cmd.push_constants(item.push_constant_data, 0, item.push_constant_size);
-            }
+bool Renderer::record_render_queue_secondaries(RHIRenderPass* render_pass, std::vector<CommandBuffer>& secondaries) {
+    OC_PROFILE_FUNCTION;
+    secondaries.clear();
+    if (render_pass == nullptr) {
+        return false;
+    }
 
-            if (material != nullptr) {
-                if (material->has_material_descriptor_set() &&
-                    !material->uses_shared_bindless_descriptor_set()) {
-                    DescriptorSet* material_descriptor_set = material->get_material_descriptor_set();
-                    cmd.bind_descriptor_sets(
-                        &material_descriptor_set,
-                        material->material_descriptor_set_index(),
-                        1,
-                        pipeline->pipeline_layout);
-                }
-            }
+    // Indirect batches are few calls per pass; splitting them gains nothing.
+    const uint32_t draw_count = static_cast<uint32_t>(render_pass->draw_batches().size());
+    if (draw_count < kSecondaryRecordingMinDraws || indirect_drawing_enabled()) {
+        return false;
+    }
 
-            cmd.draw_indexed(
-                geometry.index_count,
-                1,
-                geometry.index_offset,
-                static_cast<int32_t>(geometry.vertex_offset),
-                0);
-        }
+    const auto start = std::chrono::steady_clock::now();
+
+    // Chunks are consecutive runs of the batches, so executing the secondaries in
+    // chunk order reproduces the inline draw sequence.
+    secondaries.resize((draw_count + kSecondaryChunkDraws - 1) / kSecondaryChunkDraws);
+    SecondaryDrawTask task(device_, render_pass, render_packet_->cluster_ranges.data(), secondaries);
+    task_scheduler_.AddTaskSetToPipe(&task);
+    task_scheduler_.WaitforTask(&task);
+    if (task.unsupported()) {
+        // Backend has no secondaries; anything begun is recycled with the frame slot.
+        secondaries.clear();
+        return false;
     }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    draw_record_cpu_ns_.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    return true;
 }
 
 void Renderer::cull_visible_primitives_parallel(Scene& scene, const Frustum& frustum) {
     OC_PROFILE_FUNCTION;
 
+    // Culling reads world bounds from the hot chunk storage; bring changed entities up to date.
+    EntityComponentSystem::instance().refresh_world_bounds(task_scheduler_);
+
     primitive_cull_task_.prepare(scene.primitive_count());
 
     const uint32_t visible_cell_count = scene.visible_cell_count();
@@ -350,14 +704,32 @@ void Renderer::cull_visible_primitives_parallel(Scene& scene, const Frustum& fru
         return;
     }
 
-    const size_t max_cells_per_batch = 1; // requirement: one visible cell per range
+    // Wide views stream the hot chunks in SoA order; narrow ones only walk the entities of
+    // the visible cells, which touches less memory despite the random access.
+    const std::vector<SceneGridCell>& cells = scene.grid_cells();
+    const std::vector<uint32_t>& visible_cells = scene.visible_cell_indices();
+    uint64_t cell_entity_count = 0;
+    for (uint32_t i = 0; i < visible_cell_count; ++i) {
+        cell_entity_count += cells[visible_cells[i]].entity_count();
+    }
+    cull_chunks_.clear();
+    EntityComponentSystem::instance().collect_chunks(kWorldBoundsComponentBit, cull_chunks_);
+    uint64_t chunk_entity_count = 0;
+    for (const EntityChunkRange& entry : cull_chunks_) {
+        chunk_entity_count += entry.count;
+    }
 
-    primitive_cull_task_.configure(
-        &scene,
-        &scene.visible_cell_indices(),
-        visible_cell_count,
-        &frustum,
-        max_cells_per_batch);
+    if (RendererPrimitiveCullTask::prefer_chunk_stream(cell_entity_count, chunk_entity_count)) {
+        primitive_cull_task_.configure_chunks(&scene, &cull_chunks_, &frustum);
+    } else {
+        const size_t max_cells_per_batch = 1; // requirement: one visible cell per range
+        primitive_cull_task_.configure(
+            &scene,
+            &visible_cells,
+            visible_cell_count,
+            &frustum,
+            max_cells_per_batch);
+    }
 
     task_scheduler_.AddTaskSetToPipe(&primitive_cull_task_);
     task_scheduler_.WaitforTask(&primitive_cull_task_);
@@ -365,30 +737,256 @@ void Renderer::cull_visible_primitives_parallel(Scene& scene, const Frustum& fru
     primitive_cull_task_.commit_visible_results();
 }
 
-void Renderer::cull_scene() {
-    if (scene_ == nullptr || camera_ == nullptr) {
+void Renderer::cull_scene(FramePacket& packet) {
+    OC_PROFILE_FUNCTION;
+    const auto start = FrameStats::Clock::now();
+    cull_visible_entities(packet);
+    select_entity_lods(packet);
+    cull_entity_clusters(packet);
+    snapshot_visible_positions(packet);
+    packet.cull_ms = std::chrono::duration<double, std::milli>(FrameStats::Clock::now() - start).count();
+}
+
+void Renderer::cull_visible_entities(FramePacket& packet) {
+    Scene* scene = packet.scene;
+    if (scene == nullptr || !packet.view.valid) {
+        packet.visible_entity_indices.clear();
         return;
     }
 
     if (!frustum_culling_enabled_) {
-        primitive_cull_task_.set_visible_entity_indices(scene_->entity_indices());
+        packet.visible_entity_indices = scene->entity_indices();
         return;
     }
 
-    const math3d::Matrix4 view_projection = camera_->get_projection_matrix() * camera_->get_view_matrix();
+    const math3d::Matrix4 view_projection = packet.view.projection_matrix * packet.view.view_matrix;
     const Frustum frustum(view_projection);
 
-    scene_->cull_grids(frustum);
-    if (!scene_->has_grid()) {
-        primitive_cull_task_.set_visible_entity_indices(scene_->entity_indices());
+    scene->cull_grids(frustum);
+    if (!scene->has_grid()) {
+        packet.visible_entity_indices = scene->entity_indices();
         return;
     }
-    if (scene_->visible_cell_count() == 0) {
-        primitive_cull_task_.clear_visible_entity_indices();
+    if (scene->visible_cell_count() == 0) {
+        packet.visible_entity_indices.clear();
+        return;
+    }
+
+    cull_visible_primitives_parallel(*scene, frustum);
+    packet.visible_entity_indices = primitive_cull_task_.visible_entity_indices();
+}
+
+void Renderer::select_entity_lods(FramePacket& packet) {
+    OC_PROFILE_FUNCTION;
+    const std::vector<uint32_t>& visible = packet.visible_entity_indices;
+    packet.visible_entity_lods.assign(visible.size(), 0);
+    packet.triangle_count = 0;
+    packet.full_triangle_count = 0;
+    if (visible.empty()) {
         return;
     }
 
-    cull_visible_primitives_parallel(*scene_, frustum);
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    const bool enabled = lod_selection_enabled();
+    if (enabled) {
+        // Frustum culling already refreshed them; otherwise this brings the bounds up to date.
+        ecs.refresh_world_bounds(task_scheduler_);
+    }
+    const auto components_lock = ecs.lock_components_shared();
+    const EntityChunkStorage& chunk_storage = ecs.chunk_storage();
+    const uint32_t primitive_count = static_cast<uint32_t>(ecs.primitive_count());
+    if (entity_lods_.size() < primitive_count) {
+        entity_lods_.resize(primitive_count);
+    }
+
+    const float threshold = lod_error_threshold();
+    // Screen heights covered by a unit length at unit distance.
+    const float projection_scale = 0.5f * std::abs(packet.view.projection_matrix(1, 1));
+    const math3d::Vector3D& eye = packet.view.position;
+
+    for (size_t i = 0; i < visible.size(); ++i) {
+        const uint32_t entity_index = visible[i];
+        if (entity_index >= primitive_count) {
+            continue;
+        }
+        const Mesh* mesh = ecs.primitive(entity_index).get_mesh();
+        if (mesh == nullptr || mesh->gpu_resource_state() != GPUResourceState::GPU_Ready) {
+            continue;
+        }
+
+        EntityLodState& lod_state = entity_lods_[entity_index];
+        const uint32_t generation = ecs.handle(entity_index, components_lock).generation;
+        if (lod_state.generation != generation) {
+            lod_state = EntityLodState{generation, 0};
+        }
+
+        uint32_t lod = 0;
+        const EntityChunkLocation location = chunk_storage.location(entity_index);
+        if (enabled && mesh->lod_count() > 1 && location.valid() &&
+            chunk_storage.chunk(location.chunk).has_bounds(location.slot)) {
+            const EntityChunk& chunk = chunk_storage.chunk(location.chunk);
+            const uint32_t slot = location.slot;
+            const float3 extent = make_float3(
+                chunk.max_x[slot] - chunk.min_x[slot],
+                chunk.max_y[slot] - chunk.min_y[slot],
+                chunk.max_z[slot] - chunk.min_z[slot]);
+            const float3 to_center = make_float3(
+                0.5f * (chunk.min_x[slot] + chunk.max_x[slot]) - eye[0],
+                0.5f * (chunk.min_y[slot] + chunk.max_y[slot]) - eye[1],
+                0.5f * (chunk.min_z[slot] + chunk.max_z[slot]) - eye[2]);
+            const float radius = 0.5f * length(extent);
+            const float distance = length(to_center) - radius;
+            if (distance > 0.0f) {
+                // Level errors are relative to the bounding radius.
+                const float error_scale = radius * projection_scale / distance;
+                lod = std::min<uint32_t>(lod_state.lod, mesh->lod_count() - 1);
+                while (lod > 0 && mesh->lod_error(lod) * error_scale > threshold) {
+                    --lod;
+                }
+                while (lod + 1 < mesh->lod_count() &&
+                       mesh->lod_error(lod + 1) * error_scale < threshold * kLodHysteresis) {
+                    ++lod;
+                }
+            }
+        }
+
+        lod_state.lod = static_cast<uint8_t>(lod);
+        packet.visible_entity_lods[i] = static_cast<uint8_t>(lod);
+        packet.triangle_count += mesh->lod_slice(lod).index_count / 3;
+        packet.full_triangle_count += mesh->geometry_slice().index_count / 3;
+    }
+}
+
+void Renderer::cull_entity_clusters(FramePacket& packet) {
+    OC_PROFILE_FUNCTION;
+    std::vector<uint32_t>& visible = packet.visible_entity_indices;
+    packet.cluster_ranges.clear();
+    packet.visible_entity_cluster_offsets.assign(visible.size(), InvalidUI32);
+    packet.visible_entity_cluster_counts.assign(visible.size(), 0);
+    packet.cluster_count = 0;
+    packet.visible_cluster_count = 0;
+    if (!cluster_culling_enabled() || visible.empty() || !packet.view.valid) {
+        return;
+    }
+
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    const uint32_t primitive_count = static_cast<uint32_t>(ecs.primitive_count());
+    const Frustum frustum(packet.view.projection_matrix * packet.view.view_matrix);
+    const Frustum* cluster_frustum = frustum_culling_enabled_ ? &frustum : nullptr;
+    const float3 eye = make_float3(packet.view.position[0], packet.view.position[1], packet.view.position[2]);
+
+    // Entities whose clusters are all culled leave the visible list; the parallel
+    // arrays compact along with it.
+    size_t kept = 0;
+    for (size_t i = 0; i < visible.size(); ++i) {
+        const uint32_t entity_index = visible[i];
+        uint32_t range_offset = InvalidUI32;
+        uint32_t range_count = 0;
+        bool drawn = true;
+        const Mesh* mesh = entity_index < primitive_count ? ecs.primitive(entity_index).get_mesh() : nullptr;
+        if (packet.visible_entity_lods[i] == 0 && mesh != nullptr &&
+            mesh->gpu_resource_state() == GPUResourceState::GPU_Ready && !mesh->meshlets().empty()) {
+            // The cone test assumes the default counter-clockwise front faces.
+            const Material* material = ecs.primitive(entity_index).get_material();
+            const bool cone_test = material != nullptr &&
+                                   material->get_pipeline_state().raster_state.cull_mode == CullingMode::BACK &&
+                                   !material->get_pipeline_state().raster_state.front_face;
+            const uint32_t meshlet_count = static_cast<uint32_t>(mesh->meshlets().size());
+            const uint32_t first_range = static_cast<uint32_t>(packet.cluster_ranges.size());
+            const uint32_t visible_count = append_visible_clusters(
+                *mesh,
+                ecs.transform_component(entity_index).get_world_matrix(),
+                cluster_frustum,
+                cone_test,
+                eye,
+                packet.cluster_ranges);
+            packet.cluster_count += meshlet_count;
+            packet.visible_cluster_count += visible_count;
+
+            const uint32_t full_triangles = mesh->geometry_slice().index_count / 3;
+            if (visible_count == 0) {
+                drawn = false;
+                packet.triangle_count -= full_triangles;
+                packet.full_triangle_count -= full_triangles;
+            } else if (visible_count < meshlet_count) {
+                range_offset = first_range;
+                range_count = static_cast<uint32_t>(packet.cluster_ranges.size()) - first_range;
+                uint32_t visible_indices = 0;
+                for (uint32_t r = first_range; r < packet.cluster_ranges.size(); ++r) {
+                    visible_indices += packet.cluster_ranges[r].index_count;
+                }
+                packet.triangle_count -= full_triangles - visible_indices / 3;
+            } else {
+                // Every cluster survived: draw the whole slice, which can still be instanced.
+                packet.cluster_ranges.resize(first_range);
+            }
+        }
+        if (!drawn) {
+            continue;
+        }
+        visible[kept] = entity_index;
+        packet.visible_entity_lods[kept] = packet.visible_entity_lods[i];
+        packet.visible_entity_cluster_offsets[kept] = range_offset;
+        packet.visible_entity_cluster_counts[kept] = range_count;
+        ++kept;
+    }
+    visible.resize(kept);
+    packet.visible_entity_lods.resize(kept);
+    packet.visible_entity_cluster_offsets.resize(kept);
+    packet.visible_entity_cluster_counts.resize(kept);
+}
+
+void Renderer::snapshot_visible_positions(FramePacket& packet) {
+    OC_PROFILE_FUNCTION;
+    const std::vector<uint32_t>& visible = packet.visible_entity_indices;
+    packet.visible_entity_positions.resize(visible.size());
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    const auto components_lock = ecs.lock_components_shared();
+    const uint32_t transform_count = static_cast<uint32_t>(ecs.transform_component_count());
+    for (size_t i = 0; i < visible.size(); ++i) {
+        const uint32_t entity_index = visible[i];
+        if (entity_index >= transform_count) {
+            packet.visible_entity_positions[i] = make_float3(0.0f, 0.0f, 0.0f);
+            continue;
+        }
+        const float4 world_position = ecs.transform_component(entity_index).get_world_matrix()[3];
+        packet.visible_entity_positions[i] = make_float3(world_position.x, world_position.y, world_position.z);
+    }
+}
+
+FramePacket& Renderer::capture_frame_packet() {
+    FramePacket& packet = frame_packets_[next_frame_packet_];
+    next_frame_packet_ = (next_frame_packet_ + 1) % kMaxFramePipelineDepth;
+    packet.scene = scene_;
+    packet.view = FrameView::capture(camera_);
+    packet.capture_time = FramePacket::TimePoint::clock::now();
+    packet.cull_ms = 0.0;
+    return packet;
+}
+
+void Renderer::kick_frame_preparation(FramePacket& packet) {
+    OC_ASSERT(!frame_prepare_in_flight_);
+    frame_prepare_task_.configure(&packet, [this](FramePacket& prepared) {
+        cull_scene(prepared);
+    });
+    task_scheduler_.AddTaskSetToPipe(&frame_prepare_task_);
+    frame_prepare_in_flight_ = true;
+}
+
+FramePacket* Renderer::wait_frame_preparation() {
+    if (!frame_prepare_in_flight_) {
+        return nullptr;
+    }
+    task_scheduler_.WaitforTask(&frame_prepare_task_);
+    frame_prepare_in_flight_ = false;
+    return frame_prepare_task_.packet();
+}
+
+void Renderer::record_frame_latency() noexcept {
+    const auto latency = FramePacket::TimePoint::clock::now() - render_packet_->capture_time;
+    frame_latency_ns_.store(
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()),
+        std::memory_order_relaxed);
 }
 
 bool Renderer::is_async_loading() const noexcept {
@@ -17,9 +17,15 @@
 #include "loading_progress_listener.h"
 #include "frustum.h"
 #include "renderer_primitive_cull_task.h"
+#include "frame_packet.h"
+#include "frame_stats.h"
+#include "dynamic_resolution.h"
 #include "entity_component_system.h"
 #include "ext/enkiTS/src/TaskScheduler.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace enki { class TaskScheduler; struct ITaskSet; }
 
 namespace ocarina {
@@ -28,6 +34,7 @@ class RHIRenderPass;
 class Device;
 class Scene;
 class Camera;
+class IndirectDrawList;
 
 
 class Renderer : public concepts::Noncopyable {
@@ -108,11 +115,54 @@ public:
     [[nodiscard]] EntityComponentSystem& ecs() noexcept { return EntityComponentSystem::instance(); }
     [[nodiscard]] const EntityComponentSystem& ecs() const noexcept { return EntityComponentSystem::instance(); }
 
+    /// Visible entities of the frame being recorded.
     [[nodiscard]] const std::vector<uint32_t>& visible_entity_indices() const noexcept {
-        return primitive_cull_task_.visible_entity_indices();
+        return render_packet_->visible_entity_indices;
+    }
+
+    /// Frames in the CPU pipeline. At depth 1 each frame is culled and then recorded on the
+    /// render thread. At depth 2 workers cull frame N+1 (camera and transforms sampled after
+    /// frame N's upload) while the render thread records and submits frame N, which adds one
+    /// frame of camera latency. Custom render callbacks and async loading always run at depth 1.
+    static constexpr uint32_t kMaxFramePipelineDepth = 2;
+    void set_frame_pipeline_depth(uint32_t depth) noexcept {
+        frame_pipeline_depth_.store(std::clamp(depth, 1u, kMaxFramePipelineDepth), std::memory_order_relaxed);
     }
+    [[nodiscard]] uint32_t frame_pipeline_depth() const noexcept {
+        return frame_pipeline_depth_.load(std::memory_order_relaxed);
+    }
+    /// Per-stage CPU times and GPU time of the last FrameStats::kDefaultWindow frames, filled
+    /// by the render thread.
+    [[nodiscard]] FrameStats& frame_stats() noexcept { return frame_stats_; }
+    [[nodiscard]] const FrameStats& frame_stats() const noexcept { return frame_stats_; }
+    /// Render scale of registered offscreen passes, steered by the GPU frame time once
+    /// enabled; the render thread updates it before each frame records.
+    [[nodiscard]] DynamicResolution& dynamic_resolution() noexcept { return dynamic_resolution_; }
+    [[nodiscard]] const DynamicResolution& dynamic_resolution() const noexcept { return dynamic_resolution_; }
+    /// Time from sampling the camera to submitting the frame, for the last submitted frame.
+    [[nodiscard]] double frame_latency_ms() const noexcept {
+        return static_cast<double>(frame_latency_ns_.load(std::memory_order_relaxed)) * 1e-6;
+    }
+
+    /// Passes with at least this many draws are recorded into secondary command buffers.
+    static constexpr uint32_t kSecondaryRecordingMinDraws = 2048;
+    /// Draws per secondary command buffer (one task range each).
+    static constexpr uint32_t kSecondaryChunkDraws = 512;
 
+    /// Records the pass's draw batches (see build_draw_batches). With indirect drawing on,
+    /// instanced batches are merged into CPU-built multi-draw-indirect batches (see
+    /// IndirectDrawList) instead.
     void draw_render_queues(CommandBuffer& cmd, RHIRenderPass* render_pass);
+    /// Splits a large pass's queues into kSecondaryChunkDraws chunks and records each into
+    /// a secondary command buffer across the task scheduler. Returns false, leaving
+    /// @p secondaries empty, when the pass is small or the backend has no secondaries;
+    /// the caller then records inline with draw_render_queues().
+    [[nodiscard]] bool record_render_queue_secondaries(RHIRenderPass* render_pass, std::vector<CommandBuffer>& secondaries);
+    /// Visible entities per render-component update task range.
+    static constexpr uint32_t kRenderComponentUpdateBatch = 256;
+    /// Refreshes visible entities' render components across the task scheduler, skipping
+    /// those whose versions show nothing changed (Primitive::render_component_current()).
+    /// First-time initializations run afterwards on the calling thread.
     void update_visible_render_components();
     void populate_render_pass_queues(RHIRenderPass* render_pass);
 
@@ -121,10 +171,51 @@ public:
         render_pass_primitive_filter_ = std::move(filter);
     }
 
+    /// Requests indirect drawing; ignored when the device lacks indirect first_instance.
+    void set_indirect_drawing_enabled(bool enabled) noexcept { indirect_drawing_enabled_.store(enabled, std::memory_order_relaxed); }
+    [[nodiscard]] bool indirect_drawing_enabled() const noexcept;
+
+    /// CPU time spent recording pass draws last frame, summed over all passes.
+    [[nodiscard]] double draw_record_cpu_ms() const noexcept {
+        return static_cast<double>(last_draw_record_cpu_ns_.load(std::memory_order_relaxed)) * 1e-6;
+    }
+
+    /// Culling picks each visible entity's mesh level: the coarsest whose simplification
+    /// error, projected at the entity's distance, stays under lod_error_threshold() (a
+    /// fraction of the screen height). An entity moves to a coarser level only once that
+    /// level's error drops below kLodHysteresis of the threshold, so entities near a switch
+    /// distance do not alternate between levels every frame.
+    static constexpr float kLodHysteresis = 0.75f;
+    /// About one pixel at 1080p.
+    static constexpr float kDefaultLodErrorThreshold = 1.0f / 1080.0f;
+    void set_lod_selection_enabled(bool enabled) noexcept { lod_selection_enabled_.store(enabled, std::memory_order_relaxed); }
+    [[nodiscard]] bool lod_selection_enabled() const noexcept { return lod_selection_enabled_.load(std::memory_order_relaxed); }
+    void set_lod_error_threshold(float screen_fraction) noexcept {
+        lod_error_threshold_.store(std::max(screen_fraction, 0.0f), std::memory_order_relaxed);
+    }
+    [[nodiscard]] float lod_error_threshold() const noexcept { return lod_error_threshold_.load(std::memory_order_relaxed); }
+    /// Triangles of the visible entities' selected levels in the frame being recorded.
+    [[nodiscard]] uint64_t visible_triangle_count() const noexcept { return render_packet_->triangle_count; }
+    /// The same entities at LOD 0.
+    [[nodiscard]] uint64_t visible_full_triangle_count() const noexcept { return render_packet_->full_triangle_count; }
+
+    /// Culling also tests the meshlets (see build_meshlets()) of visible entities drawn at
+    /// LOD 0: against the frustum, and for back-face-culled materials against their normal
+    /// cones from the camera position. Only the surviving index ranges are drawn, one
+    /// draw_indexed() each, so it pays off for large meshes seen partly or from one side
+    /// (architecture) but costs the instancing of small repeated ones. Off by default.
+    void set_cluster_culling_enabled(bool enabled) noexcept { cluster_culling_enabled_.store(enabled, std::memory_order_relaxed); }
+    [[nodiscard]] bool cluster_culling_enabled() const noexcept { return cluster_culling_enabled_.load(std::memory_order_relaxed); }
+    /// Meshlets tested and drawn in the frame being recorded.
+    [[nodiscard]] uint64_t cluster_count() const noexcept { return render_packet_->cluster_count; }
+    [[nodiscard]] uint64_t visible_cluster_count() const noexcept { return render_packet_->visible_cluster_count; }
+
     void set_frustum_culling_enabled(bool enabled) noexcept { frustum_culling_enabled_ = enabled; }
     [[nodiscard]] bool frustum_culling_enabled() const noexcept { return frustum_culling_enabled_; }
 
-    void cull_scene();
+    /// Culls @p packet's scene with its view into its visible entity list, picks each
+    /// visible entity's mesh level and culls the clusters of large meshes.
+    void cull_scene(FramePacket& packet);
     void cull_visible_primitives_parallel(Scene& scene, const Frustum& frustum);
 
     void update_entity_render_component(uint32_t entity_index);
@@ -135,6 +226,30 @@ public:
 private:
     /// Poll loader completion on the render thread and invoke async_complete_fn_ once.
     void poll_async_loader_completion();
+    [[nodiscard]] IndirectDrawList& indirect_draw_list(RHIRenderPass* render_pass);
+    /// Sorts freshly populated packets and resolves each pipeline run's PSO.
+    void sort_and_resolve_draw_packets(RHIRenderPass* render_pass);
+    /// Publishes the previous frame's draw recording time and restarts the sum.
+    void begin_draw_record_timing() noexcept;
+
+    void cull_visible_entities(FramePacket& packet);
+    /// Fills @p packet's per-entity mesh levels and triangle counts.
+    void select_entity_lods(FramePacket& packet);
+    /// Fills @p packet's cluster ranges and drops entities with no visible cluster.
+    void cull_entity_clusters(FramePacket& packet);
+    /// Copies the visible entities' world positions into @p packet for depth sorting.
+    void snapshot_visible_positions(FramePacket& packet);
+
+    /// Samples the scene and camera into the next free frame packet.
+    [[nodiscard]] FramePacket& capture_frame_packet();
+    /// Starts culling @p packet on a worker; wait_frame_preparation() collects it.
+    void kick_frame_preparation(FramePacket& packet);
+    /// Waits for the packet kicked last frame; nullptr when none was in flight.
+    [[nodiscard]] FramePacket* wait_frame_preparation();
+    /// Makes @p packet the frame that components, queues and recording read from.
+    void set_render_packet(FramePacket& packet) noexcept { render_packet_ = &packet; }
+    [[nodiscard]] const FramePacket& render_packet() const noexcept { return *render_packet_; }
+    void record_frame_latency() noexcept;
 
     RenderCallback render = nullptr;
     RenderGUIImplCallback render_gui_impl_ = nullptr;
@@ -157,9 +272,40 @@ protected:
     Scene* scene_ = nullptr;
     Camera* camera_ = nullptr;
     RendererPrimitiveCullTask primitive_cull_task_;
+    /// Chunk snapshot for primitive_cull_task_ in streaming mode.
+    std::vector<EntityChunkRange> cull_chunks_;
     bool frustum_culling_enabled_ = true;
+    std::atomic<bool> lod_selection_enabled_{true};
+    std::atomic<float> lod_error_threshold_{kDefaultLodErrorThreshold};
+    std::atomic<bool> cluster_culling_enabled_{false};
+    /// Level each entity slot was drawn at, for hysteresis, and the slot generation it
+    /// belongs to: a destroyed, recycled or compacted slot starts over instead of inheriting
+    /// the previous entity's level. Only frame preparation touches it.
+    struct EntityLodState {
+        uint32_t generation = InvalidUI32;
+        uint8_t lod = 0;
+    };
+    std::vector<EntityLodState> entity_lods_;
     RenderPassPrimitiveFilter render_pass_primitive_filter_;
 
+    std::array<FramePacket, kMaxFramePipelineDepth> frame_packets_{};
+    uint32_t next_frame_packet_ = 0;
+    FramePacket* render_packet_ = &frame_packets_[0];
+    FramePrepareTask frame_prepare_task_;
+    bool frame_prepare_in_flight_ = false;
+    std::atomic<uint32_t> frame_pipeline_depth_{1};
+    std::atomic<uint64_t> frame_latency_ns_{0};
+
+    /// Per task thread: entities left for update_visible_render_components() to initialize.
+    std::vector<std::vector<uint32_t>> deferred_render_component_updates_;
+    std::atomic<bool> indirect_drawing_enabled_{false};
+    std::mutex indirect_draw_lists_mutex_;
+    std::unordered_map<RHIRenderPass*, std::unique_ptr<IndirectDrawList>> indirect_draw_lists_;
+    std::atomic<uint64_t> draw_record_cpu_ns_{0};
+    std::atomic<uint64_t> last_draw_record_cpu_ns_{0};
+    FrameStats frame_stats_;
+    DynamicResolution dynamic_resolution_;
+
     bool shutdown_called_ = false;
 };
 
@@ -6,17 +6,28 @@
 #include "frustum.h"
 #include "entity_component_system.h"
 #include "scene.h"
-#include "mesh.h"
+#include "entity_chunk_storage.h"
 #include "simd_frustum_cull.h"
 #include "enki_task_debug.h"
 #include "core/profiler.h"
 #include "ext/enkiTS/src/TaskScheduler.h"
 #include <atomic>
+#include <bit>
 
 namespace ocarina {
 
+/// Culls scene entities against a frustum in one of two modes: walking the entities of
+/// the visible grid cells (random access into the chunks), or streaming every
+/// world-bounds chunk in SoA order. Streaming wins once the visible cells hold more than
+/// 1 / kChunkStreamEntityRatio of the chunked entities; see prefer_chunk_stream().
 class RendererPrimitiveCullTask : public enki::ITaskSet {
 public:
+    static constexpr uint32_t kChunkStreamEntityRatio = 8;
+
+    [[nodiscard]] static bool prefer_chunk_stream(uint64_t cell_entity_count, uint64_t chunk_entity_count) noexcept {
+        return cell_entity_count * kChunkStreamEntityRatio >= chunk_entity_count;
+    }
+
     void prepare(uint32_t max_visible_count) {
         if (max_visible_count == 0) {
             return;
@@ -39,10 +50,23 @@ public:
         visible_cell_count_ = visible_cell_count;
         frustum_ = frustum;
         max_cells_per_batch_ = max_cells_per_batch;
+        chunks_ = nullptr;
         m_SetSize = visible_cell_count_;
         m_MinRange = static_cast<uint32_t>(max_cells_per_batch_);
     }
 
+    /// Streaming mode over a snapshot from EntityComponentSystem::collect_chunks(), one
+    /// chunk per range. Entities outside @p scene are skipped.
+    void configure_chunks(const Scene* scene, const std::vector<EntityChunkRange>* chunks, const Frustum* frustum) {
+        scene_ = scene;
+        chunks_ = chunks;
+        frustum_ = frustum;
+        visible_cell_indices_ = nullptr;
+        visible_cell_count_ = 0;
+        m_SetSize = chunks != nullptr ? static_cast<uint32_t>(chunks->size()) : 0u;
+        m_MinRange = 1;
+    }
+
     void set_visible_entity_indices(const std::vector<uint32_t>& indices) {
         visible_entity_indices_ = indices;
     }
@@ -73,13 +97,18 @@ public:
     void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
         OC_PROFILE_FUNCTION;
         (void)threadnum;
+        if (chunks_ != nullptr) {
+            execute_chunk_range(range);
+            return;
+        }
         if (scene_ == nullptr || visible_cell_indices_ == nullptr || frustum_ == nullptr) {
             return;
         }
 
         EntityComponentSystem& ecs = EntityComponentSystem::instance();
+        const auto components_lock = ecs.lock_components_shared();
         const uint32_t ecs_primitive_count = ecs.primitive_count();
-        const std::vector<uint32_t>& scene_entities = scene_->entity_indices();
+        const EntityChunkStorage& chunk_storage = ecs.chunk_storage();
         const std::vector<SceneGridCell>& cells = scene_->grid_cells();
 
         const uint32_t end_cell = range.end;
@@ -94,19 +123,17 @@ public:
         alignas(16) float valid_mask_f[4]{};
 
         for (; cell_i < end_cell; ++cell_i) {
-            const uint32_t flat = (*visible_cell_indices_)[cell_i];
-            if (flat >= cells.size()) {
+            const uint32_t cell_slot = (*visible_cell_indices_)[cell_i];
+            if (cell_slot >= cells.size()) {
                 continue;
             }
-            const SceneGridCell& cell = cells[flat];
-            if (cell.entity_count == 0) {
+            const std::vector<uint32_t>& scene_entities = cells[cell_slot].entity_indices;
+            const uint32_t end = static_cast<uint32_t>(scene_entities.size());
+            if (end == 0) {
                 continue;
             }
 
-            const uint32_t begin = cell.first_entity_index;
-            const uint32_t end = begin + cell.entity_count;
-
-            uint32_t i = begin;
+            uint32_t i = 0;
             for (; i + 4 <= end; i += 4) {
                 uint32_t entity_index[4] = {
                     scene_entities[i + 0],
@@ -117,36 +144,34 @@ public:
 
                 for (int lane = 0; lane < 4; ++lane) {
                     valid_mask_f[lane] = 0.0f;
-                    if (entity_index[lane] >= ecs_primitive_count) {
+                    // World bounds come from the hot chunk SoA (refreshed by
+                    // EntityComponentSystem::refresh_world_bounds), not Primitive / Transform.
+                    // Destroyed entities have no chunk location and are never emitted.
+                    const EntityChunkLocation location = entity_index[lane] < ecs_primitive_count
+                        ? chunk_storage.location(entity_index[lane])
+                        : EntityChunkLocation{};
+                    if (!location.valid()) {
+                        entity_index[lane] = InvalidUI32;
                         min_x[lane] = min_y[lane] = min_z[lane] = 0.0f;
                         max_x[lane] = max_y[lane] = max_z[lane] = 0.0f;
                         continue;
                     }
 
-                    Primitive& primitive = ecs.primitive(entity_index[lane]);
-                    TransformComponent& transform = ecs.transform_component(entity_index[lane]);
-                    Mesh* mesh = primitive.get_mesh();
-                    if (mesh == nullptr || !mesh->has_local_bounds()) {
+                    const EntityChunk* chunk = &chunk_storage.chunk(location.chunk);
+                    if (!chunk->has_bounds(location.slot)) {
                         valid_mask_f[lane] = -1.0f;
                         min_x[lane] = min_y[lane] = min_z[lane] = 0.0f;
                         max_x[lane] = max_y[lane] = max_z[lane] = 0.0f;
                         continue;
                     }
 
-                    const BoundingBox world_bounds = mesh->get_local_bounds().transformed(transform.get_world_matrix());
-                    if (!world_bounds.valid) {
-                        valid_mask_f[lane] = -1.0f;
-                        min_x[lane] = min_y[lane] = min_z[lane] = 0.0f;
-                        max_x[lane] = max_y[lane] = max_z[lane] = 0.0f;
-                        continue;
-                    }
-
-                    min_x[lane] = world_bounds.min.x;
-                    min_y[lane] = world_bounds.min.y;
-                    min_z[lane] = world_bounds.min.z;
-                    max_x[lane] = world_bounds.max.x;
-                    max_y[lane] = world_bounds.max.y;
-                    max_z[lane] = world_bounds.max.z;
+                    const uint32_t slot = location.slot;
+                    min_x[lane] = chunk->min_x[slot];
+                    min_y[lane] = chunk->min_y[slot];
+                    min_z[lane] = chunk->min_z[slot];
+                    max_x[lane] = chunk->max_x[slot];
+                    max_y[lane] = chunk->max_y[slot];
+                    max_z[lane] = chunk->max_z[slot];
                 }
 
                 const uint32_t visible_mask = intersect_aabb4_soa(
@@ -177,15 +202,20 @@ public:
                     continue;
                 }
 
-                Primitive& primitive = ecs.primitive(entity_index);
-                TransformComponent& transform = ecs.transform_component(entity_index);
-                Mesh* mesh = primitive.get_mesh();
+                const EntityChunkLocation location = chunk_storage.location(entity_index);
+                if (!location.valid()) {
+                    continue;
+                }
+
+                const EntityChunk& chunk = chunk_storage.chunk(location.chunk);
+                const uint32_t slot = location.slot;
                 bool is_visible = true;
-                if (mesh != nullptr && mesh->has_local_bounds()) {
-                    const BoundingBox world_bounds = mesh->get_local_bounds().transformed(transform.get_world_matrix());
-                    if (world_bounds.valid) {
-                        is_visible = world_bounds.intersects(*frustum_);
-                    }
+                if (chunk.has_bounds(slot)) {
+                    BoundingBox world_bounds;
+                    world_bounds.min = make_float3(chunk.min_x[slot], chunk.min_y[slot], chunk.min_z[slot]);
+                    world_bounds.max = make_float3(chunk.max_x[slot], chunk.max_y[slot], chunk.max_z[slot]);
+                    world_bounds.valid = true;
+                    is_visible = world_bounds.intersects(*frustum_);
                 }
 
                 if (!is_visible) {
@@ -199,7 +229,65 @@ public:
     }
 
 private:
+    void emit_visible(uint32_t entity_index) noexcept {
+        const uint32_t write_slot = visible_counts_.fetch_add(1u, std::memory_order_relaxed);
+        cull_batch_results_[write_slot] = entity_index;
+    }
+
+    void execute_chunk_range(const enki::TaskSetPartition& range) {
+        if (scene_ == nullptr || frustum_ == nullptr) {
+            return;
+        }
+        const auto components_lock = EntityComponentSystem::instance().lock_components_shared();
+        for (uint32_t chunk_i = range.start; chunk_i < range.end; ++chunk_i) {
+            const EntityChunkRange& entry = (*chunks_)[chunk_i];
+            const EntityChunk& chunk = *entry.chunk;
+            // Removals since the snapshot shrink the chunk; never read past its live entries.
+            const uint32_t count = std::min(entry.count, chunk.count);
+
+            uint32_t slot = 0;
+            for (; slot + 4 <= count; slot += 4) {
+                const __m128 min_x = _mm_load_ps(chunk.min_x + slot);
+                const __m128 max_x = _mm_load_ps(chunk.max_x + slot);
+                // Entities without bounds store min > max and are always visible.
+                uint32_t visible_mask = intersect_aabb4_soa(
+                    *frustum_,
+                    min_x,
+                    _mm_load_ps(chunk.min_y + slot),
+                    _mm_load_ps(chunk.min_z + slot),
+                    max_x,
+                    _mm_load_ps(chunk.max_y + slot),
+                    _mm_load_ps(chunk.max_z + slot),
+                    _mm_cmpgt_ps(min_x, max_x));
+                while (visible_mask != 0u) {
+                    const uint32_t entity_index = chunk.entity_index[slot + static_cast<uint32_t>(std::countr_zero(visible_mask))];
+                    visible_mask &= visible_mask - 1u;
+                    if (scene_->contains(entity_index)) {
+                        emit_visible(entity_index);
+                    }
+                }
+            }
+
+            for (; slot < count; ++slot) {
+                const uint32_t entity_index = chunk.entity_index[slot];
+                if (chunk.has_bounds(slot)) {
+                    BoundingBox world_bounds;
+                    world_bounds.min = make_float3(chunk.min_x[slot], chunk.min_y[slot], chunk.min_z[slot]);
+                    world_bounds.max = make_float3(chunk.max_x[slot], chunk.max_y[slot], chunk.max_z[slot]);
+                    world_bounds.valid = true;
+                    if (!world_bounds.intersects(*frustum_)) {
+                        continue;
+                    }
+                }
+                if (scene_->contains(entity_index)) {
+                    emit_visible(entity_index);
+                }
+            }
+        }
+    }
+
     const Scene* scene_ = nullptr;
+    const std::vector<EntityChunkRange>* chunks_ = nullptr;
     const std::vector<uint32_t>* visible_cell_indices_ = nullptr;
     uint32_t visible_cell_count_ = 0;
     const Frustum* frustum_ = nullptr;
@@ -4,7 +4,10 @@
 #include "mesh.h"
 #include "simd_frustum_cull.h"
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <numeric>
+#include <unordered_set>
 
 namespace ocarina {
 
@@ -18,33 +21,38 @@ namespace {
     return mesh->get_local_bounds().transformed(transform.get_world_matrix());
 }
 
-[[nodiscard]] math3d::Matrix4 multiply_matrix(const math3d::Matrix4& lhs, const math3d::Matrix4& rhs) {
-    return lhs * rhs;
+/// Floors @p value to a cell index within +/-Scene::kMaxCellCoord; NaN maps to cell 0.
+[[nodiscard]] int32_t clamp_cell_axis(float value) noexcept {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    constexpr float limit = static_cast<float>(Scene::kMaxCellCoord);
+    return static_cast<int32_t>(std::clamp(std::floor(value), -limit, limit));
 }
 
-[[nodiscard]] BoundingBox compute_bounds_for_range(
-    const std::vector<uint32_t>& entity_indices,
-    uint32_t begin,
-    uint32_t end,
-    const std::vector<BoundingBox>& entity_bounds) {
-    BoundingBox bounds;
-    for (uint32_t index = begin; index < end; ++index) {
-        bounds.merge(entity_bounds[entity_indices[index]]);
+[[nodiscard]] uint64_t saturating_mul(uint64_t lhs, uint64_t rhs) noexcept {
+    if (rhs != 0 && lhs > std::numeric_limits<uint64_t>::max() / rhs) {
+        return std::numeric_limits<uint64_t>::max();
     }
-    return bounds;
+    return lhs * rhs;
+}
+
+[[nodiscard]] math3d::Matrix4 multiply_matrix(const math3d::Matrix4& lhs, const math3d::Matrix4& rhs) {
+    return lhs * rhs;
 }
 
 }// namespace
 
 void Scene::clear_entities() {
     entity_indices_.clear();
+    entity_locations_.clear();
     grid_cells_.clear();
+    cell_lookup_.clear();
+    candidate_cell_indices_.clear();
     visible_cell_indices_.clear();
+    candidate_cell_count_ = 0;
     visible_cell_count_ = 0;
-    grid_dim_x_ = 0;
-    grid_dim_z_ = 0;
-    grid_origin_cell_x_ = 0;
-    grid_origin_cell_z_ = 0;
+    max_cell_overhang_ = 0;
     grid_cell_size_ = kMinGridCellSizeMeters;
     grid_built_ = false;
 }
@@ -73,121 +81,324 @@ void Scene::ensure_visible_cell_capacity() {
     }
 }
 
+SceneCellCoord Scene::cell_coord(const float3& position) const noexcept {
+    const float inv_cell_size = 1.0f / grid_cell_size_;
+    return SceneCellCoord{
+        clamp_cell_axis(position.x * inv_cell_size),
+        clamp_cell_axis(position.y * inv_cell_size),
+        clamp_cell_axis(position.z * inv_cell_size),
+    };
+}
+
+void Scene::update_cell_overhang(const SceneGridCell& cell) noexcept {
+    if (!cell.bounds.valid) {
+        return;
+    }
+    const SceneCellCoord lo = cell_coord(cell.bounds.min);
+    const SceneCellCoord hi = cell_coord(cell.bounds.max);
+    const int64_t overhang = std::max({
+        int64_t{cell.coord.x} - lo.x, int64_t{hi.x} - cell.coord.x,
+        int64_t{cell.coord.y} - lo.y, int64_t{hi.y} - cell.coord.y,
+        int64_t{cell.coord.z} - lo.z, int64_t{hi.z} - cell.coord.z,
+    });
+    max_cell_overhang_ = std::max(max_cell_overhang_, overhang);
+}
+
+void Scene::insert_into_grid(uint32_t entity_index) {
+    const BoundingBox bounds = compute_entity_bounds(entity_index);
+    const SceneCellCoord coord = bounds.valid ? cell_coord(bounds.center()) : kUnboundedCellCoord;
+
+    auto [it, inserted] = cell_lookup_.try_emplace(coord, static_cast<uint32_t>(grid_cells_.size()));
+    if (inserted) {
+        SceneGridCell& cell = grid_cells_.emplace_back();
+        cell.coord = coord;
+    }
+
+    SceneGridCell& cell = grid_cells_[it->second];
+    SceneEntityLocation& location = entity_locations_[entity_index];
+    location.cell_slot = it->second;
+    location.cell_offset = cell.entity_count();
+    cell.entity_indices.push_back(entity_index);
+    cell.bounds.merge(bounds);
+    update_cell_overhang(cell);
+}
+
+void Scene::erase_grid_cell(uint32_t cell_slot) {
+    // Swap-remove keeps occupied cells dense; patch the moved cell's lookup entry.
+    const uint32_t last_slot = static_cast<uint32_t>(grid_cells_.size() - 1);
+    cell_lookup_.erase(grid_cells_[cell_slot].coord);
+    if (cell_slot != last_slot) {
+        grid_cells_[cell_slot] = std::move(grid_cells_[last_slot]);
+        cell_lookup_[grid_cells_[cell_slot].coord] = cell_slot;
+        for (uint32_t entity_index : grid_cells_[cell_slot].entity_indices) {
+            entity_locations_[entity_index].cell_slot = cell_slot;
+        }
+    }
+    grid_cells_.pop_back();
+}
+
+EntityBatch Scene::create_entities(uint32_t count) {
+    grid_built_ = false;
+    const EntityBatch batch = EntityComponentSystem::instance().create_entities(count);
+    if (batch.empty()) {
+        return batch;
+    }
+    entity_indices_.reserve(entity_indices_.size() + batch.count);
+    if (entity_locations_.size() < size_t{batch.first_entity} + batch.count) {
+        entity_locations_.resize(size_t{batch.first_entity} + batch.count);
+    }
+    for (uint32_t i = 0; i < batch.count; ++i) {
+        track_entity(batch.entity_index(i));
+    }
+    return batch;
+}
+
+void Scene::track_entity(uint32_t entity_index) {
+    if (entity_index >= entity_locations_.size()) {
+        entity_locations_.resize(entity_index + 1);
+    }
+    entity_locations_[entity_index] = SceneEntityLocation{static_cast<uint32_t>(entity_indices_.size())};
+    entity_indices_.push_back(entity_index);
+}
+
+void Scene::rebuild_entity_locations() {
+    std::fill(entity_locations_.begin(), entity_locations_.end(), SceneEntityLocation{});
+    for (uint32_t scene_slot = 0; scene_slot < entity_indices_.size(); ++scene_slot) {
+        entity_locations_[entity_indices_[scene_slot]].scene_slot = scene_slot;
+    }
+    for (uint32_t cell_slot = 0; cell_slot < grid_cells_.size(); ++cell_slot) {
+        const std::vector<uint32_t>& cell_entities = grid_cells_[cell_slot].entity_indices;
+        for (uint32_t offset = 0; offset < cell_entities.size(); ++offset) {
+            SceneEntityLocation& location = entity_locations_[cell_entities[offset]];
+            location.cell_slot = cell_slot;
+            location.cell_offset = offset;
+        }
+    }
+}
+
+bool Scene::remove_entity(uint32_t entity_index) {
+    if (!contains(entity_index)) {
+        return false;
+    }
+
+    const SceneEntityLocation location = entity_locations_[entity_index];
+
+    const uint32_t last_entity = entity_indices_.back();
+    entity_indices_[location.scene_slot] = last_entity;
+    entity_locations_[last_entity].scene_slot = location.scene_slot;
+    entity_indices_.pop_back();
+
+    if (location.cell_slot != InvalidUI32) {
+        SceneGridCell& cell = grid_cells_[location.cell_slot];
+        const uint32_t moved_entity = cell.entity_indices.back();
+        cell.entity_indices[location.cell_offset] = moved_entity;
+        entity_locations_[moved_entity].cell_offset = location.cell_offset;
+        cell.entity_indices.pop_back();
+        // Cell bounds are left as-is (conservative) until the cell empties or the grid rebuilds.
+        if (cell.entity_indices.empty()) {
+            erase_grid_cell(location.cell_slot);
+            visible_cell_count_ = 0;
+        }
+    }
+
+    entity_locations_[entity_index] = SceneEntityLocation{};
+    return true;
+}
+
+bool Scene::destroy_entity(const EntityHandle& handle) {
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    if (!ecs.is_alive(handle)) {
+        return false;
+    }
+    remove_entity(handle.index);
+    return ecs.destroy_entity(handle);
+}
+
+void Scene::apply_entity_moves(const std::vector<EntityMove>& moves) {
+    for (const EntityMove& move : moves) {
+        if (!contains(move.from)) {
+            continue;
+        }
+        const SceneEntityLocation location = entity_locations_[move.from];
+        entity_locations_[move.from] = SceneEntityLocation{};
+        if (move.to >= entity_locations_.size()) {
+            entity_locations_.resize(move.to + 1);
+        }
+        entity_locations_[move.to] = location;
+        entity_indices_[location.scene_slot] = move.to;
+        if (location.cell_slot != InvalidUI32) {
+            grid_cells_[location.cell_slot].entity_indices[location.cell_offset] = move.to;
+        }
+    }
+}
+
 void Scene::build_grid(float cell_size_meters) {
+    grid_cells_.clear();
+    cell_lookup_.clear();
+    max_cell_overhang_ = 0;
+    visible_cell_count_ = 0;
+    candidate_cell_count_ = 0;
+
     if (entity_indices_.empty()) {
-        grid_cells_.clear();
         grid_built_ = false;
         return;
     }
 
-    EntityComponentSystem& ecs = EntityComponentSystem::instance();
     grid_cell_size_ = std::max(cell_size_meters, kMinGridCellSizeMeters);
 
-    int32_t min_cell_x = INT32_MAX;
-    int32_t min_cell_z = INT32_MAX;
-    int32_t max_cell_x = INT32_MIN;
-    int32_t max_cell_z = INT32_MIN;
+    // Only occupied cells are allocated, so far-flung entities cost one cell each
+    // instead of inflating a dense extent.
+    for (uint32_t entity_index : entity_indices_) {
+        insert_into_grid(entity_index);
+    }
 
-    auto to_cell = [&](const float3& position) -> std::pair<int32_t, int32_t> {
-        const int32_t cx = static_cast<int32_t>(std::floor(position.x / grid_cell_size_));
-        const int32_t cz = static_cast<int32_t>(std::floor(position.z / grid_cell_size_));
-        return {cx, cz};
-    };
+    ensure_visible_cell_capacity();
+    grid_built_ = true;
+}
 
-    // First pass: compute grid extents (XZ) from entity centers.
-    for (uint32_t scene_index = 0; scene_index < entity_indices_.size(); ++scene_index) {
-        const uint32_t entity_index = entity_indices_[scene_index];
-        const BoundingBox bounds = compute_entity_bounds(entity_index);
-        const float3 center = bounds.valid
-            ? bounds.center()
-            : ecs.transform_component(entity_index).get_position();
-        const auto [cx, cz] = to_cell(center);
-        min_cell_x = std::min(min_cell_x, cx);
-        min_cell_z = std::min(min_cell_z, cz);
-        max_cell_x = std::max(max_cell_x, cx);
-        max_cell_z = std::max(max_cell_z, cz);
-    }
-
-    grid_origin_cell_x_ = min_cell_x;
-    grid_origin_cell_z_ = min_cell_z;
-    grid_dim_x_ = static_cast<uint32_t>(std::max(1, max_cell_x - min_cell_x + 1));
-    grid_dim_z_ = static_cast<uint32_t>(std::max(1, max_cell_z - min_cell_z + 1));
+void Scene::load_region(const std::vector<uint32_t>& entity_indices) {
+    entity_indices_.reserve(entity_indices_.size() + entity_indices.size());
+    for (uint32_t entity_index : entity_indices) {
+        if (contains(entity_index)) {
+            continue;
+        }
+        track_entity(entity_index);
+        if (grid_built_) {
+            insert_into_grid(entity_index);
+        }
+    }
+    if (grid_built_) {
+        ensure_visible_cell_capacity();
+    }
+}
 
-    grid_cells_.clear();
-    grid_cells_.resize(static_cast<size_t>(grid_dim_x_) * static_cast<size_t>(grid_dim_z_));
-    for (SceneGridCell& cell : grid_cells_) {
-        cell.bounds = {};
-        cell.first_entity_index = 0;
-        cell.entity_count = 0;
+uint32_t Scene::unload_region(const BoundingBox& region, std::vector<uint32_t>* out_unloaded) {
+    if (!grid_built_ || !region.valid || grid_cells_.empty()) {
+        return 0;
     }
-    ensure_visible_cell_capacity();
-    visible_cell_count_ = 0;
 
-    auto cell_index = [&](int32_t cx, int32_t cz) -> uint32_t {
-        const uint32_t ix = static_cast<uint32_t>(cx - grid_origin_cell_x_);
-        const uint32_t iz = static_cast<uint32_t>(cz - grid_origin_cell_z_);
-        return iz * grid_dim_x_ + ix;
+    const SceneCellCoord lo = cell_coord(region.min);
+    const SceneCellCoord hi = cell_coord(region.max);
+    auto in_region = [&](const SceneCellCoord& coord) {
+        return coord.x >= lo.x && coord.x <= hi.x &&
+               coord.y >= lo.y && coord.y <= hi.y &&
+               coord.z >= lo.z && coord.z <= hi.z;
     };
 
-    // Second pass: count entities per cell and build per-cell bounds.
-    std::vector<uint32_t> cell_counts(grid_cells_.size(), 0u);
-    std::vector<BoundingBox> cell_bounds(grid_cells_.size());
-    std::vector<uint32_t> entity_cell_ids(entity_indices_.size());
-    for (uint32_t scene_index = 0; scene_index < entity_indices_.size(); ++scene_index) {
-        const uint32_t entity_index = entity_indices_[scene_index];
-        const BoundingBox bounds = compute_entity_bounds(entity_index);
-        const float3 center = bounds.valid
-            ? bounds.center()
-            : ecs.transform_component(entity_index).get_position();
-        const auto [cx, cz] = to_cell(center);
-        const uint32_t flat = cell_index(cx, cz);
-        entity_cell_ids[scene_index] = flat;
-        cell_counts[flat] += 1;
-        cell_bounds[flat].merge(bounds);
-    }
-
-    // Compute per-cell ranges (prefix sums) into the reordered entity_indices_ array.
-    uint32_t running = 0;
-    for (uint32_t flat = 0; flat < static_cast<uint32_t>(grid_cells_.size()); ++flat) {
-        SceneGridCell& cell = grid_cells_[flat];
-        cell.first_entity_index = running;
-        cell.entity_count = cell_counts[flat];
-        cell.bounds = cell_bounds[flat];
-        running += cell.entity_count;
-    }
-
-    // Third pass: reorder entity_indices_ so entities are grouped by cell.
-    std::vector<uint32_t> write_cursor(grid_cells_.size(), 0u);
-    for (uint32_t flat = 0; flat < static_cast<uint32_t>(grid_cells_.size()); ++flat) {
-        write_cursor[flat] = grid_cells_[flat].first_entity_index;
-    }
-    std::vector<uint32_t> reordered(entity_indices_.size());
-    for (uint32_t scene_index = 0; scene_index < static_cast<uint32_t>(entity_indices_.size()); ++scene_index) {
-        const uint32_t flat = entity_cell_ids[scene_index];
-        const uint32_t dst = write_cursor[flat]++;
-        reordered[dst] = entity_indices_[scene_index];
-    }
-    entity_indices_.swap(reordered);
+    std::unordered_set<uint32_t> removed;
+    for (uint32_t cell_slot = 0; cell_slot < grid_cells_.size();) {
+        SceneGridCell& cell = grid_cells_[cell_slot];
+        if (!in_region(cell.coord)) {
+            ++cell_slot;
+            continue;
+        }
+        for (uint32_t entity_index : cell.entity_indices) {
+            removed.insert(entity_index);
+            if (out_unloaded != nullptr) {
+                out_unloaded->push_back(entity_index);
+            }
+        }
+        // The swapped-in cell lands on cell_slot, so re-test the same slot.
+        erase_grid_cell(cell_slot);
+    }
 
-    grid_built_ = true;
+    if (removed.empty()) {
+        return 0;
+    }
+
+    std::erase_if(entity_indices_, [&](uint32_t entity_index) {
+        return removed.contains(entity_index);
+    });
+    rebuild_entity_locations();
+    visible_cell_count_ = 0;
+    return static_cast<uint32_t>(removed.size());
 }
 
 void Scene::build_primitive_cull_batch() {
-    // No-op: entity ordering is stored in grid cell ranges.
+    // No-op: entity ordering is stored per grid cell.
+}
+
+void Scene::gather_candidate_cells(const Frustum& frustum) {
+    const uint32_t cell_count = static_cast<uint32_t>(grid_cells_.size());
+    if (candidate_cell_indices_.size() < cell_count) {
+        candidate_cell_indices_.resize(cell_count);
+    }
+    candidate_cell_count_ = 0;
+
+    const BoundingBox frustum_bounds = frustum.compute_bounds();
+    if (frustum_bounds.valid) {
+        // Widened in 64 bits and re-clamped: clamped coordinates plus the overhang can
+        // leave the int32 range.
+        const SceneCellCoord lo_cell = cell_coord(frustum_bounds.min);
+        const SceneCellCoord hi_cell = cell_coord(frustum_bounds.max);
+        const int64_t lo_x = std::max<int64_t>(int64_t{lo_cell.x} - max_cell_overhang_, -kMaxCellCoord);
+        const int64_t lo_y = std::max<int64_t>(int64_t{lo_cell.y} - max_cell_overhang_, -kMaxCellCoord);
+        const int64_t lo_z = std::max<int64_t>(int64_t{lo_cell.z} - max_cell_overhang_, -kMaxCellCoord);
+        const int64_t hi_x = std::min<int64_t>(int64_t{hi_cell.x} + max_cell_overhang_, kMaxCellCoord);
+        const int64_t hi_y = std::min<int64_t>(int64_t{hi_cell.y} + max_cell_overhang_, kMaxCellCoord);
+        const int64_t hi_z = std::min<int64_t>(int64_t{hi_cell.z} + max_cell_overhang_, kMaxCellCoord);
+
+        const uint64_t range_x = static_cast<uint64_t>(hi_x - lo_x + 1);
+        const uint64_t range_y = static_cast<uint64_t>(hi_y - lo_y + 1);
+        const uint64_t range_z = static_cast<uint64_t>(hi_z - lo_z + 1);
+        const uint64_t range_cells = saturating_mul(saturating_mul(range_x, range_y), range_z);
+
+        // Probe the hash only when the frustum volume covers fewer coordinates than there
+        // are occupied cells; otherwise a linear scan with an AABB reject is cheaper.
+        if (range_cells < cell_count) {
+            for (int64_t z = lo_z; z <= hi_z; ++z) {
+                for (int64_t y = lo_y; y <= hi_y; ++y) {
+                    for (int64_t x = lo_x; x <= hi_x; ++x) {
+                        const uint32_t cell_slot = find_grid_cell(SceneCellCoord{
+                            static_cast<int32_t>(x),
+                            static_cast<int32_t>(y),
+                            static_cast<int32_t>(z)});
+                        if (cell_slot != InvalidUI32) {
+                            candidate_cell_indices_[candidate_cell_count_++] = cell_slot;
+                        }
+                    }
+                }
+            }
+            // The scan path below keeps this cell through its invalid bounds.
+            const uint32_t unbounded_slot = find_grid_cell(kUnboundedCellCoord);
+            if (unbounded_slot != InvalidUI32) {
+                candidate_cell_indices_[candidate_cell_count_++] = unbounded_slot;
+            }
+            return;
+        }
+
+        for (uint32_t cell_slot = 0; cell_slot < cell_count; ++cell_slot) {
+            const BoundingBox& bounds = grid_cells_[cell_slot].bounds;
+            if (bounds.valid &&
+                (bounds.max.x < frustum_bounds.min.x || bounds.min.x > frustum_bounds.max.x ||
+                 bounds.max.y < frustum_bounds.min.y || bounds.min.y > frustum_bounds.max.y ||
+                 bounds.max.z < frustum_bounds.min.z || bounds.min.z > frustum_bounds.max.z)) {
+                continue;
+            }
+            candidate_cell_indices_[candidate_cell_count_++] = cell_slot;
+        }
+        return;
+    }
+
+    for (uint32_t cell_slot = 0; cell_slot < cell_count; ++cell_slot) {
+        candidate_cell_indices_[candidate_cell_count_++] = cell_slot;
+    }
 }
 
 void Scene::cull_grids(const Frustum& frustum) {
     visible_cell_count_ = 0;
 
     if (!grid_built_ || grid_cells_.empty()) {
+        candidate_cell_count_ = 0;
         return;
     }
 
     ensure_visible_cell_capacity();
+    gather_candidate_cells(frustum);
 
-    // Pass 1: CullCellsSIMD. Pack visible cell flat indices into visible_cell_indices_ using visible_cell_count_.
-    const uint32_t cell_count = static_cast<uint32_t>(grid_cells_.size());
-    uint32_t cell_index_i = 0;
+    // Pass 1: CullCellsSIMD. Pack visible cell slots into visible_cell_indices_ using visible_cell_count_.
+    const uint32_t candidate_count = candidate_cell_count_;
+    uint32_t candidate_i = 0;
 
     alignas(16) float min_x[4]{};
     alignas(16) float min_y[4]{};
@@ -196,21 +407,15 @@ void Scene::cull_grids(const Frustum& frustum) {
     alignas(16) float max_y[4]{};
     alignas(16) float max_z[4]{};
     alignas(16) float valid_mask_f[4]{};
-    uint32_t flat_lane_index[4]{};
+    uint32_t slot_lane_index[4]{};
 
-    for (; cell_index_i + 4 <= cell_count; cell_index_i += 4) {
+    for (; candidate_i + 4 <= candidate_count; candidate_i += 4) {
         for (int lane = 0; lane < 4; ++lane) {
-            const uint32_t flat = cell_index_i + static_cast<uint32_t>(lane);
-            flat_lane_index[lane] = flat;
-            const SceneGridCell& cell = grid_cells_[flat];
+            const uint32_t cell_slot = candidate_cell_indices_[candidate_i + static_cast<uint32_t>(lane)];
+            slot_lane_index[lane] = cell_slot;
+            const SceneGridCell& cell = grid_cells_[cell_slot];
             valid_mask_f[lane] = 0.0f;
 
-            if (cell.entity_count == 0) {
-                min_x[lane] = min_y[lane] = min_z[lane] = 0.0f;
-                max_x[lane] = max_y[lane] = max_z[lane] = 0.0f;
-                continue;
-            }
-
             if (!cell.bounds.valid) {
                 // No bounds: conservatively treat as visible.
                 valid_mask_f[lane] = -1.0f;
@@ -238,24 +443,18 @@ void Scene::cull_grids(const Frustum& frustum) {
             _mm_load_ps(valid_mask_f));
 
         for (int lane = 0; lane < 4; ++lane) {
-            const uint32_t flat = flat_lane_index[lane];
-            if (grid_cells_[flat].entity_count == 0) {
-                continue;
-            }
             if ((visible_mask & (1u << lane)) == 0u) {
                 continue;
             }
-            visible_cell_indices_[visible_cell_count_++] = flat;
+            visible_cell_indices_[visible_cell_count_++] = slot_lane_index[lane];
         }
     }
 
-    for (; cell_index_i < cell_count; ++cell_index_i) {
-        const SceneGridCell& cell = grid_cells_[cell_index_i];
-        if (cell.entity_count == 0) {
-            continue;
-        }
+    for (; candidate_i < candidate_count; ++candidate_i) {
+        const uint32_t cell_slot = candidate_cell_indices_[candidate_i];
+        const SceneGridCell& cell = grid_cells_[cell_slot];
         if (!cell.bounds.valid || cell.bounds.intersects(frustum)) {
-            visible_cell_indices_[visible_cell_count_++] = cell_index_i;
+            visible_cell_indices_[visible_cell_count_++] = cell_slot;
         }
     }
 }
@@ -15,18 +15,59 @@ namespace ocarina {
 
 class Camera;
 
+/// Integer cell coordinates of the sparse scene grid (unbounded on all three axes).
+struct SceneCellCoord {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t z = 0;
+
+    [[nodiscard]] bool operator==(const SceneCellCoord& other) const noexcept {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+/// Spatial hash of integer cell coordinates (Teschner et al. 2003 prime mixing).
+struct SceneCellCoordHash {
+    [[nodiscard]] size_t operator()(const SceneCellCoord& coord) const noexcept {
+        const uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) * 73856093ull ^
+                           static_cast<uint64_t>(static_cast<uint32_t>(coord.y)) * 19349663ull ^
+                           static_cast<uint64_t>(static_cast<uint32_t>(coord.z)) * 83492791ull;
+        return static_cast<size_t>(h);
+    }
+};
+
+/// One occupied cell. Empty cells are never stored: a cell is created on first insert
+/// and erased when its last entity leaves.
 struct SceneGridCell {
+    SceneCellCoord coord;
     BoundingBox bounds;
-    uint32_t first_entity_index = 0; // range into Scene::entity_indices_
-    uint32_t entity_count = 0;
+    std::vector<uint32_t> entity_indices;
+
+    [[nodiscard]] uint32_t entity_count() const noexcept {
+        return static_cast<uint32_t>(entity_indices.size());
+    }
+};
+
+/// Where a scene entity sits: its slot in the entity list and, once gridded, its cell entry.
+/// Lets destruction and compaction patch the scene in O(1) per entity.
+struct SceneEntityLocation {
+    uint32_t scene_slot = InvalidUI32;
+    uint32_t cell_slot = InvalidUI32;
+    uint32_t cell_offset = InvalidUI32;
 };
 
 class OC_FRAMEWORK_API Scene {
 public:
     static constexpr size_t kMaxPrimitivesPerCullBatch = 100;
-    // Frostbite-like 2D grid culling: cell size is at least 20m x 20m (XZ plane).
+    // Sparse hashed 3D grid: cells are cubes of at least 20m per side, keyed by integer coords.
     static constexpr float kMinGridCellSizeMeters = 20.0f;
     static constexpr float kDefaultGridCellSizeMeters = 64.0f;
+    /// Cell coordinates are clamped to +/-kMaxCellCoord, so far-out or non-finite positions
+    /// stay in range and the probe loops never overflow.
+    static constexpr int32_t kMaxCellCoord = 1 << 30;
+    /// Entities without valid world bounds all share this cell, outside the clamped range.
+    /// It is a candidate for every frustum, on both the probe and the scan path.
+    static constexpr SceneCellCoord kUnboundedCellCoord{INT32_MIN, INT32_MIN, INT32_MIN};
 
     Scene() = default;
     ~Scene() = default;
@@ -40,16 +81,45 @@ public:
     Primitive& emplace_primitive(Args&&... args) {
         grid_built_ = false;
         const uint32_t entity_index = EntityComponentSystem::instance().emplace_primitive(OC_FORWARD(args)...);
-        entity_indices_.push_back(entity_index);
+        track_entity(entity_index);
         return EntityComponentSystem::instance().primitive(entity_index);
     }
 
+    /// Bulk path: creates @p count contiguous ECS entities (see
+    /// EntityComponentSystem::create_entities) and adds them all to the scene.
+    EntityBatch create_entities(uint32_t count);
+
+    /// Drop @p handle from the scene and destroy it in the ECS (slot reuse is deferred by
+    /// the ECS). Call between frames from the thread that owns the scene.
+    bool destroy_entity(const EntityHandle& handle);
+
+    /// Drop an entity from the scene and its grid cell without destroying it.
+    bool remove_entity(uint32_t entity_index);
+
+    /// Patch entity indices after EntityComponentSystem::compact().
+    void apply_entity_moves(const std::vector<EntityMove>& moves);
+
+    [[nodiscard]] bool contains(uint32_t entity_index) const noexcept {
+        return entity_index < entity_locations_.size()
+            && entity_locations_[entity_index].scene_slot != InvalidUI32;
+    }
+
     void clear_entities();
 
-    // Builds a 2D grid spatial index on XZ plane.
+    // Rebuilds the sparse 3D grid from every scene entity.
     void build_grid(float cell_size_meters = kDefaultGridCellSizeMeters);
 
-    // Pass 1: cull cells (SIMD) and output a visible cell index list.
+    /// Streaming: add already-created ECS entities to the scene and insert them into the
+    /// grid without a rebuild. Falls back to plain membership when no grid is built yet.
+    void load_region(const std::vector<uint32_t>& entity_indices);
+
+    /// Streaming: drop every cell whose coordinates overlap @p region and remove their
+    /// entities from the scene. Removed entity indices are appended to @p out_unloaded.
+    /// Returns the number of entities removed.
+    uint32_t unload_region(const BoundingBox& region, std::vector<uint32_t>* out_unloaded = nullptr);
+
+    // Pass 1: gather cells overlapping the frustum bounds, cull them (SIMD) and output
+    // a visible cell slot list.
     void cull_grids(Camera& camera);
     void cull_grids(const Frustum& frustum);
 
@@ -63,6 +133,10 @@ public:
         return entity_indices_[scene_index];
     }
 
+    [[nodiscard]] EntityHandle entity_handle(uint32_t scene_index) const noexcept {
+        return EntityComponentSystem::instance().handle(entity_indices_[scene_index]);
+    }
+
     [[nodiscard]] Primitive& primitive(uint32_t scene_index) {
         return EntityComponentSystem::instance().primitive(entity_indices_[scene_index]);
     }
@@ -96,25 +170,31 @@ public:
     }
 
     [[nodiscard]] bool has_grid() const noexcept { return grid_built_; }
+    [[nodiscard]] float grid_cell_size() const noexcept { return grid_cell_size_; }
     [[nodiscard]] uint32_t grid_cell_count() const noexcept { return static_cast<uint32_t>(grid_cells_.size()); }
+    /// Cells walked by the last cull_grids() before the SIMD frustum test.
+    [[nodiscard]] uint32_t candidate_cell_count() const noexcept { return candidate_cell_count_; }
     [[nodiscard]] uint32_t visible_cell_count() const noexcept { return visible_cell_count_; }
     [[nodiscard]] const std::vector<uint32_t>& visible_cell_indices() const noexcept { return visible_cell_indices_; }
     // Legacy aliases used by the culling test UI.
     [[nodiscard]] uint32_t visible_grid_count() const noexcept { return visible_cell_count_; }
     [[nodiscard]] const std::vector<uint32_t>& visible_grid_indices() const noexcept { return visible_cell_indices_; }
 
-    // Convert a flat cell index to world cell coordinates (cx, cz).
-    [[nodiscard]] std::pair<int32_t, int32_t> grid_cell_coords(uint32_t flat_index) const noexcept {
-        if (grid_dim_x_ == 0) {
-            return {grid_origin_cell_x_, grid_origin_cell_z_};
-        }
-        const uint32_t iz = flat_index / grid_dim_x_;
-        const uint32_t ix = flat_index - iz * grid_dim_x_;
-        return {grid_origin_cell_x_ + static_cast<int32_t>(ix), grid_origin_cell_z_ + static_cast<int32_t>(iz)};
+    [[nodiscard]] SceneCellCoord cell_coord(const float3& position) const noexcept;
+
+    /// Cell slot for @p coord, or InvalidUI32 when that cell is empty.
+    [[nodiscard]] uint32_t find_grid_cell(const SceneCellCoord& coord) const noexcept {
+        const auto it = cell_lookup_.find(coord);
+        return it == cell_lookup_.end() ? InvalidUI32 : it->second;
+    }
+
+    // Convert a cell slot to world cell coordinates (cx, cy, cz).
+    [[nodiscard]] SceneCellCoord grid_cell_coords(uint32_t cell_slot) const noexcept {
+        return cell_slot < grid_cells_.size() ? grid_cells_[cell_slot].coord : SceneCellCoord{};
     }
 
-    [[nodiscard]] uint32_t grid_cell_entity_count(uint32_t flat_index) const noexcept {
-        return flat_index < grid_cells_.size() ? grid_cells_[flat_index].entity_count : 0u;
+    [[nodiscard]] uint32_t grid_cell_entity_count(uint32_t cell_slot) const noexcept {
+        return cell_slot < grid_cells_.size() ? grid_cells_[cell_slot].entity_count() : 0u;
     }
 
     [[nodiscard]] const std::vector<SceneGridCell>& grid_cells() const noexcept {
@@ -125,17 +205,28 @@ private:
     [[nodiscard]] BoundingBox compute_entity_bounds(uint32_t entity_index) const;
     [[nodiscard]] BoundingBox compute_bounds(const std::vector<uint32_t>& entity_indices) const;
     void ensure_visible_cell_capacity();
+    void track_entity(uint32_t entity_index);
+    void rebuild_entity_locations();
+    void insert_into_grid(uint32_t entity_index);
+    void erase_grid_cell(uint32_t cell_slot);
+    void update_cell_overhang(const SceneGridCell& cell) noexcept;
+    void gather_candidate_cells(const Frustum& frustum);
 
     std::vector<uint32_t> entity_indices_;
+    /// Indexed by ECS entity index.
+    std::vector<SceneEntityLocation> entity_locations_;
 
-    // Grid data (XZ plane).
+    // Sparse grid data: occupied cells are stored densely, addressed through cell_lookup_.
     std::vector<SceneGridCell> grid_cells_;
+    std::unordered_map<SceneCellCoord, uint32_t, SceneCellCoordHash> cell_lookup_;
+    std::vector<uint32_t> candidate_cell_indices_;
     std::vector<uint32_t> visible_cell_indices_;
+    uint32_t candidate_cell_count_ = 0;
     uint32_t visible_cell_count_ = 0;
-    uint32_t grid_dim_x_ = 0;
-    uint32_t grid_dim_z_ = 0;
-    int32_t grid_origin_cell_x_ = 0;
-    int32_t grid_origin_cell_z_ = 0;
+    // Max distance (in cells) that entity bounds extend past their owning cell; widens the
+    // coordinate range walked during culling so protruding entities are never missed.
+    // At most 2 * kMaxCellCoord.
+    int64_t max_cell_overhang_ = 0;
     float grid_cell_size_ = kMinGridCellSizeMeters;
     bool grid_built_ = false;
 };
@@ -3,58 +3,213 @@
 #include "math/basic_types.h"
 #include "transform.h"
 
+#include <atomic>
+#include <thread>
+
 namespace ocarina {
 
+/// Queue @p entity_index for the next EntityComponentSystem::sync_gpu_transforms()
+/// (defined in entity_component_system.cpp).
+void enqueue_transform_sync(uint32_t entity_index);
+/// Queue @p entity_index as a dirty subtree root for the next
+/// EntityComponentSystem::propagate_transforms().
+void enqueue_hierarchy_update(uint32_t entity_index);
+
+/// Matrices are read concurrently (transform sync, culling, pass recording) while setters
+/// and hierarchy propagation run on other threads, so they sit behind a seqlock: writers
+/// bump sequence_ to odd, update and recompute the matrices eagerly, then bump it to even;
+/// readers copy a matrix and retry if the sequence moved. Getters never write.
 class TransformComponent {
 public:
     void set_position(const float3& position) {
+        begin_write();
         position_ = position;
-        transform_.set_position(position);
-        transform_dirty_ = true;
-        ++transform_version_;
+        update_local_matrix();
+        end_write();
+        mark_changed();
     }
 
     void set_rotation(const quaternion& rotation) {
+        begin_write();
         rotation_ = rotation;
-        transform_dirty_ = true;
-        ++transform_version_;
+        update_local_matrix();
+        end_write();
+        mark_changed();
     }
 
     void set_scale(const float3& scale) {
+        begin_write();
         scale_ = scale;
-        transform_dirty_ = true;
-        ++transform_version_;
+        update_local_matrix();
+        end_write();
+        mark_changed();
+    }
+
+    /// Called by the ECS when the component is (re)assigned to a slot.
+    void bind_entity(uint32_t entity_index) noexcept {
+        entity_index_ = entity_index;
+        sync_queued_.value.store(false, std::memory_order_relaxed);
+        hierarchy_queued_ = false;
+    }
+    [[nodiscard]] uint32_t entity_index() const noexcept { return entity_index_; }
+
+    /// Cleared by the GPU sync (on a worker) before it reads the matrix, so later changes
+    /// queue again. The acquire half pairs with the claim of a setter whose change was
+    /// folded into the current entry, so the matrix read afterwards sees it.
+    void clear_sync_queued() noexcept { sync_queued_.value.exchange(false, std::memory_order_acq_rel); }
+
+    /// Claims the sync queue entry; the caller that gets true must queue the entity. Any
+    /// thread. Returns false when the entity is already queued or unbound.
+    [[nodiscard]] bool try_claim_sync_queue() noexcept {
+        if (entity_index_ == InvalidUI32) {
+            return false;
+        }
+        return !sync_queued_.value.exchange(true, std::memory_order_acq_rel);
+    }
+
+    /// Set by the ECS while the entity has a parent or children. Leaving the hierarchy
+    /// drops the propagated world matrix, so the local TRS becomes the world transform.
+    void set_hierarchy_node(bool hierarchy_node) {
+        if (hierarchy_node_ == hierarchy_node) {
+            return;
+        }
+        hierarchy_node_ = hierarchy_node;
+        hierarchy_queued_ = false;
+        if (!hierarchy_node_ && hierarchy_world_valid_) {
+            begin_write();
+            hierarchy_world_valid_ = false;
+            end_write();
+            mark_changed();
+        }
+    }
+    [[nodiscard]] bool hierarchy_node() const noexcept { return hierarchy_node_; }
+    void clear_hierarchy_queued() noexcept { hierarchy_queued_ = false; }
+
+    /// Written by TransformHierarchy propagation: parent world * local.
+    void set_hierarchy_world_matrix(const float4x4& world_matrix) noexcept {
+        begin_write();
+        hierarchy_world_matrix_ = world_matrix;
+        hierarchy_world_valid_ = true;
+        end_write();
     }
 
     [[nodiscard]] const float3& get_position() const noexcept { return position_; }
     [[nodiscard]] const quaternion& get_rotation() const noexcept { return rotation_; }
     [[nodiscard]] const float3& get_scale() const noexcept { return scale_; }
 
-    [[nodiscard]] const float4x4& get_world_matrix() const {
-        if (transform_dirty_) {
-            transform_.set_TRS(position_, rotation_, scale_);
-            transform_dirty_ = false;
-            world_matrix_ = transform_.mat4x4();
-        }
-        return world_matrix_;
+    /// Matrix built from the component's own position / rotation / scale. Any thread.
+    [[nodiscard]] float4x4 get_local_matrix() const noexcept {
+        return read_consistent([this] { return local_matrix_; });
+    }
+
+    /// Local matrix for flat entities; the last propagated matrix for hierarchy nodes.
+    /// Any thread.
+    [[nodiscard]] float4x4 get_world_matrix() const noexcept {
+        return read_consistent([this] {
+            return hierarchy_world_valid_ ? hierarchy_world_matrix_ : local_matrix_;
+        });
     }
 
+    /// Not guarded by the seqlock; for the thread that owns the component's setters.
     [[nodiscard]] const Transform<float4x4>& get_transform() const noexcept {
         return transform_;
     }
 
+    /// Bumped by every completed write; a write in progress still reports the old version,
+    /// so a reader that pairs it with a newer matrix only refreshes once more.
     [[nodiscard]] uint32_t transform_version() const noexcept {
-        return transform_version_;
+        return sequence_.value.load(std::memory_order_acquire) >> 1;
     }
 
 private:
-    mutable float4x4 world_matrix_{};
+    void update_local_matrix() noexcept {
+        transform_.set_TRS(position_, rotation_, scale_);
+        local_matrix_ = transform_.mat4x4();
+    }
+
+    /// Writers may race (a setter and hierarchy propagation on one entity), so the odd
+    /// sequence is claimed with a CAS and doubles as a write lock.
+    void begin_write() noexcept {
+        uint32_t sequence = sequence_.value.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((sequence & 1u) != 0u) {
+                std::this_thread::yield();
+                sequence = sequence_.value.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (sequence_.value.compare_exchange_weak(sequence, sequence + 1u, std::memory_order_acquire, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        // Keeps the data writes after the odd sequence for readers.
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write() noexcept { sequence_.value.fetch_add(1u, std::memory_order_release); }
+
+    template<typename Read>
+    [[nodiscard]] float4x4 read_consistent(Read&& read) const noexcept {
+        for (;;) {
+            const uint32_t begin = sequence_.value.load(std::memory_order_acquire);
+            if ((begin & 1u) != 0u) {
+                std::this_thread::yield();
+                continue;
+            }
+            const float4x4 value = read();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.value.load(std::memory_order_relaxed) == begin) {
+                return value;
+            }
+        }
+    }
+
+    void mark_changed() {
+        // One queue entry per entity until the next sync consumes it.
+        if (try_claim_sync_queue()) {
+            enqueue_transform_sync(entity_index_);
+        }
+        // Children inherit the change on the next propagation.
+        if (hierarchy_node_ && !hierarchy_queued_ && entity_index_ != InvalidUI32) {
+            hierarchy_queued_ = true;
+            enqueue_hierarchy_update(entity_index_);
+        }
+    }
+
+    /// Identity TRS, matching the defaults below.
+    float4x4 local_matrix_{1};
+    float4x4 hierarchy_world_matrix_{};
     float3 position_{};
     quaternion rotation_{0.0f, 0.0f, 0.0f, 1.0f};
     float3 scale_{1.0f, 1.0f, 1.0f};
-    mutable bool transform_dirty_ = true;
-    uint32_t transform_version_ = 0;
-    mutable Transform<float4x4> transform_{};
+    uint32_t entity_index_ = InvalidUI32;
+    /// Seqlock sequence: odd while a write is in progress, version = sequence / 2. Copies
+    /// (under the ECS exclusive lock) drop a stray write bit so readers never spin forever.
+    struct WriteSequence {
+        std::atomic<uint32_t> value{0};
+        WriteSequence() = default;
+        WriteSequence(const WriteSequence& other) noexcept : value(other.value.load(std::memory_order_relaxed) & ~1u) {}
+        WriteSequence& operator=(const WriteSequence& other) noexcept {
+            value.store(other.value.load(std::memory_order_relaxed) & ~1u, std::memory_order_relaxed);
+            return *this;
+        }
+    };
+    WriteSequence sequence_;
+    /// Set by setters (main or loader thread), cleared by sync workers. Copies take the
+    /// value so components stay assignable inside the ECS arrays.
+    struct SyncQueuedFlag {
+        std::atomic<bool> value{false};
+        SyncQueuedFlag() = default;
+        SyncQueuedFlag(const SyncQueuedFlag& other) noexcept : value(other.value.load(std::memory_order_relaxed)) {}
+        SyncQueuedFlag& operator=(const SyncQueuedFlag& other) noexcept {
+            value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+    SyncQueuedFlag sync_queued_;
+    bool hierarchy_node_ = false;
+    bool hierarchy_queued_ = false;
+    bool hierarchy_world_valid_ = false;
+    Transform<float4x4> transform_{};
 };
 
 }// namespace ocarina
@@ -0,0 +1,328 @@
+#include "transform_hierarchy.h"
+#include "core/profiler.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+#include <algorithm>
+#include <immintrin.h>
+
+namespace ocarina {
+
+namespace {
+
+static_assert(sizeof(float4x4) == 16 * sizeof(float));
+
+/// out = lhs * rhs for column-major 4x4 matrices: each output column is a linear
+/// combination of lhs columns weighted by one rhs column.
+inline void multiply_float4x4_sse(const float4x4& lhs, const float4x4& rhs, float4x4& out) noexcept {
+    const float* a = reinterpret_cast<const float*>(&lhs);
+    const float* b = reinterpret_cast<const float*>(&rhs);
+    float* result = reinterpret_cast<float*>(&out);
+
+    const __m128 a0 = _mm_loadu_ps(a + 0);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int column = 0; column < 4; ++column) {
+        const float* b_column = b + column * 4;
+        __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(b_column[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(b_column[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b_column[2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b_column[3])));
+        _mm_storeu_ps(result + column * 4, sum);
+    }
+}
+
+class HierarchyLevelTask : public enki::ITaskSet {
+public:
+    using RangeFunction = ocarina::function<void(uint32_t, uint32_t)>;
+
+    HierarchyLevelTask(uint32_t begin, uint32_t end, RangeFunction function)
+        : begin_(begin), function_(std::move(function)) {
+        m_SetSize = end - begin;
+        m_MinRange = TransformHierarchy::kPropagateBatchSize;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)threadnum;
+        function_(begin_ + range.start, begin_ + range.end);
+    }
+
+private:
+    uint32_t begin_ = 0;
+    RangeFunction function_;
+};
+
+}// namespace
+
+void TransformHierarchy::ensure_entity(uint32_t entity) {
+    if (entity >= links_.size()) {
+        links_.resize(entity + 1);
+    }
+}
+
+void TransformHierarchy::unlink_from_parent(uint32_t entity) {
+    Links& links = links_[entity];
+    if (links.parent == InvalidUI32) {
+        return;
+    }
+    if (links.prev_sibling != InvalidUI32) {
+        links_[links.prev_sibling].next_sibling = links.next_sibling;
+    } else {
+        links_[links.parent].first_child = links.next_sibling;
+    }
+    if (links.next_sibling != InvalidUI32) {
+        links_[links.next_sibling].prev_sibling = links.prev_sibling;
+    }
+    links.parent = InvalidUI32;
+    links.next_sibling = InvalidUI32;
+    links.prev_sibling = InvalidUI32;
+}
+
+bool TransformHierarchy::set_parent(uint32_t child, uint32_t parent, std::vector<uint32_t>& touched) {
+    if (child == InvalidUI32 || child == parent) {
+        return false;
+    }
+    ensure_entity(child);
+    if (parent != InvalidUI32) {
+        ensure_entity(parent);
+        // Reject cycles: the new parent must not be a descendant of the child.
+        for (uint32_t ancestor = parent; ancestor != InvalidUI32; ancestor = links_[ancestor].parent) {
+            if (ancestor == child) {
+                return false;
+            }
+        }
+    }
+
+    const uint32_t old_parent = links_[child].parent;
+    if (old_parent == parent) {
+        return true;
+    }
+
+    unlink_from_parent(child);
+    if (parent != InvalidUI32) {
+        Links& parent_links = links_[parent];
+        Links& child_links = links_[child];
+        child_links.parent = parent;
+        child_links.next_sibling = parent_links.first_child;
+        if (parent_links.first_child != InvalidUI32) {
+            links_[parent_links.first_child].prev_sibling = child;
+        }
+        parent_links.first_child = child;
+        touched.push_back(parent);
+    }
+    if (old_parent != InvalidUI32) {
+        touched.push_back(old_parent);
+    }
+    touched.push_back(child);
+    layout_dirty_ = true;
+    return true;
+}
+
+void TransformHierarchy::remove_entity(uint32_t entity, std::vector<uint32_t>& touched) {
+    if (!contains(entity)) {
+        return;
+    }
+    const uint32_t old_parent = links_[entity].parent;
+    unlink_from_parent(entity);
+    if (old_parent != InvalidUI32) {
+        touched.push_back(old_parent);
+    }
+
+    uint32_t child = links_[entity].first_child;
+    while (child != InvalidUI32) {
+        Links& child_links = links_[child];
+        const uint32_t next = child_links.next_sibling;
+        child_links.parent = InvalidUI32;
+        child_links.next_sibling = InvalidUI32;
+        child_links.prev_sibling = InvalidUI32;
+        touched.push_back(child);
+        child = next;
+    }
+    links_[entity].first_child = InvalidUI32;
+    touched.push_back(entity);
+    layout_dirty_ = true;
+}
+
+void TransformHierarchy::move_entity(uint32_t from, uint32_t to) {
+    if (!contains(from)) {
+        return;
+    }
+    ensure_entity(to);
+    const Links links = links_[from];
+    links_[to] = links;
+    links_[from] = Links{};
+
+    if (links.prev_sibling != InvalidUI32) {
+        links_[links.prev_sibling].next_sibling = to;
+    } else if (links.parent != InvalidUI32) {
+        links_[links.parent].first_child = to;
+    }
+    if (links.next_sibling != InvalidUI32) {
+        links_[links.next_sibling].prev_sibling = to;
+    }
+    for (uint32_t child = links.first_child; child != InvalidUI32; child = links_[child].next_sibling) {
+        links_[child].parent = to;
+    }
+    layout_dirty_ = true;
+}
+
+void TransformHierarchy::mark_dirty(uint32_t entity) {
+    if (layout_dirty_ || entity >= entity_node_.size()) {
+        return;
+    }
+    const uint32_t node = entity_node_[entity];
+    if (node != InvalidUI32 && !node_dirty_[node]) {
+        node_dirty_[node] = 1;
+        dirty_roots_.push_back(node);
+    }
+}
+
+void TransformHierarchy::rebuild_levels() {
+    OC_PROFILE_FUNCTION;
+    node_entity_.clear();
+    node_parent_.clear();
+    node_child_offsets_.clear();
+    level_offsets_.clear();
+    entity_node_.assign(links_.size(), InvalidUI32);
+
+    // Breadth-first from the roots: each level is appended after the previous one, and
+    // siblings end up adjacent so a batch mostly reads the same few parent matrices.
+    for (uint32_t entity = 0; entity < links_.size(); ++entity) {
+        const Links& links = links_[entity];
+        if (links.parent == InvalidUI32 && links.first_child != InvalidUI32) {
+            entity_node_[entity] = static_cast<uint32_t>(node_entity_.size());
+            node_entity_.push_back(entity);
+            node_parent_.push_back(InvalidUI32);
+        }
+    }
+
+    uint32_t level_begin = 0;
+    while (level_begin < node_entity_.size()) {
+        level_offsets_.push_back(level_begin);
+        const uint32_t level_end = static_cast<uint32_t>(node_entity_.size());
+        for (uint32_t node = level_begin; node < level_end; ++node) {
+            node_child_offsets_.push_back(static_cast<uint32_t>(node_entity_.size()));
+            for (uint32_t child = links_[node_entity_[node]].first_child; child != InvalidUI32;
+                 child = links_[child].next_sibling) {
+                entity_node_[child] = static_cast<uint32_t>(node_entity_.size());
+                node_entity_.push_back(child);
+                node_parent_.push_back(node);
+            }
+        }
+        level_begin = level_end;
+    }
+    level_offsets_.push_back(static_cast<uint32_t>(node_entity_.size()));
+    node_child_offsets_.push_back(static_cast<uint32_t>(node_entity_.size()));
+
+    // Every node moved, so recompute the whole forest from its roots.
+    node_world_.resize(node_entity_.size());
+    node_dirty_.assign(node_entity_.size(), 0);
+    dirty_roots_.clear();
+    const uint32_t root_count = level_offsets_.size() > 1 ? level_offsets_[1] : 0u;
+    for (uint32_t node = 0; node < root_count; ++node) {
+        node_dirty_[node] = 1;
+        dirty_roots_.push_back(node);
+    }
+    layout_dirty_ = false;
+}
+
+void TransformHierarchy::propagate_range(std::vector<TransformComponent>& transforms, uint32_t begin, uint32_t end) {
+    for (uint32_t index = begin; index < end; ++index) {
+        const uint32_t node = level_nodes_[index];
+        const uint32_t parent = node_parent_[node];
+        TransformComponent& transform = transforms[node_entity_[node]];
+        const float4x4 local_matrix = transform.get_local_matrix();
+        if (parent == InvalidUI32) {
+            node_world_[node] = local_matrix;
+        } else {
+            // Parents live in an earlier, already finished level.
+            multiply_float4x4_sse(node_world_[parent], local_matrix, node_world_[node]);
+        }
+        transform.set_hierarchy_world_matrix(node_world_[node]);
+    }
+}
+
+void TransformHierarchy::propagate(std::vector<TransformComponent>& transforms,
+                                   enki::TaskScheduler* scheduler,
+                                   std::vector<uint32_t>& changed,
+                                   std::shared_mutex* guard) {
+    OC_PROFILE_FUNCTION;
+    std::shared_lock<std::shared_mutex> lock;
+    if (guard != nullptr) {
+        lock = std::shared_lock<std::shared_mutex>(*guard);
+    }
+    if (layout_dirty_) {
+        rebuild_levels();
+    }
+    if (dirty_roots_.empty()) {
+        return;
+    }
+
+    // Node indices are level-major, so sorted roots are consumed level by level.
+    std::sort(dirty_roots_.begin(), dirty_roots_.end());
+    size_t next_root = 0;
+    level_nodes_.clear();
+    for (uint32_t level = 0; level + 1 < level_offsets_.size(); ++level) {
+        const uint32_t level_end = level_offsets_[level + 1];
+        // Children expanded from the previous level are sorted too; merge in this level's roots.
+        const size_t expanded_count = level_nodes_.size();
+        while (next_root < dirty_roots_.size() && dirty_roots_[next_root] < level_end) {
+            level_nodes_.push_back(dirty_roots_[next_root++]);
+        }
+        if (level_nodes_.empty()) {
+            continue;
+        }
+        if (expanded_count != 0 && expanded_count != level_nodes_.size()) {
+            std::inplace_merge(level_nodes_.begin(), level_nodes_.begin() + expanded_count, level_nodes_.end());
+        }
+
+        const uint32_t count = static_cast<uint32_t>(level_nodes_.size());
+        if (scheduler == nullptr || count <= kPropagateBatchSize) {
+            propagate_range(transforms, 0, count);
+        } else {
+            HierarchyLevelTask task(0, count, [this, &transforms, guard](uint32_t range_begin, uint32_t range_end) {
+                std::shared_lock<std::shared_mutex> range_lock;
+                if (guard != nullptr) {
+                    range_lock = std::shared_lock<std::shared_mutex>(*guard);
+                }
+                if (!layout_dirty_) {
+                    propagate_range(transforms, range_begin, range_end);
+                }
+            });
+            // Workers take the guard themselves; holding it here while this thread runs
+            // other tasks inside WaitforTask could stall behind a queued writer.
+            if (lock.owns_lock()) {
+                lock.unlock();
+            }
+            scheduler->AddTaskSetToPipe(&task);
+            scheduler->WaitforTask(&task);
+            if (guard != nullptr) {
+                lock.lock();
+            }
+        }
+        if (layout_dirty_) {
+            // Node arrays are stale; rebuild_levels() marks everything on the next call.
+            level_nodes_.clear();
+            return;
+        }
+
+        next_level_nodes_.clear();
+        for (uint32_t node : level_nodes_) {
+            node_dirty_[node] = 0;
+            changed.push_back(node_entity_[node]);
+            for (uint32_t child = node_child_offsets_[node]; child < node_child_offsets_[node + 1]; ++child) {
+                // Already-queued roots are picked up from dirty_roots_ at their own level.
+                if (!node_dirty_[child]) {
+                    node_dirty_[child] = 1;
+                    next_level_nodes_.push_back(child);
+                }
+            }
+        }
+        level_nodes_.swap(next_level_nodes_);
+        if (level_nodes_.empty() && next_root == dirty_roots_.size()) {
+            break;
+        }
+    }
+    dirty_roots_.clear();
+}
+
+}// namespace ocarina
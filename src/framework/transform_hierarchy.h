@@ -0,0 +1,116 @@
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "math/basic_types.h"
+#include "transform_component.h"
+#include <shared_mutex>
+
+namespace enki { class TaskScheduler; }
+
+namespace ocarina {
+
+/// Parent/child links between ECS entities plus a depth-sorted node array used to
+/// propagate local-to-world matrices. Only entities that have a parent or children are
+/// nodes; everything else keeps using its local TRS as world transform.
+///
+/// Nodes are stored breadth-first (all depth-0 nodes, then depth-1, ...), so a node's
+/// parent is always in an earlier level and a node's children are contiguous. propagate()
+/// starts from the queued dirty nodes and expands their children one level at a time, so a
+/// pass costs the size of the dirty subtrees rather than the whole hierarchy; each level's
+/// list is split into batches across the task scheduler. Not thread-safe;
+/// EntityComponentSystem serializes access.
+class TransformHierarchy {
+public:
+    /// Nodes per task range when a level is split across workers.
+    static constexpr uint32_t kPropagateBatchSize = 512;
+
+    /// Links @p child under @p parent (InvalidUI32 detaches). Fails if the link would
+    /// create a cycle. Entities whose node membership changed are appended to @p touched.
+    bool set_parent(uint32_t child, uint32_t parent, std::vector<uint32_t>& touched);
+
+    /// Drops @p entity from the hierarchy; its children become roots. Entities whose
+    /// membership changed (including @p entity) are appended to @p touched.
+    void remove_entity(uint32_t entity, std::vector<uint32_t>& touched);
+
+    /// Relinks a live entity that EntityComponentSystem::compact() moved to a new slot.
+    void move_entity(uint32_t from, uint32_t to);
+
+    [[nodiscard]] uint32_t parent(uint32_t entity) const noexcept {
+        return entity < links_.size() ? links_[entity].parent : InvalidUI32;
+    }
+    [[nodiscard]] uint32_t first_child(uint32_t entity) const noexcept {
+        return entity < links_.size() ? links_[entity].first_child : InvalidUI32;
+    }
+    [[nodiscard]] uint32_t next_sibling(uint32_t entity) const noexcept {
+        return entity < links_.size() ? links_[entity].next_sibling : InvalidUI32;
+    }
+    [[nodiscard]] bool contains(uint32_t entity) const noexcept {
+        return entity < links_.size() && links_[entity].member();
+    }
+
+    /// Marks the subtree rooted at @p entity for recomputation (no-op for non-nodes).
+    void mark_dirty(uint32_t entity);
+
+    /// Recomputes world matrices of dirty subtrees, level by level, writing them into
+    /// @p transforms (indexed by entity) and appending every updated entity to @p changed.
+    /// Levels smaller than kPropagateBatchSize, or all levels when @p scheduler is null,
+    /// run on the calling thread.
+    ///
+    /// With @p guard set, the calling thread and every task range hold it shared while they
+    /// touch nodes or @p transforms, and the calling thread releases it while waiting on
+    /// workers. A structural change that lands in that window ends the pass early; the
+    /// layout rebuild on the next call recomputes every node.
+    void propagate(std::vector<TransformComponent>& transforms,
+                   enki::TaskScheduler* scheduler,
+                   std::vector<uint32_t>& changed,
+                   std::shared_mutex* guard = nullptr);
+
+    [[nodiscard]] uint32_t node_count() const noexcept { return static_cast<uint32_t>(node_entity_.size()); }
+    [[nodiscard]] uint32_t level_count() const noexcept {
+        return level_offsets_.empty() ? 0u : static_cast<uint32_t>(level_offsets_.size() - 1);
+    }
+
+private:
+    struct Links {
+        uint32_t parent = InvalidUI32;
+        uint32_t first_child = InvalidUI32;
+        uint32_t next_sibling = InvalidUI32;
+        uint32_t prev_sibling = InvalidUI32;
+
+        [[nodiscard]] bool member() const noexcept {
+            return parent != InvalidUI32 || first_child != InvalidUI32;
+        }
+    };
+
+    void ensure_entity(uint32_t entity);
+    void unlink_from_parent(uint32_t entity);
+    void rebuild_levels();
+    /// Recomputes level_nodes_[begin, end); their parents are already up to date.
+    void propagate_range(std::vector<TransformComponent>& transforms, uint32_t begin, uint32_t end);
+
+    /// Entity-indexed links (intrusive doubly linked sibling lists).
+    std::vector<Links> links_;
+
+    // Depth-sorted node arrays, rebuilt when links change.
+    std::vector<uint32_t> node_entity_;
+    /// Node position of the parent, InvalidUI32 for roots.
+    std::vector<uint32_t> node_parent_;
+    std::vector<float4x4> node_world_;
+    /// Children of node N span [node_child_offsets_[N], node_child_offsets_[N + 1]).
+    std::vector<uint32_t> node_child_offsets_;
+    /// Set while a node is queued in dirty_roots_ or in the level being expanded.
+    std::vector<uint8_t> node_dirty_;
+    /// Entity -> node position (InvalidUI32 for non-nodes).
+    std::vector<uint32_t> entity_node_;
+    /// Level L spans [level_offsets_[L], level_offsets_[L + 1]).
+    std::vector<uint32_t> level_offsets_;
+    /// Nodes passed to mark_dirty() since the last propagate(); their subtrees are recomputed.
+    std::vector<uint32_t> dirty_roots_;
+    // Scratch for propagate(): nodes of the current level and of the next one.
+    std::vector<uint32_t> level_nodes_;
+    std::vector<uint32_t> next_level_nodes_;
+    bool layout_dirty_ = false;
+};
+
+}// namespace ocarina
@@ -0,0 +1,442 @@
+#include "capture_device.h"
+#include "index_buffer.h"
+#include "renderpass.h"
+#include "vertex_buffer.h"
+#include "resources/buffer.h"
+#include "core/logging.h"
+
+namespace ocarina {
+
+namespace {
+
+[[nodiscard]] CapturedResource describe(CapturedResourceKind kind) noexcept {
+    CapturedResource resource;
+    resource.kind = kind;
+    return resource;
+}
+
+[[nodiscard]] CapturedResource describe_buffer(handle_ty handle) noexcept {
+    CapturedResource resource = describe(CapturedResourceKind::Buffer);
+    if (const Buffer *buffer = reinterpret_cast<const Buffer *>(handle)) {
+        resource.size = buffer->size_in_byte();
+    }
+    return resource;
+}
+
+void destroy_capture_device(Device::Impl *device) {
+    ocarina::delete_with_allocator(static_cast<CaptureDevice *>(device));
+}
+
+}// namespace
+
+void CaptureCommandBuffer::attach(const CommandBuffer &inner, bool recording) noexcept {
+    inner_ = inner;
+    recording_ = recording;
+    stream_.clear();
+}
+
+CommandBuffer CaptureCommandBuffer::unwrap() noexcept {
+    CommandBuffer::Impl *inner_impl = inner_.impl();
+    inner_impl->wait_semaphores = wait_semaphores;
+    inner_impl->signal_semaphores = signal_semaphores;
+    return inner_;
+}
+
+void CaptureCommandBuffer::begin() {
+    recording_ = device_->capturing();
+    stream_.clear();
+    if (recording_) {
+        stream_.write(CapturedCommand::Begin);
+    }
+    inner_.begin();
+}
+
+void CaptureCommandBuffer::end() {
+    if (recording_) {
+        stream_.write(CapturedCommand::End);
+    }
+    inner_.end();
+}
+
+void CaptureCommandBuffer::begin_render_pass(RHIRenderPass *render_pass, RenderPassContents contents) {
+    if (recording_) {
+        CapturedResource resource = describe(CapturedResourceKind::RenderPass);
+        if (render_pass) {
+            resource.width = render_pass->size().x;
+            resource.height = render_pass->size().y;
+        }
+        stream_.write_command(CapturedCommand::BeginRenderPass,
+                              CapturedBeginRenderPass{device_->resource_id(render_pass, resource), contents});
+    }
+    inner_.begin_render_pass(render_pass, contents);
+}
+
+void CaptureCommandBuffer::end_render_pass() {
+    if (recording_) {
+        stream_.write(CapturedCommand::EndRenderPass);
+    }
+    inner_.end_render_pass();
+}
+
+void CaptureCommandBuffer::bind_pipeline(const RHIPipeline *pipeline) {
+    if (recording_) {
+        CapturedResource resource = describe(CapturedResourceKind::Pipeline);
+        resource.size = pipeline ? pipeline->push_constant_size : 0;
+        stream_.write_command(CapturedCommand::BindPipeline, device_->resource_id(pipeline, resource));
+    }
+    inner_.bind_pipeline(pipeline);
+}
+
+void CaptureCommandBuffer::bind_descriptor_sets(DescriptorSet **descriptor_sets, uint32_t first_set, uint32_t descriptor_set_count, handle_ty pipeline_layout) {
+    if (recording_) {
+        const uint32_t layout_id = device_->resource_id(reinterpret_cast<const void *>(pipeline_layout),
+                                                        describe(CapturedResourceKind::PipelineLayout));
+        stream_.write_command(CapturedCommand::BindDescriptorSets,
+                              CapturedBindDescriptorSets{first_set, descriptor_set_count, layout_id});
+        for (uint32_t i = 0; i < descriptor_set_count; ++i) {
+            stream_.write(device_->resource_id(descriptor_sets[i], describe(CapturedResourceKind::DescriptorSet)));
+        }
+    }
+    inner_.bind_descriptor_sets(descriptor_sets, first_set, descriptor_set_count, pipeline_layout);
+}
+
+void CaptureCommandBuffer::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) {
+    if (recording_) {
+        stream_.write_command(CapturedCommand::DrawIndexed,
+                              CapturedDrawIndexed{index_count, instance_count, first_index, vertex_offset, first_instance});
+    }
+    inner_.draw_indexed(index_count, instance_count, first_index, vertex_offset, first_instance);
+}
+
+void CaptureCommandBuffer::push_constants(const void *data, uint32_t offset, uint32_t size) {
+    if (recording_) {
+        stream_.write_command(CapturedCommand::PushConstants, CapturedPushConstants{offset, size});
+        stream_.write_bytes(data, size);
+    }
+    inner_.push_constants(data, offset, size);
+}
+
+void CaptureCommandBuffer::draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) {
+    if (recording_) {
+        const uint32_t buffer_id = device_->resource_id(reinterpret_cast<const void *>(indirect_buffer), describe_buffer(indirect_buffer));
+        stream_.write_command(CapturedCommand::DrawIndirect, CapturedIndirectDraw{buffer_id, draw_count, stride, offset});
+    }
+    inner_.draw_indirect(indirect_buffer, offset, draw_count, stride);
+}
+
+void CaptureCommandBuffer::draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) {
+    if (recording_) {
+        const uint32_t buffer_id = device_->resource_id(reinterpret_cast<const void *>(indirect_buffer), describe_buffer(indirect_buffer));
+        stream_.write_command(CapturedCommand::DrawIndexedIndirect, CapturedIndirectDraw{buffer_id, draw_count, stride, offset});
+    }
+    inner_.draw_indexed_indirect(indirect_buffer, offset, draw_count, stride);
+}
+
+void CaptureCommandBuffer::draw_indexed_indirect_count(
+    handle_ty indirect_buffer,
+    size_t offset,
+    handle_ty count_buffer,
+    size_t count_offset,
+    uint32_t max_draw_count,
+    uint32_t stride) {
+    if (recording_) {
+        CapturedIndirectDrawCount payload;
+        payload.buffer = device_->resource_id(reinterpret_cast<const void *>(indirect_buffer), describe_buffer(indirect_buffer));
+        payload.count_buffer = device_->resource_id(reinterpret_cast<const void *>(count_buffer), describe_buffer(count_buffer));
+        payload.max_draw_count = max_draw_count;
+        payload.stride = stride;
+        payload.offset = offset;
+        payload.count_offset = count_offset;
+        stream_.write_command(CapturedCommand::DrawIndexedIndirectCount, payload);
+    }
+    inner_.draw_indexed_indirect_count(indirect_buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+}
+
+void CaptureCommandBuffer::set_vertex_buffer(VertexBuffer *vertex_buffer, uint32_t base_vertex) {
+    if (recording_) {
+        CapturedResource resource = describe(CapturedResourceKind::VertexBuffer);
+        resource.size = vertex_buffer ? vertex_buffer->vertex_count() : 0;
+        stream_.write_command(CapturedCommand::SetVertexBuffer,
+                              CapturedBindBuffer{device_->resource_id(vertex_buffer, resource), base_vertex});
+    }
+    inner_.set_vertex_buffer(vertex_buffer, base_vertex);
+}
+
+void CaptureCommandBuffer::set_index_buffer(IndexBuffer *index_buffer, uint32_t first_index) {
+    if (recording_) {
+        CapturedResource resource = describe(CapturedResourceKind::IndexBuffer);
+        if (index_buffer) {
+            resource.size = index_buffer->buffer() ? index_buffer->buffer()->size_in_byte() : 0;
+            resource.bit16 = index_buffer->is_16_bit();
+        }
+        stream_.write_command(CapturedCommand::SetIndexBuffer,
+                              CapturedBindBuffer{device_->resource_id(index_buffer, resource), first_index});
+    }
+    inner_.set_index_buffer(index_buffer, first_index);
+}
+
+void CaptureCommandBuffer::copy_buffer(
+    handle_ty src,
+    handle_ty dst,
+    size_t src_offset,
+    size_t dst_offset,
+    size_t size_in_byte) {
+    if (recording_) {
+        CapturedCopyBuffer payload;
+        payload.src = device_->resource_id(reinterpret_cast<const void *>(src), describe_buffer(src));
+        payload.dst = device_->resource_id(reinterpret_cast<const void *>(dst), describe_buffer(dst));
+        payload.src_offset = src_offset;
+        payload.dst_offset = dst_offset;
+        payload.size = size_in_byte;
+        stream_.write_command(CapturedCommand::CopyBuffer, payload);
+    }
+    inner_.copy_buffer(src, dst, src_offset, dst_offset, size_in_byte);
+}
+
+void CaptureCommandBuffer::transition_texture_layout(
+    handle_ty texture,
+    TextureLayout old_layout,
+    TextureLayout new_layout) {
+    if (recording_) {
+        const uint32_t texture_id = device_->resource_id(reinterpret_cast<const void *>(texture), describe(CapturedResourceKind::Texture));
+        stream_.write_command(CapturedCommand::TransitionTextureLayout,
+                              CapturedTextureTransition{texture_id, old_layout, new_layout});
+    }
+    inner_.transition_texture_layout(texture, old_layout, new_layout);
+}
+
+void CaptureCommandBuffer::copy_buffer_to_texture(
+    handle_ty src_buffer,
+    handle_ty dst_texture,
+    const BufferTextureCopy *regions,
+    uint32_t region_count) {
+    if (recording_) {
+        CapturedCopyBufferToTexture payload;
+        payload.src_buffer = device_->resource_id(reinterpret_cast<const void *>(src_buffer), describe_buffer(src_buffer));
+        payload.dst_texture = device_->resource_id(reinterpret_cast<const void *>(dst_texture), describe(CapturedResourceKind::Texture));
+        payload.region_count = region_count;
+        stream_.write_command(CapturedCommand::CopyBufferToTexture, payload);
+        stream_.write_bytes(regions, sizeof(BufferTextureCopy) * region_count);
+    }
+    inner_.copy_buffer_to_texture(src_buffer, dst_texture, regions, region_count);
+}
+
+void CaptureCommandBuffer::set_viewport(float x, float y, float width, float height, float min_depth, float max_depth) {
+    if (recording_) {
+        stream_.write_command(CapturedCommand::SetViewport, CapturedViewport{x, y, width, height, min_depth, max_depth});
+    }
+    inner_.set_viewport(x, y, width, height, min_depth, max_depth);
+}
+
+void CaptureCommandBuffer::set_scissor(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (recording_) {
+        stream_.write_command(CapturedCommand::SetScissor, CapturedScissor{x, y, width, height});
+    }
+    inner_.set_scissor(x, y, width, height);
+}
+
+void CaptureCommandBuffer::execute_secondary_command_buffers(const CommandBuffer *secondaries, uint32_t count) {
+    std::vector<CommandBuffer> inner_secondaries;
+    inner_secondaries.reserve(count);
+    if (recording_) {
+        stream_.write_command(CapturedCommand::ExecuteSecondaries, count);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        auto *secondary = static_cast<CaptureCommandBuffer *>(secondaries[i].impl());
+        if (recording_) {
+            // Secondaries acquired before the window opened recorded nothing: replay them empty.
+            const std::vector<std::byte> commands = secondary->take_commands();
+            stream_.write(static_cast<uint32_t>(commands.size()));
+            stream_.write_bytes(commands.data(), commands.size());
+        }
+        inner_secondaries.push_back(secondary->unwrap());
+    }
+    inner_.execute_secondary_command_buffers(inner_secondaries.data(), count);
+}
+
+void CaptureCommandBuffer::submit_to_queue(QueueType queue_type, Fence *fence) {
+    if (recording_) {
+        CapturedSubmission submission;
+        submission.queue = queue_type;
+        submission.fence = fence != nullptr;
+        submission.command_buffers.push_back(CapturedCommandBuffer{take_commands()});
+        device_->record_submission(std::move(submission));
+    }
+    CommandBuffer inner = unwrap();
+    inner.submit_to_queue(queue_type, fence);
+}
+
+CaptureDevice::CaptureDevice(Device inner, CaptureCreation creation)
+    : Device::Impl(inner.context()),
+      inner_(std::move(inner)),
+      creation_(std::move(creation)) {
+    inner_impl_ = inner_.impl();
+    OC_INFO_FORMAT("capturing {} frames after frame {} to {}",
+                   creation_.frame_count, creation_.first_frame, creation_.path.string());
+}
+
+CaptureDevice::~CaptureDevice() {
+    if (!finished_ && !capture_.frames.empty()) {
+        save_capture();
+    }
+}
+
+bool CaptureDevice::begin_frame() noexcept {
+    if (!finished_ && !capturing() && frames_ended_ >= creation_.first_frame) {
+        capturing_.store(true, std::memory_order_release);
+    }
+    return inner()->begin_frame();
+}
+
+void CaptureDevice::end_frame() noexcept {
+    inner()->end_frame();
+    ++frames_ended_;
+    if (!capturing()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(capture_mutex_);
+    capture_.frames.push_back(std::move(current_frame_));
+    current_frame_ = {};
+    if (capture_.frames.size() >= creation_.frame_count) {
+        capturing_.store(false, std::memory_order_release);
+        finished_ = true;
+        save_capture();
+    }
+}
+
+void CaptureDevice::bind_pipeline(const CommandBuffer &cmd_buffer, const handle_ty pipeline) noexcept {
+    if (!cmd_buffer.valid()) {
+        inner()->bind_pipeline(cmd_buffer, pipeline);
+        return;
+    }
+    // Recorded like CommandBuffer::bind_pipeline(), then forwarded with the backend buffer.
+    auto *capture_cmd = static_cast<CaptureCommandBuffer *>(cmd_buffer.impl());
+    capture_cmd->bind_pipeline(reinterpret_cast<const RHIPipeline *>(pipeline));
+}
+
+CommandBuffer CaptureDevice::wrap(const CommandBuffer &inner, bool secondary) {
+    if (!inner.valid()) {
+        return inner;
+    }
+    CaptureCommandBuffer *wrapper = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(wrappers_mutex_);
+        std::unique_ptr<CaptureCommandBuffer> &slot = wrappers_[inner.impl()];
+        if (!slot) {
+            slot = std::make_unique<CaptureCommandBuffer>(this);
+        }
+        wrapper = slot.get();
+    }
+    // Primaries decide in begin(); secondaries arrive begun, so decide now.
+    wrapper->attach(inner, secondary && capturing());
+    CommandBuffer cmd_buffer(wrapper);
+    cmd_buffer.command_buffer = inner.command_buffer;
+    return cmd_buffer;
+}
+
+CommandBuffer CaptureDevice::get_command_buffer() {
+    return wrap(inner()->get_command_buffer(), false);
+}
+
+CommandBuffer CaptureDevice::get_command_buffer(QueueType queue_type) {
+    return wrap(inner()->get_command_buffer(queue_type), false);
+}
+
+void CaptureDevice::release_command_buffer(const CommandBuffer &cmd_buffer) {
+    if (!cmd_buffer.valid()) {
+        return;
+    }
+    cmd_buffer.reset();
+    auto *wrapper = static_cast<CaptureCommandBuffer *>(cmd_buffer.impl());
+    inner()->release_command_buffer(wrapper->unwrap());
+}
+
+CommandBuffer CaptureDevice::get_secondary_command_buffer(RHIRenderPass *render_pass, uint32_t thread_index) {
+    return wrap(inner()->get_secondary_command_buffer(render_pass, thread_index), true);
+}
+
+void CaptureDevice::execute_command_buffers(CommandBuffer *cmd_buffer, uint32_t count) noexcept {
+    std::array<CommandBuffer, MAX_COMMAND_BUFFERS_PER_SUBMIT> inner_cmd_buffers;
+    count = std::min<uint32_t>(count, MAX_COMMAND_BUFFERS_PER_SUBMIT);
+    CapturedSubmission submission;
+    submission.batch = true;
+    for (uint32_t i = 0; i < count; ++i) {
+        auto *wrapper = static_cast<CaptureCommandBuffer *>(cmd_buffer[i].impl());
+        if (wrapper->recording()) {
+            submission.command_buffers.push_back(CapturedCommandBuffer{wrapper->take_commands()});
+        }
+        inner_cmd_buffers[i] = wrapper->unwrap();
+    }
+    if (!submission.command_buffers.empty()) {
+        record_submission(std::move(submission));
+    }
+    inner()->execute_command_buffers(inner_cmd_buffers.data(), count);
+}
+
+void CaptureDevice::register_object(const void *object) {
+    if (object == nullptr) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(resource_mutex_);
+    object_identities_[object] = ++next_object_identity_;
+}
+
+void CaptureDevice::unregister_object(const void *object) {
+    if (object == nullptr) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(resource_mutex_);
+    object_identities_.erase(object);
+}
+
+uint32_t CaptureDevice::resource_id(const void *object, const CapturedResource &description) {
+    if (object == nullptr) {
+        return 0;
+    }
+    const uint64_t kind_bits = static_cast<uint64_t>(description.kind) << 56;
+    {
+        std::shared_lock<std::shared_mutex> lock(resource_mutex_);
+        const auto identity = object_identities_.find(object);
+        if (identity != object_identities_.end()) {
+            const auto it = resource_ids_.find(identity->second ^ kind_bits);
+            if (it != resource_ids_.end()) {
+                return it->second;
+            }
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(resource_mutex_);
+    auto [identity, identity_inserted] = object_identities_.try_emplace(object, 0);
+    if (identity_inserted) {
+        identity->second = ++next_object_identity_;
+    }
+    auto [it, inserted] = resource_ids_.try_emplace(identity->second ^ kind_bits, 0);
+    if (inserted) {
+        std::lock_guard<std::mutex> capture_lock(capture_mutex_);
+        capture_.resources.push_back(description);
+        it->second = static_cast<uint32_t>(capture_.resources.size());
+    }
+    return it->second;
+}
+
+void CaptureDevice::record_submission(CapturedSubmission &&submission) {
+    std::lock_guard<std::mutex> lock(capture_mutex_);
+    current_frame_.submissions.push_back(std::move(submission));
+}
+
+void CaptureDevice::save_capture() {
+    size_t submission_count = 0;
+    for (const CapturedFrame &frame : capture_.frames) {
+        submission_count += frame.submissions.size();
+    }
+    if (capture_.save(creation_.path)) {
+        OC_INFO_FORMAT("saved {} frames ({} submissions, {} resources) to {}",
+                       capture_.frames.size(), submission_count, capture_.resources.size(), creation_.path.string());
+    }
+}
+
+Device make_capture_device(Device device, const CaptureCreation &creation) {
+    auto *capture_device = ocarina::new_with_allocator<CaptureDevice>(std::move(device), creation);
+    return Device{Device::Handle{capture_device, &destroy_capture_device}};
+}
+
+}// namespace ocarina
@@ -0,0 +1,283 @@
+//
+// Capture layer: a Device::Impl that forwards to a real backend and writes the command
+// buffers it submits during a window of frames to a CommandCapture file.
+//
+
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "device.h"
+#include "command_capture.h"
+#include <shared_mutex>
+
+namespace ocarina {
+
+struct CaptureCreation {
+    fs::path path;
+    /// Frames ended before capturing starts.
+    uint32_t first_frame = 0;
+    uint32_t frame_count = 1;
+};
+
+class CaptureDevice;
+
+/// Wraps the backend's command buffer: records each call into its own stream (no
+/// locking while recording), then forwards it.
+class CaptureCommandBuffer : public CommandBuffer::Impl {
+public:
+    explicit CaptureCommandBuffer(CaptureDevice *device) : device_(device) {}
+
+    /// Points the wrapper at a freshly acquired backend buffer. Recording starts only if
+    /// the device is capturing now, so frames outside the window cost one branch per call.
+    void attach(const CommandBuffer &inner, bool recording) noexcept;
+    /// The backend buffer, carrying this wrapper's semaphores.
+    [[nodiscard]] CommandBuffer unwrap() noexcept;
+    /// Hands over what was recorded since attach() or begin().
+    [[nodiscard]] std::vector<std::byte> take_commands() noexcept { return stream_.take(); }
+    [[nodiscard]] bool recording() const noexcept { return recording_; }
+
+    void begin_render_pass(RHIRenderPass *render_pass, RenderPassContents contents) override;
+    void end_render_pass() override;
+    void bind_pipeline(const RHIPipeline *pipeline) override;
+    void bind_descriptor_sets(DescriptorSet **descriptor_sets, uint32_t first_set, uint32_t descriptor_set_count, handle_ty pipeline_layout) override;
+    void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) override;
+    void push_constants(const void *data, uint32_t offset, uint32_t size) override;
+    void draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) override;
+    void draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) override;
+    void draw_indexed_indirect_count(
+        handle_ty indirect_buffer,
+        size_t offset,
+        handle_ty count_buffer,
+        size_t count_offset,
+        uint32_t max_draw_count,
+        uint32_t stride) override;
+    void set_vertex_buffer(VertexBuffer *vertex_buffer, uint32_t base_vertex) override;
+    void set_index_buffer(IndexBuffer *index_buffer, uint32_t first_index) override;
+    void copy_buffer(
+        handle_ty src,
+        handle_ty dst,
+        size_t src_offset,
+        size_t dst_offset,
+        size_t size_in_byte) override;
+    void transition_texture_layout(
+        handle_ty texture,
+        TextureLayout old_layout,
+        TextureLayout new_layout) override;
+    void copy_buffer_to_texture(
+        handle_ty src_buffer,
+        handle_ty dst_texture,
+        const BufferTextureCopy *regions,
+        uint32_t region_count) override;
+    void submit_to_queue(QueueType queue_type, Fence *fence) override;
+    void begin() override;
+    void end() override;
+    void set_viewport(float x, float y, float width, float height, float min_depth, float max_depth) override;
+    void set_scissor(int32_t x, int32_t y, uint32_t width, uint32_t height) override;
+    void execute_secondary_command_buffers(const CommandBuffer *secondaries, uint32_t count) override;
+    /// Timers are measurement, not workload: forwarded but not captured.
+    void begin_gpu_timer(uint32_t timer) override { inner_.begin_gpu_timer(timer); }
+    void end_gpu_timer(uint32_t timer) override { inner_.end_gpu_timer(timer); }
+
+private:
+    CaptureDevice *device_ = nullptr;
+    CommandBuffer inner_;
+    CommandStreamWriter stream_;
+    bool recording_ = false;
+};
+
+/// Forwards every call to the wrapped device. Command buffers it hands out are
+/// CaptureCommandBuffers; while frames [first_frame, first_frame + frame_count) run, their
+/// submissions are collected, and the capture is saved when the window closes (or when
+/// the device is destroyed first). ImGui draw data goes straight to the backend and is not
+/// captured.
+class OC_RHI_API CaptureDevice : public Device::Impl {
+public:
+    CaptureDevice(Device inner, CaptureCreation creation);
+    ~CaptureDevice();
+
+    [[nodiscard]] handle_ty create_buffer(size_t size, const string &desc, bool exported) noexcept override {
+        return track_object(inner()->create_buffer(size, desc, exported));
+    }
+    [[nodiscard]] handle_ty create_buffer(
+        size_t size,
+        GraphicBufferBindFlags bind_flags,
+        const string &desc,
+        bool exported) noexcept override {
+        return track_object(inner()->create_buffer(size, bind_flags, desc, exported));
+    }
+    [[nodiscard]] handle_ty create_gpu_buffer(size_t size_in_byte, GraphicBufferBindFlags bind_flags) noexcept override {
+        return track_object(inner()->create_gpu_buffer(size_in_byte, bind_flags));
+    }
+    void destroy_buffer(handle_ty handle) noexcept override {
+        forget_object(handle);
+        inner()->destroy_buffer(handle);
+    }
+    [[nodiscard]] handle_ty create_texture(uint3 res, PixelStorage pixel_storage,
+                                           uint level_num, const string &desc) noexcept override {
+        return track_object(inner()->create_texture(res, pixel_storage, level_num, desc));
+    }
+    [[nodiscard]] handle_ty create_texture(
+        Image *image,
+        const TextureViewCreation &texture_view,
+        const TextureSampler &sampler) noexcept override {
+        return track_object(inner()->create_texture(image, texture_view, sampler));
+    }
+    [[nodiscard]] handle_ty create_texture(
+        uint32_t width,
+        uint32_t height,
+        uint32_t depth,
+        PixelStorage pixel_storage,
+        const TextureViewCreation &texture_view,
+        const TextureSampler &sampler,
+        uint4 default_color,
+        const void *data) noexcept override {
+        return track_object(inner()->create_texture(width, height, depth, pixel_storage, texture_view, sampler, default_color, data));
+    }
+    [[nodiscard]] handle_ty create_render_target_texture(uint32_t width, uint32_t height, PixelStorage pixel_storage,
+                                                         TextureUsageFlags usage) noexcept override {
+        return track_object(inner()->create_render_target_texture(width, height, pixel_storage, usage));
+    }
+    void destroy_texture(handle_ty handle) noexcept override {
+        forget_object(handle);
+        inner()->destroy_texture(handle);
+    }
+    [[nodiscard]] handle_ty create_shader_from_file(const std::string &file_name, ShaderType shader_type, const std::set<string> &options) noexcept override {
+        return inner()->create_shader_from_file(file_name, shader_type, options);
+    }
+    void destroy_shader(handle_ty handle) noexcept override { inner()->destroy_shader(handle); }
+    VertexBuffer *create_vertex_buffer() noexcept override { return track_object(inner()->create_vertex_buffer()); }
+    IndexBuffer *create_index_buffer(const void *initial_data, uint32_t indices_count, bool bit16) noexcept override {
+        return track_object(inner()->create_index_buffer(initial_data, indices_count, bit16));
+    }
+    bool begin_frame() noexcept override;
+    void end_frame() noexcept override;
+    void wait_idle() noexcept override { inner()->wait_idle(); }
+    RHIRenderPass *create_render_pass(const RenderPassCreation &render_pass_creation) noexcept override {
+        return track_object(inner()->create_render_pass(render_pass_creation));
+    }
+    void destroy_render_pass(RHIRenderPass *render_pass) noexcept override {
+        forget_object(render_pass);
+        inner()->destroy_render_pass(render_pass);
+    }
+    std::array<DescriptorSetLayout *, MAX_DESCRIPTOR_SETS_PER_SHADER> create_descriptor_set_layout(void **shaders, uint32_t shaders_count) noexcept override {
+        return inner()->create_descriptor_set_layout(shaders, shaders_count);
+    }
+    bool build_pipeline_layout_desc(const handle_ty shaders[PipelineState::MAX_SHADER_STAGE], PipelineLayoutDesc &out_desc) noexcept override {
+        return inner()->build_pipeline_layout_desc(shaders, out_desc);
+    }
+    RHIPipelineLayout *create_pipeline_layout(const PipelineLayoutDesc &desc) noexcept override {
+        return track_object(inner()->create_pipeline_layout(desc));
+    }
+    void destroy_pipeline_layout(RHIPipelineLayout *layout) noexcept override {
+        forget_object(layout);
+        inner()->destroy_pipeline_layout(layout);
+    }
+    void bind_pipeline(const CommandBuffer &cmd_buffer, const handle_ty pipeline) noexcept override;
+    RHIPipeline *create_pipeline(const PipelineState &pipeline_state, RHIRenderPass *render_pass, RHIPipelineLayout *pipeline_layout) noexcept override {
+        return track_object(inner()->create_pipeline(pipeline_state, render_pass, pipeline_layout));
+    }
+    void destroy_pipeline(RHIPipeline *pipeline) noexcept override {
+        forget_object(pipeline);
+        inner()->destroy_pipeline(pipeline);
+    }
+    void memory_allocate(handle_ty *handle, size_t size, bool exported) override {
+        inner()->memory_allocate(handle, size, exported);
+        (void)track_object(*handle);
+    }
+    void memory_free(handle_ty *handle) override {
+        forget_object(*handle);
+        inner()->memory_free(handle);
+    }
+    uint64_t get_aligned_memory_size(handle_ty handle) const override { return inner()->get_aligned_memory_size(handle); }
+#if _WIN32 || _WIN64
+    handle_ty import_handle(handle_ty handle, size_t size) override { return inner()->import_handle(handle, size); }
+    uint64_t export_handle(handle_ty handle) override { return inner()->export_handle(handle); }
+#endif
+    void get_imgui_creation(ImguiCreation &imgui_creation) noexcept override { inner()->get_imgui_creation(imgui_creation); }
+    void imgui_rhi_initialize(const ImguiCreation &imgui_creation) noexcept override { inner()->imgui_rhi_initialize(imgui_creation); }
+    void imgui_rhi_new_frame() noexcept override { inner()->imgui_rhi_new_frame(); }
+    void imgui_rhi_render_draw_data(void *draw_data, handle_ty command_buffer) noexcept override {
+        inner()->imgui_rhi_render_draw_data(draw_data, command_buffer);
+    }
+    void imgui_rhi_shutdown() noexcept override { inner()->imgui_rhi_shutdown(); }
+    CommandBuffer get_command_buffer() override;
+    CommandBuffer get_command_buffer(QueueType queue_type) override;
+    void release_command_buffer(const CommandBuffer &cmd_buffer) override;
+    CommandBuffer get_secondary_command_buffer(RHIRenderPass *render_pass, uint32_t thread_index) override;
+    void execute_command_buffers(CommandBuffer *cmd_buffer, uint32_t count) noexcept override;
+    Semaphore get_present_complete_semaphore() noexcept override { return inner()->get_present_complete_semaphore(); }
+    Semaphore get_render_complete_semaphore() noexcept override { return inner()->get_render_complete_semaphore(); }
+    void attach_swapchain_semaphores(CommandBuffer &cmd) noexcept override { inner()->attach_swapchain_semaphores(cmd); }
+    Fence create_fence() noexcept override { return inner()->create_fence(); }
+    Semaphore create_timeline_semaphore(uint64_t initial_value) noexcept override { return inner()->create_timeline_semaphore(initial_value); }
+    [[nodiscard]] uint64_t query_timeline_semaphore_value(const Semaphore &semaphore) const noexcept override {
+        return inner()->query_timeline_semaphore_value(semaphore);
+    }
+    void destroy_semaphore(Semaphore &semaphore) noexcept override { inner()->destroy_semaphore(semaphore); }
+    [[nodiscard]] double gpu_frame_time_ms() const noexcept override { return inner()->gpu_frame_time_ms(); }
+    [[nodiscard]] bool supports_dynamic_rendering() const noexcept override { return inner()->supports_dynamic_rendering(); }
+    [[nodiscard]] bool supports_multi_draw_indirect() const noexcept override { return inner()->supports_multi_draw_indirect(); }
+    [[nodiscard]] bool supports_indirect_first_instance() const noexcept override { return inner()->supports_indirect_first_instance(); }
+    [[nodiscard]] bool supports_draw_indirect_count() const noexcept override { return inner()->supports_draw_indirect_count(); }
+    [[nodiscard]] uint64_t frame_count() const noexcept override { return inner()->frame_count(); }
+    [[nodiscard]] CommandStats last_frame_command_stats() const noexcept override { return inner()->last_frame_command_stats(); }
+    [[nodiscard]] bool supports_gpu_timers() const noexcept override { return inner()->supports_gpu_timers(); }
+    [[nodiscard]] GpuTimerResults last_gpu_timer_results() const noexcept override { return inner()->last_gpu_timer_results(); }
+
+    [[nodiscard]] bool capturing() const noexcept { return capturing_.load(std::memory_order_acquire); }
+    /// Id of @p object, registering it with @p description on first use; 0 for null. Ids
+    /// follow the object's identity, not its address: an object created at a destroyed
+    /// one's address gets a new id.
+    [[nodiscard]] uint32_t resource_id(const void *object, const CapturedResource &description);
+    void record_submission(CapturedSubmission &&submission);
+
+private:
+    [[nodiscard]] Device::Impl *inner() const noexcept { return inner_impl_; }
+    [[nodiscard]] CommandBuffer wrap(const CommandBuffer &inner, bool secondary);
+    void save_capture();
+
+    /// Gives the object created at @p object a fresh identity, replacing any left behind by
+    /// an earlier object at the same address.
+    void register_object(const void *object);
+    /// Drops @p object's identity before the backend frees it.
+    void unregister_object(const void *object);
+    [[nodiscard]] handle_ty track_object(handle_ty handle) {
+        register_object(reinterpret_cast<const void *>(handle));
+        return handle;
+    }
+    template<typename T>
+    [[nodiscard]] T *track_object(T *object) {
+        register_object(object);
+        return object;
+    }
+    void forget_object(handle_ty handle) { unregister_object(reinterpret_cast<const void *>(handle)); }
+    void forget_object(const void *object) { unregister_object(object); }
+
+    Device inner_;
+    Device::Impl *inner_impl_ = nullptr;
+    CaptureCreation creation_;
+
+    std::unordered_map<CommandBuffer::Impl *, std::unique_ptr<CaptureCommandBuffer>> wrappers_;
+    std::mutex wrappers_mutex_;
+
+    /// Live objects -> identity from next_object_identity_. Objects the device never saw
+    /// created (descriptor sets) get one on first use and keep it.
+    std::unordered_map<const void *, uint64_t> object_identities_;
+    uint64_t next_object_identity_ = 0;
+    /// (identity, resource kind) -> capture resource id.
+    std::unordered_map<uint64_t, uint32_t> resource_ids_;
+    std::shared_mutex resource_mutex_;
+
+    std::atomic<bool> capturing_{false};
+    bool finished_ = false;
+    uint64_t frames_ended_ = 0;
+    CommandCapture capture_;
+    CapturedFrame current_frame_;
+    std::mutex capture_mutex_;
+};
+
+/// Wraps @p device in a CaptureDevice.
+[[nodiscard]] OC_RHI_API Device make_capture_device(Device device, const CaptureCreation &creation);
+
+}// namespace ocarina
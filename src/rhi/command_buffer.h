@@ -13,6 +13,67 @@ struct RHIPipeline;
 class VertexBuffer;
 class IndexBuffer;
 class Fence;
+
+/// Commands recorded into command buffers. Backends that count them (the null backend)
+/// report the sum over a frame's submissions through Device::last_frame_command_stats().
+struct CommandStats {
+    uint32_t command_buffers = 0;
+    uint32_t secondary_command_buffers = 0;
+    uint32_t render_passes = 0;
+    uint32_t pipeline_binds = 0;
+    uint32_t descriptor_set_binds = 0;
+    uint32_t vertex_buffer_binds = 0;
+    uint32_t index_buffer_binds = 0;
+    uint32_t push_constant_updates = 0;
+    uint64_t push_constant_bytes = 0;
+    /// draw_indexed() calls and the indices they draw (index count times instance count).
+    uint32_t draws = 0;
+    uint64_t drawn_indices = 0;
+    /// Indirect draw calls of any kind; their draw counts live in GPU buffers.
+    uint32_t indirect_draws = 0;
+    uint32_t buffer_copies = 0;
+    uint64_t buffer_copy_bytes = 0;
+    uint32_t texture_copies = 0;
+    uint32_t texture_transitions = 0;
+
+    CommandStats& operator+=(const CommandStats& other) noexcept {
+        command_buffers += other.command_buffers;
+        secondary_command_buffers += other.secondary_command_buffers;
+        render_passes += other.render_passes;
+        pipeline_binds += other.pipeline_binds;
+        descriptor_set_binds += other.descriptor_set_binds;
+        vertex_buffer_binds += other.vertex_buffer_binds;
+        index_buffer_binds += other.index_buffer_binds;
+        push_constant_updates += other.push_constant_updates;
+        push_constant_bytes += other.push_constant_bytes;
+        draws += other.draws;
+        drawn_indices += other.drawn_indices;
+        indirect_draws += other.indirect_draws;
+        buffer_copies += other.buffer_copies;
+        buffer_copy_bytes += other.buffer_copy_bytes;
+        texture_copies += other.texture_copies;
+        texture_transitions += other.texture_transitions;
+        return *this;
+    }
+};
+
+/// GPU timers a frame can write with CommandBuffer::begin_gpu_timer(); the ids are the
+/// caller's.
+static constexpr uint32_t MAX_GPU_TIMERS = 64;
+
+/// GPU time of each timer written in one frame. Backends resolve a frame's timers when its
+/// frame slot comes round again (the slot's fence has already been waited for), so results
+/// trail the CPU by the frames in flight and reading them never stalls.
+struct GpuTimerResults {
+    /// Bit i: timer i was written that frame and its result is in ms[i].
+    uint64_t written_mask = 0;
+    std::array<double, MAX_GPU_TIMERS> ms{};
+
+    [[nodiscard]] bool written(uint32_t timer) const noexcept {
+        return timer < MAX_GPU_TIMERS && (written_mask >> timer & 1u) != 0;
+    }
+};
+
 //This command buffer class is designed to be a holder for the actual command buffer implementation, which can be VulkanCommandBuffer, D3D12CommandBuffer, etc. 
 //It also holds the synchronization primitives (semaphores) that are needed for submitting the command buffer to the GPU. 
 // The actual command buffer implementation is hidden behind the Impl class, which is a pure virtual interface. 
@@ -23,14 +84,23 @@ public:
     public:
         Impl() {}
         virtual ~Impl() {}
-        virtual void begin_render_pass(RHIRenderPass* render_pass) = 0;
+        virtual void begin_render_pass(RHIRenderPass* render_pass, RenderPassContents contents = RenderPassContents::Inline) = 0;
         virtual void end_render_pass() = 0;
         virtual void bind_pipeline(const RHIPipeline* pipeline) = 0;
         virtual void bind_descriptor_sets(DescriptorSet** descriptor_sets, uint32_t first_set, uint32_t descriptor_set_count, handle_ty pipeline_layout) = 0;
         virtual void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) = 0;
         virtual void push_constants(const void* data, uint32_t offset, uint32_t size) = 0;
-        virtual void draw_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride) = 0;
-        virtual void draw_indexed_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride) = 0;
+        virtual void draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) = 0;
+        virtual void draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride) = 0;
+        /// Draw count read on the GPU from @p count_buffer at @p count_offset, clamped to
+        /// @p max_draw_count. Only valid when Device::supports_draw_indirect_count().
+        virtual void draw_indexed_indirect_count(
+            handle_ty indirect_buffer,
+            size_t offset,
+            handle_ty count_buffer,
+            size_t count_offset,
+            uint32_t max_draw_count,
+            uint32_t stride) = 0;
         virtual void set_vertex_buffer(VertexBuffer* vertex_buffer, uint32_t base_vertex = 0) = 0;
         virtual void set_index_buffer(IndexBuffer* index_buffer, uint32_t first_index = 0) = 0;
         virtual void copy_buffer(
@@ -53,6 +123,13 @@ public:
         virtual void end() = 0;
         virtual void set_viewport(float x, float y, float width, float height, float min_depth = 0.0f, float max_depth = 1.0f) = 0;
         virtual void set_scissor(int32_t x, int32_t y, uint32_t width, uint32_t height) = 0;
+        /// Records secondary command buffers, in order, into the current render pass. The pass
+        /// must have been begun with RenderPassContents::SecondaryCommandBuffers.
+        virtual void execute_secondary_command_buffers(const CommandBuffer* secondaries, uint32_t count) = 0;
+        /// Timestamps around a span of a primary command buffer, outside render passes. No-ops
+        /// unless the backend supports GPU timers (Device::supports_gpu_timers()).
+        virtual void begin_gpu_timer(uint32_t /*timer*/) {}
+        virtual void end_gpu_timer(uint32_t /*timer*/) {}
 
         SmallVector<Semaphore, MAX_COMMAND_BUFFERS_PER_SUBMIT> wait_semaphores;
         SmallVector<Semaphore, MAX_COMMAND_BUFFERS_PER_SUBMIT> signal_semaphores;
@@ -71,9 +148,9 @@ public:
 
     ~CommandBuffer() { }
 
-    void begin_render_pass(RHIRenderPass* render_pass)
+    void begin_render_pass(RHIRenderPass* render_pass, RenderPassContents contents = RenderPassContents::Inline)
     {
-        impl_->begin_render_pass(render_pass);
+        impl_->begin_render_pass(render_pass, contents);
     }
     void end_render_pass()
     {
@@ -128,13 +205,25 @@ public:
         impl_->draw_indexed(index_count, instance_count, first_index, vertex_offset, first_instance);
     }
 
-    void draw_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride)
+    /// @p indirect_buffer is a Buffer handle (Device::create_buffer) holding draw arguments
+    /// from byte @p offset, @p stride bytes apart.
+    void draw_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride)
+    {
+        impl_->draw_indirect(indirect_buffer, offset, draw_count, stride);
+    }
+    void draw_indexed_indirect(handle_ty indirect_buffer, size_t offset, uint32_t draw_count, uint32_t stride)
     {
-        //impl_->draw_indirect(indirect_buffer, draw_count, stride);
+        impl_->draw_indexed_indirect(indirect_buffer, offset, draw_count, stride);
     }
-    void draw_indexed_indirect(handle_ty indirect_buffer, uint32_t draw_count, uint32_t stride)
+    void draw_indexed_indirect_count(
+        handle_ty indirect_buffer,
+        size_t offset,
+        handle_ty count_buffer,
+        size_t count_offset,
+        uint32_t max_draw_count,
+        uint32_t stride)
     {
-        //impl_->draw_indexed_indirect(indirect_buffer, draw_count, stride);
+        impl_->draw_indexed_indirect_count(indirect_buffer, offset, count_buffer, count_offset, max_draw_count, stride);
     }
     void set_vertex_buffer(VertexBuffer* vertex_buffer, uint32_t base_vertex = 0)
     {
@@ -188,6 +277,16 @@ public:
     void set_scissor(int32_t x, int32_t y, uint32_t width, uint32_t height) {
         impl_->set_scissor(x, y, width, height);
     }
+    void execute_secondary_command_buffers(const CommandBuffer* secondaries, uint32_t count) {
+        impl_->execute_secondary_command_buffers(secondaries, count);
+    }
+    void begin_gpu_timer(uint32_t timer) {
+        impl_->begin_gpu_timer(timer);
+    }
+    void end_gpu_timer(uint32_t timer) {
+        impl_->end_gpu_timer(timer);
+    }
+    [[nodiscard]] bool valid() const noexcept { return impl_ != nullptr; }
 private:
     Impl* impl_ = nullptr;
 };
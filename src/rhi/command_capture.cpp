@@ -0,0 +1,128 @@
+#include "command_capture.h"
+#include "core/logging.h"
+#include <fstream>
+
+namespace ocarina {
+
+const char *captured_command_name(CapturedCommand command) noexcept {
+    switch (command) {
+        case CapturedCommand::Begin: return "begin";
+        case CapturedCommand::End: return "end";
+        case CapturedCommand::BeginRenderPass: return "begin_render_pass";
+        case CapturedCommand::EndRenderPass: return "end_render_pass";
+        case CapturedCommand::BindPipeline: return "bind_pipeline";
+        case CapturedCommand::BindDescriptorSets: return "bind_descriptor_sets";
+        case CapturedCommand::PushConstants: return "push_constants";
+        case CapturedCommand::DrawIndexed: return "draw_indexed";
+        case CapturedCommand::DrawIndirect: return "draw_indirect";
+        case CapturedCommand::DrawIndexedIndirect: return "draw_indexed_indirect";
+        case CapturedCommand::DrawIndexedIndirectCount: return "draw_indexed_indirect_count";
+        case CapturedCommand::SetVertexBuffer: return "set_vertex_buffer";
+        case CapturedCommand::SetIndexBuffer: return "set_index_buffer";
+        case CapturedCommand::CopyBuffer: return "copy_buffer";
+        case CapturedCommand::TransitionTextureLayout: return "transition_texture_layout";
+        case CapturedCommand::CopyBufferToTexture: return "copy_buffer_to_texture";
+        case CapturedCommand::SetViewport: return "set_viewport";
+        case CapturedCommand::SetScissor: return "set_scissor";
+        case CapturedCommand::ExecuteSecondaries: return "execute_secondaries";
+        default: return "unknown";
+    }
+}
+
+bool CommandCapture::save(const fs::path &path) const {
+    CommandStreamWriter writer;
+    writer.write(kMagic);
+    writer.write(kVersion);
+    writer.write(static_cast<uint32_t>(resources.size()));
+    writer.write(static_cast<uint32_t>(frames.size()));
+    for (const CapturedResource &resource : resources) {
+        writer.write(resource.kind);
+        writer.write(static_cast<uint8_t>(resource.bit16 ? 1 : 0));
+        writer.write(resource.width);
+        writer.write(resource.height);
+        writer.write(resource.size);
+    }
+    for (const CapturedFrame &frame : frames) {
+        writer.write(static_cast<uint32_t>(frame.submissions.size()));
+        for (const CapturedSubmission &submission : frame.submissions) {
+            writer.write(static_cast<uint8_t>(submission.queue));
+            writer.write(static_cast<uint8_t>(submission.batch ? 1 : 0));
+            writer.write(static_cast<uint8_t>(submission.fence ? 1 : 0));
+            writer.write(static_cast<uint32_t>(submission.command_buffers.size()));
+            for (const CapturedCommandBuffer &command_buffer : submission.command_buffers) {
+                writer.write(static_cast<uint64_t>(command_buffer.commands.size()));
+                writer.write_bytes(command_buffer.commands.data(), command_buffer.commands.size());
+            }
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        OC_WARNING_FORMAT("cannot write command capture {}", path.string());
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(writer.bytes().data()), static_cast<std::streamsize>(writer.bytes().size()));
+    return static_cast<bool>(out);
+}
+
+bool CommandCapture::load(const fs::path &path) {
+    resources.clear();
+    frames.clear();
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        OC_WARNING_FORMAT("cannot open command capture {}", path.string());
+        return false;
+    }
+    std::vector<std::byte> bytes(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    CommandStreamReader reader(bytes);
+    if (reader.read<uint32_t>() != kMagic || reader.read<uint32_t>() != kVersion) {
+        OC_WARNING_FORMAT("{} is not a version {} command capture", path.string(), kVersion);
+        return false;
+    }
+    const uint32_t resource_count = reader.read<uint32_t>();
+    const uint32_t frame_count = reader.read<uint32_t>();
+    resources.resize(resource_count);
+    for (CapturedResource &resource : resources) {
+        resource.kind = reader.read<CapturedResourceKind>();
+        resource.bit16 = reader.read<uint8_t>() != 0;
+        resource.width = reader.read<uint32_t>();
+        resource.height = reader.read<uint32_t>();
+        resource.size = reader.read<uint64_t>();
+    }
+    frames.resize(frame_count);
+    for (CapturedFrame &frame : frames) {
+        frame.submissions.resize(reader.read<uint32_t>());
+        for (CapturedSubmission &submission : frame.submissions) {
+            submission.queue = static_cast<QueueType>(reader.read<uint8_t>());
+            submission.batch = reader.read<uint8_t>() != 0;
+            submission.fence = reader.read<uint8_t>() != 0;
+            submission.command_buffers.resize(reader.read<uint32_t>());
+            for (CapturedCommandBuffer &command_buffer : submission.command_buffers) {
+                const uint64_t size = reader.read<uint64_t>();
+                const std::byte *commands = reader.read_bytes(size);
+                if (commands != nullptr) {
+                    command_buffer.commands.assign(commands, commands + size);
+                }
+            }
+            if (reader.failed()) {
+                break;
+            }
+        }
+        if (reader.failed()) {
+            break;
+        }
+    }
+    if (reader.failed()) {
+        OC_WARNING_FORMAT("command capture {} is truncated", path.string());
+        resources.clear();
+        frames.clear();
+        return false;
+    }
+    return true;
+}
+
+}// namespace ocarina
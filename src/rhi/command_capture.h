@@ -0,0 +1,248 @@
+//
+// Binary command-stream captures written by CaptureDevice (capture_device.h) and read
+// back by replay tools.
+//
+
+#pragma once
+
+#include "core/header.h"
+#include "core/stl.h"
+#include "graphics_descriptions.h"
+#include <cstring>
+
+namespace ocarina {
+
+/// One recorded CommandBuffer call. Each record is the opcode byte followed by its
+/// payload struct below; records marked "+" carry trailing data.
+enum class CapturedCommand : uint8_t {
+    Begin,
+    End,
+    BeginRenderPass,         ///< CapturedBeginRenderPass
+    EndRenderPass,
+    BindPipeline,            ///< uint32_t pipeline id
+    BindDescriptorSets,      ///< CapturedBindDescriptorSets + descriptor set ids
+    PushConstants,           ///< CapturedPushConstants + bytes
+    DrawIndexed,             ///< CapturedDrawIndexed
+    DrawIndirect,            ///< CapturedIndirectDraw
+    DrawIndexedIndirect,     ///< CapturedIndirectDraw
+    DrawIndexedIndirectCount,///< CapturedIndirectDrawCount
+    SetVertexBuffer,         ///< CapturedBindBuffer
+    SetIndexBuffer,          ///< CapturedBindBuffer
+    CopyBuffer,              ///< CapturedCopyBuffer
+    TransitionTextureLayout, ///< CapturedTextureTransition
+    CopyBufferToTexture,     ///< CapturedCopyBufferToTexture + BufferTextureCopy regions
+    SetViewport,             ///< CapturedViewport
+    SetScissor,              ///< CapturedScissor
+    ExecuteSecondaries,      ///< uint32_t count + per secondary: uint32_t byte size, records
+    Count,
+};
+
+[[nodiscard]] OC_RHI_API const char *captured_command_name(CapturedCommand command) noexcept;
+
+/// Objects the commands refer to. Captures store them as ids (1-based in order of first
+/// use, 0 for null) so a replay can stand in its own objects.
+enum class CapturedResourceKind : uint8_t {
+    Buffer,
+    Texture,
+    RenderPass,
+    Pipeline,
+    PipelineLayout,
+    DescriptorSet,
+    VertexBuffer,
+    IndexBuffer,
+};
+
+struct CapturedResource {
+    CapturedResourceKind kind = CapturedResourceKind::Buffer;
+    /// Buffers and index buffers: size in bytes. Vertex buffers: vertex count. Pipelines:
+    /// push constant size.
+    uint64_t size = 0;
+    /// Render passes: attachment size.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /// Index buffers: 16-bit indices.
+    bool bit16 = false;
+};
+
+struct CapturedBeginRenderPass {
+    uint32_t render_pass = 0;
+    RenderPassContents contents = RenderPassContents::Inline;
+};
+
+struct CapturedBindDescriptorSets {
+    uint32_t first_set = 0;
+    uint32_t descriptor_set_count = 0;
+    uint32_t pipeline_layout = 0;
+};
+
+struct CapturedPushConstants {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+struct CapturedDrawIndexed {
+    uint32_t index_count = 0;
+    uint32_t instance_count = 0;
+    uint32_t first_index = 0;
+    int32_t vertex_offset = 0;
+    uint32_t first_instance = 0;
+};
+
+struct CapturedIndirectDraw {
+    uint32_t buffer = 0;
+    uint32_t draw_count = 0;
+    uint32_t stride = 0;
+    uint64_t offset = 0;
+};
+
+struct CapturedIndirectDrawCount {
+    uint32_t buffer = 0;
+    uint32_t count_buffer = 0;
+    uint32_t max_draw_count = 0;
+    uint32_t stride = 0;
+    uint64_t offset = 0;
+    uint64_t count_offset = 0;
+};
+
+struct CapturedBindBuffer {
+    uint32_t buffer = 0;
+    /// Base vertex or first index.
+    uint32_t first = 0;
+};
+
+struct CapturedCopyBuffer {
+    uint32_t src = 0;
+    uint32_t dst = 0;
+    uint64_t src_offset = 0;
+    uint64_t dst_offset = 0;
+    uint64_t size = 0;
+};
+
+struct CapturedTextureTransition {
+    uint32_t texture = 0;
+    TextureLayout old_layout = TextureLayout::Undefined;
+    TextureLayout new_layout = TextureLayout::Undefined;
+};
+
+struct CapturedCopyBufferToTexture {
+    uint32_t src_buffer = 0;
+    uint32_t dst_texture = 0;
+    uint32_t region_count = 0;
+};
+
+struct CapturedViewport {
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    float min_depth = 0.0f;
+    float max_depth = 1.0f;
+};
+
+struct CapturedScissor {
+    int32_t x = 0;
+    int32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/// Appends records to a byte stream.
+class CommandStreamWriter {
+public:
+    template<typename T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write_bytes(&value, sizeof(T));
+    }
+    void write_bytes(const void *data, size_t size) {
+        const size_t offset = bytes_.size();
+        bytes_.resize(offset + size);
+        if (size > 0) {
+            std::memcpy(bytes_.data() + offset, data, size);
+        }
+    }
+    template<typename T>
+    void write_command(CapturedCommand command, const T &payload) {
+        write(command);
+        write(payload);
+    }
+
+    [[nodiscard]] const std::vector<std::byte> &bytes() const noexcept { return bytes_; }
+    [[nodiscard]] std::vector<std::byte> take() noexcept { return std::move(bytes_); }
+    void clear() noexcept { bytes_.clear(); }
+
+private:
+    std::vector<std::byte> bytes_;
+};
+
+/// Reads records back; a read past the end returns a zeroed value and sets failed().
+class CommandStreamReader {
+public:
+    CommandStreamReader(const std::byte *data, size_t size) noexcept : cursor_(data), end_(data + size) {}
+    explicit CommandStreamReader(const std::vector<std::byte> &bytes) noexcept
+        : CommandStreamReader(bytes.data(), bytes.size()) {}
+
+    template<typename T>
+    [[nodiscard]] T read() noexcept {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        const std::byte *bytes = read_bytes(sizeof(T));
+        if (bytes != nullptr) {
+            std::memcpy(&value, bytes, sizeof(T));
+        }
+        return value;
+    }
+    /// Returns @p size bytes in place, or nullptr if fewer are left.
+    [[nodiscard]] const std::byte *read_bytes(size_t size) noexcept {
+        if (static_cast<size_t>(end_ - cursor_) < size) {
+            failed_ = true;
+            cursor_ = end_;
+            return nullptr;
+        }
+        const std::byte *bytes = cursor_;
+        cursor_ += size;
+        return bytes;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return cursor_ == end_; }
+    [[nodiscard]] bool failed() const noexcept { return failed_; }
+
+private:
+    const std::byte *cursor_ = nullptr;
+    const std::byte *end_ = nullptr;
+    bool failed_ = false;
+};
+
+/// A primary command buffer as submitted: its records, secondaries inlined.
+struct CapturedCommandBuffer {
+    std::vector<std::byte> commands;
+};
+
+/// One submit_to_queue() (a single buffer, with a fence or not) or one
+/// Device::execute_command_buffers() batch.
+struct CapturedSubmission {
+    QueueType queue = QueueType::Graphics;
+    bool batch = false;
+    bool fence = false;
+    std::vector<CapturedCommandBuffer> command_buffers;
+};
+
+/// Submissions between two end_frame() calls, uploads included.
+struct CapturedFrame {
+    std::vector<CapturedSubmission> submissions;
+};
+
+struct OC_RHI_API CommandCapture {
+    static constexpr uint32_t kMagic = 0x5343434fu;// "OCCS"
+    static constexpr uint32_t kVersion = 1;
+
+    std::vector<CapturedResource> resources;
+    std::vector<CapturedFrame> frames;
+
+    [[nodiscard]] bool save(const fs::path &path) const;
+    /// Replaces the contents with the capture at @p path; false (with a warning) if the
+    /// file is missing, from another version or truncated.
+    [[nodiscard]] bool load(const fs::path &path);
+};
+
+}// namespace ocarina
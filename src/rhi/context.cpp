@@ -5,8 +5,10 @@
 #include "context.h"
 #include "core/dynamic_module.h"
 #include "rhi/device.h"
+#include "rhi/capture_device.h"
 #include "core/platform.h"
 #include "core/logging.h"
+#include <cstdlib>
 #include <fstream>
 
 namespace ocarina {
@@ -82,6 +84,12 @@ void RHIContext::parse_command_line(int argc, char **argv) {
         if (arg == "rebuildshader" || arg == "--rebuildshader" || arg == "/rebuildshader") {
             impl_->rebuild_shaders = true;
             OC_INFO("rebuildshader: SPV disk cache will be ignored; shaders recompiled from HLSL");
+        } else if (arg.starts_with("--capture=")) {
+            impl_->capture_path = string(arg.substr(arg.find('=') + 1));
+        } else if (arg.starts_with("--capture-frames=")) {
+            impl_->capture_frames = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[i] + arg.find('=') + 1, nullptr, 10)));
+        } else if (arg.starts_with("--capture-skip=")) {
+            impl_->capture_skip = static_cast<uint32_t>(std::strtoul(argv[i] + arg.find('=') + 1, nullptr, 10));
         }
     }
 }
@@ -97,6 +105,21 @@ bool RHIContext::rebuild_shaders() const noexcept {
     return impl_ && impl_->rebuild_shaders;
 }
 
+const fs::path &RHIContext::capture_path() const noexcept {
+    return impl_->capture_path;
+}
+
+Device RHIContext::wrap_capture(Device device) const noexcept {
+    if (impl_->capture_path.empty()) {
+        return device;
+    }
+    CaptureCreation creation;
+    creation.path = impl_->capture_path;
+    creation.first_frame = impl_->capture_skip;
+    creation.frame_count = impl_->capture_frames;
+    return make_capture_device(std::move(device), creation);
+}
+
 void RHIContext::destroy_instance() {
     if (s_context) {
         delete s_context;
@@ -195,7 +218,7 @@ Device RHIContext::create_device(const string &backend_name, const ocarina::Inst
     using Constructor = Device::Impl *(RHIContext *, const InstanceCreation &instance_creation);
     auto create_device = reinterpret_cast<Constructor *>(d->function_ptr("create_device"));
     auto destroy_func = reinterpret_cast<Device::Deleter *>(d->function_ptr("destroy"));
-    return Device{Device::Handle{create_device(this, instance_creation), destroy_func}};
+    return wrap_capture(Device{Device::Handle{create_device(this, instance_creation), destroy_func}});
 }
 
 Device RHIContext::create_device(const string &backend_name) noexcept {
@@ -212,7 +235,7 @@ Device RHIContext::create_device(const string &backend_name) noexcept {
         OC_ERROR("Failed to create device for backend ", backend_name);
     }
     auto destroy_func = reinterpret_cast<Device::Deleter *>(d->function_ptr("destroy"));
-    return Device{Device::Handle{create_device(this), destroy_func}};
+    return wrap_capture(Device{Device::Handle{create_device(this), destroy_func}});
 }
 
 }// namespace ocarina
\ No newline at end of file
@@ -27,6 +27,9 @@ private:
         fs::path cache_directory;
         bool use_cache{true};
         bool rebuild_shaders{false};
+        fs::path capture_path;
+        uint32_t capture_frames{1};
+        uint32_t capture_skip{0};
         ocarina::map<string, DynamicModule> modules;
         Impl() = default;
     };
@@ -35,9 +38,13 @@ private:
 public:
     RHIContext &init(const fs::path &path, string_view cache_dir = ".cache");
     virtual ~RHIContext() noexcept;
-    /// Parse argv for launch flags (e.g. "rebuildshader"). Safe to call more than once.
+    /// Parse argv for launch flags (e.g. "rebuildshader", "--capture=<file>"). Safe to call
+    /// more than once.
     void parse_command_line(int argc, char **argv);
     [[nodiscard]] bool rebuild_shaders() const noexcept;
+    /// Where create_device() captures submitted commands to (empty: no capture), see
+    /// CaptureDevice.
+    [[nodiscard]] const fs::path &capture_path() const noexcept;
     [[nodiscard]] const fs::path &runtime_directory() const noexcept;
     [[nodiscard]] const fs::path &cache_directory() const noexcept;
     static bool create_directory_if_necessary(const fs::path &path);
@@ -55,6 +62,7 @@ public:
     [[nodiscard]] const std::string& current_backend() const noexcept { return current_backend_; }
 private:
     void parse_process_command_line();
+    [[nodiscard]] Device wrap_capture(Device device) const noexcept;
 };
 
 }// namespace ocarina
\ No newline at end of file
@@ -115,6 +115,16 @@ public:
             return get_command_buffer();
         }
         virtual void release_command_buffer(const CommandBuffer& cmd_buffer) = 0;
+        /// Returns a secondary command buffer that is already begun inside @p render_pass
+        /// (viewport and scissor set), or an invalid CommandBuffer when the backend cannot
+        /// record secondaries. Each @p thread_index owns its own pool, so workers record
+        /// without locking. Call end() before executing it; the buffer is recycled
+        /// automatically once its frame slot comes around again, never released by the caller.
+        virtual CommandBuffer get_secondary_command_buffer(RHIRenderPass* render_pass, uint32_t thread_index) {
+            (void)render_pass;
+            (void)thread_index;
+            return {};
+        }
         virtual void execute_command_buffers(CommandBuffer* cmd_buffer, uint32_t count) noexcept {}
         virtual Semaphore get_present_complete_semaphore() noexcept = 0;
         virtual Semaphore get_render_complete_semaphore() noexcept = 0;
@@ -130,6 +140,21 @@ public:
         [[nodiscard]] virtual double gpu_frame_time_ms() const noexcept { return 0.0; }
         /// True when the device was created with Vulkan 1.3 dynamicRendering enabled.
         [[nodiscard]] virtual bool supports_dynamic_rendering() const noexcept { return false; }
+        /// True when one draw_indexed_indirect() may issue more than one draw.
+        [[nodiscard]] virtual bool supports_multi_draw_indirect() const noexcept { return false; }
+        /// True when indirect draws may use a non-zero first_instance.
+        [[nodiscard]] virtual bool supports_indirect_first_instance() const noexcept { return false; }
+        /// True when draw_indexed_indirect_count() is available (Vulkan 1.2 drawIndirectCount).
+        [[nodiscard]] virtual bool supports_draw_indirect_count() const noexcept { return false; }
+        /// Frames ended so far (0 if the backend does not count them).
+        [[nodiscard]] virtual uint64_t frame_count() const noexcept { return 0; }
+        /// Commands submitted between the last begin_frame() / end_frame() pair, uploads
+        /// included (all zero if the backend does not count them).
+        [[nodiscard]] virtual CommandStats last_frame_command_stats() const noexcept { return {}; }
+        /// Timestamp queries back CommandBuffer::begin_gpu_timer(); without them the timers are
+        /// no-ops and last_gpu_timer_results() stays empty.
+        [[nodiscard]] virtual bool supports_gpu_timers() const noexcept { return false; }
+        [[nodiscard]] virtual GpuTimerResults last_gpu_timer_results() const noexcept { return {}; }
     };
 
     using Creator = Device::Impl *(RHIContext *);
@@ -274,6 +299,10 @@ public:
         impl_->release_command_buffer(cmd_buffer);
     }
 
+    CommandBuffer get_secondary_command_buffer(RHIRenderPass* render_pass, uint32_t thread_index) noexcept {
+        return impl_->get_secondary_command_buffer(render_pass, thread_index);
+    }
+
     void execute_command_buffers(CommandBuffer* cmd_buffer, uint32_t count) noexcept {
         impl_->execute_command_buffers(cmd_buffer, count);
     }
@@ -314,6 +343,34 @@ public:
         return impl_->supports_dynamic_rendering();
     }
 
+    [[nodiscard]] bool supports_multi_draw_indirect() const noexcept {
+        return impl_->supports_multi_draw_indirect();
+    }
+
+    [[nodiscard]] bool supports_indirect_first_instance() const noexcept {
+        return impl_->supports_indirect_first_instance();
+    }
+
+    [[nodiscard]] bool supports_draw_indirect_count() const noexcept {
+        return impl_->supports_draw_indirect_count();
+    }
+
+    [[nodiscard]] uint64_t frame_count() const noexcept {
+        return impl_->frame_count();
+    }
+
+    [[nodiscard]] CommandStats last_frame_command_stats() const noexcept {
+        return impl_->last_frame_command_stats();
+    }
+
+    [[nodiscard]] bool supports_gpu_timers() const noexcept {
+        return impl_->supports_gpu_timers();
+    }
+
+    [[nodiscard]] GpuTimerResults last_gpu_timer_results() const noexcept {
+        return impl_->last_gpu_timer_results();
+    }
+
     Device::Impl* impl() noexcept { return impl_.get(); }
 
     [[nodiscard]] static Device create_device(const string &backend_name, const ocarina::InstanceCreation &instance_creation);
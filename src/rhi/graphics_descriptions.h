@@ -64,9 +64,20 @@ enum class GraphicBufferBindFlags {
     CopyDst = (1 << 7),                 ///< Can bind as a copy destination.
     ShaderReadWrite = (1 << 8),         ///< Can bind for usage as ReadWrite buffer for any shader stage (UAV on D3D12).
     PredicationExt = (1 << 9),          ///< Can use the buffer for SetPredicationEx calls (must have AdapterFeatures::Predication requested feature enabled)
-    AccelerationStructureExt = (1 << 10)///< Can bind as a ray tracing acceleration structure (require AdapterFeatures::RayTracing)
+    AccelerationStructureExt = (1 << 10),///< Can bind as a ray tracing acceleration structure (require AdapterFeatures::RayTracing)
+    IndirectBuffer = (1 << 11)          ///< Can be the argument / count buffer of indirect draws.
 };
 
+/// Argument layout of one indexed indirect draw; matches VkDrawIndexedIndirectCommand.
+struct DrawIndexedIndirectCommand {
+    uint32_t index_count = 0;
+    uint32_t instance_count = 0;
+    uint32_t first_index = 0;
+    int32_t vertex_offset = 0;
+    uint32_t first_instance = 0;
+};
+static_assert(sizeof(DrawIndexedIndirectCommand) == 20);
+
 enum QueueType
 {
     Graphics,///< Graphics queue
@@ -75,6 +86,12 @@ enum QueueType
     NumQueueType,
 };
 
+/// How the draws of a render pass instance are recorded.
+enum class RenderPassContents : uint8_t {
+    Inline,                 ///< Draws are recorded directly into the primary command buffer.
+    SecondaryCommandBuffers,///< The primary only executes secondary command buffers inside the pass.
+};
+
 enum class ShaderType {
     VertexShader,           ///< Vertex shader.
     PixelShader,            ///< Pixel shader.
@@ -126,8 +126,13 @@ void IndexBuffer::upload_indices(const void* data, uint32_t indices_count) {
 
     const uint32_t stride = bit16_ ? sizeof(uint16_t) : sizeof(uint32_t);
     const uint32_t num_bytes = indices_count * stride;
-    indices_.resize(indices_count);
-    memcpy(indices_.data(), data, num_bytes);
+    // The CPU mirror holds 16-bit indices only.
+    if (bit16_) {
+        indices_.resize(indices_count);
+        memcpy(indices_.data(), data, num_bytes);
+    } else {
+        indices_.clear();
+    }
     load_from_cpu(data, num_bytes);
     set_gpu_resource_state(GPUResourceState::GPU_Ready);
 }
@@ -25,14 +25,32 @@ struct DescriptorSetsBinding
     uint32_t descriptor_set_count = 0;
 };
 
-struct PipelineRenderQueue
+/// One visible draw of a pass. Packets are sorted by sort_key (layout in
+/// framework/draw_sort_key.h) so consecutive draws share as much GPU state as possible.
+struct DrawPacket
 {
-    std::list<uint32_t> draw_call_items;
+    uint64_t sort_key = 0;
+    uint32_t entity_index = InvalidUI32;
+    /// PipelineManager pipeline-state id.
+    uint32_t pipeline_id = InvalidUI32;
+    /// Compiled pipeline for this pass, resolved once per pipeline run after sorting;
+    /// null while the PSO is still compiling.
+    RHIPipeline* pipeline = nullptr;
+};
 
-    void clear()
-    {
-        draw_call_items.clear();
-    }
+/// One recorded draw, built from the sorted packets. Instanced batches draw instance_count
+/// copies of entity_index's mesh slice, reading each instance's entity index from the
+/// frame's draw-instance buffer at first_instance; plain batches draw entity_index alone.
+struct DrawBatch
+{
+    RHIPipeline* pipeline = nullptr;
+    /// Entity whose precompiled draw supplies buffers, sets and push constants.
+    uint32_t entity_index = InvalidUI32;
+    /// InvalidUI32 for plain batches.
+    uint32_t first_instance = InvalidUI32;
+    uint32_t instance_count = 1;
+
+    [[nodiscard]] bool instanced() const noexcept { return first_instance != InvalidUI32; }
 };
 
 struct GlobalUBO
@@ -46,9 +64,13 @@ public:
     RHIRenderPass(const RenderPassCreation &render_pass_creation) {}
     virtual ~RHIRenderPass();
 
-    void clear_draw_call_items();
+    void clear_draw_packets() noexcept { draw_packets_.clear(); }
 
-    void add_draw_call(uint32_t render_component_index, const PipelineState& pipeline_state);
+    void add_draw_packet(const DrawPacket& packet) { draw_packets_.push_back(packet); }
+
+    void clear_draw_batches() noexcept { draw_batches_.clear(); }
+
+    void add_draw_batch(const DrawBatch& batch) { draw_batches_.push_back(batch); }
 
     void add_color_attachment(Texture* texture) {
         OC_ASSERT(color_attachment_count_ < kMaxColorAttachments);
@@ -75,6 +97,24 @@ public:
         scissor_ = scissor;
     }
 
+    /// Offscreen passes: renders only the top-left @p extent of the attachments (clamped to
+    /// size()), so a lower resolution needs no new targets. Viewport and scissor follow;
+    /// {0, 0} renders the full size again.
+    void set_render_extent(uint2 extent) noexcept {
+        if (!is_offscreen_renderpass()) {
+            return;
+        }
+        render_extent_ = {extent.x < size_.x ? extent.x : size_.x, extent.y < size_.y ? extent.y : size_.y};
+        const uint2 area = render_extent();
+        scissor_ = {0, 0, static_cast<int>(area.x), static_cast<int>(area.y)};
+        viewport_ = {0, 0, static_cast<float>(area.x), static_cast<float>(area.y)};
+    }
+
+    /// Rendered area of the attachments: size() unless set_render_extent() narrowed it.
+    [[nodiscard]] uint2 render_extent() const noexcept {
+        return render_extent_.x == 0 || render_extent_.y == 0 ? size_ : render_extent_;
+    }
+
     handle_ty get_command_buffer() const
     {
         return command_buffer_;
@@ -112,8 +152,17 @@ public:
         viewport_ = {0, 0, static_cast<float>(extent.x), static_cast<float>(extent.y)};
     }
 
-    const std::unordered_map<PipelineState, PipelineRenderQueue*, PipelineStateHash>& pipeline_render_queues() const {
-        return pipeline_render_queues_;
+    /// Draws in recording order once the renderer has sorted them.
+    const std::vector<DrawPacket>& draw_packets() const noexcept {
+        return draw_packets_;
+    }
+    std::vector<DrawPacket>& draw_packets() noexcept {
+        return draw_packets_;
+    }
+
+    /// Draws as recorded, rebuilt from draw_packets() every frame.
+    const std::vector<DrawBatch>& draw_batches() const noexcept {
+        return draw_batches_;
     }
 
 protected:
@@ -121,6 +170,7 @@ protected:
     float4 viewport_ = {0, 0, 0, 0};
     int4 scissor_ = {0, 0, 0, 0};
     uint2 size_ = {0, 0};
+    uint2 render_extent_ = {0, 0};
 
     std::string name_ = "RHIRenderPass";
 
@@ -136,7 +186,8 @@ protected:
     float swapchain_clear_depth_ = 1.0f;
     uint32_t swapchain_clear_stencil_ = 0;
 
-    std::unordered_map<PipelineState, PipelineRenderQueue*, PipelineStateHash> pipeline_render_queues_;
+    std::vector<DrawPacket> draw_packets_;
+    std::vector<DrawBatch> draw_batches_;
     GlobalUBO global_ubo_data_ = {};
     handle_ty command_buffer_ = 0;
 };
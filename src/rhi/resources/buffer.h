@@ -37,6 +37,12 @@ struct is_valid_buffer_element_impl : std::bool_constant<std::is_trivially_copya
 template<typename T>
 constexpr bool is_valid_buffer_element_v = detail::is_valid_buffer_element_impl<T>::value;
 
+/// Byte range copied from a CPU mirror to the same offset in a buffer.
+struct BufferCopyRange {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
 /// Non-template GPU buffer resource. Concrete backends (e.g. VulkanBuffer) implement map/unmap.
 /// Owned by ResourceManager and looked up by handle_ty (backend Buffer* cast to uint64_t).
 class Buffer : public ExportableResource {
@@ -89,6 +95,30 @@ public:
         memcpy(static_cast<std::byte *>(mapped_) + dst_offset, src, size);
     }
 
+    /// Copies each range of @p src (a CPU mirror of the whole buffer) to the same offset,
+    /// mapping once for the batch. Ranges past the end of the buffer are clamped.
+    void copy_ranges_from_immediately(const void *src, const BufferCopyRange *ranges, size_t range_count) noexcept {
+        if (src == nullptr || ranges == nullptr || range_count == 0) {
+            return;
+        }
+        if (mapped_ == nullptr) {
+            map();
+        }
+        if (mapped_ == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < range_count; ++i) {
+            const BufferCopyRange &range = ranges[i];
+            if (range.offset >= size_in_byte_) {
+                continue;
+            }
+            const size_t size = std::min<size_t>(range.size, size_in_byte_ - range.offset);
+            memcpy(static_cast<std::byte *>(mapped_) + range.offset,
+                   static_cast<const std::byte *>(src) + range.offset,
+                   size);
+        }
+    }
+
 protected:
     Buffer(Device::Impl *device, handle_ty handle, size_t size_in_byte, bool exported = false)
         : Super(device, Tag::BUFFER, handle, exported),
@@ -163,6 +193,12 @@ public:
         }
     }
 
+    void copy_ranges_from_immediately(const void *src, const BufferCopyRange *ranges, size_t range_count) noexcept {
+        if (Buffer *b = buffer()) {
+            b->copy_ranges_from_immediately(src, ranges, range_count);
+        }
+    }
+
     void reset() noexcept {
         handle_ = 0;
         size_ = 0;
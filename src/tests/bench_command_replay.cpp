@@ -0,0 +1,492 @@
+//
+// Command-stream replay benchmark: loads a capture written with --capture=<file> (see
+// CaptureDevice) and replays its frames on the null backend, so the CPU cost of recording
+// and submitting exactly that command stream can be compared between builds. Captures hold
+// resource ids, not resource contents: replay binds stand-ins of the recorded sizes (null
+// descriptor sets, 1x1 textures), which is all the null backend looks at.
+//
+// Usage:
+//   bench-command-replay --input=path [--repeat=N] [--json=path]
+//
+// (--input rather than --capture: RHIContext reads --capture itself and would capture the
+// replay over its own input.)
+//
+
+#include "bench_common.h"
+#include "rhi/context.h"
+#include "rhi/command_capture.h"
+#include "rhi/renderpass.h"
+#include "rhi/pipeline_state.h"
+#include "rhi/vertex_buffer.h"
+#include "rhi/index_buffer.h"
+#include "rhi/fence.h"
+
+#include <chrono>
+
+using namespace ocarina;
+using namespace ocarina::bench;
+
+namespace {
+
+struct ReplayOptions {
+    std::string capture_path;
+    /// Times the captured frames are replayed.
+    uint32_t repeat = 100;
+    std::string json_path;
+};
+
+[[nodiscard]] bool parse_options(int argc, char* argv[], ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string value = eq == std::string_view::npos ? std::string{} : std::string(arg.substr(eq + 1));
+
+        if (value.empty()) {
+            std::fprintf(stderr, "option '%s' needs a value\n", argv[i]);
+            return false;
+        }
+        if (key == "--input") {
+            options.capture_path = value;
+        } else if (key == "--repeat") {
+            if (!parse_uint(value, options.repeat)) {
+                std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+                return false;
+            }
+            options.repeat = std::max(1u, options.repeat);
+        } else if (key == "--json") {
+            options.json_path = value;
+        } else {
+            std::fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+    if (options.capture_path.empty()) {
+        std::fprintf(stderr, "usage: bench-command-replay --input=path [--repeat=N] [--json=path]\n");
+        return false;
+    }
+    return true;
+}
+
+/// Null-backend objects standing in for the captured resources, indexed by resource id.
+class ReplayResources {
+public:
+    ReplayResources(Device& device, const std::vector<CapturedResource>& resources)
+        : device_(device), resources_(resources), objects_(resources.size() + 1, 0) {
+        for (uint32_t id = 1; id <= resources.size(); ++id) {
+            objects_[id] = create(resources[id - 1]);
+        }
+    }
+    ~ReplayResources() {
+        for (uint32_t id = 1; id <= resources_.size(); ++id) {
+            destroy(resources_[id - 1], objects_[id]);
+        }
+        for (RHIPipelineLayout* layout : pipeline_layouts_) {
+            device_.destroy_pipeline_layout(layout);
+        }
+    }
+
+    [[nodiscard]] handle_ty handle(uint32_t id) const noexcept {
+        return id < objects_.size() ? objects_[id] : 0;
+    }
+    template<typename T>
+    [[nodiscard]] T* get(uint32_t id) const noexcept {
+        return reinterpret_cast<T*>(handle(id));
+    }
+
+private:
+    [[nodiscard]] handle_ty create(const CapturedResource& resource) {
+        switch (resource.kind) {
+            case CapturedResourceKind::Buffer:
+                return device_.create_buffer(std::max<uint64_t>(resource.size, 4));
+            case CapturedResourceKind::Texture:
+                return device_.impl()->create_render_target_texture(1, 1, PixelStorage::BYTE4, TextureUsageFlags::RenderTarget);
+            case CapturedResourceKind::RenderPass:
+                return reinterpret_cast<handle_ty>(device_.create_render_pass(RenderPassCreation{}));
+            case CapturedResourceKind::Pipeline: {
+                RHIPipelineLayout* layout = device_.create_pipeline_layout(PipelineLayoutDesc{});
+                layout->push_constant_size = static_cast<uint32_t>(resource.size);
+                pipeline_layouts_.push_back(layout);
+                return reinterpret_cast<handle_ty>(device_.create_pipeline(PipelineState{}, nullptr, layout));
+            }
+            case CapturedResourceKind::PipelineLayout: {
+                RHIPipelineLayout* layout = device_.create_pipeline_layout(PipelineLayoutDesc{});
+                pipeline_layouts_.push_back(layout);
+                return layout->handle;
+            }
+            case CapturedResourceKind::VertexBuffer:
+                return reinterpret_cast<handle_ty>(device_.create_vertex_buffer());
+            case CapturedResourceKind::IndexBuffer: {
+                const uint32_t index_size = resource.bit16 ? sizeof(uint16_t) : sizeof(uint32_t);
+                const std::vector<std::byte> indices(resource.size);
+                return reinterpret_cast<handle_ty>(device_.create_index_buffer(
+                    indices.data(), static_cast<uint32_t>(resource.size / index_size), resource.bit16));
+            }
+            default:
+                return 0;
+        }
+    }
+
+    void destroy(const CapturedResource& resource, handle_ty object) {
+        if (object == 0) {
+            return;
+        }
+        switch (resource.kind) {
+            case CapturedResourceKind::Buffer: device_.destroy_buffer(object); break;
+            case CapturedResourceKind::Texture: device_.impl()->destroy_texture(object); break;
+            case CapturedResourceKind::RenderPass: device_.destroy_render_pass(reinterpret_cast<RHIRenderPass*>(object)); break;
+            case CapturedResourceKind::Pipeline: device_.destroy_pipeline(reinterpret_cast<RHIPipeline*>(object)); break;
+            case CapturedResourceKind::VertexBuffer: ocarina::delete_with_allocator(reinterpret_cast<VertexBuffer*>(object)); break;
+            case CapturedResourceKind::IndexBuffer: ocarina::delete_with_allocator(reinterpret_cast<IndexBuffer*>(object)); break;
+            default: break;
+        }
+    }
+
+    Device& device_;
+    const std::vector<CapturedResource>& resources_;
+    std::vector<handle_ty> objects_;
+    std::vector<RHIPipelineLayout*> pipeline_layouts_;
+};
+
+struct CommandTiming {
+    uint64_t count = 0;
+    double total_ns = 0.0;
+};
+
+/// Replays one command buffer's records into @p cmd, timing each call by opcode.
+class CommandReplayer {
+public:
+    CommandReplayer(Device& device, const ReplayResources& resources)
+        : device_(device), resources_(resources) {}
+
+    [[nodiscard]] bool replay(const std::byte* data, size_t size, CommandBuffer& cmd) {
+        CommandStreamReader reader(data, size);
+        while (!reader.empty() && !reader.failed()) {
+            const auto command = reader.read<CapturedCommand>();
+            if (command >= CapturedCommand::Count) {
+                return false;
+            }
+            if (!replay_command(command, reader, cmd)) {
+                return false;
+            }
+        }
+        return !reader.failed();
+    }
+
+    [[nodiscard]] const std::array<CommandTiming, static_cast<size_t>(CapturedCommand::Count)>& timings() const noexcept {
+        return timings_;
+    }
+
+private:
+    template<typename F>
+    void timed(CapturedCommand command, F&& call) {
+        const auto start = std::chrono::steady_clock::now();
+        call();
+        const auto end = std::chrono::steady_clock::now();
+        CommandTiming& timing = timings_[static_cast<size_t>(command)];
+        ++timing.count;
+        timing.total_ns += std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    [[nodiscard]] bool replay_command(CapturedCommand command, CommandStreamReader& reader, CommandBuffer& cmd) {
+        switch (command) {
+            case CapturedCommand::Begin:
+                timed(command, [&] { cmd.begin(); });
+                return true;
+            case CapturedCommand::End:
+                timed(command, [&] { cmd.end(); });
+                return true;
+            case CapturedCommand::BeginRenderPass: {
+                const auto payload = reader.read<CapturedBeginRenderPass>();
+                render_pass_ = resources_.get<RHIRenderPass>(payload.render_pass);
+                timed(command, [&] { cmd.begin_render_pass(render_pass_, payload.contents); });
+                return true;
+            }
+            case CapturedCommand::EndRenderPass:
+                timed(command, [&] { cmd.end_render_pass(); });
+                return true;
+            case CapturedCommand::BindPipeline: {
+                const RHIPipeline* pipeline = resources_.get<RHIPipeline>(reader.read<uint32_t>());
+                timed(command, [&] { cmd.bind_pipeline(pipeline); });
+                return true;
+            }
+            case CapturedCommand::BindDescriptorSets: {
+                const auto payload = reader.read<CapturedBindDescriptorSets>();
+                // Descriptor sets are not captured; the ids only keep the stream aligned.
+                descriptor_sets_.assign(payload.descriptor_set_count, nullptr);
+                for (uint32_t i = 0; i < payload.descriptor_set_count; ++i) {
+                    (void)reader.read<uint32_t>();
+                }
+                const handle_ty layout = resources_.handle(payload.pipeline_layout);
+                timed(command, [&] {
+                    cmd.bind_descriptor_sets(descriptor_sets_.data(), payload.first_set, payload.descriptor_set_count, layout);
+                });
+                return true;
+            }
+            case CapturedCommand::PushConstants: {
+                const auto payload = reader.read<CapturedPushConstants>();
+                const std::byte* bytes = reader.read_bytes(payload.size);
+                if (bytes == nullptr) {
+                    return false;
+                }
+                timed(command, [&] { cmd.push_constants(bytes, payload.offset, payload.size); });
+                return true;
+            }
+            case CapturedCommand::DrawIndexed: {
+                const auto payload = reader.read<CapturedDrawIndexed>();
+                timed(command, [&] {
+                    cmd.draw_indexed(payload.index_count, payload.instance_count, payload.first_index,
+                                     payload.vertex_offset, payload.first_instance);
+                });
+                return true;
+            }
+            case CapturedCommand::DrawIndirect:
+            case CapturedCommand::DrawIndexedIndirect: {
+                const auto payload = reader.read<CapturedIndirectDraw>();
+                const handle_ty buffer = resources_.handle(payload.buffer);
+                timed(command, [&] {
+                    if (command == CapturedCommand::DrawIndirect) {
+                        cmd.draw_indirect(buffer, payload.offset, payload.draw_count, payload.stride);
+                    } else {
+                        cmd.draw_indexed_indirect(buffer, payload.offset, payload.draw_count, payload.stride);
+                    }
+                });
+                return true;
+            }
+            case CapturedCommand::DrawIndexedIndirectCount: {
+                const auto payload = reader.read<CapturedIndirectDrawCount>();
+                const handle_ty buffer = resources_.handle(payload.buffer);
+                const handle_ty count_buffer = resources_.handle(payload.count_buffer);
+                timed(command, [&] {
+                    cmd.draw_indexed_indirect_count(buffer, payload.offset, count_buffer, payload.count_offset,
+                                                    payload.max_draw_count, payload.stride);
+                });
+                return true;
+            }
+            case CapturedCommand::SetVertexBuffer: {
+                const auto payload = reader.read<CapturedBindBuffer>();
+                VertexBuffer* vertex_buffer = resources_.get<VertexBuffer>(payload.buffer);
+                timed(command, [&] { cmd.set_vertex_buffer(vertex_buffer, payload.first); });
+                return true;
+            }
+            case CapturedCommand::SetIndexBuffer: {
+                const auto payload = reader.read<CapturedBindBuffer>();
+                IndexBuffer* index_buffer = resources_.get<IndexBuffer>(payload.buffer);
+                timed(command, [&] { cmd.set_index_buffer(index_buffer, payload.first); });
+                return true;
+            }
+            case CapturedCommand::CopyBuffer: {
+                const auto payload = reader.read<CapturedCopyBuffer>();
+                const handle_ty src = resources_.handle(payload.src);
+                const handle_ty dst = resources_.handle(payload.dst);
+                timed(command, [&] { cmd.copy_buffer(src, dst, payload.src_offset, payload.dst_offset, payload.size); });
+                return true;
+            }
+            case CapturedCommand::TransitionTextureLayout: {
+                const auto payload = reader.read<CapturedTextureTransition>();
+                const handle_ty texture = resources_.handle(payload.texture);
+                timed(command, [&] { cmd.transition_texture_layout(texture, payload.old_layout, payload.new_layout); });
+                return true;
+            }
+            case CapturedCommand::CopyBufferToTexture: {
+                const auto payload = reader.read<CapturedCopyBufferToTexture>();
+                const std::byte* bytes = reader.read_bytes(sizeof(BufferTextureCopy) * payload.region_count);
+                if (bytes == nullptr) {
+                    return false;
+                }
+                regions_.resize(payload.region_count);
+                std::memcpy(regions_.data(), bytes, sizeof(BufferTextureCopy) * payload.region_count);
+                const handle_ty src = resources_.handle(payload.src_buffer);
+                const handle_ty dst = resources_.handle(payload.dst_texture);
+                timed(command, [&] { cmd.copy_buffer_to_texture(src, dst, regions_.data(), payload.region_count); });
+                return true;
+            }
+            case CapturedCommand::SetViewport: {
+                const auto payload = reader.read<CapturedViewport>();
+                timed(command, [&] {
+                    cmd.set_viewport(payload.x, payload.y, payload.width, payload.height, payload.min_depth, payload.max_depth);
+                });
+                return true;
+            }
+            case CapturedCommand::SetScissor: {
+                const auto payload = reader.read<CapturedScissor>();
+                timed(command, [&] { cmd.set_scissor(payload.x, payload.y, payload.width, payload.height); });
+                return true;
+            }
+            case CapturedCommand::ExecuteSecondaries:
+                return replay_secondaries(reader, cmd);
+            default:
+                return false;
+        }
+    }
+
+    /// Secondaries are recorded from their first call after acquisition (the backend hands
+    /// them out begun), so each is replayed into a freshly acquired one.
+    [[nodiscard]] bool replay_secondaries(CommandStreamReader& reader, CommandBuffer& cmd) {
+        const uint32_t count = reader.read<uint32_t>();
+        RHIRenderPass* render_pass = render_pass_;
+        std::vector<CommandBuffer> secondaries;
+        secondaries.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t size = reader.read<uint32_t>();
+            const std::byte* records = reader.read_bytes(size);
+            if (records == nullptr) {
+                return false;
+            }
+            CommandBuffer secondary = device_.get_secondary_command_buffer(render_pass, 0);
+            if (!replay(records, size, secondary)) {
+                return false;
+            }
+            secondaries.push_back(secondary);
+        }
+        render_pass_ = render_pass;
+        timed(CapturedCommand::ExecuteSecondaries, [&] { cmd.execute_secondary_command_buffers(secondaries.data(), count); });
+        return true;
+    }
+
+    Device& device_;
+    const ReplayResources& resources_;
+    RHIRenderPass* render_pass_ = nullptr;
+    std::vector<DescriptorSet*> descriptor_sets_;
+    std::vector<BufferTextureCopy> regions_;
+    std::array<CommandTiming, static_cast<size_t>(CapturedCommand::Count)> timings_{};
+};
+
+[[nodiscard]] bool replay_frame(Device& device, CommandReplayer& replayer, const CapturedFrame& frame) {
+    if (!device.begin_frame()) {
+        return true;
+    }
+    std::array<CommandBuffer, MAX_COMMAND_BUFFERS_PER_SUBMIT> batch;
+    for (const CapturedSubmission& submission : frame.submissions) {
+        const uint32_t count = std::min<uint32_t>(static_cast<uint32_t>(submission.command_buffers.size()),
+                                                  MAX_COMMAND_BUFFERS_PER_SUBMIT);
+        for (uint32_t i = 0; i < count; ++i) {
+            const std::vector<std::byte>& commands = submission.command_buffers[i].commands;
+            batch[i] = device.get_command_buffer(submission.queue);
+            if (!replayer.replay(commands.data(), commands.size(), batch[i])) {
+                return false;
+            }
+        }
+        if (submission.batch) {
+            device.execute_command_buffers(batch.data(), count);
+        } else if (submission.fence) {
+            Fence fence = device.create_fence();
+            for (uint32_t i = 0; i < count; ++i) {
+                batch[i].submit_to_queue(submission.queue, &fence);
+                fence.wait();
+                fence.reset();
+            }
+        } else {
+            for (uint32_t i = 0; i < count; ++i) {
+                batch[i].submit_to_queue(submission.queue, nullptr);
+            }
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            device.release_command_buffer(batch[i]);
+        }
+    }
+    device.end_frame();
+    return true;
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    CommandCapture capture;
+    if (!capture.load(options.capture_path)) {
+        return 1;
+    }
+    if (capture.frames.empty()) {
+        std::fprintf(stderr, "%s holds no frames\n", options.capture_path.c_str());
+        return 1;
+    }
+
+    RHIContext& context = RHIContext::instance();
+
+    InstanceCreation instance_creation{};
+    instance_creation.applicationName = "bench-command-replay";
+    instance_creation.windowWidth = 1280;
+    instance_creation.windowHeight = 720;
+    Device device = context.create_device("null", instance_creation);
+
+    size_t submissions_per_pass = 0;
+    for (const CapturedFrame& frame : capture.frames) {
+        submissions_per_pass += frame.submissions.size();
+    }
+
+    std::vector<double> frame_samples_ns;
+    frame_samples_ns.reserve(size_t{options.repeat} * capture.frames.size());
+    CommandTiming total;
+    std::array<CommandTiming, static_cast<size_t>(CapturedCommand::Count)> timings{};
+    {
+        ReplayResources resources(device, capture.resources);
+        CommandReplayer replayer(device, resources);
+        for (uint32_t pass = 0; pass < options.repeat; ++pass) {
+            for (const CapturedFrame& frame : capture.frames) {
+                Clock clock;
+                if (!replay_frame(device, replayer, frame)) {
+                    std::fprintf(stderr, "%s holds a malformed command stream\n", options.capture_path.c_str());
+                    return 1;
+                }
+                frame_samples_ns.push_back(elapsed_ns(clock));
+            }
+        }
+        device.wait_idle();
+        timings = replayer.timings();
+    }
+    for (const CommandTiming& timing : timings) {
+        total.count += timing.count;
+        total.total_ns += timing.total_ns;
+    }
+    const uint64_t commands_per_pass = total.count / options.repeat;
+
+    const StageStats frame = summarize(std::move(frame_samples_ns),
+                                       static_cast<uint32_t>(commands_per_pass / capture.frames.size()));
+
+    std::printf("bench-command-replay: %s, %zu frames x %u, %zu submissions and %llu commands per pass, %zu resources\n",
+                options.capture_path.c_str(),
+                capture.frames.size(),
+                options.repeat,
+                submissions_per_pass,
+                static_cast<unsigned long long>(commands_per_pass),
+                capture.resources.size());
+    print_stage("frame", frame);
+    std::printf("  %-28s %12s %12s %10s\n", "command", "count", "total ms", "ns/cmd");
+    nlohmann::json commands_json = nlohmann::json::object();
+    for (size_t i = 0; i < timings.size(); ++i) {
+        const CommandTiming& timing = timings[i];
+        if (timing.count == 0) {
+            continue;
+        }
+        const char* name = captured_command_name(static_cast<CapturedCommand>(i));
+        const double ns_per_command = timing.total_ns / static_cast<double>(timing.count);
+        std::printf("  %-28s %12llu %12.3f %10.1f\n",
+                    name,
+                    static_cast<unsigned long long>(timing.count),
+                    timing.total_ns * 1e-6,
+                    ns_per_command);
+        commands_json[name] = nlohmann::json{
+            {"count", timing.count},
+            {"total_ns", timing.total_ns},
+            {"ns_per_command", ns_per_command},
+        };
+    }
+
+    write_json_report(options.json_path, nlohmann::json{
+        {"benchmark", "bench-command-replay"},
+        {"capture", options.capture_path},
+        {"frames", capture.frames.size()},
+        {"repeat", options.repeat},
+        {"submissions_per_pass", submissions_per_pass},
+        {"commands_per_pass", commands_per_pass},
+        {"resources", capture.resources.size()},
+        {"frame", stage_to_json(frame)},
+        {"commands", commands_json},
+    });
+    return 0;
+}
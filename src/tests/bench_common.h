@@ -0,0 +1,114 @@
+#pragma once
+
+// Shared timing / reporting helpers for the headless bench-* targets.
+
+#include "core/stl.h"
+#include "core/util.h"
+#include "ext/nlohmann/json.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string_view>
+
+namespace ocarina::bench {
+
+struct StageStats {
+    double mean_ns = 0.0;
+    double p50_ns = 0.0;
+    double p95_ns = 0.0;
+    double p99_ns = 0.0;
+    double max_ns = 0.0;
+    double ns_per_entity = 0.0;
+};
+
+[[nodiscard]] inline StageStats summarize(std::vector<double> samples_ns, uint32_t entity_count) {
+    StageStats stats;
+    if (samples_ns.empty()) {
+        return stats;
+    }
+    std::sort(samples_ns.begin(), samples_ns.end());
+    auto percentile = [&](double p) {
+        const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(samples_ns.size()))) - 1;
+        return samples_ns[std::min(rank, samples_ns.size() - 1)];
+    };
+    double sum = 0.0;
+    for (double sample : samples_ns) {
+        sum += sample;
+    }
+    stats.mean_ns = sum / static_cast<double>(samples_ns.size());
+    stats.p50_ns = percentile(0.50);
+    stats.p95_ns = percentile(0.95);
+    stats.p99_ns = percentile(0.99);
+    stats.max_ns = samples_ns.back();
+    stats.ns_per_entity = entity_count > 0 ? stats.mean_ns / static_cast<double>(entity_count) : 0.0;
+    return stats;
+}
+
+[[nodiscard]] inline double elapsed_ns(const Clock& clock) noexcept {
+    return clock.elapse_ms() * 1e6;
+}
+
+inline void print_stage(const char* name, const StageStats& stats) {
+    std::printf("  %-16s mean %10.3f ms  p50 %10.3f  p95 %10.3f  p99 %10.3f  max %10.3f  %8.2f ns/entity\n",
+                name,
+                stats.mean_ns * 1e-6,
+                stats.p50_ns * 1e-6,
+                stats.p95_ns * 1e-6,
+                stats.p99_ns * 1e-6,
+                stats.max_ns * 1e-6,
+                stats.ns_per_entity);
+}
+
+[[nodiscard]] inline nlohmann::json stage_to_json(const StageStats& stats) {
+    return nlohmann::json{
+        {"mean_ns", stats.mean_ns},
+        {"p50_ns", stats.p50_ns},
+        {"p95_ns", stats.p95_ns},
+        {"p99_ns", stats.p99_ns},
+        {"max_ns", stats.max_ns},
+        {"ns_per_entity", stats.ns_per_entity},
+    };
+}
+
+/// Parses a whole decimal option value; false on empty, malformed or out-of-range input,
+/// so bad command lines print usage instead of throwing.
+[[nodiscard]] inline bool parse_uint(std::string_view text, uint32_t& out) noexcept {
+    uint32_t value = 0;
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    if (text.empty() || ec != std::errc{} || ptr != end) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+[[nodiscard]] inline bool parse_float(const std::string& text, float& out) noexcept {
+    char* end = nullptr;
+    const float value = std::strtof(text.c_str(), &end);
+    if (text.empty() || end != text.c_str() + text.size() || !std::isfinite(value)) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+/// Writes @p report to @p path (pretty-printed); no-op for an empty path.
+inline void write_json_report(const std::string& path, const nlohmann::json& report) {
+    if (path.empty()) {
+        return;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::fprintf(stderr, "failed to open '%s' for writing\n", path.c_str());
+        return;
+    }
+    out << report.dump(2) << '\n';
+    std::printf("wrote %s\n", path.c_str());
+}
+
+}// namespace ocarina::bench
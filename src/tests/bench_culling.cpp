@@ -0,0 +1,516 @@
+//
+// Headless culling benchmark: builds synthetic scenes on the CPU and times the
+// scene grid, world-bounds refresh, the primitive cull task (walking the visible cells and
+// streaming the hot chunks, side by side) and render-queue population. No window,
+// no RHI device — runs on CI / GPU-less machines.
+//
+// Usage:
+//   bench-culling [--scene=uniform|clustered|city|all] [--entities=10000,100000,...]
+//                 [--frames=N] [--build-iterations=N] [--cell-size=M]
+//                 [--threads=N] [--json=path]
+//
+
+#include "bench_common.h"
+#include "math/basic_types.h"
+#include "framework/camera.h"
+#include "framework/draw_sort_key.h"
+#include "framework/entity_component_system.h"
+#include "framework/frustum.h"
+#include "framework/mesh.h"
+#include "framework/pipeline_manager.h"
+#include "framework/primitive.h"
+#include "framework/renderer_primitive_cull_task.h"
+#include "framework/scene.h"
+#include "rhi/renderpass.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+#include <cmath>
+#include <random>
+
+using namespace ocarina;
+using namespace ocarina::bench;
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+// Distinct pipeline states the synthetic draws are spread across when filling render queues.
+constexpr uint32_t kSyntheticPipelineCount = 8;
+// Distinct material ids mixed into the synthetic draw sort keys.
+constexpr uint32_t kSyntheticMaterialCount = 64;
+
+enum class SceneLayout : uint8_t {
+    Uniform,
+    Clustered,
+    City,
+};
+
+constexpr SceneLayout kAllLayouts[] = {SceneLayout::Uniform, SceneLayout::Clustered, SceneLayout::City};
+
+[[nodiscard]] const char* layout_name(SceneLayout layout) noexcept {
+    switch (layout) {
+        case SceneLayout::Uniform: return "uniform";
+        case SceneLayout::Clustered: return "clustered";
+        case SceneLayout::City: return "city";
+    }
+    return "unknown";
+}
+
+struct BenchOptions {
+    std::vector<SceneLayout> layouts{std::begin(kAllLayouts), std::end(kAllLayouts)};
+    std::vector<uint32_t> entity_counts{10000u, 100000u, 1000000u, 2000000u};
+    uint32_t frames = 64;
+    uint32_t build_iterations = 4;
+    uint32_t threads = 0;
+    float cell_size = Scene::kDefaultGridCellSizeMeters;
+    std::string json_path;
+};
+
+void print_usage() {
+    std::fprintf(stderr,
+                 "usage: bench-culling [--scene=uniform|clustered|city|all] [--entities=10000,100000,...]\n"
+                 "                     [--frames=N] [--build-iterations=N] [--cell-size=M]\n"
+                 "                     [--threads=N] [--json=path]\n");
+}
+
+[[nodiscard]] bool parse_options(int argc, char* argv[], BenchOptions& options) {
+    auto invalid_value = [&](int i) {
+        std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+        print_usage();
+        return false;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string value = eq == std::string_view::npos ? std::string{} : std::string(arg.substr(eq + 1));
+
+        if (key == "--scene") {
+            options.layouts.clear();
+            if (value == "uniform" || value == "all") { options.layouts.push_back(SceneLayout::Uniform); }
+            if (value == "clustered" || value == "all") { options.layouts.push_back(SceneLayout::Clustered); }
+            if (value == "city" || value == "all") { options.layouts.push_back(SceneLayout::City); }
+            if (options.layouts.empty()) {
+                std::fprintf(stderr, "unknown scene layout '%s'\n", value.c_str());
+                print_usage();
+                return false;
+            }
+        } else if (key == "--entities") {
+            options.entity_counts.clear();
+            size_t begin = 0;
+            while (begin < value.size()) {
+                size_t end = value.find(',', begin);
+                end = end == std::string::npos ? value.size() : end;
+                uint32_t count = 0;
+                if (!parse_uint(std::string_view(value).substr(begin, end - begin), count)) {
+                    return invalid_value(i);
+                }
+                if (count > 0) {
+                    options.entity_counts.push_back(count);
+                }
+                begin = end + 1;
+            }
+            if (options.entity_counts.empty()) {
+                std::fprintf(stderr, "--entities needs at least one non-zero count\n");
+                print_usage();
+                return false;
+            }
+        } else if (key == "--frames") {
+            if (!parse_uint(value, options.frames)) {
+                return invalid_value(i);
+            }
+            options.frames = std::max(1u, options.frames);
+        } else if (key == "--build-iterations") {
+            if (!parse_uint(value, options.build_iterations)) {
+                return invalid_value(i);
+            }
+            options.build_iterations = std::max(1u, options.build_iterations);
+        } else if (key == "--threads") {
+            if (!parse_uint(value, options.threads)) {
+                return invalid_value(i);
+            }
+        } else if (key == "--cell-size") {
+            if (!parse_float(value, options.cell_size)) {
+                return invalid_value(i);
+            }
+        } else if (key == "--json") {
+            options.json_path = value;
+        } else {
+            std::fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            print_usage();
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Attaches the shared mesh to a bulk-created entity batch from the worker threads.
+class PoolFillTask : public enki::ITaskSet {
+public:
+    PoolFillTask(const EntityBatch& batch, Mesh* mesh)
+        : batch_(batch), mesh_(mesh) {
+        m_SetSize = batch.count;
+        m_MinRange = 4096;
+    }
+
+    void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+        (void)threadnum;
+        for (uint32_t i = range.start; i < range.end; ++i) {
+            batch_.primitives[i].set_mesh(mesh_);
+        }
+    }
+
+private:
+    EntityBatch batch_;
+    Mesh* mesh_ = nullptr;
+};
+
+/// World-space extent of a generated layout, used to place the orbit camera.
+struct LayoutExtent {
+    float3 center{};
+    float radius = 1.0f;
+    float eye_height = 0.0f;
+};
+
+/// Writes positions for the first @p count pooled entities (setters build the matrices).
+LayoutExtent layout_entities(SceneLayout layout, const std::vector<uint32_t>& entities, uint32_t count) {
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    std::mt19937 rng(0x0cab1e5u + count);
+    BoundingBox bounds;
+
+    auto place = [&](uint32_t i, const float3& position) {
+        TransformComponent& transform = ecs.transform_component(entities[i]);
+        transform.set_position(position);
+        bounds.expand(position);
+    };
+
+    switch (layout) {
+        case SceneLayout::Uniform: {
+            constexpr float kSpacing = 4.0f;
+            const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t x = i % side;
+                const uint32_t y = (i / side) % side;
+                const uint32_t z = i / (side * side);
+                place(i, make_float3(x * kSpacing, y * kSpacing, z * kSpacing));
+            }
+            break;
+        }
+        case SceneLayout::Clustered: {
+            // Dense blobs scattered through a large, mostly empty volume.
+            constexpr uint32_t kEntitiesPerCluster = 2000;
+            const uint32_t cluster_count = std::max(1u, count / kEntitiesPerCluster);
+            const float extent = 8.0f * std::cbrt(static_cast<float>(count)) + 200.0f;
+            std::uniform_real_distribution<float> center_dist(0.0f, extent);
+            std::normal_distribution<float> offset_dist(0.0f, 12.0f);
+            std::vector<float3> centers(cluster_count);
+            for (float3& center : centers) {
+                center = make_float3(center_dist(rng), center_dist(rng) * 0.25f, center_dist(rng));
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                const float3& center = centers[i % cluster_count];
+                place(i, make_float3(
+                             center.x + offset_dist(rng),
+                             center.y + offset_dist(rng),
+                             center.z + offset_dist(rng)));
+            }
+            break;
+        }
+        case SceneLayout::City: {
+            // Towers of stacked floors on a street grid: wide in XZ, tall in Y.
+            constexpr uint32_t kFloorsPerTower = 48;
+            constexpr float kBlockSpacing = 16.0f;
+            constexpr float kFloorHeight = 3.5f;
+            const uint32_t tower_count = (count + kFloorsPerTower - 1) / kFloorsPerTower;
+            const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(tower_count))));
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t tower = i / kFloorsPerTower;
+                const uint32_t floor = i % kFloorsPerTower;
+                place(i, make_float3(
+                             static_cast<float>(tower % side) * kBlockSpacing,
+                             static_cast<float>(floor) * kFloorHeight,
+                             static_cast<float>(tower / side) * kBlockSpacing));
+            }
+            break;
+        }
+    }
+
+    LayoutExtent extent;
+    extent.center = bounds.center();
+    const float3 size = bounds.max - bounds.min;
+    extent.radius = std::max(1.0f, 0.5f * std::sqrt(dot(size, size)));
+    // City views sit low (street level); volumetric layouts are viewed from above.
+    extent.eye_height = layout == SceneLayout::City ? 1.8f - extent.center.y : 0.35f * extent.radius;
+    return extent;
+}
+
+struct CaseResult {
+    SceneLayout layout = SceneLayout::Uniform;
+    uint32_t entity_count = 0;
+    uint32_t cell_count = 0;
+    double avg_candidate_cells = 0.0;
+    double avg_visible_cells = 0.0;
+    double avg_visible_entities = 0.0;
+    double hot_bytes_per_entity = 0.0;
+    double cold_bytes_per_entity = 0.0;
+    StageStats build_grid;
+    StageStats refresh_bounds;
+    StageStats cull_grids;
+    StageStats cull_primitives;
+    StageStats cull_chunks;
+    StageStats populate_queues;
+    StageStats frame_total;
+};
+
+CaseResult run_case(
+    const BenchOptions& options,
+    enki::TaskScheduler& scheduler,
+    SceneLayout layout,
+    const std::vector<uint32_t>& pool,
+    uint32_t count,
+    RHIRenderPass& render_pass,
+    const std::vector<uint32_t>& pipeline_ids) {
+    CaseResult result;
+    result.layout = layout;
+    result.entity_count = count;
+
+    const LayoutExtent extent = layout_entities(layout, pool, count);
+
+    Scene scene;
+    scene.load_region(std::vector<uint32_t>(pool.begin(), pool.begin() + count));
+
+    std::vector<double> build_samples;
+    for (uint32_t i = 0; i < options.build_iterations; ++i) {
+        Clock clock;
+        scene.build_grid(options.cell_size);
+        build_samples.push_back(elapsed_ns(clock));
+    }
+    result.cell_count = scene.grid_cell_count();
+
+    Camera camera;
+    camera.set_aspect_ratio(16.0f / 9.0f);
+    camera.set_znear(0.1f);
+    camera.set_zfar(extent.radius * 1.5f);
+
+    RendererPrimitiveCullTask cull_task;
+    RendererPrimitiveCullTask chunk_cull_task;
+    std::vector<EntityChunkRange> cull_chunks;
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    std::vector<double> refresh_samples;
+    std::vector<double> grid_samples;
+    std::vector<double> cull_samples;
+    std::vector<double> chunk_cull_samples;
+    std::vector<double> populate_samples;
+    std::vector<double> total_samples;
+    uint64_t candidate_cells = 0;
+    uint64_t visible_cells = 0;
+    uint64_t visible_entities = 0;
+
+    for (uint32_t frame = 0; frame < options.frames; ++frame) {
+        // Orbit the scene so the visible set changes every frame.
+        const float angle = 2.0f * kPi * static_cast<float>(frame) / static_cast<float>(options.frames);
+        const float orbit = extent.radius * 0.8f;
+        camera.set_position({
+            extent.center.x + std::cos(angle) * orbit,
+            extent.center.y + extent.eye_height,
+            extent.center.z + std::sin(angle) * orbit,
+        });
+        camera.set_target({extent.center.x, extent.center.y, extent.center.z});
+        const math3d::Matrix4 view_projection = camera.get_projection_matrix() * camera.get_view_matrix();
+        const Frustum frustum(view_projection);
+
+        Clock frame_clock;
+
+        // Only the first frame after a re-layout rebuilds bounds; later frames measure the
+        // version scan over unchanged entities.
+        Clock refresh_clock;
+        ecs.refresh_world_bounds(scheduler);
+        refresh_samples.push_back(elapsed_ns(refresh_clock));
+
+        Clock grid_clock;
+        scene.cull_grids(frustum);
+        grid_samples.push_back(elapsed_ns(grid_clock));
+
+        Clock cull_clock;
+        cull_task.prepare(scene.primitive_count());
+        if (scene.visible_cell_count() > 0) {
+            cull_task.configure(&scene, &scene.visible_cell_indices(), scene.visible_cell_count(), &frustum, 1);
+            scheduler.AddTaskSetToPipe(&cull_task);
+            scheduler.WaitforTask(&cull_task);
+            cull_task.commit_visible_results();
+        } else {
+            cull_task.clear_visible_entity_indices();
+        }
+        cull_samples.push_back(elapsed_ns(cull_clock));
+
+        // The streaming mode the renderer switches to for wide views, timed on the same frustum.
+        Clock chunk_cull_clock;
+        cull_chunks.clear();
+        ecs.collect_chunks(kWorldBoundsComponentBit, cull_chunks);
+        chunk_cull_task.prepare(scene.primitive_count());
+        chunk_cull_task.configure_chunks(&scene, &cull_chunks, &frustum);
+        scheduler.AddTaskSetToPipe(&chunk_cull_task);
+        scheduler.WaitforTask(&chunk_cull_task);
+        chunk_cull_task.commit_visible_results();
+        chunk_cull_samples.push_back(elapsed_ns(chunk_cull_clock));
+
+        // Mirrors Renderer::populate_render_pass_queues; material / PSO lookups need a
+        // device, so draws are keyed over a fixed set of synthetic pipeline states.
+        Clock populate_clock;
+        const math3d::Vector3D& eye = camera.get_position();
+        const float3 camera_position = make_float3(eye[0], eye[1], eye[2]);
+        render_pass.clear_draw_packets();
+        for (uint32_t entity_index : cull_task.visible_entity_indices()) {
+            const uint32_t pipeline_id = pipeline_ids[entity_index % pipeline_ids.size()];
+            const float4& world_position = ecs.transform_component(entity_index).get_world_matrix()[3];
+            const float3 to_camera = make_float3(world_position.x, world_position.y, world_position.z) - camera_position;
+            render_pass.add_draw_packet(DrawPacket{
+                draw_sort_key::make(
+                    DrawBucket::Opaque,
+                    pipeline_id,
+                    entity_index % kSyntheticMaterialCount,
+                    0,
+                    0,
+                    draw_sort_key::quantize_depth(dot(to_camera, to_camera))),
+                entity_index,
+                pipeline_id});
+        }
+        sort_draw_packets(render_pass.draw_packets(), &scheduler);
+        populate_samples.push_back(elapsed_ns(populate_clock));
+
+        total_samples.push_back(elapsed_ns(frame_clock));
+
+        candidate_cells += scene.candidate_cell_count();
+        visible_cells += scene.visible_cell_count();
+        visible_entities += cull_task.visible_entity_indices().size();
+    }
+
+    const double frame_count = static_cast<double>(options.frames);
+    result.avg_candidate_cells = static_cast<double>(candidate_cells) / frame_count;
+    result.avg_visible_cells = static_cast<double>(visible_cells) / frame_count;
+    result.avg_visible_entities = static_cast<double>(visible_entities) / frame_count;
+    // Memory covers the whole entity pool, so normalize by pool size rather than case size.
+    const double pool_size = static_cast<double>(pool.size());
+    result.hot_bytes_per_entity = static_cast<double>(ecs.hot_memory_bytes()) / pool_size;
+    result.cold_bytes_per_entity = static_cast<double>(ecs.cold_memory_bytes()) / pool_size;
+    result.build_grid = summarize(std::move(build_samples), count);
+    result.refresh_bounds = summarize(std::move(refresh_samples), count);
+    result.cull_grids = summarize(std::move(grid_samples), count);
+    result.cull_primitives = summarize(std::move(cull_samples), count);
+    result.cull_chunks = summarize(std::move(chunk_cull_samples), count);
+    result.populate_queues = summarize(std::move(populate_samples), count);
+    result.frame_total = summarize(std::move(total_samples), count);
+    return result;
+}
+
+void print_case(const CaseResult& result) {
+    std::printf("[%s] %u entities, %u cells | candidates %.1f  visible cells %.1f  visible entities %.1f\n",
+                layout_name(result.layout),
+                result.entity_count,
+                result.cell_count,
+                result.avg_candidate_cells,
+                result.avg_visible_cells,
+                result.avg_visible_entities);
+    std::printf("  memory           hot %.1f B/entity  cold %.1f B/entity\n",
+                result.hot_bytes_per_entity,
+                result.cold_bytes_per_entity);
+    print_stage("build_grid", result.build_grid);
+    print_stage("refresh_bounds", result.refresh_bounds);
+    print_stage("cull_grids", result.cull_grids);
+    print_stage("cull_primitives", result.cull_primitives);
+    print_stage("cull_chunks", result.cull_chunks);
+    print_stage("populate_queues", result.populate_queues);
+    print_stage("frame_total", result.frame_total);
+}
+
+[[nodiscard]] nlohmann::json case_to_json(const CaseResult& result) {
+    return nlohmann::json{
+        {"scene", layout_name(result.layout)},
+        {"entities", result.entity_count},
+        {"cells", result.cell_count},
+        {"avg_candidate_cells", result.avg_candidate_cells},
+        {"avg_visible_cells", result.avg_visible_cells},
+        {"avg_visible_entities", result.avg_visible_entities},
+        {"hot_bytes_per_entity", result.hot_bytes_per_entity},
+        {"cold_bytes_per_entity", result.cold_bytes_per_entity},
+        {"stages", {
+            {"build_grid", stage_to_json(result.build_grid)},
+            {"refresh_bounds", stage_to_json(result.refresh_bounds)},
+            {"cull_grids", stage_to_json(result.cull_grids)},
+            {"cull_primitives", stage_to_json(result.cull_primitives)},
+            {"cull_chunks", stage_to_json(result.cull_chunks)},
+            {"populate_queues", stage_to_json(result.populate_queues)},
+            {"frame_total", stage_to_json(result.frame_total)},
+        }},
+    };
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    enki::TaskScheduler scheduler;
+    enki::TaskSchedulerConfig scheduler_config = scheduler.GetConfig();
+    if (options.threads > 0) {
+        scheduler_config.numTaskThreadsToCreate = options.threads - 1;
+    }
+    scheduler.Initialize(scheduler_config);
+
+    // One shared unit cube: bounds only, never uploaded.
+    Mesh* cube_mesh = ocarina::new_with_allocator<Mesh>();
+    cube_mesh->set_local_bounds(make_float3(-0.5f), make_float3(0.5f));
+
+    // A single pool sized for the largest case is re-laid-out per case instead of growing
+    // the ECS for every scene. Created in bulk and filled in parallel like a loader would.
+    const uint32_t max_count = *std::max_element(options.entity_counts.begin(), options.entity_counts.end());
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    const EntityBatch batch = ecs.create_entities(max_count);
+    PoolFillTask fill_task(batch, cube_mesh);
+    scheduler.AddTaskSetToPipe(&fill_task);
+    scheduler.WaitforTask(&fill_task);
+    ecs.commit_entities(batch);
+    std::vector<uint32_t> pool(max_count);
+    for (uint32_t i = 0; i < max_count; ++i) {
+        pool[i] = batch.entity_index(i);
+    }
+
+    std::vector<uint32_t> pipeline_ids;
+    for (uint32_t i = 0; i < kSyntheticPipelineCount; ++i) {
+        pipeline_ids.push_back(PipelineManager::instance().register_pipeline_state(
+            PipelineState::MakeGraphicsDefault(2 * i + 1, 2 * i + 2)));
+    }
+    RHIRenderPass render_pass(RenderPassCreation{});
+
+    std::printf("bench-culling: %u worker threads, %u frames, %u build iterations, cell size %.1f m\n",
+                scheduler.GetNumTaskThreads(),
+                options.frames,
+                options.build_iterations,
+                options.cell_size);
+
+    nlohmann::json cases = nlohmann::json::array();
+    for (SceneLayout layout : options.layouts) {
+        for (uint32_t count : options.entity_counts) {
+            const CaseResult result = run_case(options, scheduler, layout, pool, count, render_pass, pipeline_ids);
+            print_case(result);
+            cases.push_back(case_to_json(result));
+        }
+    }
+
+    if (!options.json_path.empty()) {
+        bench::write_json_report(options.json_path, nlohmann::json{
+            {"benchmark", "bench-culling"},
+            {"threads", scheduler.GetNumTaskThreads()},
+            {"frames", options.frames},
+            {"build_iterations", options.build_iterations},
+            {"cell_size", options.cell_size},
+            {"cases", std::move(cases)},
+        });
+    }
+
+    scheduler.WaitforAllAndShutdown();
+    ocarina::delete_with_allocator(cube_mesh);
+    return 0;
+}
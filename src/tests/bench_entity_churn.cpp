@@ -0,0 +1,199 @@
+//
+// Headless entity churn benchmark: streams entities into and out of a gridded scene at a
+// fixed rate and times creation, destruction, slot retirement and compaction. Verifies the
+// ECS stays bounded (slot count tracks the resident population, not the total ever created).
+//
+// Usage:
+//   bench-entity-churn [--rate=100000] [--resident=100000] [--fps=60] [--seconds=10]
+//                      [--compact-moves=1024] [--json=path]
+//
+
+#include "bench_common.h"
+#include "math/basic_types.h"
+#include "framework/entity_component_system.h"
+#include "framework/mesh.h"
+#include "framework/primitive.h"
+#include "framework/scene.h"
+
+#include <random>
+
+using namespace ocarina;
+using namespace ocarina::bench;
+
+namespace {
+
+struct ChurnOptions {
+    uint32_t rate = 100000;
+    uint32_t resident = 100000;
+    uint32_t fps = 60;
+    uint32_t seconds = 10;
+    uint32_t compact_moves = 1024;
+    std::string json_path;
+};
+
+[[nodiscard]] bool parse_options(int argc, char* argv[], ChurnOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string value = eq == std::string_view::npos ? std::string{} : std::string(arg.substr(eq + 1));
+
+        if (key == "--json") {
+            options.json_path = value;
+            continue;
+        }
+        if (value.empty()) {
+            std::fprintf(stderr, "option '%s' needs a value\n", argv[i]);
+            return false;
+        }
+        uint32_t number = 0;
+        if (!parse_uint(value, number)) {
+            std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+            return false;
+        }
+        if (key == "--rate") {
+            options.rate = number;
+        } else if (key == "--resident") {
+            options.resident = number;
+        } else if (key == "--fps") {
+            options.fps = std::max(1u, number);
+        } else if (key == "--seconds") {
+            options.seconds = std::max(1u, number);
+        } else if (key == "--compact-moves") {
+            options.compact_moves = number;
+        } else {
+            std::fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    ChurnOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    Mesh* cube_mesh = ocarina::new_with_allocator<Mesh>();
+    cube_mesh->set_local_bounds(make_float3(-0.5f), make_float3(0.5f));
+
+    std::mt19937 rng(0xc4u);
+    constexpr float kWorldExtent = 2000.0f;
+    std::uniform_real_distribution<float> position_dist(0.0f, kWorldExtent);
+
+    std::vector<uint32_t> batch;
+    auto create_batch = [&](Scene& scene, uint32_t count) {
+        batch.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t entity_index = ecs.emplace_primitive();
+            ecs.primitive(entity_index).set_mesh(cube_mesh);
+            ecs.transform_component(entity_index).set_position(
+                make_float3(position_dist(rng), position_dist(rng) * 0.1f, position_dist(rng)));
+            batch.push_back(entity_index);
+        }
+        scene.load_region(batch);
+    };
+
+    Scene scene;
+    create_batch(scene, options.resident);
+    scene.build_grid();
+
+    const uint32_t frame_count = options.fps * options.seconds;
+    const uint32_t per_frame = std::max(1u, options.rate / options.fps);
+
+    std::vector<double> create_samples;
+    std::vector<double> destroy_samples;
+    std::vector<double> advance_samples;
+    std::vector<double> compact_samples;
+    std::vector<EntityMove> moves;
+    std::vector<BufferCopyRange> upload_ranges;
+    uint64_t total_moves = 0;
+    uint64_t total_upload_bytes = 0;
+    uint32_t peak_slots = ecs.primitive_count();
+
+    for (uint32_t frame = 0; frame < frame_count; ++frame) {
+        Clock destroy_clock;
+        for (uint32_t i = 0; i < per_frame && scene.primitive_count() > 0; ++i) {
+            std::uniform_int_distribution<uint32_t> victim_dist(0, scene.primitive_count() - 1);
+            scene.destroy_entity(scene.entity_handle(victim_dist(rng)));
+        }
+        destroy_samples.push_back(elapsed_ns(destroy_clock));
+
+        Clock create_clock;
+        create_batch(scene, per_frame);
+        create_samples.push_back(elapsed_ns(create_clock));
+
+        Clock advance_clock;
+        ecs.advance_frame();
+        advance_samples.push_back(elapsed_ns(advance_clock));
+
+        if (options.compact_moves > 0) {
+            Clock compact_clock;
+            moves.clear();
+            ecs.compact(options.compact_moves, moves);
+            scene.apply_entity_moves(moves);
+            compact_samples.push_back(elapsed_ns(compact_clock));
+            total_moves += moves.size();
+        }
+
+        // Bytes FrameResources would copy into the transforms buffer this frame.
+        ecs.sync_gpu_transforms();
+        upload_ranges.clear();
+        total_upload_bytes += ecs.take_gpu_transform_upload_ranges(
+            upload_ranges, size_t{ecs.primitive_count()} * sizeof(GPUTransform));
+
+        peak_slots = std::max(peak_slots, ecs.primitive_count());
+    }
+    const double upload_bytes_per_frame = static_cast<double>(total_upload_bytes) / static_cast<double>(frame_count);
+
+    const StageStats create_stats = summarize(std::move(create_samples), per_frame);
+    const StageStats destroy_stats = summarize(std::move(destroy_samples), per_frame);
+    const StageStats advance_stats = summarize(std::move(advance_samples), per_frame);
+    const StageStats compact_stats = summarize(std::move(compact_samples), per_frame);
+
+    std::printf("bench-entity-churn: %u entities/s (%u per frame) for %u frames, resident %u\n",
+                options.rate, per_frame, frame_count, options.resident);
+    std::printf("  slots: peak %u  final %u  alive %u  retiring %u  free %u  moved %llu\n",
+                peak_slots,
+                ecs.primitive_count(),
+                ecs.alive_entity_count(),
+                ecs.retiring_slot_count(),
+                ecs.free_slot_count(),
+                static_cast<unsigned long long>(total_moves));
+    std::printf("  transform upload: %.1f KB/frame (full buffer %.1f KB)\n",
+                upload_bytes_per_frame / 1024.0,
+                static_cast<double>(ecs.primitive_count()) * sizeof(GPUTransform) / 1024.0);
+    print_stage("create", create_stats);
+    print_stage("destroy", destroy_stats);
+    print_stage("advance_frame", advance_stats);
+    if (options.compact_moves > 0) {
+        print_stage("compact", compact_stats);
+    }
+
+    write_json_report(options.json_path, nlohmann::json{
+        {"benchmark", "bench-entity-churn"},
+        {"rate", options.rate},
+        {"per_frame", per_frame},
+        {"frames", frame_count},
+        {"resident", options.resident},
+        {"compact_moves", options.compact_moves},
+        {"peak_slots", peak_slots},
+        {"final_slots", ecs.primitive_count()},
+        {"alive", ecs.alive_entity_count()},
+        {"moved", total_moves},
+        {"transform_upload_bytes_per_frame", upload_bytes_per_frame},
+        {"stages", {
+            {"create", stage_to_json(create_stats)},
+            {"destroy", stage_to_json(destroy_stats)},
+            {"advance_frame", stage_to_json(advance_stats)},
+            {"compact", stage_to_json(compact_stats)},
+        }},
+    });
+
+    ocarina::delete_with_allocator(cube_mesh);
+    return 0;
+}
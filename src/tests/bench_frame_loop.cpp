@@ -0,0 +1,358 @@
+//
+// Headless frame-loop benchmark: runs the full Renderer (async load, culling, sorting,
+// command recording, uploads) on the null backend, so the CPU cost of a frame is measured
+// without a GPU or a window. The scene is the cube grid of test-culling. Prints frame
+// time, draw-record time, frame latency and the commands of the last measured frame.
+//
+// Usage:
+//   bench-frame-loop [--frames=N] [--warmup=N] [--grid=N] [--indirect=0|1]
+//                    [--pipelined=0|1] [--culling=0|1] [--json=path] [--stats=path]
+//
+// --stats writes the Renderer's FrameStats window: per-frame rows for a .csv path, stage
+// percentiles otherwise. GPU pass timings stay empty here: the null backend has no timers.
+//
+
+#include "bench_common.h"
+#include "core/hash.h"
+#include "rhi/context.h"
+#include "rhi/renderpass.h"
+#include "rhi/bindless_sampler.h"
+#include "rhi/resources/texture_sampler.h"
+#include "framework/renderer.h"
+#include "framework/primitive.h"
+#include "framework/camera.h"
+#include "framework/resource_manager.h"
+#include "framework/material.h"
+#include "framework/async_loader.h"
+#include "framework/pipeline_compile_task.h"
+#include "framework/scene.h"
+#include "framework/mesh.h"
+#include "framework/internal_textures.h"
+#include "framework/bindless_texture_registry.h"
+
+#include <thread>
+
+using namespace ocarina;
+using namespace ocarina::bench;
+
+namespace {
+
+struct FrameLoopOptions {
+    uint32_t frames = 300;
+    uint32_t warmup = 30;
+    /// Cubes per side of the grid.
+    uint32_t grid = 50;
+    bool indirect = false;
+    bool pipelined = false;
+    bool culling = true;
+    std::string json_path;
+    std::string stats_path;
+};
+
+constexpr float kGridSpacing = 2.0f;
+
+[[nodiscard]] bool parse_options(int argc, char* argv[], FrameLoopOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string value = eq == std::string_view::npos ? std::string{} : std::string(arg.substr(eq + 1));
+
+        if (value.empty()) {
+            std::fprintf(stderr, "option '%s' needs a value\n", argv[i]);
+            return false;
+        }
+        if (key == "--frames") {
+            if (!parse_uint(value, options.frames)) {
+                std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+                return false;
+            }
+            options.frames = std::max(1u, options.frames);
+        } else if (key == "--warmup") {
+            if (!parse_uint(value, options.warmup)) {
+                std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+                return false;
+            }
+        } else if (key == "--grid") {
+            if (!parse_uint(value, options.grid)) {
+                std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+                return false;
+            }
+            options.grid = std::clamp(options.grid, 1u, 200u);
+        } else if (key == "--indirect") {
+            options.indirect = value != "0";
+        } else if (key == "--pipelined") {
+            options.pipelined = value != "0";
+        } else if (key == "--culling") {
+            options.culling = value != "0";
+        } else if (key == "--json") {
+            options.json_path = value;
+        } else if (key == "--stats") {
+            options.stats_path = value;
+        } else {
+            std::fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void apply_mesh_material_defaults(Material* material, const TextureHandle& albedo_handle) {
+    material->set_property("baseColorFactor", make_float4(1.f, 1.f, 1.f, 1.f));
+    material->set_property("roughness", 1.f);
+    material->set_property("metallic", 0.f);
+    material->set_property("ao", 1.f);
+    material->set_property("normalIndex", 0u);
+    material->set_property("normalSamplerIndex", 0u);
+    material->set_property("metallicRoughnessIndex", InvalidUI32);
+    material->set_property("metallicRoughnessSamplerIndex", 0u);
+    material->set_property("albedoIndex", albedo_handle);
+    material->set_property(
+        "albedoSamplerIndex",
+        get_bindless_sampler_index(
+            TextureSampler{TextureSampler::Filter::LINEAR_LINEAR, TextureSampler::Address::REPEAT}));
+}
+
+/// Sleeps until the device has ended @p target frames.
+void wait_for_frame(const Device& device, uint64_t target) {
+    while (device.frame_count() < target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+[[nodiscard]] nlohmann::json command_stats_to_json(const CommandStats& stats) {
+    return nlohmann::json{
+        {"command_buffers", stats.command_buffers},
+        {"secondary_command_buffers", stats.secondary_command_buffers},
+        {"render_passes", stats.render_passes},
+        {"pipeline_binds", stats.pipeline_binds},
+        {"descriptor_set_binds", stats.descriptor_set_binds},
+        {"vertex_buffer_binds", stats.vertex_buffer_binds},
+        {"index_buffer_binds", stats.index_buffer_binds},
+        {"push_constant_updates", stats.push_constant_updates},
+        {"push_constant_bytes", stats.push_constant_bytes},
+        {"draws", stats.draws},
+        {"drawn_indices", stats.drawn_indices},
+        {"indirect_draws", stats.indirect_draws},
+        {"buffer_copies", stats.buffer_copies},
+        {"buffer_copy_bytes", stats.buffer_copy_bytes},
+        {"texture_copies", stats.texture_copies},
+        {"texture_transitions", stats.texture_transitions},
+    };
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    FrameLoopOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+    const uint32_t total_cubes = options.grid * options.grid * options.grid;
+
+    RHIContext& context = RHIContext::instance();
+    context.parse_command_line(argc, argv);
+
+    InstanceCreation instance_creation{};
+    instance_creation.applicationName = "bench-frame-loop";
+    instance_creation.windowWidth = 1280;
+    instance_creation.windowHeight = 720;
+    Device device = context.create_device("null", instance_creation);
+
+    const fs::path source_dir = fs::path(__FILE__).parent_path();
+    const fs::path project_root = source_dir.parent_path().parent_path();
+    const fs::path shader_vert = project_root / "res/shaderlibrary/builtin/mesh.vert";
+    const fs::path shader_frag = project_root / "res/shaderlibrary/builtin/mesh.frag";
+
+    Material* material = nullptr;
+    Mesh* cube_mesh = nullptr;
+    Scene* scene = nullptr;
+
+    Renderer renderer(&device);
+
+    std::vector<PipelineCompileTask::Entry> pipeline_entries;
+    pipeline_entries.push_back(PipelineCompileTask::Entry::make_graphics(
+        fs::absolute(shader_vert).string(),
+        fs::absolute(shader_frag).string()));
+
+    AsyncLoader async_loader(
+        &renderer.task_scheduler(),
+        &device,
+        &pipeline_entries,
+        [&](Device* load_device) {
+        material = ResourceManager::instance().create_material(
+            load_device,
+            pipeline_entries[0].vertex_shader(),
+            pipeline_entries[0].pixel_shader());
+        cube_mesh = Mesh::create_cube();
+        apply_mesh_material_defaults(material, InternalTextures::instance().get_white_texture_handle(load_device));
+
+        scene = ocarina::new_with_allocator<Scene>();
+        scene->reserve_primitives(total_cubes);
+        for (uint32_t height = 0; height < options.grid; ++height) {
+            for (uint32_t row = 0; row < options.grid; ++row) {
+                for (uint32_t col = 0; col < options.grid; ++col) {
+                    Primitive& primitive = scene->emplace_primitive();
+                    const uint32_t primitive_index = scene->primitive_count() - 1;
+                    scene->transform_component(primitive_index).set_position(make_float3(
+                        static_cast<float>(col) * kGridSpacing,
+                        static_cast<float>(height) * kGridSpacing,
+                        static_cast<float>(row) * kGridSpacing));
+                    primitive.set_mesh(cube_mesh);
+                    primitive.set_material(material);
+                }
+            }
+        }
+        scene->build_grid();
+    });
+
+    // Same view as test-culling, scaled to the grid: roughly half the cubes are visible.
+    const float extent = static_cast<float>(options.grid) * kGridSpacing;
+    Camera camera;
+    camera.set_aspect_ratio(1280.0f / 720.0f);
+    camera.set_znear(0.1f);
+    camera.set_zfar(2000.0f);
+    camera.set_position({-0.8f * extent, 1.2f * extent, -0.8f * extent});
+    camera.set_target({extent - 1.0f, extent - 1.0f, extent - 1.0f});
+
+    const uint64_t model_matrix_name_id = hash64("modelMatrix");
+    const uint64_t model_matrix_inverse_name_id = hash64("modelMatrixInverse");
+    auto update_push_constant = [&](Primitive& primitive, TransformComponent& transform) {
+        const float4x4 world_matrix = transform.get_world_matrix();
+        const float4x4 world_matrix_inverse = inverse(world_matrix);
+        primitive.set_push_constant_variable(
+            model_matrix_name_id,
+            reinterpret_cast<std::byte*>(const_cast<float4x4*>(&world_matrix)),
+            sizeof(world_matrix));
+        primitive.set_push_constant_variable(
+            model_matrix_inverse_name_id,
+            reinterpret_cast<std::byte*>(const_cast<float4x4*>(&world_matrix_inverse)),
+            sizeof(world_matrix_inverse));
+    };
+
+    RenderPassCreation render_pass_creation;
+    RHIRenderPass* render_pass = device.create_render_pass(render_pass_creation);
+
+    renderer.set_camera(&camera);
+    renderer.set_frustum_culling_enabled(options.culling);
+    renderer.set_indirect_drawing_enabled(options.indirect);
+    renderer.set_frame_pipeline_depth(options.pipelined ? Renderer::kMaxFramePipelineDepth : 1);
+    renderer.pass_group(PassGroupId::UI).add_render_pass(render_pass);
+
+    std::atomic<bool> scene_ready{false};
+    renderer.set_async_loader(&async_loader, nullptr, [&]() {
+        if (scene == nullptr) {
+            return;
+        }
+        for (uint32_t index = 0; index < scene->primitive_count(); ++index) {
+            Primitive& primitive = scene->primitive(index);
+            primitive.set_update_push_constant_function(update_push_constant);
+            primitive.set_geometry_data_setup(&device, [&](Primitive& prim) {
+                (void)prim;
+            });
+        }
+        renderer.set_scene(scene);
+        scene_ready.store(true, std::memory_order_release);
+    });
+    renderer.set_render_task_end_callback([&]() {
+        if (scene != nullptr) {
+            ocarina::delete_with_allocator<Scene>(scene);
+            scene = nullptr;
+        }
+        InternalTextures::instance().cleanup();
+    });
+
+    Clock load_clock;
+    renderer.run();
+    while (!scene_ready.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const double load_ms = load_clock.elapse_ms();
+
+    wait_for_frame(device, device.frame_count() + options.warmup + 1);
+    renderer.frame_stats().reset();
+
+    std::vector<double> record_samples_ns;
+    std::vector<double> latency_samples_ns;
+    record_samples_ns.reserve(options.frames);
+    latency_samples_ns.reserve(options.frames);
+    const uint64_t first_frame = device.frame_count();
+    Clock clock;
+    for (uint64_t frame = first_frame + 1; frame <= first_frame + options.frames; ++frame) {
+        wait_for_frame(device, frame);
+        record_samples_ns.push_back(renderer.draw_record_cpu_ms() * 1e6);
+        latency_samples_ns.push_back(renderer.frame_latency_ms() * 1e6);
+    }
+    const double frames_ms = clock.elapse_ms();
+    const uint64_t measured_frames = device.frame_count() - first_frame;
+    const CommandStats commands = device.last_frame_command_stats();
+    const uint64_t visible_triangles = renderer.visible_triangle_count();
+
+    renderer.shutdown();
+
+    const FrameStats& frame_stats = renderer.frame_stats();
+    if (!options.stats_path.empty()) {
+        const fs::path stats_path = options.stats_path;
+        (void)(stats_path.extension() == ".csv" ? frame_stats.write_csv(stats_path) : frame_stats.write_json(stats_path));
+    }
+
+    const double frame_ms = frames_ms / static_cast<double>(std::max<uint64_t>(measured_frames, 1));
+    const StageStats record = summarize(std::move(record_samples_ns), total_cubes);
+    const StageStats latency = summarize(std::move(latency_samples_ns), total_cubes);
+
+    std::printf("bench-frame-loop: %u cubes, %u frames, indirect %s, pipelined %s, culling %s\n",
+                total_cubes,
+                options.frames,
+                options.indirect ? "on" : "off",
+                options.pipelined ? "on" : "off",
+                options.culling ? "on" : "off");
+    std::printf("  load %.1f ms, frame %.3f ms (%.1f fps), %llu visible triangles\n",
+                load_ms,
+                frame_ms,
+                frame_ms > 0.0 ? 1000.0 / frame_ms : 0.0,
+                static_cast<unsigned long long>(visible_triangles));
+    print_stage("draw record", record);
+    print_stage("frame latency", latency);
+    std::printf("  stages (p50 / p95 ms):");
+    for (size_t stage = 0; stage < kFrameStageCount; ++stage) {
+        const FrameTimeSummary summary = frame_stats.stage_summary(static_cast<FrameStage>(stage));
+        std::printf(" %s %.3f / %.3f", frame_stage_name(static_cast<FrameStage>(stage)), summary.p50_ms, summary.p95_ms);
+    }
+    std::printf("\n");
+    if (device.supports_gpu_timers()) {
+        std::printf("  gpu pass groups (p50 / p95 ms):");
+        for (size_t group = 0; group < kPassGroupCount; ++group) {
+            const FrameTimeSummary summary = frame_stats.gpu_group_summary(static_cast<PassGroupId>(group));
+            std::printf(" %s %.3f / %.3f", pass_group_id_name(static_cast<PassGroupId>(group)), summary.p50_ms, summary.p95_ms);
+        }
+        std::printf("\n");
+    }
+    std::printf("  last frame: %u command buffers (%u secondary), %u passes, %u pipeline binds, "
+                "%u draws (%llu indices), %u indirect draws, %u buffer copies (%llu bytes)\n",
+                commands.command_buffers,
+                commands.secondary_command_buffers,
+                commands.render_passes,
+                commands.pipeline_binds,
+                commands.draws,
+                static_cast<unsigned long long>(commands.drawn_indices),
+                commands.indirect_draws,
+                commands.buffer_copies,
+                static_cast<unsigned long long>(commands.buffer_copy_bytes));
+
+    write_json_report(options.json_path, nlohmann::json{
+        {"benchmark", "bench-frame-loop"},
+        {"cubes", total_cubes},
+        {"frames", measured_frames},
+        {"indirect", options.indirect},
+        {"pipelined", options.pipelined},
+        {"culling", options.culling},
+        {"load_ms", load_ms},
+        {"frame_ms", frame_ms},
+        {"visible_triangles", visible_triangles},
+        {"draw_record", stage_to_json(record)},
+        {"frame_latency", stage_to_json(latency)},
+        {"gpu_timers", device.supports_gpu_timers()},
+        {"last_frame_commands", command_stats_to_json(commands)},
+    });
+    return 0;
+}
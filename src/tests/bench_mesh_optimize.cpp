@@ -0,0 +1,244 @@
+//
+// Headless index optimization report: runs the load-time mesh pipeline (meshlets for
+// large meshes, LODs, vertex cache / overdraw / vertex fetch optimization) on procedural
+// meshes or the shapes of an OBJ file and prints the FIFO vertex cache ACMR and ATVR of
+// each base level as authored and after optimization. Checks that every mesh still has
+// the same triangles.
+//
+// Usage:
+//   bench-mesh-optimize [--obj=path] [--resolution=N] [--cache=N] [--json=path]
+//
+
+#include "bench_common.h"
+#include "framework/global_gpu_storage.h"
+#include "framework/mesh_optimizer.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <array>
+#include <random>
+
+using namespace ocarina;
+using namespace ocarina::bench;
+
+namespace {
+
+struct OptimizeOptions {
+    std::string obj_path;
+    /// Quads per side of the procedural meshes.
+    uint32_t resolution = 120;
+    uint32_t cache_size = kVertexCacheSize;
+    std::string json_path;
+};
+
+struct NamedMesh {
+    std::string name;
+    OwnedMeshGeometry geometry;
+};
+
+[[nodiscard]] bool parse_options(int argc, char* argv[], OptimizeOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string value = eq == std::string_view::npos ? std::string{} : std::string(arg.substr(eq + 1));
+
+        if (value.empty()) {
+            std::fprintf(stderr, "option '%s' needs a value\n", argv[i]);
+            return false;
+        }
+        if (key == "--obj") {
+            options.obj_path = value;
+        } else if (key == "--json") {
+            options.json_path = value;
+        } else if (key == "--resolution") {
+            if (!parse_uint(value, options.resolution)) {
+                std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+                return false;
+            }
+            options.resolution = std::clamp(options.resolution, 2u, 2048u);
+        } else if (key == "--cache") {
+            if (!parse_uint(value, options.cache_size)) {
+                std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+                return false;
+            }
+            options.cache_size = std::max(3u, options.cache_size);
+        } else {
+            std::fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Row-by-row grid, the order most procedural generators (and Mesh::create_sphere()) emit.
+[[nodiscard]] OwnedMeshGeometry make_grid(uint32_t resolution, bool wrap_to_sphere) {
+    OwnedMeshGeometry geometry;
+    for (uint32_t row = 0; row <= resolution; ++row) {
+        for (uint32_t column = 0; column <= resolution; ++column) {
+            const float u = static_cast<float>(column) / static_cast<float>(resolution);
+            const float v = static_cast<float>(row) / static_cast<float>(resolution);
+            Vector3 position(u * 2.0f - 1.0f, 0.0f, v * 2.0f - 1.0f);
+            if (wrap_to_sphere) {
+                const float theta = u * 6.2831853f;
+                const float phi = v * 3.1415927f;
+                position = Vector3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+            }
+            geometry.positions.push_back(position);
+            geometry.uvs.emplace_back(u, v);
+        }
+    }
+    for (uint32_t row = 0; row < resolution; ++row) {
+        for (uint32_t column = 0; column < resolution; ++column) {
+            const uint32_t first = row * (resolution + 1) + column;
+            const uint32_t second = first + resolution + 1;
+            geometry.indices.insert(geometry.indices.end(), {first, second, first + 1});
+            geometry.indices.insert(geometry.indices.end(), {second, second + 1, first + 1});
+        }
+    }
+    return geometry;
+}
+
+/// Triangles in random order: the worst case, e.g. exporters that sort by material.
+void shuffle_triangles(OwnedMeshGeometry& geometry) {
+    const uint32_t triangle_count = static_cast<uint32_t>(geometry.indices.size() / 3);
+    std::vector<uint32_t> order(triangle_count);
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        order[triangle] = triangle;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(0x5eedu));
+    std::vector<uint32_t> shuffled;
+    shuffled.reserve(geometry.indices.size());
+    for (uint32_t triangle : order) {
+        shuffled.insert(shuffled.end(), geometry.indices.begin() + triangle * 3, geometry.indices.begin() + triangle * 3 + 3);
+    }
+    geometry.indices = std::move(shuffled);
+}
+
+/// One position-only mesh per OBJ shape.
+[[nodiscard]] bool load_obj(const std::string& path, std::vector<NamedMesh>& meshes) {
+    tinyobj::ObjReader reader;
+    if (!reader.ParseFromFile(path)) {
+        std::fprintf(stderr, "failed to load '%s': %s\n", path.c_str(), reader.Error().c_str());
+        return false;
+    }
+    const tinyobj::attrib_t& attrib = reader.GetAttrib();
+    for (const tinyobj::shape_t& shape : reader.GetShapes()) {
+        NamedMesh mesh;
+        mesh.name = shape.name.empty() ? "shape" : shape.name;
+        std::unordered_map<int, uint32_t> vertex_of;
+        for (const tinyobj::index_t& index : shape.mesh.indices) {
+            auto [it, inserted] = vertex_of.try_emplace(index.vertex_index, static_cast<uint32_t>(mesh.geometry.positions.size()));
+            if (inserted) {
+                const float* position = &attrib.vertices[3 * index.vertex_index];
+                mesh.geometry.positions.emplace_back(position[0], position[1], position[2]);
+            }
+            mesh.geometry.indices.push_back(it->second);
+        }
+        meshes.push_back(std::move(mesh));
+    }
+    return true;
+}
+
+/// Winding-preserving canonical triangles (rotated to start at the smallest corner), sorted.
+[[nodiscard]] std::vector<std::array<float, 9>> canonical_triangles(const OwnedMeshGeometry& geometry) {
+    std::vector<std::array<float, 9>> triangles;
+    for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+        std::array<float, 9> best{};
+        for (uint32_t rotation = 0; rotation < 3; ++rotation) {
+            std::array<float, 9> candidate{};
+            for (uint32_t k = 0; k < 3; ++k) {
+                const Vector3& p = geometry.positions[geometry.indices[i + (k + rotation) % 3]];
+                candidate[k * 3 + 0] = p.x;
+                candidate[k * 3 + 1] = p.y;
+                candidate[k * 3 + 2] = p.z;
+            }
+            if (rotation == 0 || candidate < best) {
+                best = candidate;
+            }
+        }
+        triangles.push_back(best);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+[[nodiscard]] VertexCacheStats cache_stats(const OwnedMeshGeometry& geometry, uint32_t cache_size) {
+    MeshGeometryInput input{};
+    input.vertex_count = static_cast<uint32_t>(geometry.positions.size());
+    input.indices = geometry.indices.data();
+    input.index_count = static_cast<uint32_t>(geometry.indices.size());
+    return analyze_vertex_cache(input, cache_size);
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    OptimizeOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<NamedMesh> meshes;
+    if (!options.obj_path.empty()) {
+        if (!load_obj(options.obj_path, meshes)) {
+            return 1;
+        }
+    } else {
+        meshes.push_back(NamedMesh{"grid", make_grid(options.resolution, false)});
+        meshes.push_back(NamedMesh{"sphere", make_grid(options.resolution, true)});
+        NamedMesh shuffled{"shuffled_sphere", make_grid(options.resolution, true)};
+        shuffle_triangles(shuffled.geometry);
+        meshes.push_back(std::move(shuffled));
+    }
+
+    std::printf("bench-mesh-optimize: %zu meshes, %u-entry FIFO cache\n", meshes.size(), options.cache_size);
+    std::printf("  %-24s %9s %9s %14s %14s %10s\n", "mesh", "triangles", "meshlets", "ACMR", "ATVR", "ms");
+
+    bool triangles_match = true;
+    nlohmann::json mesh_reports = nlohmann::json::array();
+    for (NamedMesh& mesh : meshes) {
+        const VertexCacheStats before = cache_stats(mesh.geometry, options.cache_size);
+        const std::vector<std::array<float, 9>> authored = canonical_triangles(mesh.geometry);
+
+        // Same steps and order as GltfAsyncLoader::upload_pending_meshes().
+        Clock clock;
+        build_mesh_meshlets(mesh.geometry);
+        build_mesh_lods(mesh.geometry);
+        optimize_mesh(mesh.geometry);
+        const double optimize_ms = elapsed_ns(clock) * 1e-6;
+
+        const VertexCacheStats after = cache_stats(mesh.geometry, options.cache_size);
+        const bool match = canonical_triangles(mesh.geometry) == authored;
+        triangles_match = triangles_match && match;
+        std::printf("  %-24s %9zu %9zu %6.3f->%5.3f %6.3f->%5.3f %10.3f%s\n",
+                    mesh.name.c_str(),
+                    mesh.geometry.indices.size() / 3,
+                    mesh.geometry.meshlets.size(),
+                    before.acmr,
+                    after.acmr,
+                    before.atvr,
+                    after.atvr,
+                    optimize_ms,
+                    match ? "" : "  TRIANGLES CHANGED");
+        mesh_reports.push_back(nlohmann::json{
+            {"name", mesh.name},
+            {"triangles", mesh.geometry.indices.size() / 3},
+            {"meshlets", mesh.geometry.meshlets.size()},
+            {"acmr_before", before.acmr},
+            {"acmr_after", after.acmr},
+            {"atvr_before", before.atvr},
+            {"atvr_after", after.atvr},
+            {"optimize_ms", optimize_ms},
+            {"triangles_match", match},
+        });
+    }
+
+    write_json_report(options.json_path, nlohmann::json{
+        {"benchmark", "bench-mesh-optimize"},
+        {"cache_size", options.cache_size},
+        {"meshes", mesh_reports},
+    });
+    return triangles_match ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+//
+// Headless transform hierarchy benchmark: builds an N-node tree of ECS entities and times
+// level-ordered world-matrix propagation for a full-tree change, random subtree changes,
+// leaf-only changes and an idle frame. Checks propagated matrices against a serial
+// reference walk of the parent chain.
+//
+// Usage:
+//   bench-transform-hierarchy [--nodes=100000] [--fanout=4] [--frames=200]
+//                             [--dirty=1000] [--threads=N] [--json=path]
+//
+
+#include "bench_common.h"
+#include "math/basic_types.h"
+#include "framework/entity_component_system.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+#include <random>
+
+using namespace ocarina;
+using namespace ocarina::bench;
+
+namespace {
+
+struct HierarchyOptions {
+    uint32_t nodes = 100000;
+    uint32_t fanout = 4;
+    uint32_t frames = 200;
+    /// Nodes whose local transform changes per frame in the subtree / leaf stages.
+    uint32_t dirty = 1000;
+    uint32_t threads = 0;
+    std::string json_path;
+};
+
+[[nodiscard]] bool parse_options(int argc, char* argv[], HierarchyOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string value = eq == std::string_view::npos ? std::string{} : std::string(arg.substr(eq + 1));
+
+        if (key == "--json") {
+            options.json_path = value;
+            continue;
+        }
+        if (value.empty()) {
+            std::fprintf(stderr, "option '%s' needs a value\n", argv[i]);
+            return false;
+        }
+        uint32_t number = 0;
+        if (!parse_uint(value, number)) {
+            std::fprintf(stderr, "invalid value in '%s'\n", argv[i]);
+            return false;
+        }
+        if (key == "--nodes") {
+            options.nodes = std::max(2u, number);
+        } else if (key == "--fanout") {
+            options.fanout = std::max(1u, number);
+        } else if (key == "--frames") {
+            options.frames = std::max(1u, number);
+        } else if (key == "--dirty") {
+            options.dirty = number;
+        } else if (key == "--threads") {
+            options.threads = number;
+        } else {
+            std::fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Serial reference: multiply local matrices up the parent chain.
+[[nodiscard]] float4x4 reference_world_matrix(const EntityComponentSystem& ecs, uint32_t entity_index) {
+    float4x4 world = ecs.transform_component(entity_index).get_local_matrix();
+    for (uint32_t parent = ecs.parent(entity_index); parent != InvalidUI32; parent = ecs.parent(parent)) {
+        world = ecs.transform_component(parent).get_local_matrix() * world;
+    }
+    return world;
+}
+
+[[nodiscard]] float max_abs_difference(const float4x4& lhs, const float4x4& rhs) {
+    float difference = 0.0f;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            difference = std::max(difference, std::abs(lhs[column][row] - rhs[column][row]));
+        }
+    }
+    return difference;
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    HierarchyOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    enki::TaskScheduler scheduler;
+    enki::TaskSchedulerConfig scheduler_config = scheduler.GetConfig();
+    if (options.threads > 0) {
+        scheduler_config.numTaskThreadsToCreate = options.threads - 1;
+    }
+    scheduler.Initialize(scheduler_config);
+
+    EntityComponentSystem& ecs = EntityComponentSystem::instance();
+    std::mt19937 rng(0x7a11u);
+    std::uniform_real_distribution<float> offset_dist(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> angle_dist(-0.5f, 0.5f);
+
+    auto random_rotation = [&]() {
+        const float half_angle = angle_dist(rng);
+        return quaternion(0.0f, std::sin(half_angle), 0.0f, std::cos(half_angle));
+    };
+
+    // Complete fanout-ary tree in creation order: node i's parent is (i - 1) / fanout.
+    Clock build_clock;
+    std::vector<uint32_t> entities;
+    entities.reserve(options.nodes);
+    for (uint32_t i = 0; i < options.nodes; ++i) {
+        const uint32_t entity_index = ecs.emplace_primitive();
+        TransformComponent& transform = ecs.transform_component(entity_index);
+        transform.set_position(make_float3(offset_dist(rng), offset_dist(rng), offset_dist(rng)));
+        transform.set_rotation(random_rotation());
+        entities.push_back(entity_index);
+        if (i > 0) {
+            ecs.set_parent(entity_index, entities[(i - 1) / options.fanout]);
+        }
+    }
+    ecs.propagate_transforms(&scheduler);
+    ecs.sync_gpu_transforms(&scheduler);
+    const double build_ns = elapsed_ns(build_clock);
+
+    const TransformHierarchy& hierarchy = ecs.transform_hierarchy();
+    const uint32_t first_leaf = options.nodes > 1 ? (options.nodes - 2) / options.fanout + 1 : 0;
+    std::uniform_int_distribution<uint32_t> node_dist(0, options.nodes - 1);
+    std::uniform_int_distribution<uint32_t> leaf_dist(first_leaf, options.nodes - 1);
+
+    auto run_stage = [&](auto&& touch) {
+        std::vector<double> samples;
+        samples.reserve(options.frames);
+        for (uint32_t frame = 0; frame < options.frames; ++frame) {
+            touch();
+            Clock clock;
+            ecs.propagate_transforms(&scheduler);
+            samples.push_back(elapsed_ns(clock));
+            // Drain the GPU sync queue outside the timed region so stages stay independent.
+            ecs.sync_gpu_transforms(&scheduler);
+        }
+        return samples;
+    };
+
+    const StageStats full_stats = summarize(run_stage([&] {
+        ecs.transform_component(entities[0]).set_rotation(random_rotation());
+    }), options.nodes);
+    const StageStats subtree_stats = summarize(run_stage([&] {
+        for (uint32_t i = 0; i < options.dirty; ++i) {
+            ecs.transform_component(entities[node_dist(rng)]).set_rotation(random_rotation());
+        }
+    }), options.nodes);
+    const StageStats leaf_stats = summarize(run_stage([&] {
+        for (uint32_t i = 0; i < options.dirty; ++i) {
+            ecs.transform_component(entities[leaf_dist(rng)]).set_rotation(random_rotation());
+        }
+    }), options.nodes);
+    const StageStats idle_stats = summarize(run_stage([] {}), options.nodes);
+
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < 1024; ++i) {
+        const uint32_t entity_index = entities[node_dist(rng)];
+        max_error = std::max(max_error, max_abs_difference(
+            ecs.transform_component(entity_index).get_world_matrix(),
+            reference_world_matrix(ecs, entity_index)));
+    }
+
+    std::printf("bench-transform-hierarchy: %u nodes, fanout %u, %u levels, %u dirty/frame, %u threads\n",
+                hierarchy.node_count(),
+                options.fanout,
+                hierarchy.level_count(),
+                options.dirty,
+                scheduler.GetNumTaskThreads());
+    std::printf("  build %.3f ms  max error vs reference %.3g\n", build_ns * 1e-6, max_error);
+    print_stage("full_tree", full_stats);
+    print_stage("subtrees", subtree_stats);
+    print_stage("leaves", leaf_stats);
+    print_stage("idle", idle_stats);
+
+    write_json_report(options.json_path, nlohmann::json{
+        {"benchmark", "bench-transform-hierarchy"},
+        {"nodes", hierarchy.node_count()},
+        {"fanout", options.fanout},
+        {"levels", hierarchy.level_count()},
+        {"dirty", options.dirty},
+        {"threads", scheduler.GetNumTaskThreads()},
+        {"build_ms", build_ns * 1e-6},
+        {"max_error", max_error},
+        {"stages", {
+            {"full_tree", stage_to_json(full_stats)},
+            {"subtrees", stage_to_json(subtree_stats)},
+            {"leaves", stage_to_json(leaf_stats)},
+            {"idle", stage_to_json(idle_stats)},
+        }},
+    });
+
+    scheduler.WaitforAllAndShutdown();
+    return max_error < 1e-3f ? 0 : 1;
+}
@@ -155,6 +155,8 @@ int main(int argc, char* argv[]) {
     RHIRenderPass* render_pass = device.create_render_pass(render_pass_creation);
 
     bool frustum_culling_enabled = true;
+    bool indirect_drawing_enabled = false;
+    bool pipelined_frames = false;
 
     renderer.set_camera(&camera);
     renderer.set_frustum_culling_enabled(frustum_culling_enabled);
@@ -169,20 +171,29 @@ int main(int argc, char* argv[]) {
     frame_info.extra = [&](Widgets& widgets) {
         widgets.check_box("Frustum culling", &frustum_culling_enabled);
         renderer.set_frustum_culling_enabled(frustum_culling_enabled);
-        if (scene != nullptr) {
+        // Compare "Draw record CPU" with and without multi-draw-indirect batching.
+        widgets.check_box("Indirect draws", &indirect_drawing_enabled);
+        renderer.set_indirect_drawing_enabled(indirect_drawing_enabled);
+        // Compare "Frame latency" and FPS with culling overlapped with recording.
+        widgets.check_box("Pipelined frames", &pipelined_frames);
+        renderer.set_frame_pipeline_depth(pipelined_frames ? Renderer::kMaxFramePipelineDepth : 1);
+        // When pipelined, workers cull the next frame into the grids while this UI records.
+        if (scene != nullptr && renderer.frame_pipeline_depth() == 1) {
             widgets.text("Total grids: %u", scene->grid_cell_count());
+            widgets.text("Candidate grids: %u", scene->candidate_cell_count());
             widgets.text("Visible grids: %u", scene->visible_grid_count());
             const auto& visible_grids = scene->visible_grid_indices();
             const uint32_t sample_count = std::min(scene->visible_grid_count(), 12u);
             for (uint32_t i = 0; i < sample_count; ++i) {
-                const uint32_t flat = visible_grids[i];
-                const auto [cx, cz] = scene->grid_cell_coords(flat);
+                const uint32_t cell_slot = visible_grids[i];
+                const SceneCellCoord coord = scene->grid_cell_coords(cell_slot);
                 widgets.text(
-                    "Grid[%u] cell=(%d,%d) prim=%u",
-                    flat,
-                    cx,
-                    cz,
-                    scene->grid_cell_entity_count(flat));
+                    "Grid[%u] cell=(%d,%d,%d) prim=%u",
+                    cell_slot,
+                    coord.x,
+                    coord.y,
+                    coord.z,
+                    scene->grid_cell_entity_count(cell_slot));
             }
             widgets.text(
                 "Culling: %s",
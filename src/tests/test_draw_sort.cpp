@@ -0,0 +1,151 @@
+//
+// Headless check of sort_draw_packets(): every result must match std::stable_sort on the
+// sort keys, on the calling thread and on the block-parallel path, for packet counts
+// around kParallelDrawSortMinPackets. Returns non-zero on the first mismatch.
+//
+
+#include "core/stl.h"
+#include "framework/draw_sort_key.h"
+#include "rhi/renderpass.h"
+#include "ext/enkiTS/src/TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+
+using namespace ocarina;
+
+namespace {
+
+enum class KeyPattern {
+    /// Full 64-bit random keys: every radix pass runs.
+    Random,
+    /// Few distinct keys, so stability decides most of the order.
+    Duplicates,
+    /// Realistic keys from draw_sort_key::make(), leaving some bytes constant.
+    DrawKeys,
+};
+
+const char* key_pattern_name(KeyPattern pattern) noexcept {
+    switch (pattern) {
+        case KeyPattern::Random: return "random";
+        case KeyPattern::Duplicates: return "duplicates";
+        case KeyPattern::DrawKeys: return "draw-keys";
+    }
+    return "?";
+}
+
+std::vector<DrawPacket> make_packets(uint32_t count, KeyPattern pattern, std::mt19937_64& rng) {
+    std::vector<DrawPacket> packets(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        DrawPacket& packet = packets[i];
+        // The original position identifies the packet, so stability is checked too.
+        packet.entity_index = i;
+        switch (pattern) {
+            case KeyPattern::Random:
+                packet.sort_key = rng();
+                break;
+            case KeyPattern::Duplicates:
+                packet.sort_key = (rng() % 7) << 40;
+                break;
+            case KeyPattern::DrawKeys: {
+                const auto bucket = (rng() & 3) == 0 ? DrawBucket::Blended : DrawBucket::Opaque;
+                packet.sort_key = draw_sort_key::make(bucket,
+                                                      static_cast<uint32_t>(rng() % 8),
+                                                      static_cast<uint32_t>(rng() % 64),
+                                                      static_cast<uint32_t>(rng() % 4),
+                                                      static_cast<uint32_t>(rng() % 4),
+                                                      draw_sort_key::quantize_depth(static_cast<float>(rng() % 10000)));
+                break;
+            }
+        }
+        packet.pipeline_id = static_cast<uint32_t>(packet.sort_key);
+    }
+    return packets;
+}
+
+bool check_sort(uint32_t count, KeyPattern pattern, enki::TaskScheduler* scheduler, std::mt19937_64& rng) {
+    std::vector<DrawPacket> packets = make_packets(count, pattern, rng);
+    std::vector<DrawPacket> expected = packets;
+    std::stable_sort(expected.begin(), expected.end(), [](const DrawPacket& lhs, const DrawPacket& rhs) {
+        return lhs.sort_key < rhs.sort_key;
+    });
+
+    sort_draw_packets(packets, scheduler);
+
+    const char* path = scheduler != nullptr ? "parallel" : "serial";
+    if (packets.size() != expected.size()) {
+        printf("FAIL %s %s count=%u: size %zu, expected %zu\n",
+               key_pattern_name(pattern), path, count, packets.size(), expected.size());
+        return false;
+    }
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (packets[i].sort_key != expected[i].sort_key || packets[i].entity_index != expected[i].entity_index ||
+            packets[i].pipeline_id != expected[i].pipeline_id) {
+            printf("FAIL %s %s count=%u: packet %zu is entity %u, expected %u\n",
+                   key_pattern_name(pattern), path, count, i, packets[i].entity_index, expected[i].entity_index);
+            return false;
+        }
+    }
+    return true;
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    enki::TaskScheduler scheduler;
+    scheduler.Initialize();
+
+    // Below, at and above the parallel threshold, plus partial trailing blocks.
+    const uint32_t counts[] = {
+        0u, 1u, 2u, 3u, 1000u,
+        kParallelDrawSortMinPackets - 1,
+        kParallelDrawSortMinPackets,
+        kParallelDrawSortMinPackets + 1,
+        3 * kParallelDrawSortMinPackets + 4097,
+    };
+    const KeyPattern patterns[] = {KeyPattern::Random, KeyPattern::Duplicates, KeyPattern::DrawKeys};
+
+    std::mt19937_64 rng(0x5eed5eedull);
+    uint32_t failures = 0;
+    uint32_t checks = 0;
+    for (uint32_t count : counts) {
+        for (KeyPattern pattern : patterns) {
+            for (enki::TaskScheduler* task_scheduler : {static_cast<enki::TaskScheduler*>(nullptr), &scheduler}) {
+                ++checks;
+                if (!check_sort(count, pattern, task_scheduler, rng)) {
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    // Sorting from several threads at once exercises the per-thread scratch buffers.
+    struct ConcurrentSortTask : public enki::ITaskSet {
+        enki::TaskScheduler* scheduler = nullptr;
+        std::atomic<uint32_t> failures{0};
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override {
+            for (uint32_t i = range.start; i < range.end; ++i) {
+                std::mt19937_64 task_rng(0x1234ull + i * 7919ull + threadnum);
+                if (!check_sort(2 * kParallelDrawSortMinPackets + i, KeyPattern::DrawKeys, scheduler, task_rng)) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    } concurrent_task;
+    concurrent_task.scheduler = &scheduler;
+    concurrent_task.m_SetSize = 8;
+    concurrent_task.m_MinRange = 1;
+    scheduler.AddTaskSetToPipe(&concurrent_task);
+    scheduler.WaitforTask(&concurrent_task);
+    checks += concurrent_task.m_SetSize;
+    failures += concurrent_task.failures.load();
+
+    scheduler.WaitforAllAndShutdown();
+    printf("%u/%u draw sort checks passed\n", checks - failures, checks);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+//
+// Headless check of the DynamicResolution controller: fed synthetic GPU frame times, it
+// must hold inside the hysteresis band, wait settle_frames between changes, snap to
+// scale_step, stay within [min_scale, max_scale] and keep pass extents, uv_transform()
+// and scale_version() in step with the scale. Returns non-zero if any check fails.
+//
+
+#include "core/stl.h"
+#include "framework/dynamic_resolution.h"
+#include "rhi/renderpass.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace ocarina;
+
+namespace {
+
+/// Offscreen pass without a device: one color slot marks it offscreen, nothing is bound.
+class HeadlessRenderPass : public RHIRenderPass {
+public:
+    explicit HeadlessRenderPass(uint2 size)
+        : RHIRenderPass(RenderPassCreation{}) {
+        size_ = size;
+        color_attachment_count_ = 1;
+    }
+};
+
+constexpr double kTargetMs = 10.0;
+
+uint32_t g_failures = 0;
+uint32_t g_checks = 0;
+
+void check(bool condition, const char* what) {
+    ++g_checks;
+    if (!condition) {
+        ++g_failures;
+        printf("FAIL %s\n", what);
+    }
+}
+
+DynamicResolutionSettings make_settings() {
+    DynamicResolutionSettings settings;
+    settings.target_gpu_ms = kTargetMs;
+    settings.min_scale = 0.5f;
+    settings.max_scale = 1.0f;
+    settings.settle_frames = 4;
+    settings.scale_step = 0.05f;
+    return settings;
+}
+
+bool on_step(float scale, const DynamicResolutionSettings& settings) {
+    const float steps = scale / settings.scale_step;
+    return std::abs(steps - std::round(steps)) < 1e-3f || scale == settings.min_scale || scale == settings.max_scale;
+}
+
+void check_pass_follows(const DynamicResolution& controller, const HeadlessRenderPass& pass, const char* what) {
+    const float scale = controller.scale();
+    const uint2 size = pass.size();
+    const uint2 expected = scale < 1.0f
+                               ? uint2{static_cast<uint32_t>(std::lround(size.x * scale)),
+                                       static_cast<uint32_t>(std::lround(size.y * scale))}
+                               : size;
+    const uint2 extent = pass.render_extent();
+    check(extent.x == expected.x && extent.y == expected.y, what);
+
+    const float4 uv = DynamicResolution::uv_transform(&pass);
+    check(std::abs(uv.x - static_cast<float>(extent.x) / size.x) < 1e-6f &&
+              std::abs(uv.y - static_cast<float>(extent.y) / size.y) < 1e-6f &&
+              uv.z < uv.x && uv.w < uv.y,
+          "uv_transform() covers the rendered corner");
+}
+
+void test_disabled_holds_full_scale() {
+    DynamicResolution controller;
+    controller.set_settings(make_settings());
+    for (int frame = 0; frame < 16; ++frame) {
+        check(!controller.update(kTargetMs * 3.0), "disabled controller never changes");
+    }
+    check(controller.scale() == 1.0f, "disabled controller stays at full scale");
+    check(controller.scale_version() == 0, "disabled controller keeps its scale version");
+}
+
+void test_settle_snap_and_version() {
+    HeadlessRenderPass pass({1920, 1080});
+    DynamicResolution controller;
+    controller.set_settings(make_settings());
+    controller.add_render_pass(&pass);
+    controller.set_enabled(true);
+
+    // Far over budget: the first change waits for settle_frames updates.
+    const DynamicResolutionSettings& settings = controller.settings();
+    uint32_t frame = 1;
+    for (; frame < settings.settle_frames; ++frame) {
+        check(!controller.update(kTargetMs * 2.0), "no change before settle_frames");
+    }
+    check(controller.update(kTargetMs * 2.0), "over budget lowers the scale after settle_frames");
+    check(controller.scale() < 1.0f, "scale dropped");
+    check(on_step(controller.scale(), settings), "scale snaps to scale_step");
+    check(controller.scale_version() == 1, "a scale change bumps scale_version()");
+    check_pass_follows(controller, pass, "pass extent follows the lowered scale");
+
+    // Held for settle_frames again, even though the load stays high.
+    const float lowered = controller.scale();
+    for (frame = 1; frame < settings.settle_frames; ++frame) {
+        check(!controller.update(kTargetMs * 2.0), "no second change within settle_frames");
+    }
+    check(controller.scale() == lowered, "scale held while settling");
+    check(controller.scale_version() == 1, "no version bump while settling");
+}
+
+void test_clamps() {
+    HeadlessRenderPass pass({1280, 720});
+    DynamicResolution controller;
+    controller.set_settings(make_settings());
+    controller.add_render_pass(&pass);
+    controller.set_enabled(true);
+    const DynamicResolutionSettings& settings = controller.settings();
+
+    for (int frame = 0; frame < 200; ++frame) {
+        controller.update(kTargetMs * 10.0);
+        check(controller.scale() >= settings.min_scale, "scale never drops below min_scale");
+    }
+    check(controller.scale() == settings.min_scale, "sustained overload settles at min_scale");
+    check_pass_follows(controller, pass, "pass extent at min_scale");
+
+    for (int frame = 0; frame < 400; ++frame) {
+        controller.update(kTargetMs * 0.1);
+        check(controller.scale() <= settings.max_scale, "scale never rises above max_scale");
+    }
+    check(controller.scale() == settings.max_scale, "sustained headroom returns to max_scale");
+    check_pass_follows(controller, pass, "pass extent at max_scale");
+
+    // Out-of-range settings are clamped on the way in.
+    DynamicResolutionSettings wild = make_settings();
+    wild.min_scale = 0.0f;
+    wild.max_scale = 4.0f;
+    wild.scale_step = 0.0f;
+    controller.set_settings(wild);
+    check(controller.settings().min_scale > 0.0f, "min_scale clamped above zero");
+    check(controller.settings().max_scale == 1.0f, "max_scale clamped to 1");
+    check(controller.settings().scale_step > 0.0f, "scale_step clamped above zero");
+}
+
+void test_hysteresis_band() {
+    HeadlessRenderPass pass({1920, 1080});
+    DynamicResolution controller;
+    controller.set_settings(make_settings());
+    controller.add_render_pass(&pass);
+    controller.set_enabled(true);
+    const DynamicResolutionSettings& settings = controller.settings();
+
+    for (int frame = 0; frame < 64 && controller.scale() >= 0.8f; ++frame) {
+        controller.update(kTargetMs * 1.5);
+    }
+    const float lowered = controller.scale();
+    const uint32_t version = controller.scale_version();
+    check(lowered < 1.0f, "controller lowered the scale before the band test");
+
+    // Just over the target (inside downscale_threshold) and a little under it (inside
+    // upscale_headroom): a frame time hovering at the target must not move the scale.
+    const double inside_over = kTargetMs * (1.0 + settings.downscale_threshold * 0.5);
+    const double inside_under = kTargetMs * (1.0 - settings.upscale_headroom * 0.5);
+    for (int frame = 0; frame < 100; ++frame) {
+        check(!controller.update(frame % 2 == 0 ? inside_over : inside_under), "no change inside the hysteresis band");
+    }
+    check(controller.scale() == lowered, "scale held inside the hysteresis band");
+    check(controller.scale_version() == version, "no version bump inside the hysteresis band");
+
+    // No GPU timing holds the scale as well.
+    for (int frame = 0; frame < 16; ++frame) {
+        check(!controller.update(0.0), "missing GPU time holds the scale");
+    }
+
+    // Disabling returns to full size at once.
+    controller.set_enabled(false);
+    check(controller.update(kTargetMs * 2.0), "disabling restores full scale");
+    check(controller.scale() == 1.0f, "disabled scale is 1");
+    check(controller.scale_version() == version + 1, "restoring full scale bumps the version");
+    check_pass_follows(controller, pass, "pass extent back at full size");
+    check(!controller.update(kTargetMs * 2.0), "disabled controller stays put");
+
+    controller.remove_render_pass(&pass);
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    test_disabled_holds_full_scale();
+    test_settle_snap_and_version();
+    test_clamps();
+    test_hysteresis_band();
+    printf("%u/%u dynamic resolution checks passed\n", g_checks - g_failures, g_checks);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -56,9 +56,18 @@ int main(int argc, char* argv[]) {
     renderer.set_loading_progress_listener(&loading_progress);
 
     std::vector<PipelineCompileTask::Entry> pipeline_entries;
+    // --quantized uploads the scene as 20-byte quantized vertices instead of 48-byte floats.
+    const bool quantized_vertices = std::any_of(argv + 1, argv + argc, [](const char* arg) {
+        return string_view(arg) == "--quantized";
+    });
+    std::set<string> vertex_options;
+    if (quantized_vertices) {
+        vertex_options.insert(kQuantizedVertexDefine);
+    }
     pipeline_entries.push_back(PipelineCompileTask::Entry::make_graphics(
         fs::absolute(shader_vert).string(),
-        fs::absolute(shader_frag).string()));
+        fs::absolute(shader_frag).string(),
+        std::move(vertex_options)));
 
     GltfAsyncLoader gltf_loader(
         &renderer.task_scheduler(),
@@ -94,6 +103,15 @@ int main(int argc, char* argv[]) {
     frame_info.renderer = &renderer;
     frame_info.device = &device;
     frame_info.window_title = window_name;
+    bool lod_selection_enabled = renderer.lod_selection_enabled();
+    bool cluster_culling_enabled = renderer.cluster_culling_enabled();
+    frame_info.extra = [&](Widgets& widgets) {
+        // Compare "Visible triangles" and FPS with and without the simplified mesh levels.
+        widgets.check_box("Mesh LODs", &lod_selection_enabled);
+        renderer.set_lod_selection_enabled(lod_selection_enabled);
+        widgets.check_box("Cluster culling", &cluster_culling_enabled);
+        renderer.set_cluster_culling_enabled(cluster_culling_enabled);
+    };
     window->widgets()->set_frame_info_context(&frame_info);
     imgui_renderer.set_frame_callback([&]() {
         display_loading_progress(*window->widgets(), &loading_progress, renderer.dt());
@@ -2,6 +2,8 @@
 // Offscreen render target test using Vulkan dynamic rendering (vkCmdBeginRendering).
 // Pass 1: render a colored triangle to an offscreen texture (white clear) via ECS entity draw call.
 // Pass 2: blit result to swapchain via a textured fullscreen quad from the scene.
+// Dynamic resolution steers the offscreen pass's render scale from the GPU frame time and
+// the quad upscales the rendered corner (toggle in the frame info window).
 //
 
 #include "core/stl.h"
@@ -26,6 +28,7 @@
 #include "framework/mesh.h"
 #include "framework/resource_manager.h"
 #include "framework/material.h"
+#include "framework/draw_sort_key.h"
 #include "framework/async_loader.h"
 #include "framework/pipeline_compile_task.h"
 #include "framework/frame_resources.h"
@@ -87,16 +90,16 @@ int main(int argc, char *argv[]) {
     const fs::path project_root = source_dir.parent_path().parent_path();
     const fs::path triangle_vert = project_root / "res/shaderlibrary/builtin/triangle.vert";
     const fs::path triangle_frag = project_root / "res/shaderlibrary/builtin/triangle.frag";
-    const fs::path texture_vert = project_root / "res/shaderlibrary/builtin/texture.vert";
-    const fs::path texture_frag = project_root / "res/shaderlibrary/builtin/texture.frag";
+    const fs::path upscale_vert = project_root / "res/shaderlibrary/builtin/upscale.vert";
+    const fs::path upscale_frag = project_root / "res/shaderlibrary/builtin/upscale.frag";
 
     std::vector<PipelineCompileTask::Entry> pipeline_entries;
     pipeline_entries.push_back(PipelineCompileTask::Entry::make_graphics(
         fs::absolute(triangle_vert).string(),
         fs::absolute(triangle_frag).string()));
     pipeline_entries.push_back(PipelineCompileTask::Entry::make_graphics(
-        fs::absolute(texture_vert).string(),
-        fs::absolute(texture_frag).string()));
+        fs::absolute(upscale_vert).string(),
+        fs::absolute(upscale_frag).string()));
 
     const TextureUsageFlags offscreen_usage = static_cast<TextureUsageFlags>(
         static_cast<uint32_t>(TextureUsageFlags::RenderTarget) | static_cast<uint32_t>(TextureUsageFlags::ShaderReadOnly));
@@ -144,13 +147,15 @@ int main(int argc, char *argv[]) {
     camera.set_target({0.0f, 0.0f, 0.0f});
 
     const uint64_t model_matrix_name_id = hash64("modelMatrix");
-    const uint64_t model_matrix_inverse_name_id = hash64("modelMatrixInverse");
+    const uint64_t uv_transform_name_id = hash64("uvTransform");
 
     RenderPassCreation offscreen_pass_creation;
     offscreen_pass_creation.color_attachment_count = 1;
     offscreen_pass_creation.color_attachments[0] = offscreen_color;
     offscreen_pass_creation.clear_color = make_float4(1.0f, 1.0f, 1.0f, 1.0f);
     RHIRenderPass* offscreen_pass = device.create_render_pass(offscreen_pass_creation);
+    renderer.dynamic_resolution().add_render_pass(offscreen_pass);
+    renderer.dynamic_resolution().set_enabled(true);
 
     RenderPassCreation swapchain_pass_creation;
     swapchain_pass_creation.swapchain_clear_color = make_float4(0.1f, 0.1f, 0.1f, 1.0f);
@@ -193,24 +198,24 @@ int main(int argc, char *argv[]) {
         Primitive& triangle = ecs.primitive(triangle_entity_index);
 
         triangle.set_update_push_constant_function([&](Primitive& primitive, TransformComponent& transform) {
+            const float4x4 world_matrix = transform.get_world_matrix();
             primitive.set_push_constant_variable(
                 model_matrix_name_id,
-                reinterpret_cast<std::byte*>(const_cast<void*>(static_cast<const void*>(&transform.get_world_matrix()))),
-                sizeof(transform.get_world_matrix()));
+                reinterpret_cast<const std::byte*>(&world_matrix),
+                sizeof(world_matrix));
         });
 
         quad.set_update_push_constant_function([&](Primitive& primitive, TransformComponent& transform) {
-            const float4x4 world_matrix = transform.get_world_matrix();
-            const float4x4 world_matrix_inverse = inverse(world_matrix);
-            primitive.set_push_constant_variable(
-                model_matrix_name_id,
-                reinterpret_cast<std::byte*>(const_cast<float4x4*>(&world_matrix)),
-                sizeof(world_matrix));
+            (void)transform;
+            // The offscreen pass renders only its scaled corner; sample just that.
+            const float4 uv_transform = DynamicResolution::uv_transform(offscreen_pass);
             primitive.set_push_constant_variable(
-                model_matrix_inverse_name_id,
-                reinterpret_cast<std::byte*>(const_cast<float4x4*>(&world_matrix_inverse)),
-                sizeof(world_matrix_inverse));
+                uv_transform_name_id,
+                reinterpret_cast<std::byte*>(const_cast<float4*>(&uv_transform)),
+                sizeof(uv_transform));
         });
+        // The quad never moves; the scale version alone triggers the refresh.
+        quad.set_push_constant_version_source(renderer.dynamic_resolution().scale_version_source());
 
         triangle.set_geometry_data_setup(&device, [&](Primitive& primitive) {
             setup_offscreen_triangle(primitive);
@@ -224,9 +229,11 @@ int main(int argc, char *argv[]) {
             &device,
             ecs.render_component(triangle_entity_index),
             ecs.transform_component(triangle_entity_index));
-        offscreen_pass->add_draw_call(
+        const uint32_t triangle_pipeline_id = triangle_material->pipeline_state_id();
+        offscreen_pass->add_draw_packet(DrawPacket{
+            draw_sort_key::make(DrawBucket::Opaque, triangle_pipeline_id, triangle_material->material_id(), 0, 0, 0),
             triangle_entity_index,
-            triangle_material->get_pipeline_state());
+            triangle_pipeline_id});
 
         imgui_renderer.set_frame_callback([&]() {
             display_frame_info(*window->widgets());
@@ -105,10 +105,11 @@ int main(int argc, char *argv[]) {
 
     uint64_t model_matrix_name_id = hash64("modelMatrix");
     auto update_push_constant = [&](Primitive& primitive, TransformComponent& transform) {
+        const float4x4 world_matrix = transform.get_world_matrix();
         primitive.set_push_constant_variable(
             model_matrix_name_id,
-            reinterpret_cast<std::byte*>(const_cast<void*>(static_cast<const void*>(&transform.get_world_matrix()))),
-            sizeof(transform.get_world_matrix()));
+            reinterpret_cast<const std::byte*>(&world_matrix),
+            sizeof(world_matrix));
     };
 
     triangle.set_update_push_constant_function(update_push_constant);